@@ -17,15 +17,24 @@
 
 #include <atomic>
 #include <array>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
 
 #include <boost/intrusive_ptr.hpp>
 #include <folly/small_vector.h>
+#include <folly/futures/Future.h>
 #include <iomgr/fiber_lib.hpp>
+#include <iomgr/iomgr.hpp>
 
 #include "btree_req.hpp"
 #include "btree_kv.hpp"
 #include <homestore/btree/detail/btree_internal.hpp>
 #include <homestore/btree/detail/btree_node.hpp>
+#include <homestore/btree/detail/btree_epoch.hpp>
+#include <homestore/btree/detail/btree_msg_buffer.hpp>
 
 SISL_LOGGING_DECL(btree)
 
@@ -37,10 +46,26 @@ struct BtreeThreadVariables {
     std::vector< btree_locked_node_info > wr_locked_nodes;
     std::vector< btree_locked_node_info > rd_locked_nodes;
     BtreeNodePtr force_split_node{nullptr};
+
+    // Single key write in flight, in a btree with subtree counts
+    int64_t count_delta{0}; // Change in entries it made to the leaf, yet to be applied to the counts on its path
 };
 
+template < typename K, typename V >
+class BtreeBulkLoader;
+
+template < typename K, typename V >
+class BtreeCursor;
+
+template < typename K, typename V >
+class BtreeParallelScan;
+
 template < typename K, typename V >
 class Btree {
+    friend class BtreeBulkLoader< K, V >;
+    friend class BtreeCursor< K, V >;
+    friend class BtreeParallelScan< K, V >;
+
 private:
     mutable iomgr::FiberManagerLib::shared_mutex m_btree_lock;
     BtreeLinkInfo m_root_node_info;
@@ -53,6 +78,38 @@ private:
     std::atomic< uint64_t > m_req_id{0};
 #endif
 
+    // Nodes freed while optimistic readers are in flight. A freed node is released only after all the optimistic
+    // readers which entered before it was freed, and hence could have picked up a stale link to it, have finished.
+    mutable EpochReclaimer< BtreeNodePtr > m_node_reclaimer;
+    static constexpr uint32_t max_optimistic_read_attempts = 4;
+
+    // Background destroy creates these many subtrees per fiber to balance the skew and frees nodes in these batches
+    static constexpr uint32_t destroy_subtrees_per_fiber = 4;
+    static constexpr uint32_t destroy_batch_size = 1024;
+
+    // Orders the keys the btree keeps aside, such as the deferred merges, in the order of the keys in the btree
+    struct key_less {
+        bool operator()(K const& a, K const& b) const { return a.compare(b) < 0; }
+    };
+
+    // Running number of entries added by the multi key writes to a btree with subtree counts, which are applied one at
+    // a time under exclusive m_btree_lock. Interior nodes adjust the count of a child by how much this moved within it.
+    int64_t m_subtree_delta{0};
+
+    // A key within each underfull leaf whose merge is deferred by the removes, till rebalance() merges it
+    mutable std::mutex m_merge_mtx;
+    std::set< K, key_less > m_deferred_merges;
+
+    // Roots of the subtrees unlinked by the range removes and their level, yet to be freed once the remove is done
+    std::mutex m_dropped_mtx;
+    std::vector< std::pair< bnodeid_t, uint16_t > > m_dropped_subtrees;
+    std::atomic< uint64_t > m_drop_gen{0}; // Bumped whenever subtrees are dropped, for cursors to reposition from root
+
+    // With buffered messages, held shared by the single key writes which add messages to the buffers and exclusive by
+    // the operations which need all the messages flushed down to the leaves first (see btree_buffer_impl.ipp)
+    mutable iomgr::FiberManagerLib::shared_mutex m_msg_lock;
+    std::atomic< bool > m_msgs_buffered{false}; // Could any buffer have messages, cleared once all are flushed
+
     // This workaround of BtreeThreadVariables is needed instead of directly declaring statics
     // to overcome the gcc bug, pointer here: https://gcc.gnu.org/bugzilla/show_bug.cgi?id=66944
     static BtreeThreadVariables* bt_thread_vars() {
@@ -63,11 +120,11 @@ private:
         return fiber_map[this_id].get();
     }
 
-    static bool is_repair_needed(const BtreeNodePtr& child_node, const BtreeLinkInfo& child_info);
-
 protected:
     BtreeConfig m_bt_cfg;
 
+    static bool is_repair_needed(const BtreeNodePtr& child_node, const BtreeLinkInfo& child_info);
+
 public:
     /////////////////////////////////////// All External APIs /////////////////////////////
     Btree(const BtreeConfig& cfg);
@@ -85,12 +142,52 @@ public:
 
     btree_status_t query(BtreeQueryRequest< K >& query_req, std::vector< std::pair< K, V > >& out_values) const;
 
+    /// @brief Applies the merges of the underfull leaves deferred by the removes, in deferred merge mode. Each merge
+    /// locks only the nodes on the path to its leaf, hence rebalance can run in background along with other operations.
+    ///
+    /// @param context Operation context the merged nodes are written with
+    /// @param max_merges Upto these many deferred merges are applied, 0 to apply all of them
+    btree_status_t rebalance(void* context, uint32_t max_merges = 0);
+    bool is_merge_deferred() const { return (m_bt_cfg.m_max_deferred_merges != 0); }
+    uint64_t deferred_merges_count() const;
+
+    /// @brief Counts the entries within the range from the subtree counts kept in the interior nodes, reading only the
+    /// nodes on the paths to both the ends of the range, instead of the leaves within.
+    ///
+    /// @return btree_status_t::success, btree_status_t::not_supported if the btree doesn't keep subtree counts
+    btree_status_t range_count(BtreeKeyRange< K > const& range, uint64_t& count, void* context = nullptr) const;
+
+    /// @brief Counts all the entries in the btree, reading only the nodes on the path to the last entry
+    btree_status_t total_count(uint64_t& count, void* context = nullptr) const;
+
+    /// @brief Finds the nth entry (0 based) in the key order, reading only the nodes on the path to it
+    ///
+    /// @return btree_status_t::success, btree_status_t::not_found if there are n or less entries in the btree,
+    /// btree_status_t::not_supported if the btree doesn't keep subtree counts
+    btree_status_t get_nth_entry(uint64_t n, K& out_key, V* out_val = nullptr, void* context = nullptr) const;
+    bool is_subtree_counted() const { return m_bt_cfg.m_subtree_counts_turned_on; }
+
+    /// @brief Whether the interior nodes buffer the single key writes, which are flushed down in batches
+    bool is_msg_buffered() const { return (m_bt_cfg.m_msg_buffer_size != 0); }
+
     // bool verify_tree(bool update_debug_bm) const;
     virtual std::pair< btree_status_t, uint64_t > destroy_btree(void* context);
+
+    /// @brief Destroys the btree in the background, walking the subtrees under root in parallel on the given fibers or
+    /// on the calling fiber if none are given. Leaf nodes are freed without being read, only the interior nodes are
+    /// read to find their children, and nodes are freed in batches through free_node_ids_impl(). With blink splits,
+    /// the leaves are read as well to find the splits not yet linked to their parent. Caller must ensure there are no
+    /// other operations on the btree once destroy is issued.
+    ///
+    /// @return Future of the status and the number of nodes freed
+    folly::Future< std::pair< btree_status_t, uint64_t > >
+    destroy_btree_async(std::vector< iomgr::io_fiber_t > const& fibers);
     nlohmann::json get_status(int log_level) const;
 
     void print_tree(const std::string& file = "") const;
     void print_tree_keys() const;
+    uint64_t get_btree_node_cnt() const;
+    uint64_t allocated_node_cnt() const { return m_total_nodes.load(); } // Nodes allocated and not yet freed
 
     nlohmann::json get_metrics_in_json(bool updated = true);
     bnodeid_t root_node_id() const;
@@ -109,6 +206,7 @@ protected:
     virtual btree_status_t write_node_impl(const BtreeNodePtr& node, void* context) = 0;
     virtual btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const = 0;
     virtual void free_node_impl(const BtreeNodePtr& node, void* context) = 0;
+    virtual void free_node_ids_impl(std::vector< bnodeid_t > const& node_ids);
     virtual btree_status_t prepare_node_txn(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
                                             void* context) = 0;
     virtual btree_status_t transact_write_nodes(const folly::small_vector< BtreeNodePtr, 3 >& new_nodes,
@@ -116,7 +214,24 @@ protected:
                                                 void* context) = 0;
 
     virtual std::string btree_store_type() const = 0;
-    virtual void update_new_root_info(bnodeid_t root_node, uint64_t version) = 0;
+    virtual void update_new_root_info(bnodeid_t root_node, uint64_t version, void* context) = 0;
+
+    // Runs the freeing of the subtrees dropped by range removes. Store which has fibers of its own to spare runs it in
+    // the background, by default they are freed on the calling fiber after the remove is done.
+    virtual void run_subtree_free(std::function< void() > free_fn) { free_fn(); }
+
+    // Looks up the node only if it is in memory already, never reading it from the device. Store which can't look up
+    // a node that cheaply doesn't support it, in which case the lookup is skipped where it is only an optimization.
+    virtual btree_status_t peek_node_impl(bnodeid_t id, BtreeNodePtr& node) const {
+        return btree_status_t::not_supported;
+    }
+
+    // Resolves the node id to the node object without referencing it, for the optimistic readers, which keep the node
+    // alive through the epoch of m_node_reclaimer instead. Store which can't resolve a node that cheaply doesn't
+    // support it, in which case the optimistic reads fall back to the lock coupled traversal.
+    virtual btree_status_t peek_node_unref_impl(bnodeid_t id, BtreeNode*& node) const {
+        return btree_status_t::not_supported;
+    }
 
     /////////////////////////// Methods the application use case is expected to handle ///////////////////////////
 
@@ -137,10 +252,22 @@ protected:
                                            locktype_t leaf_lock_type, void* context) const;
     btree_status_t upgrade_node_locks(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
                                       locktype_t parent_cur_lock, locktype_t child_cur_lock, void* context);
+    btree_status_t promote_node_locks(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
+                                      locktype_t child_cur_lock, void* context);
     btree_status_t upgrade_node(const BtreeNodePtr& node, locktype_t prev_lock, void* context, uint64_t prev_gen);
     btree_status_t _lock_node(const BtreeNodePtr& node, locktype_t type, void* context, const char* fname,
                               int line) const;
     void unlock_node(const BtreeNodePtr& node, locktype_t type) const;
+    template < typename ReqT >
+    btree_status_t upgrade_lock_leaf_parent(const BtreeNodePtr& node, locktype_t& cur_lock, ReqT& req);
+    btree_status_t move_to_split_sibling(BtreeNodePtr& child_node, BtreeLinkInfo& child_info, BtreeKey const& key,
+                                         void* context, K* skipped_last_key = nullptr) const;
+    btree_status_t optimistic_find_leaf(BtreeKey const& key, BtreeNodePtr& leaf_node, void* context) const;
+    btree_status_t optimistic_descend(BtreeKey const& key, BtreeNode*& leaf_node, uint64_t& leaf_version) const;
+    btree_status_t optimistic_lock_leaf(BtreeNodePtr const& leaf_node, uint64_t leaf_version, void* context) const;
+    btree_status_t optimistic_get(BtreeSingleGetRequest& greq) const;
+    void retire_node(const BtreeNodePtr& node);
+    void release_retired_nodes() const;
 
     std::pair< btree_status_t, uint64_t > do_destroy();
     void observe_lock_time(const BtreeNodePtr& node, locktype_t type, uint64_t time_spent) const;
@@ -158,8 +285,15 @@ protected:
     btree_status_t post_order_traversal(locktype_t acq_lock, const auto& cb);
     btree_status_t post_order_traversal(const BtreeNodePtr& node, locktype_t acq_lock, const auto& cb);
     void get_all_kvs(std::vector< std::pair< K, V > >& kvs) const;
+    btree_status_t for_each_key(std::function< bool(K const&) > const& cb) const;
     btree_status_t do_destroy(uint64_t& n_freed_nodes, void* context);
-    uint64_t get_btree_node_cnt() const;
+    btree_status_t collect_destroy_subtrees(uint32_t min_subtrees, std::vector< bnodeid_t >& subtree_ids,
+                                            uint16_t& subtree_level, std::vector< bnodeid_t >& upper_ids);
+    btree_status_t destroy_subtree(bnodeid_t id, uint16_t level, std::vector< bnodeid_t >& batch,
+                                   std::atomic< uint64_t >& n_freed);
+    void free_destroyed_nodes(std::vector< bnodeid_t >& batch, std::atomic< uint64_t >& n_freed);
+    static void get_child_ids(const BtreeNodePtr& node, std::vector< bnodeid_t >& child_ids);
+    btree_status_t get_unlinked_split_ids(const BtreeNodePtr& node, std::vector< bnodeid_t >& split_ids) const;
     uint64_t get_child_node_cnt(bnodeid_t bnodeid) const;
     void to_string(bnodeid_t bnodeid, std::string& buf) const;
     void to_string_keys(bnodeid_t bnodeid, std::string& buf) const;
@@ -171,7 +305,58 @@ protected:
 
     //////////////////////////////// Impl Methods //////////////////////////////////////////
 
+    ///////// Subtree Count Impl Methods
+    template < typename ReqT >
+    static constexpr bool is_single_key_write() {
+        return std::is_same_v< ReqT, BtreeSinglePutRequest > || std::is_same_v< ReqT, BtreeSingleRemoveRequest >;
+    }
+    // Multi key writes adjust the counts on their path as they unwind, holding the path and the btree for write
+    template < typename ReqT >
+    bool is_counted_on_unwind() const {
+        return is_subtree_counted() && !is_single_key_write< ReqT >();
+    }
+    void lock_for_write(bool exclusive) const;
+    void unlock_for_write(bool exclusive) const;
+    template < typename ReqT >
+    locktype_t interior_write_lock() const {
+        return is_counted_on_unwind< ReqT >() ? locktype_t::WRITE : locktype_t::READ;
+    }
+    uint32_t link_size() const;
+    BtreeLinkInfo child_link(BtreeLinkInfo link, uint64_t subtree_count = 0) const;
+    uint64_t subtree_count(const BtreeNodePtr& node) const;
+    uint64_t children_count(const BtreeNodePtr& node, uint32_t start_idx, uint32_t end_idx) const;
+    void set_child_count(const BtreeNodePtr& parent_node, uint32_t idx, const BtreeNodePtr& child_node) const;
+    void update_child_count(const BtreeNodePtr& node, uint32_t idx, int64_t delta, void* context);
+    btree_status_t count_upto(K const* key, bool inclusive, uint64_t& count, void* context) const;
+    btree_status_t count_path_side(BtreeNodePtr& node, BtreeKeyRange< K > const& range, bool start_side,
+                                   uint64_t& count, void* context) const;
+    void begin_leaf_count();
+    template < typename ReqT >
+    void count_leaf_change(int64_t delta);
+    void end_leaf_count(BtreeKey const& key, void* context);
+    btree_status_t recount_path(BtreeKey const& key, void* context);
+    btree_status_t recount_level(BtreeKey const& key, uint16_t level, void* context);
+    btree_status_t recount_child(const BtreeNodePtr& node, BtreeKey const& key, void* context);
+
+    ///////// Message Buffer Impl Methods
+    BtreeMsgBuffer msg_buffer(const BtreeNodePtr& node) const;
+    bool is_interior_full(const BtreeNodePtr& node) const;
+    template < typename ReqT >
+    btree_status_t buffered_write(ReqT& req);
+    template < typename ReqT >
+    btree_status_t add_msg(ReqT& req, bool& in_tree);
+    btree_status_t find_current_value(const BtreeNodePtr& root, BtreeKey const& key, V& val, bool& found,
+                                      void* context);
+    btree_status_t flush_msg_batch(const BtreeNodePtr& node, void* context);
+    btree_status_t flush_subtree(const BtreeNodePtr& node, void* context);
+    btree_status_t flush_all_msgs(void* context);
+    btree_status_t flush_msgs_for_read(void* context) const;
+    void split_msgs(const BtreeNodePtr& child_node1, const BtreeNodePtr& child_node2, K const& split_key);
+
     ///////// Mutate Impl Methods
+    template < typename ReqT >
+    btree_status_t put_in_tree(ReqT& req);
+
     template < typename ReqT >
     btree_status_t do_put(const BtreeNodePtr& my_node, locktype_t curlock, ReqT& req);
 
@@ -183,14 +368,27 @@ protected:
 
     template < typename ReqT >
     bool is_split_needed(const BtreeNodePtr& node, ReqT& req) const;
+    template < typename ReqT >
+    uint32_t leaf_put_value_size(const BtreeNodePtr& node, ReqT& req) const;
+
+    template < typename ReqT >
+    bool is_append_split(const BtreeNodePtr& node, ReqT& req) const;
 
     btree_status_t split_node(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node, uint32_t parent_ind,
-                              K* out_split_key, void* context);
+                              K* out_split_key, void* context, bool append_split = false);
+    btree_status_t split_to_right(const BtreeNodePtr& child_node1, BtreeNodePtr& child_node2, bool append_split);
+    btree_status_t split_node_unlinked(const BtreeNodePtr& child_node, void* context, bool append_split);
+    bool is_blink_split(const BtreeNodePtr& child_node, const BtreeLinkInfo& child_info) const;
+    bool is_split_unlinked(const BtreeNodePtr& parent_node, uint32_t idx, const BtreeNodePtr& child_node,
+                           void* context) const;
     btree_status_t mutate_extents_in_leaf(const BtreeNodePtr& my_node, BtreeRangePutRequest< K >& rpreq);
     btree_status_t repair_split(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node1,
                                 uint32_t parent_split_idx, void* context);
 
     ///////// Remove Impl Methods
+    template < typename ReqT >
+    btree_status_t remove_in_tree(ReqT& req);
+
     template < typename ReqT >
     btree_status_t check_collapse_root(ReqT& rreq);
 
@@ -199,15 +397,32 @@ protected:
 
     btree_status_t merge_nodes(const BtreeNodePtr& parent_node, const BtreeNodePtr& leftmost_node, uint32_t start_indx,
                                uint32_t end_indx, void* context);
+    // Node types which re-encode on every change (see CompactNode) can run out of room midway through a multi entry
+    // update, only those are copied upfront to be rolled back
+    bool is_reencoded_node(const BtreeNodePtr& node) const {
+        return ((node->is_leaf() ? m_bt_cfg.leaf_node_type() : m_bt_cfg.interior_node_type()) ==
+                btree_node_type::COMPACT);
+    }
     bool remove_extents_in_leaf(const BtreeNodePtr& node, BtreeRangeRemoveRequest< K >& rrreq);
+    bool find_covered_children(const BtreeNodePtr& node, BtreeKeyRange< K > const& range, uint32_t start_idx,
+                               uint32_t end_idx, uint32_t& cover_start, uint32_t& cover_end) const;
+    btree_status_t drop_subtrees(const BtreeNodePtr& parent_node, uint32_t start_idx, uint32_t end_idx,
+                                 void* context);
+    void free_dropped_subtrees();
     btree_status_t repair_merge(const BtreeNodePtr& parent_node, const BtreeNodePtr& left_child,
                                 uint32_t parent_merge_idx, void* context);
+    bool defer_merge(const BtreeNodePtr& parent_node, uint32_t idx, const BtreeNodePtr& child_node);
+    btree_status_t merge_deferred(K const& key, void* context);
 
     ///////// Query Impl Methods
     btree_status_t do_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
                                   std::vector< std::pair< K, V > >& out_values) const;
     btree_status_t do_traversal_query(const BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
                                       std::vector< std::pair< K, V > >& out_values) const;
+    btree_status_t do_reverse_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                          std::vector< std::pair< K, V > >& out_values) const;
+    btree_status_t descend_to_leaf(BtreeNodePtr& my_node, K const& key, BtreeQueryRequest< K >& qreq,
+                                   std::optional< K >& left_fence) const;
 #ifdef SERIALIZABLE_QUERY_IMPLEMENTATION
     btree_status_t do_serialzable_query(const BtreeNodePtr& my_node, BtreeSerializableQueryRequest& qreq,
                                         std::vector< std::pair< K, V > >& out_values);
@@ -219,5 +434,7 @@ protected:
     ///////// Get Impl Methods
     template < typename ReqT >
     btree_status_t do_get(const BtreeNodePtr& my_node, ReqT& greq) const;
+    btree_status_t do_multi_get(const BtreeNodePtr& my_node, BtreeMultiGetRequest< K >& greq) const;
+    void bound_by_msgs(const BtreeNodePtr& node, BtreeMultiGetRequest< K >& greq) const;
 };
 } // namespace homestore
@@ -32,6 +32,8 @@
 #include <homestore/btree/detail/btree_query_impl.ipp>
 #include <homestore/btree/detail/btree_get_impl.ipp>
 #include <homestore/btree/detail/btree_remove_impl.ipp>
+#include <homestore/btree/detail/btree_count_impl.ipp>
+#include <homestore/btree/detail/btree_buffer_impl.ipp>
 #include <homestore/btree/detail/btree_node.hpp>
 
 namespace homestore {
@@ -39,6 +41,28 @@ template < typename K, typename V >
 Btree< K, V >::Btree(const BtreeConfig& cfg) :
         m_metrics{cfg.name().c_str()}, m_node_size{cfg.node_size()}, m_bt_cfg{cfg} {
     m_bt_cfg.set_node_data_size(cfg.node_size() - sizeof(persistent_hdr_t));
+
+    // Optimistic readers parse interior nodes which could be in middle of a modification. It is safe only with fixed
+    // size entries, where a torn read can't lead to an out of bound access within the node.
+    if (m_bt_cfg.interior_node_type() != btree_node_type::FIXED) { m_bt_cfg.m_optimistic_read_turned_on = false; }
+
+    if (m_bt_cfg.m_subtree_counts_turned_on) {
+        BT_REL_ASSERT(((m_bt_cfg.interior_node_type() == btree_node_type::FIXED) ||
+                       (m_bt_cfg.interior_node_type() == btree_node_type::VAR_KEY)),
+                      "Subtree counts are not supported for interior node type {}", m_bt_cfg.interior_node_type());
+    }
+
+    if (is_msg_buffered()) {
+        BT_REL_ASSERT(((m_bt_cfg.interior_node_type() == btree_node_type::FIXED) ||
+                       (m_bt_cfg.interior_node_type() == btree_node_type::VAR_KEY)),
+                      "Message buffers are not supported for interior node type {}", m_bt_cfg.interior_node_type());
+        BT_REL_ASSERT(!m_bt_cfg.m_subtree_counts_turned_on, "Message buffers are not supported with subtree counts");
+        BT_REL_ASSERT_LT(m_bt_cfg.m_msg_buffer_size, cfg.node_size() / 2, "Message buffer takes most of the node");
+
+        // Optimistic readers descend without looking at the buffers. Buffers of a recovered btree could have messages.
+        m_bt_cfg.m_optimistic_read_turned_on = false;
+        m_msgs_buffered.store(true);
+    }
 }
 
 template < typename K, typename V >
@@ -78,13 +102,27 @@ std::pair< btree_status_t, uint64_t > Btree< K, V >::destroy_btree(void* context
 template < typename K, typename V >
 template < typename ReqT >
 btree_status_t Btree< K, V >::put(ReqT& put_req) {
-    static_assert(std::is_same_v< ReqT, BtreeSinglePutRequest > || std::is_same_v< ReqT, BtreeRangePutRequest< K > >,
+    static_assert(std::is_same_v< ReqT, BtreeSinglePutRequest > || std::is_same_v< ReqT, BtreeRangePutRequest< K > > ||
+                      std::is_same_v< ReqT, BtreeMultiPutRequest< K > >,
                   "put api is called with non put request type");
+    if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+        if (put_req.is_done()) { return btree_status_t::success; }
+    }
     COUNTER_INCREMENT(m_metrics, btree_write_ops_count, 1);
-    auto acq_lock = locktype_t::READ;
+    return is_msg_buffered() ? buffered_write(put_req) : put_in_tree(put_req);
+}
+
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::put_in_tree(ReqT& put_req) {
+    auto acq_lock = interior_write_lock< ReqT >();
     bool is_leaf = false;
+    bool const exclusive = is_counted_on_unwind< ReqT >();
 
-    m_btree_lock.lock_shared();
+    if constexpr (is_single_key_write< ReqT >()) {
+        if (is_subtree_counted()) { begin_leaf_count(); }
+    }
+    lock_for_write(exclusive);
     btree_status_t ret = btree_status_t::success;
 
 retry:
@@ -102,13 +140,13 @@ retry:
     if (is_split_needed(root, put_req)) {
         // Time to do the split of root.
         unlock_node(root, acq_lock);
-        m_btree_lock.unlock_shared();
+        unlock_for_write(exclusive);
         ret = check_split_root(put_req);
         BT_LOG_ASSERT_EQ(bt_thread_vars()->rd_locked_nodes.size(), 0);
         BT_LOG_ASSERT_EQ(bt_thread_vars()->wr_locked_nodes.size(), 0);
 
         // We must have gotten a new root, need to start from scratch.
-        m_btree_lock.lock_shared();
+        lock_for_write(exclusive);
         if (ret != btree_status_t::success) {
             LOGERROR("root split failed btree name {}", m_bt_cfg.name());
             goto out;
@@ -121,10 +159,13 @@ retry:
         acq_lock = locktype_t::WRITE;
         goto retry;
     } else {
+        if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) { put_req.reset_leaf_end_key(); }
+        ret = upgrade_lock_leaf_parent(root, acq_lock, put_req);
+        if (ret != btree_status_t::success) { goto out; }
         ret = do_put(root, acq_lock, put_req);
         if ((ret == btree_status_t::retry) || (ret == btree_status_t::has_more)) {
             // Need to start from top down again, since there was a split or we have more to insert in case of range put
-            acq_lock = locktype_t::READ;
+            acq_lock = interior_write_lock< ReqT >();
             BT_LOG(TRACE, "retrying put operation");
             BT_LOG_ASSERT_EQ(bt_thread_vars()->rd_locked_nodes.size(), 0);
             BT_LOG_ASSERT_EQ(bt_thread_vars()->wr_locked_nodes.size(), 0);
@@ -133,7 +174,10 @@ retry:
     }
 
 out:
-    m_btree_lock.unlock_shared();
+    unlock_for_write(exclusive);
+    if constexpr (is_single_key_write< ReqT >()) {
+        if (is_subtree_counted()) { end_leaf_count(put_req.key(), put_req.m_op_context); }
+    }
 #ifndef NDEBUG
     check_lock_debug();
 #endif
@@ -148,18 +192,47 @@ out:
 template < typename K, typename V >
 template < typename ReqT >
 btree_status_t Btree< K, V >::get(ReqT& greq) const {
-    static_assert(std::is_same_v< BtreeSingleGetRequest, ReqT > || std::is_same_v< BtreeGetAnyRequest< K >, ReqT >,
+    static_assert(std::is_same_v< BtreeSingleGetRequest, ReqT > || std::is_same_v< BtreeGetAnyRequest< K >, ReqT > ||
+                      std::is_same_v< BtreeMultiGetRequest< K >, ReqT >,
                   "get api is called with non get request type");
 
     btree_status_t ret = btree_status_t::success;
+    if constexpr (std::is_same_v< BtreeMultiGetRequest< K >, ReqT >) {
+        if (greq.is_done()) { return ret; }
+        greq.reset_end_key();
+    } else if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
+        // Any key within the range could be in a buffer, hence they are all flushed to the leaves first
+        ret = flush_msgs_for_read(greq.m_op_context);
+        if (ret != btree_status_t::success) { return ret; }
+    }
 
     m_btree_lock.lock_shared();
     BtreeNodePtr root;
 
+    if constexpr (!std::is_same_v< BtreeMultiGetRequest< K >, ReqT >) {
+        if (m_bt_cfg.m_optimistic_read_turned_on && !greq.route_tracing) {
+            if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
+                ret = optimistic_find_leaf(greq.m_range.start_key(), root, greq.m_op_context);
+                // On success, root is the read locked leaf node, otherwise fallback to the lock coupled traversal
+                if (ret == btree_status_t::success) {
+                    ret = do_get(root, greq);
+                    goto out;
+                }
+            } else {
+                // Fallback to the lock coupled traversal, unless optimistic read could conclude
+                ret = optimistic_get(greq);
+                if ((ret == btree_status_t::success) || (ret == btree_status_t::not_found)) { goto out; }
+            }
+        }
+    }
+
     ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, greq.m_op_context);
     if (ret != btree_status_t::success) { goto out; }
 
     ret = do_get(root, greq);
+    if constexpr (std::is_same_v< BtreeMultiGetRequest< K >, ReqT >) {
+        if ((ret == btree_status_t::success) && (greq.num_not_found() != 0)) { ret = btree_status_t::not_found; }
+    }
 out:
     m_btree_lock.unlock_shared();
 
@@ -176,9 +249,19 @@ btree_status_t Btree< K, V >::remove(ReqT& req) {
                       std::is_same_v< ReqT, BtreeRangeRemoveRequest< K > > ||
                       std::is_same_v< ReqT, BtreeRemoveAnyRequest< K > >,
                   "remove api is called with non remove request type");
+    return is_msg_buffered() ? buffered_write(req) : remove_in_tree(req);
+}
 
-    locktype_t acq_lock = locktype_t::READ;
-    m_btree_lock.lock_shared();
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::remove_in_tree(ReqT& req) {
+    locktype_t acq_lock = interior_write_lock< ReqT >();
+    bool const exclusive = is_counted_on_unwind< ReqT >();
+
+    if constexpr (is_single_key_write< ReqT >()) {
+        if (is_subtree_counted()) { begin_leaf_count(); }
+    }
+    lock_for_write(exclusive);
 
 retry:
     btree_status_t ret = btree_status_t::success;
@@ -190,14 +273,14 @@ retry:
         if (root->is_leaf()) {
             // There are no entries in btree.
             unlock_node(root, acq_lock);
-            m_btree_lock.unlock_shared();
+            unlock_for_write(exclusive);
             ret = btree_status_t::not_found;
             goto out;
         }
 
         BT_NODE_LOG_ASSERT_EQ(root->has_valid_edge(), true, root, "Orphaned root with no entries and edge");
         unlock_node(root, acq_lock);
-        m_btree_lock.unlock_shared();
+        unlock_for_write(exclusive);
 
         ret = check_collapse_root(req);
         if (ret != btree_status_t::success && ret != btree_status_t::merge_not_required) {
@@ -206,7 +289,7 @@ retry:
         }
 
         // We must have gotten a new root, need to start from scratch.
-        m_btree_lock.lock_shared();
+        lock_for_write(exclusive);
         goto retry;
     } else if (root->is_leaf() && (acq_lock != locktype_t::WRITE)) {
         // Root is a leaf, need to take write lock, instead of read, retry
@@ -214,16 +297,25 @@ retry:
         acq_lock = locktype_t::WRITE;
         goto retry;
     } else {
+        ret = upgrade_lock_leaf_parent(root, acq_lock, req);
+        if (ret != btree_status_t::success) {
+            unlock_for_write(exclusive);
+            goto out;
+        }
         ret = do_remove(root, acq_lock, req);
         if (ret == btree_status_t::retry) {
             // Need to start from top down again, since there was a merge nodes in-between
-            acq_lock = locktype_t::READ;
+            acq_lock = interior_write_lock< ReqT >();
             goto retry;
         }
     }
-    m_btree_lock.unlock_shared();
+    unlock_for_write(exclusive);
+    if constexpr (std::is_same_v< ReqT, BtreeRangeRemoveRequest< K > >) { free_dropped_subtrees(); }
 
 out:
+    if constexpr (is_single_key_write< ReqT >()) {
+        if (is_subtree_counted()) { end_leaf_count(req.key(), req.m_op_context); }
+    }
 #ifndef NDEBUG
     check_lock_debug();
 #endif
@@ -237,10 +329,23 @@ btree_status_t Btree< K, V >::query(BtreeQueryRequest< K >& qreq, std::vector< s
     btree_status_t ret = btree_status_t::success;
     if (qreq.batch_size() == 0) { return ret; }
 
+    ret = flush_msgs_for_read(qreq.m_op_context);
+    if (ret != btree_status_t::success) { return ret; }
+
     m_btree_lock.lock_shared();
     BtreeNodePtr root = nullptr;
-    ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ, qreq.m_op_context);
-    if (ret != btree_status_t::success) { goto out; }
+    if ((qreq.query_type() == BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY) &&
+        m_bt_cfg.m_optimistic_read_turned_on && !qreq.route_tracing) {
+        // Sweep query needs only the starting leaf, subsequent leaves are reached through sibling links
+        ret = optimistic_find_leaf(qreq.first_key(), root, qreq.m_op_context);
+    } else {
+        ret = btree_status_t::retry;
+    }
+    if (ret != btree_status_t::success) {
+        ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ,
+                                 qreq.m_op_context);
+        if (ret != btree_status_t::success) { goto out; }
+    }
 
     switch (qreq.query_type()) {
     case BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY:
@@ -251,6 +356,10 @@ btree_status_t Btree< K, V >::query(BtreeQueryRequest< K >& qreq, std::vector< s
         ret = do_traversal_query(root, qreq, out_values);
         break;
 
+    case BtreeQueryType::REVERSE_SWEEP_QUERY:
+        ret = do_reverse_sweep_query(root, qreq, out_values);
+        break;
+
     default:
         unlock_node(root, locktype_t::READ);
         LOGERROR("Query type {} is not supported yet", qreq.query_type());
@@ -266,6 +375,14 @@ btree_status_t Btree< K, V >::query(BtreeQueryRequest< K >& qreq, std::vector< s
         } else {
             DEBUG_ASSERT_NE(ret, btree_status_t::has_more, "Query returned has_more, but no values added")
         }
+    } else if (qreq.query_type() == BtreeQueryType::REVERSE_SWEEP_QUERY) {
+        if (out_values.size()) {
+            K out_last_key = out_values.back().first;
+            if (out_last_key.compare(qreq.input_range().start_key()) <= 0) { ret = btree_status_t::success; }
+            qreq.shift_working_range_end(std::move(out_last_key), false /* non inclusive*/);
+        } else {
+            DEBUG_ASSERT_NE(ret, btree_status_t::has_more, "Query returned has_more, but no values added")
+        }
     }
 
 out:
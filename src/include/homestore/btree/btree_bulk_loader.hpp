@@ -0,0 +1,282 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "btree.ipp"
+
+namespace homestore {
+/* BtreeBulkLoader builds a btree bottom up from a stream of key/values sorted in ascending order of keys, instead of
+ * inserting them one at a time through put(), which splits nodes repeatedly and leaves them half filled.
+ *
+ * Leaf nodes are filled upto the requested fill percentage and linked to their siblings as they are completed. Every
+ * completed node adds an entry (its last key and link) to the level above, so interior levels are built alongside in
+ * the same pass over the input. Completed nodes are written right away and only the node being filled and the node
+ * waiting for its right sibling are kept in memory per level.
+ *
+ * Every node is tied to its parent through the store's prepare_node_txn() before it is written, the same way a split
+ * ties the nodes it writes, so that stores persisting the nodes asynchronously (IndexTable) flush the children ahead
+ * of their parent. The parent is written only after all its children are added, so a crash in the middle of the
+ * flush never leaves a persisted parent pointing to an unwritten child.
+ *
+ * The loader works only on an empty btree (root is an empty leaf) and holds the btree exclusively during the load.
+ * For stores with checkpoints, caller is expected to pass the context of a single CP as op context, so that all the
+ * nodes built are flushed as part of that CP.
+ */
+template < typename K, typename V >
+class BtreeBulkLoader {
+private:
+    struct level_state {
+        BtreeNodePtr open_node;                   // Node which is being filled at this level
+        BtreeNodePtr prev_node;                   // Completed node yet to be written, waiting for its right sibling
+        bnodeid_t first_nodeid{empty_bnodeid};    // Left most node of this level
+    };
+
+    Btree< K, V >& m_bt;
+    BtreeConfig const& m_bt_cfg;
+    uint32_t m_fill_size;
+    void* m_context{nullptr};
+    std::vector< level_state > m_levels;
+    uint64_t m_num_entries{0};
+    K m_last_key;
+
+public:
+    /// @brief Constructs a loader which fills the nodes upto the ideal fill percentage of the btree config
+    explicit BtreeBulkLoader(Btree< K, V >& bt) :
+            m_bt{bt}, m_bt_cfg{bt.m_bt_cfg}, m_fill_size{m_bt_cfg.ideal_fill_size()} {}
+
+    /// @brief Constructs a loader which fills the nodes upto the given percentage of the node data size, clamped to
+    /// [1, 100]. Nodes take atleast 2 entries regardless, so that the height of the btree is bounded.
+    BtreeBulkLoader(Btree< K, V >& bt, uint8_t fill_pct) :
+            m_bt{bt},
+            m_bt_cfg{bt.m_bt_cfg},
+            m_fill_size{(m_bt_cfg.node_data_size() * std::clamp(fill_pct, uint8_t{1}, uint8_t{100})) / 100} {}
+
+    /// @brief Loads all the key/values in the range [begin, end) into the btree.
+    ///
+    /// @param begin Iterator to the first key/value, dereferencing it should yield a pair-like object of K and V
+    /// @param end Iterator past the last key/value
+    /// @param context Op context passed as is to the underlying store for every node write
+    /// @return btree_status_t::success on successful load, btree_status_t::not_supported if the btree is not empty
+    /// or the input is not in strictly ascending order of keys. On failure, all nodes built so far are freed and btree
+    /// is left as it was.
+    template < typename IterT >
+    btree_status_t load(IterT begin, IterT end, void* context) {
+        m_context = context;
+        m_bt.m_btree_lock.lock();
+
+        BtreeNodePtr old_root;
+        BtreeNodePtr new_root;
+        auto ret = m_bt.read_and_lock_node(m_bt.m_root_node_info.bnode_id(), old_root, locktype_t::WRITE,
+                                           locktype_t::WRITE, m_context);
+        if (ret != btree_status_t::success) { goto done; }
+
+        if (!old_root->is_leaf() || (old_root->total_entries() != 0)) {
+            BT_LOG(ERROR, "Bulk load is supported only on empty btree");
+            m_bt.unlock_node(old_root, locktype_t::WRITE);
+            ret = btree_status_t::not_supported;
+            goto done;
+        }
+
+        for (auto it = begin; (it != end) && (ret == btree_status_t::success); ++it) {
+            ret = add_entry(it->first, it->second);
+        }
+        if ((ret == btree_status_t::success) && (m_num_entries != 0)) { ret = finish(new_root); }
+
+        if (ret != btree_status_t::success) {
+            m_bt.unlock_node(old_root, locktype_t::WRITE);
+            free_built_nodes();
+        } else if (new_root) {
+            m_bt.m_root_node_info = new_root->link_info();
+            m_bt.update_new_root_info(new_root->node_id(), new_root->link_version(), m_context);
+            m_bt.free_node(old_root, locktype_t::WRITE, m_context);
+
+            COUNTER_INCREMENT(m_bt.m_metrics, btree_obj_count, m_num_entries);
+            COUNTER_INCREMENT(m_bt.m_metrics, btree_depth, m_levels.size() - 1);
+            BT_LOG(INFO, "Bulk loaded {} entries, new root={} levels={}", m_num_entries, new_root->node_id(),
+                   m_levels.size());
+        } else {
+            m_bt.unlock_node(old_root, locktype_t::WRITE);
+        }
+
+    done:
+        m_bt.m_btree_lock.unlock();
+        return ret;
+    }
+
+    uint64_t num_entries() const { return m_num_entries; }
+
+private:
+    btree_status_t add_entry(K const& key, V const& val) {
+        if ((m_num_entries != 0) && (key.compare(m_last_key) <= 0)) {
+            BT_LOG(ERROR, "Bulk load input is not sorted, key={} is after key={}", key.to_string(),
+                   m_last_key.to_string());
+            return btree_status_t::not_supported;
+        }
+        if (m_levels.empty()) { m_levels.emplace_back(); }
+
+        auto ret = btree_status_t::success;
+        auto const& node = m_levels[0].open_node;
+        if (node &&
+            (is_filled(node) ||
+             !node->has_room_for_put(btree_put_type::INSERT, key.serialized_size(), val.serialized_size()))) {
+            ret = complete_node(0);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+        if (m_levels[0].open_node == nullptr) {
+            ret = open_node(0);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        auto const& leaf = m_levels[0].open_node;
+        ret = leaf->insert(leaf->total_entries(), key, val);
+        if (ret != btree_status_t::success) { return ret; }
+
+        m_last_key = key;
+        ++m_num_entries;
+        return ret;
+    }
+
+    btree_status_t add_child(uint32_t level, K const& last_key, BtreeLinkInfo const& link) {
+        if (m_levels.size() == level) { m_levels.emplace_back(); }
+
+        auto ret = btree_status_t::success;
+        auto const& node = m_levels[level].open_node;
+        if (node &&
+            (is_filled(node) ||
+             !node->has_room_for_put(btree_put_type::INSERT, last_key.serialized_size(), m_bt.link_size()))) {
+            ret = complete_node(level);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+        if (m_levels[level].open_node == nullptr) {
+            ret = open_node(level);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        auto const& parent = m_levels[level].open_node;
+        return parent->insert(parent->total_entries(), last_key, link);
+    }
+
+    // Allocate a new node at the level and link it as the right sibling of the previously completed node, which can now
+    // be written.
+    btree_status_t open_node(uint32_t level) {
+        BtreeNodePtr node = (level == 0) ? m_bt.alloc_leaf_node() : m_bt.alloc_interior_node();
+        if (node == nullptr) { return btree_status_t::space_not_avail; }
+        node->set_level(level);
+
+        auto& lvl = m_levels[level];
+        if (lvl.first_nodeid == empty_bnodeid) { lvl.first_nodeid = node->node_id(); }
+        lvl.open_node = std::move(node);
+
+        if (lvl.prev_node) {
+            lvl.prev_node->set_next_bnode(lvl.open_node->node_id());
+            auto ret = m_bt.write_node(lvl.prev_node, m_context);
+            lvl.prev_node.reset();
+            if (ret != btree_status_t::success) { return ret; }
+        }
+        return btree_status_t::success;
+    }
+
+    // Complete the open node at the level and add it as a child entry to the level above
+    btree_status_t complete_node(uint32_t level, bool last_node = false) {
+        auto& lvl = m_levels[level];
+        K last_key;
+        auto ret = seal_node(lvl.open_node, last_node, last_key);
+        if (ret != btree_status_t::success) { return ret; }
+        lvl.prev_node = std::move(lvl.open_node);
+
+        // Adding the child could grow m_levels, so hold the child and not the reference to its level
+        BtreeNodePtr child = m_levels[level].prev_node;
+        uint64_t const count = (m_bt.is_subtree_counted() && !last_node) ? m_bt.subtree_count(child) : 0;
+        ret = add_child(level + 1, last_key, m_bt.child_link(child->link_info(), count));
+        if (ret != btree_status_t::success) { return ret; }
+
+        // Child is yet to be written and the parent is still open, so the store can order the child ahead of parent
+        return m_bt.prepare_node_txn(m_levels[level + 1].open_node, child, m_context);
+    }
+
+    // Interior nodes are built with an entry per child, the last child becomes the edge of the node. Fills the last
+    // key of the subtree under this node. With subtree counts, only the last node of a level gets the edge, since the
+    // count of the edge child is not kept.
+    btree_status_t seal_node(BtreeNodePtr const& node, bool last_node, K& last_key) const {
+        if (node->is_leaf()) {
+            last_key = node->get_last_key< K >();
+            return btree_status_t::success;
+        }
+
+        auto const last_idx = node->total_entries() - 1;
+        last_key = node->get_nth_key< K >(last_idx, true /* copy */);
+        if (m_bt.is_subtree_counted() && !last_node) { return btree_status_t::success; }
+
+        BtreeLinkInfo edge_info;
+        node->get_nth_value(last_idx, &edge_info, true /* copy */);
+        auto const ret = node->remove(last_idx);
+        if (ret == btree_status_t::success) { node->set_edge_value(edge_info); }
+        return ret;
+    }
+
+    // Complete all the open nodes bottom up, till a level ends up with exactly one node, which becomes the root
+    btree_status_t finish(BtreeNodePtr& root) {
+        for (uint32_t level{0}; level < m_levels.size(); ++level) {
+            auto ret = btree_status_t::success;
+            if ((level == m_levels.size() - 1) && (m_levels[level].prev_node == nullptr)) {
+                root = m_levels[level].open_node;
+                K last_key;
+                ret = seal_node(root, true /* last_node */, last_key);
+                if (ret != btree_status_t::success) { return ret; }
+                return m_bt.write_node(root, m_context);
+            }
+
+            ret = complete_node(level, true /* last_node */);
+            if (ret != btree_status_t::success) { return ret; }
+
+            auto& lvl = m_levels[level];
+            ret = m_bt.write_node(lvl.prev_node, m_context);
+            lvl.prev_node.reset();
+            if (ret != btree_status_t::success) { return ret; }
+        }
+        return btree_status_t::success;
+    }
+
+    // Nodes of every level are chained through their next node links, starting from the left most node of the level
+    void free_built_nodes() {
+        for (auto& lvl : m_levels) {
+            auto nodeid = lvl.first_nodeid;
+            while (nodeid != empty_bnodeid) {
+                BtreeNodePtr node;
+                if (lvl.open_node && (lvl.open_node->node_id() == nodeid)) {
+                    node = lvl.open_node;
+                } else if (lvl.prev_node && (lvl.prev_node->node_id() == nodeid)) {
+                    node = lvl.prev_node;
+                } else {
+                    m_bt.read_node_impl(nodeid, node);
+                    if (node == nullptr) { break; }
+                }
+                nodeid = node->next_bnode();
+                m_bt.free_node(node, locktype_t::NONE, m_context);
+            }
+            lvl.open_node.reset();
+            lvl.prev_node.reset();
+        }
+        m_levels.clear();
+    }
+
+    // Atleast 2 entries per node, so that every level atleast halves the number of nodes of the level below
+    bool is_filled(BtreeNodePtr const& node) const {
+        return (node->total_entries() >= 2) && (node->occupied_size() >= m_fill_size);
+    }
+};
+} // namespace homestore
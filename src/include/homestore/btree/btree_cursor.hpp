@@ -0,0 +1,211 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include "btree.ipp"
+
+namespace homestore {
+/* BtreeCursor is a streaming alternative to Btree::query() for large range scans. Instead of copying the results into a
+ * vector, it yields each key/value deserialized in place into the cursor from the leaf node buffer (with copy=false,
+ * so var length keys/values refer to the node buffer), without allocating per entry. The end of range is checked on
+ * the node buffer itself before an entry is deserialized. Leaves are walked through their sibling links instead of
+ * descending from root for every page.
+ *
+ * The cursor holds the read lock of the leaf it is positioned on, so the key/value views are valid till the next call
+ * to next() or release(). release() drops the leaf lock but retains the position: the next call to next() relocks the
+ * leaf and continues from where it left, if the leaf was not write locked in between (validated through its lock
+ * version), otherwise it descends again from root to the entry after the last returned key.
+ *
+ * While positioned, the cursor also holds m_btree_lock shared like any other operation in flight, so that the subtrees
+ * dropped by a range remove are not freed underneath it as it walks the sibling links. If subtrees were dropped while
+ * the cursor was released, it repositions from root instead of relocking its leaf, which could be freed by then.
+ *
+ * In a btree with buffered messages, the messages are flushed to the leaves whenever the cursor (re)positions, so it
+ * sees the writes buffered till then.
+ *
+ * NOTE: Since the leaf stays read locked and m_btree_lock held shared while the cursor is positioned, caller must
+ * release() the cursor before issuing any other btree operation from the same fiber or yielding for long periods.
+ */
+template < typename K, typename V >
+class BtreeCursor {
+private:
+    Btree< K, V > const& m_bt;
+    BtreeConfig const& m_bt_cfg;
+    BtreeKeyRange< K > m_range;
+    void* m_context{nullptr};
+
+    BtreeNodePtr m_node;           // Leaf node the cursor is positioned on
+    bool m_locked{false};          // Is m_node read locked and m_btree_lock held shared by the cursor
+    uint64_t m_node_version{0};    // Lock version of m_node when it was released
+    uint64_t m_drop_gen{0};        // Drop generation of the btree when m_node was reached
+    uint32_t m_next_idx{0};        // Index of the entry in m_node to yield on next()
+    bool m_started{false};         // Has any entry been yielded yet
+    bool m_at_end{false};          // Has the cursor moved past the range
+
+    K m_key;                       // View of current key from the node buffer
+    V m_val;                       // View of current value from the node buffer
+    K m_resume_key;                // Copy of the last yielded key, to reposition if the leaf is modified after release
+
+public:
+    BtreeCursor(Btree< K, V > const& bt, BtreeKeyRange< K > range, void* context = nullptr) :
+            m_bt{bt}, m_bt_cfg{bt.m_bt_cfg}, m_range{std::move(range)}, m_context{context} {}
+    BtreeCursor(const BtreeCursor&) = delete;
+    BtreeCursor& operator=(const BtreeCursor&) = delete;
+    ~BtreeCursor() { release(); }
+
+    /// @brief Moves the cursor to the next entry in the range.
+    ///
+    /// @return btree_status_t::success if the cursor is positioned on the next entry, btree_status_t::not_found if
+    /// there are no more entries in the range or any other error while reading the nodes.
+    btree_status_t next() {
+        if (m_at_end) { return btree_status_t::not_found; }
+
+        auto ret = reposition();
+        if (ret != btree_status_t::success) { return ret; }
+
+        while (m_next_idx >= m_node->total_entries()) {
+            ret = move_to_next_leaf();
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        // Check the end of range against the key in the node buffer, before materializing it into the cursor
+        auto const x = m_node->compare_nth_key(m_range.end_key(), m_next_idx);
+        if ((x > 0) || ((x == 0) && !m_range.is_end_inclusive())) { return mark_end(); }
+
+        m_node->get_nth_key_internal(m_next_idx, m_key, false /* copy */);
+        m_node->get_nth_value(m_next_idx, &m_val, false /* copy */);
+        ++m_next_idx;
+        m_started = true;
+        return btree_status_t::success;
+    }
+
+    /// @brief Key of the entry cursor is positioned on, valid only till the next call to next() or release()
+    K const& key() const { return m_key; }
+
+    /// @brief Value of the entry cursor is positioned on, valid only till the next call to next() or release()
+    V const& value() const { return m_val; }
+
+    /// @brief Releases the leaf node lock and m_btree_lock held by the cursor, retaining its position for subsequent
+    /// next()
+    void release() {
+        if (!m_locked) { return; }
+        if (m_started && (m_next_idx != 0)) { m_resume_key = m_node->get_nth_key< K >(m_next_idx - 1, true); }
+        m_node_version = m_node->optimistic_read_begin();
+        unlock();
+    }
+
+private:
+    btree_status_t reposition() {
+        if (m_locked) { return btree_status_t::success; }
+
+        // Cursor walks the leaves, so the messages buffered in the interior nodes are flushed down first
+        auto ret = m_bt.flush_msgs_for_read(m_context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        m_bt.m_btree_lock.lock_shared();
+        if (m_node) {
+            // Leaf could have been dropped and freed while released, if any subtree was dropped meanwhile
+            if (m_bt.m_drop_gen.load() == m_drop_gen) {
+                ret = m_bt.lock_node(m_node, locktype_t::READ, m_context);
+                if (ret != btree_status_t::success) {
+                    m_bt.m_btree_lock.unlock_shared();
+                    return ret;
+                }
+
+                // Nobody has write locked the node since released, continue where we left off
+                if (m_node->validate_optimistic_read(m_node_version) && m_node->is_valid_node()) {
+                    m_locked = true;
+                    return btree_status_t::success;
+                }
+                m_bt.unlock_node(m_node, locktype_t::READ);
+            }
+            m_node.reset();
+        }
+
+        return m_started ? seek(m_resume_key, false /* inclusive */)
+                         : seek(m_range.start_key(), m_range.is_start_inclusive());
+    }
+
+    // Descend from root to the leaf covering the key and position on the first entry at or after the key. It expects
+    // m_btree_lock to be held shared, which is retained only if the cursor is positioned.
+    btree_status_t seek(K const& key, bool inclusive) {
+        btree_status_t ret{btree_status_t::retry};
+        BtreeNodePtr node;
+
+        m_drop_gen = m_bt.m_drop_gen.load();
+        if (m_bt_cfg.m_optimistic_read_turned_on) { ret = m_bt.optimistic_find_leaf(key, node, m_context); }
+        if (ret != btree_status_t::success) {
+            ret = m_bt.read_and_lock_node(m_bt.m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ,
+                                          m_context);
+            while ((ret == btree_status_t::success) && !node->is_leaf()) {
+                BtreeLinkInfo child_info;
+                BtreeNodePtr child_node;
+                node->find(key, &child_info, false /* copy */);
+                ret = m_bt.read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
+                                              m_context);
+                if (ret == btree_status_t::success) {
+                    ret = m_bt.move_to_split_sibling(child_node, child_info, key, m_context);
+                }
+                m_bt.unlock_node(node, locktype_t::READ);
+                node = std::move(child_node);
+            }
+        }
+        if (ret != btree_status_t::success) {
+            m_bt.m_btree_lock.unlock_shared();
+            return ret;
+        }
+
+        m_node = std::move(node);
+        m_locked = true;
+        auto const [found, idx] = m_node->find(key, nullptr, false);
+        m_next_idx = (found && !inclusive) ? idx + 1 : idx;
+        return ret;
+    }
+
+    btree_status_t move_to_next_leaf() {
+        auto const next_id = m_node->next_bnode();
+        if ((next_id == empty_bnodeid) || (m_node->total_entries() &&
+                                           (m_node->get_last_key< K >().compare(m_range.end_key()) >= 0))) {
+            return mark_end();
+        }
+
+        BtreeNodePtr next_node;
+        auto ret = m_bt.read_and_lock_node(next_id, next_node, locktype_t::READ, locktype_t::READ, m_context);
+        if (ret != btree_status_t::success) {
+            unlock();
+            m_node.reset();
+            return ret;
+        }
+        m_bt.unlock_node(m_node, locktype_t::READ);
+
+        m_node = std::move(next_node);
+        m_next_idx = 0;
+        return btree_status_t::success;
+    }
+
+    btree_status_t mark_end() {
+        m_at_end = true;
+        if (m_locked) { unlock(); }
+        m_node.reset();
+        return btree_status_t::not_found;
+    }
+
+    void unlock() {
+        m_bt.unlock_node(m_node, locktype_t::READ);
+        m_bt.m_btree_lock.unlock_shared();
+        m_locked = false;
+    }
+};
+} // namespace homestore
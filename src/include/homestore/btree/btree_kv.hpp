@@ -15,7 +15,9 @@
  *********************************************************************************/
 #pragma once
 
+#include <algorithm>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <fmt/format.h>
 #include <sisl/fds/buffer.hpp>
@@ -33,7 +35,8 @@ ENUM(MultiMatchOption, uint16_t,
 ENUM(btree_put_type, uint16_t,
      INSERT, // Insert only if it doesn't exist
      UPDATE, // Update only if it exists
-     UPSERT  // Update if exists, insert otherwise
+     UPSERT, // Update if exists, insert otherwise
+     MERGE   // Merge into the existing value through the merge callback if exists, insert otherwise
 )
 
 // The base class, btree library expects its key to be derived from
@@ -57,6 +60,77 @@ public:
     virtual bool is_interval_key() const { return false; }
 };
 
+// Keys whose serialized form is a single native integer, ordered the same way as compare() does, can opt-in for faster
+// in-node search by declaring `using native_key_t = <integer type>;`. Nodes with fixed size entries then compare the
+// raw integers in-place, instead of deserializing every probed key and calling the virtual compare.
+template < typename K, typename = void >
+struct is_native_int_key : std::false_type {};
+
+template < typename K >
+struct is_native_int_key< K, std::void_t< typename K::native_key_t > >
+        : std::bool_constant< std::is_integral_v< typename K::native_key_t > > {};
+
+template < typename K >
+inline constexpr bool is_native_int_key_v = is_native_int_key< K >::value;
+
+// Key types with variable sized serialization can opt-in to suffix truncation of the separator keys promoted to the
+// interior nodes on leaf split, by providing `static K shortest_separator(K const& left, K const& right)` which returns
+// the shortest key s, such that left <= s < right.
+template < typename K, typename = void >
+struct has_shortest_separator : std::false_type {};
+
+template < typename K >
+struct has_shortest_separator<
+    K, std::void_t< decltype(K::shortest_separator(std::declval< K const& >(), std::declval< K const& >())) > >
+        : std::is_same< decltype(K::shortest_separator(std::declval< K const& >(), std::declval< K const& >())), K > {};
+
+template < typename K >
+inline constexpr bool has_shortest_separator_v = has_shortest_separator< K >::value;
+
+// Helper for keys whose serialized bytes sort in the same order as their compare(), e.g string keys. Returns the
+// shortest byte string s, such that left <= s < right: if there is room to increment the first differing byte of left
+// and still be less than right, the prefix of left upto that byte incremented, otherwise left itself.
+inline std::string shortest_byte_separator(sisl::blob const& left, sisl::blob const& right) {
+    uint32_t const min_len = std::min(left.size, right.size);
+    uint32_t diff_idx{0};
+    while ((diff_idx < min_len) && (left.bytes[diff_idx] == right.bytes[diff_idx])) {
+        ++diff_idx;
+    }
+
+    std::string sep{r_cast< const char* >(left.bytes), left.size};
+    if (diff_idx < min_len) {
+        uint8_t const diff_byte = left.bytes[diff_idx];
+        if ((diff_byte < 0xff) && (diff_byte + 1 < right.bytes[diff_idx]) && (diff_idx + 1 < left.size)) {
+            sep.resize(diff_idx + 1);
+            sep[diff_idx] = s_cast< char >(diff_byte + 1);
+        }
+    }
+    return sep;
+}
+
+// Variable sized keys can opt-in to keep a fixed size head of each key alongside its record in the node, by providing
+// `uint64_t key_head() const` which is order preserving, i.e a < b implies a.key_head() <= b.key_head(). Node search
+// then compares the heads, which are packed together, and compares the full keys only among the ones with equal heads.
+template < typename K, typename = void >
+struct has_key_head : std::false_type {};
+
+template < typename K >
+struct has_key_head< K, std::void_t< decltype(std::declval< K const& >().key_head()) > >
+        : std::is_same< decltype(std::declval< K const& >().key_head()), uint64_t > {};
+
+template < typename K >
+inline constexpr bool has_key_head_v = has_key_head< K >::value;
+
+// Helper for keys whose serialized bytes sort in the same order as their compare(). Returns first 8 bytes of the key
+// as a big endian integer, padded with zeros, so that the integers sort in the same order as the byte strings.
+inline uint64_t byte_key_head(sisl::blob const& b) {
+    uint64_t head{0};
+    for (uint32_t i{0}; i < sizeof(uint64_t); ++i) {
+        head = (head << 8) | ((i < b.size) ? b.bytes[i] : 0);
+    }
+    return head;
+}
+
 // An extension of BtreeKey where each key is part of an interval range. Keys are not neccessarily only needs to be
 // integers, but it needs to be able to get next or prev key from a given key in the key range
 class BtreeIntervalKey : public BtreeKey {
@@ -214,6 +288,11 @@ public:
         }
     }
 
+    // Shift the working range end to specific key, used by descending traversals which consume the range from its end
+    void shift_working_range_end(K&& end_key, bool end_incl) {
+        m_working_range.set_end_key(std::move(end_key), end_incl);
+    }
+
     const K& first_key() const { return m_working_range.start_key(); }
 
     uint32_t first_key_size() const {
@@ -236,39 +315,63 @@ public:
         uint64_t m_link_version{0}; // Link version between parent and a child
     };
 
+    // Link as kept in the interior nodes of btrees with subtree counts, along with the number of entries in the leaves
+    // under the child
+    struct counted_link_info {
+        bnode_link_info m_link;
+        uint64_t m_subtree_count{0};
+    };
+
 private:
-    bnode_link_info info;
+    counted_link_info info;
+    bool m_counted{false};
 
 public:
     BtreeLinkInfo() = default;
     explicit BtreeLinkInfo(bnodeid_t id, uint64_t v) {
-        info.m_bnodeid = id;
-        info.m_link_version = v;
+        info.m_link.m_bnodeid = id;
+        info.m_link.m_link_version = v;
     }
-    BtreeLinkInfo(bnode_link_info l) : info{l} {}
+    BtreeLinkInfo(bnode_link_info l) : info{l, 0} {}
     BtreeLinkInfo& operator=(const BtreeLinkInfo& other) = default;
 
-    bnodeid_t bnode_id() const { return info.m_bnodeid; }
-    uint64_t link_version() const { return info.m_link_version; }
-    void set_bnode_id(bnodeid_t bid) { info.m_bnodeid = bid; }
-    void set_link_version(uint64_t v) { info.m_link_version = v; }
-    bool has_valid_bnode_id() const { return (info.m_bnodeid != empty_bnodeid); }
+    bnodeid_t bnode_id() const { return info.m_link.m_bnodeid; }
+    uint64_t link_version() const { return info.m_link.m_link_version; }
+    void set_bnode_id(bnodeid_t bid) { info.m_link.m_bnodeid = bid; }
+    void set_link_version(uint64_t v) { info.m_link.m_link_version = v; }
+    bool has_valid_bnode_id() const { return (info.m_link.m_bnodeid != empty_bnodeid); }
+
+    // Once the subtree count is set, the link is serialized along with the count
+    bool is_counted() const { return m_counted; }
+    uint64_t subtree_count() const { return info.m_subtree_count; }
+    void set_subtree_count(uint64_t count) {
+        info.m_subtree_count = count;
+        m_counted = true;
+    }
 
     sisl::blob serialize() const override {
         sisl::blob b;
-        b.size = sizeof(bnode_link_info);
-        b.bytes = uintptr_cast(const_cast< bnode_link_info* >(&info));
+        b.size = serialized_size();
+        b.bytes = uintptr_cast(const_cast< counted_link_info* >(&info));
         return b;
     }
-    uint32_t serialized_size() const override { return sizeof(bnode_link_info); }
+    uint32_t serialized_size() const override {
+        return m_counted ? sizeof(counted_link_info) : sizeof(bnode_link_info);
+    }
     static uint32_t get_fixed_size() { return sizeof(bnode_link_info); }
-    std::string to_string() const override { return fmt::format("{}.{}", info.m_bnodeid, info.m_link_version); }
+    std::string to_string() const override {
+        return m_counted ? fmt::format("{}.{}#{}", bnode_id(), link_version(), subtree_count())
+                         : fmt::format("{}.{}", bnode_id(), link_version());
+    }
 
     void deserialize(const sisl::blob& b, bool copy) override {
-        DEBUG_ASSERT_EQ(b.size, sizeof(bnode_link_info), "BtreeLinkInfo deserialize received invalid blob");
-        auto other = r_cast< bnode_link_info* >(b.bytes);
-        set_bnode_id(other->m_bnodeid);
-        set_link_version(other->m_link_version);
+        DEBUG_ASSERT((b.size == sizeof(bnode_link_info)) || (b.size == sizeof(counted_link_info)),
+                     "BtreeLinkInfo deserialize received invalid blob");
+        auto other = r_cast< counted_link_info* >(b.bytes);
+        set_bnode_id(other->m_link.m_bnodeid);
+        set_link_version(other->m_link.m_link_version);
+        m_counted = (b.size == sizeof(counted_link_info));
+        info.m_subtree_count = m_counted ? other->m_subtree_count : 0;
     }
 
     friend std::ostream& operator<<(std::ostream& os, const BtreeLinkInfo& b) {
@@ -277,4 +380,11 @@ public:
     }
 };
 
+// Value type of the interior nodes of btrees with subtree counts, which are laid out with the counted links
+class BtreeCountedLinkInfo : public BtreeLinkInfo {
+public:
+    BtreeCountedLinkInfo() { set_subtree_count(0); }
+    static uint32_t get_fixed_size() { return sizeof(counted_link_info); }
+};
+
 } // namespace homestore
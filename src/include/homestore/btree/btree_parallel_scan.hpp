@@ -0,0 +1,266 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include <atomic>
+#include <memory>
+
+#include <folly/futures/Future.h>
+#include <iomgr/iomgr.hpp>
+#include "btree_cursor.hpp"
+
+namespace homestore {
+/* BtreeParallelScan splits a large range scan into partitions at the interior node boundaries and runs them on
+ * multiple iomgr fibers concurrently, instead of a single fiber walking all the leaves through their sibling links.
+ *
+ * Partitions are found by descending level by level from root, with the nodes of a level read locked, till the keys of
+ * the interior nodes within the range are enough to make the requested number of partitions or the level right above
+ * the leaves is reached. These keys are only hints of where to split, the partitions always cover the whole range
+ * without overlap, even if the nodes are split or merged once the locks are released.
+ *
+ * Scan creates a few partitions per fiber and each fiber picks the next partition to scan as it finishes one, so that
+ * a skewed partition doesn't hold back the whole scan. Results are either delivered per partition through a callback,
+ * called on the fiber scanning the partition, or collected per partition and merged in key order at the end.
+ *
+ * NOTE: Scanner must outlive the future returned by scan(). Caller must not wait on the future from one of the fibers
+ * passed to scan(), as the partitions queued to that fiber would never run.
+ */
+template < typename K, typename V >
+class BtreeParallelScan {
+public:
+    // Callback per entry with the partition it belongs to. Returning false stops the scan of all the partitions. It is
+    // called with the cursor of the partition positioned, hence must not issue any btree operation itself.
+    using partition_cb_t = std::function< bool(uint32_t, K const&, V const&) >;
+
+private:
+    static constexpr uint32_t partitions_per_fiber{4};
+
+    Btree< K, V > const& m_bt;
+    BtreeKeyRange< K > m_range;
+    void* m_context{nullptr};
+
+    std::vector< BtreeKeyRange< K > > m_partitions;
+    std::vector< std::vector< std::pair< K, V > > > m_results; // Results per partition, if merging in order
+    std::atomic< uint32_t > m_next_partition{0};
+    std::atomic< bool > m_stopped{false};
+
+public:
+    BtreeParallelScan(Btree< K, V > const& bt, BtreeKeyRange< K > range, void* context = nullptr) :
+            m_bt{bt}, m_range{std::move(range)}, m_context{context} {}
+    BtreeParallelScan(const BtreeParallelScan&) = delete;
+    BtreeParallelScan& operator=(const BtreeParallelScan&) = delete;
+
+    /// @brief Splits the range into consecutive non overlapping sub ranges at the interior node keys.
+    ///
+    /// @param max_partitions Maximum number of partitions, fewer are returned if the btree doesn't have enough
+    /// interior keys within the range
+    /// @return Partitions in key order, which together cover the entire range
+    std::vector< BtreeKeyRange< K > > partition(uint32_t max_partitions) const {
+        std::vector< K > boundaries;
+        if (max_partitions > 1) {
+            m_bt.m_btree_lock.lock_shared();
+            auto const ret = collect_boundaries(max_partitions - 1, boundaries);
+            m_bt.m_btree_lock.unlock_shared();
+            if (ret != btree_status_t::success) { boundaries.clear(); }
+        }
+
+        // Pick evenly spaced boundaries, if the level has more keys than needed
+        if (boundaries.size() >= max_partitions) {
+            std::vector< K > picked;
+            picked.reserve(max_partitions - 1);
+            for (size_t i{1}; i < max_partitions; ++i) {
+                picked.push_back(std::move(boundaries[(i * boundaries.size()) / max_partitions]));
+            }
+            boundaries = std::move(picked);
+        }
+
+        std::vector< BtreeKeyRange< K > > partitions;
+        partitions.reserve(boundaries.size() + 1);
+        K const* start_key = &m_range.start_key();
+        bool start_incl = m_range.is_start_inclusive();
+        for (auto const& b : boundaries) {
+            partitions.emplace_back(*start_key, start_incl, b, true /* end_incl */, m_range.multi_option());
+            start_key = &b;
+            start_incl = false;
+        }
+        partitions.emplace_back(*start_key, start_incl, m_range.end_key(), m_range.is_end_inclusive(),
+                                m_range.multi_option());
+        return partitions;
+    }
+
+    /// @brief Scans the range in parallel, calling the callback for every entry on the fiber scanning its partition.
+    /// Entries within a partition are delivered in key order, key and value are views valid only during the callback.
+    /// If no fibers are passed, partitions are scanned one after another on the calling fiber.
+    ///
+    /// @return Future of btree_status_t::success if the entire range is scanned or stopped by the callback,
+    /// otherwise the first error any of the partitions ran into
+    folly::Future< btree_status_t > scan(std::vector< iomgr::io_fiber_t > const& fibers, partition_cb_t cb) {
+        m_partitions = partition(num_partitions_for(fibers));
+        return run_partitions(fibers, [this, cb = std::move(cb)](uint32_t idx) { return scan_partition(idx, cb); });
+    }
+
+    /// @brief Scans the range in parallel and merges the results of all partitions in key order into out_values,
+    /// which should be valid till the returned future is fulfilled.
+    folly::Future< btree_status_t > scan(std::vector< iomgr::io_fiber_t > const& fibers,
+                                         std::vector< std::pair< K, V > >& out_values) {
+        m_partitions = partition(num_partitions_for(fibers));
+        m_results.clear();
+        m_results.resize(m_partitions.size());
+        return run_partitions(fibers, [this](uint32_t idx) { return query_partition(idx); })
+            .thenValue([this, &out_values](btree_status_t ret) {
+                if (ret == btree_status_t::success) {
+                    for (auto& r : m_results) {
+                        out_values.insert(out_values.end(), std::make_move_iterator(r.begin()),
+                                          std::make_move_iterator(r.end()));
+                    }
+                }
+                m_results.clear();
+                return ret;
+            });
+    }
+
+    /// @brief Partitions of the last scan, indexed by the partition number passed to the callback
+    std::vector< BtreeKeyRange< K > > const& partitions() const { return m_partitions; }
+
+private:
+    static uint32_t num_partitions_for(std::vector< iomgr::io_fiber_t > const& fibers) {
+        return fibers.empty() ? 1u : uint32_cast(fibers.size()) * partitions_per_fiber;
+    }
+
+    /* Descends from root collecting the interior keys within range, one level at a time. Keys of a level are collected
+     * first and its children in range are locked only if the level doesn't have enough keys and its children are not
+     * leaves. Nodes of the current level stay read locked till their children in range are locked, so none of them can
+     * be freed underneath. */
+    btree_status_t collect_boundaries(uint32_t max_boundaries, std::vector< K >& boundaries) const {
+        BtreeNodePtr root;
+        auto ret = m_bt.read_and_lock_node(m_bt.m_root_node_info.bnode_id(), root, locktype_t::READ, locktype_t::READ,
+                                           m_context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        std::vector< BtreeNodePtr > level_nodes{std::move(root)};
+        while (!level_nodes.empty() && !level_nodes[0]->is_leaf()) {
+            boundaries.clear();
+            for (auto const& node : level_nodes) {
+                visit_children_in_range(node, &boundaries, nullptr);
+            }
+            if ((level_nodes[0]->level() <= 1) || (boundaries.size() >= max_boundaries)) { break; }
+
+            std::vector< BtreeNodePtr > child_nodes;
+            for (auto const& node : level_nodes) {
+                ret = visit_children_in_range(node, nullptr, &child_nodes);
+                if (ret != btree_status_t::success) { break; }
+            }
+            for (auto& node : level_nodes) {
+                m_bt.unlock_node(node, locktype_t::READ);
+            }
+            level_nodes = std::move(child_nodes);
+            if (ret != btree_status_t::success) { break; }
+        }
+
+        for (auto& node : level_nodes) {
+            m_bt.unlock_node(node, locktype_t::READ);
+        }
+        return ret;
+    }
+
+    /* Child i of an interior node holds the keys in (key[i-1], key[i]], so key[i] is a partition boundary if it is
+     * strictly within the range. Boundaries are added to boundaries and the children overlapping the range are read
+     * locked and returned in child_nodes, whichever is given. */
+    btree_status_t visit_children_in_range(BtreeNodePtr const& node, std::vector< K >* boundaries,
+                                           std::vector< BtreeNodePtr >* child_nodes) const {
+        for (uint32_t i{0}; i <= node->total_entries(); ++i) {
+            BtreeLinkInfo child_info;
+            bool last_child{false};
+            if (i == node->total_entries()) {
+                if (!node->has_valid_edge()) { break; }
+                child_info = node->get_edge_value();
+            } else {
+                auto key = node->get_nth_key< K >(i, boundaries != nullptr /* copy */);
+                auto const sx = key.compare(m_range.start_key());
+                if ((sx < 0) || ((sx == 0) && !m_range.is_start_inclusive())) { continue; }
+
+                auto const ex = key.compare(m_range.end_key());
+                last_child = (ex >= 0);
+                if (boundaries && (sx > 0) && (ex < 0)) { boundaries->push_back(std::move(key)); }
+                node->get_nth_value(i, &child_info, false /* copy */);
+            }
+
+            if (child_nodes) {
+                BtreeNodePtr child_node;
+                auto const ret = m_bt.read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ,
+                                                         locktype_t::READ, m_context);
+                if (ret != btree_status_t::success) { return ret; }
+                child_nodes->push_back(std::move(child_node));
+            }
+            if (last_child) { break; }
+        }
+        return btree_status_t::success;
+    }
+
+    folly::Future< btree_status_t > run_partitions(std::vector< iomgr::io_fiber_t > const& fibers,
+                                                   std::function< btree_status_t(uint32_t) >&& fn) {
+        m_next_partition.store(0);
+        m_stopped.store(false);
+
+        auto worker = [this, fn = std::move(fn)]() {
+            btree_status_t ret{btree_status_t::success};
+            for (auto idx = m_next_partition.fetch_add(1); idx < m_partitions.size();
+                 idx = m_next_partition.fetch_add(1)) {
+                if (m_stopped.load()) { break; }
+                ret = fn(idx);
+                if (ret != btree_status_t::success) {
+                    m_stopped.store(true);
+                    break;
+                }
+            }
+            return ret;
+        };
+
+        if (fibers.empty()) { return folly::makeFuture< btree_status_t >(worker()); }
+
+        auto shared_worker = std::make_shared< decltype(worker) >(std::move(worker));
+        std::vector< folly::Future< btree_status_t > > futs;
+        futs.reserve(fibers.size());
+        for (auto const& fiber : fibers) {
+            auto promise = std::make_shared< folly::Promise< btree_status_t > >();
+            futs.emplace_back(promise->getFuture());
+            iomanager.run_on_forget(fiber, [shared_worker, promise]() { promise->setValue((*shared_worker)()); });
+        }
+
+        return folly::collectAllUnsafe(futs).thenValue([](auto&& tries) {
+            for (auto const& t : tries) {
+                if (t.hasValue() && (t.value() != btree_status_t::success)) { return t.value(); }
+            }
+            return btree_status_t::success;
+        });
+    }
+
+    btree_status_t scan_partition(uint32_t idx, partition_cb_t const& cb) {
+        BtreeCursor< K, V > cursor{m_bt, m_partitions[idx], m_context};
+        btree_status_t ret{btree_status_t::success};
+        while (!m_stopped.load() && ((ret = cursor.next()) == btree_status_t::success)) {
+            if (!cb(idx, cursor.key(), cursor.value())) { m_stopped.store(true); }
+        }
+        return (ret == btree_status_t::not_found) ? btree_status_t::success : ret;
+    }
+
+    btree_status_t query_partition(uint32_t idx) {
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{m_partitions[idx]},
+                                    BtreeQueryType::SWEEP_NON_INTRUSIVE_PAGINATION_QUERY, UINT32_MAX,
+                                    nullptr /* filter_cb */, m_context};
+        return m_bt.query(qreq, m_results[idx]);
+    }
+};
+} // namespace homestore
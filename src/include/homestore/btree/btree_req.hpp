@@ -14,6 +14,8 @@
  *
  *********************************************************************************/
 #pragma once
+#include <algorithm>
+#include <vector>
 #include <sisl/fds/buffer.hpp>
 #include <homestore/btree/btree_kv.hpp>
 
@@ -61,6 +63,9 @@ public:
         m_search_state.shift_working_range(std::move(start_key), start_incl);
     }
     void shift_working_range() { m_search_state.shift_working_range(); }
+    void shift_working_range_end(K&& end_key, bool end_incl) {
+        m_search_state.shift_working_range_end(std::move(end_key), end_incl);
+    }
     const BtreeKeyRange< K >& working_range() const { return m_search_state.working_range(); }
 
     const K& first_key() const { return m_search_state.first_key(); }
@@ -83,11 +88,25 @@ private:
 ENUM(put_filter_decision, uint8_t, keep, replace, remove);
 using put_filter_cb_t = std::function< put_filter_decision(BtreeKey const&, BtreeValue const&, BtreeValue const&) >;
 
+// Merge operator for btree_put_type::MERGE. It is called with the key, a copy of the existing value which it modifies
+// in place into the new value and the value passed in the put request as the operand. It is called under the leaf write
+// lock, hence it should be quick and free of side effects, as it is invoked more than once for the same key: to size
+// the merged value before the leaf is checked for room and again to apply it, or if the put has to be retried. For
+// range puts it is called for every existing entry in the range. Merged value can be of any size, the leaf is split
+// first if it doesn't fit.
+using put_merge_cb_t = std::function< void(BtreeKey const&, BtreeValue&, BtreeValue const&) >;
+
 struct BtreeSinglePutRequest : public BtreeRequest {
 public:
     BtreeSinglePutRequest(const BtreeKey* k, const BtreeValue* v, btree_put_type put_type,
-                          BtreeValue* existing_val = nullptr, put_filter_cb_t filter_cb = nullptr) :
-            m_k{k}, m_v{v}, m_put_type{put_type}, m_existing_val{existing_val}, m_filter_cb{std::move(filter_cb)} {}
+                          BtreeValue* existing_val = nullptr, put_filter_cb_t filter_cb = nullptr,
+                          put_merge_cb_t merge_cb = nullptr) :
+            m_k{k},
+            m_v{v},
+            m_put_type{put_type},
+            m_existing_val{existing_val},
+            m_filter_cb{std::move(filter_cb)},
+            m_merge_cb{std::move(merge_cb)} {}
 
     const BtreeKey& key() const { return *m_k; }
     const BtreeValue& value() const { return *m_v; }
@@ -97,6 +116,7 @@ public:
     const btree_put_type m_put_type;
     BtreeValue* m_existing_val;
     put_filter_cb_t m_filter_cb;
+    put_merge_cb_t m_merge_cb;
 };
 
 template < typename K >
@@ -104,15 +124,74 @@ struct BtreeRangePutRequest : public BtreeRangeRequest< K > {
 public:
     BtreeRangePutRequest(BtreeKeyRange< K >&& inp_range, btree_put_type put_type, const BtreeValue* value,
                          void* app_context = nullptr, uint32_t batch_size = std::numeric_limits< uint32_t >::max(),
-                         put_filter_cb_t filter_cb = nullptr) :
+                         put_filter_cb_t filter_cb = nullptr, put_merge_cb_t merge_cb = nullptr) :
             BtreeRangeRequest< K >(std::move(inp_range), app_context, batch_size),
             m_put_type{put_type},
             m_newval{value},
-            m_filter_cb{std::move(filter_cb)} {}
+            m_filter_cb{std::move(filter_cb)},
+            m_merge_cb{std::move(merge_cb)} {}
 
     const btree_put_type m_put_type{btree_put_type::UPDATE};
     const BtreeValue* m_newval;
     put_filter_cb_t m_filter_cb;
+    put_merge_cb_t m_merge_cb;
+};
+
+// Put a batch of independent keys in one call. The entries are sorted by key upon construction, so that btree can
+// descend once per leaf and apply all the keys that belong to that leaf under a single write lock. Outcome of each
+// individual key is recorded in the entry itself (and existing value if requested), similar to single put request.
+template < typename K >
+struct BtreeMultiPutRequest : public BtreeRequest {
+public:
+    struct entry_t {
+        const BtreeKey* m_k;
+        const BtreeValue* m_v;
+        BtreeValue* m_existing_val{nullptr};
+        bool m_done{false};
+    };
+
+    BtreeMultiPutRequest(std::vector< entry_t >&& entries, btree_put_type put_type, put_filter_cb_t filter_cb = nullptr,
+                         void* app_context = nullptr, put_merge_cb_t merge_cb = nullptr) :
+            BtreeRequest{app_context, nullptr},
+            m_put_type{put_type},
+            m_filter_cb{std::move(filter_cb)},
+            m_merge_cb{std::move(merge_cb)},
+            m_entries{std::move(entries)} {
+        std::stable_sort(m_entries.begin(), m_entries.end(),
+                         [](entry_t const& a, entry_t const& b) { return a.m_k->compare(*b.m_k) < 0; });
+    }
+
+    // Key and value which is yet to be put in the btree
+    const BtreeKey& key() const { return *m_entries[m_cur_idx].m_k; }
+    const BtreeValue& value() const { return *m_entries[m_cur_idx].m_v; }
+    entry_t& cur_entry() { return m_entries[m_cur_idx]; }
+    void advance() { ++m_cur_idx; }
+    bool is_done() const { return (m_cur_idx >= m_entries.size()); }
+
+    std::vector< entry_t > const& entries() const { return m_entries; }
+    uint32_t num_failed() const {
+        return std::count_if(m_entries.begin(), m_entries.end(), [](entry_t const& e) { return !e.m_done; });
+    }
+
+    // Upper bound (inclusive) of the keys the leaf currently being descended to can accept, as per its parent.
+    // If there is no bound (right most leaf) the key range is open ended.
+    bool has_leaf_end_key() const { return m_has_leaf_end_key; }
+    const K& leaf_end_key() const { return m_leaf_end_key; }
+    void set_leaf_end_key(K&& end_key) {
+        m_leaf_end_key = std::move(end_key);
+        m_has_leaf_end_key = true;
+    }
+    void reset_leaf_end_key() { m_has_leaf_end_key = false; }
+
+    const btree_put_type m_put_type;
+    put_filter_cb_t m_filter_cb;
+    put_merge_cb_t m_merge_cb;
+
+private:
+    std::vector< entry_t > m_entries;
+    uint32_t m_cur_idx{0};
+    K m_leaf_end_key;
+    bool m_has_leaf_end_key{false};
 };
 
 /////////////////////////// 2: Remove Operations /////////////////////////////////////
@@ -145,6 +224,11 @@ struct BtreeRangeRemoveRequest : public BtreeRangeRequest< K > {
 public:
     remove_filter_cb_t m_filter_cb;
 
+    // Outcome of the remove: entries removed from the leaves, and whether any of the subtrees entirely within the range
+    // were dropped as a whole, whose entries are not counted
+    uint64_t m_removed_count{0};
+    bool m_subtrees_dropped{false};
+
 public:
     BtreeRangeRemoveRequest(BtreeKeyRange< K >&& inp_range, void* app_context = nullptr,
                             uint32_t batch_size = std::numeric_limits< uint32_t >::max(),
@@ -164,6 +248,51 @@ public:
     BtreeValue* m_outval;
 };
 
+// Lookup a batch of keys in one call. The entries are sorted by key upon construction, so that btree can reuse the
+// locked interior path between consecutive keys and resolve all keys landing on the same leaf with one read lock.
+template < typename K >
+struct BtreeMultiGetRequest : public BtreeRequest {
+public:
+    struct entry_t {
+        const BtreeKey* m_k;
+        BtreeValue* m_outval;
+        bool m_found{false};
+    };
+
+    BtreeMultiGetRequest(std::vector< entry_t >&& entries, void* app_context = nullptr) :
+            BtreeRequest{app_context, nullptr}, m_entries{std::move(entries)} {
+        std::stable_sort(m_entries.begin(), m_entries.end(),
+                         [](entry_t const& a, entry_t const& b) { return a.m_k->compare(*b.m_k) < 0; });
+    }
+
+    // Key which is yet to be looked up in the btree
+    const BtreeKey& key() const { return *m_entries[m_cur_idx].m_k; }
+    entry_t& cur_entry() { return m_entries[m_cur_idx]; }
+    uint32_t cur_idx() const { return m_cur_idx; }
+    void advance() { ++m_cur_idx; }
+    bool is_done() const { return (m_cur_idx >= m_entries.size()); }
+
+    std::vector< entry_t > const& entries() const { return m_entries; }
+    uint32_t num_not_found() const {
+        return std::count_if(m_entries.begin(), m_entries.end(), [](entry_t const& e) { return !e.m_found; });
+    }
+
+    // Upper bound (inclusive) of the keys the subtree currently being descended to can contain, as per its parent.
+    bool has_end_key() const { return m_has_end_key; }
+    const K& end_key() const { return m_end_key; }
+    void set_end_key(K const& end_key) {
+        m_end_key = end_key;
+        m_has_end_key = true;
+    }
+    void reset_end_key() { m_has_end_key = false; }
+
+private:
+    std::vector< entry_t > m_entries;
+    uint32_t m_cur_idx{0};
+    K m_end_key;
+    bool m_has_end_key{false};
+};
+
 template < typename K >
 struct BtreeGetAnyRequest : public BtreeRequest {
 public:
@@ -195,7 +324,13 @@ ENUM(BtreeQueryType, uint8_t,
      // This is both inefficient and quiet intrusive/unsafe query, where it locks the range
      // that is being queried for and do not allow any insert or update within that range. It
      // essentially create a serializable level of isolation.
-     SERIALIZABLE_QUERY)
+     SERIALIZABLE_QUERY,
+
+     // Walks to the last element in range and sweeps towards the start of the range, returning the entries in
+     // descending order of keys. Since leaf nodes carry only the next link, it reaches the previous leaf node by walking
+     // down from the root with the separator key bounding the current leaf on its left. Upon pagination, it walks down
+     // again from the key it left off.
+     REVERSE_SWEEP_QUERY)
 
 using get_filter_cb_t = std::function< bool(BtreeKey const&, BtreeValue const&) >;
 
@@ -0,0 +1,417 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include <homestore/btree/btree.hpp>
+
+namespace homestore {
+
+/* Buffered messages: With m_msg_buffer_size set, every interior node reserves that many bytes at the tail of its node
+ * buffer for the messages (puts and removes) yet to be applied to its subtree, see BtreeMsgBuffer. A single key write
+ * is added as a message to the buffer of the root, the highest buffer there is, under the root write lock. Only when
+ * the root buffer is full, the largest batch of messages bound to a single child is moved down into the buffer of the
+ * child, or applied to the child if it is a leaf, making room in the root. A child whose buffer is full in turn flushes
+ * its own largest batch first, and so on down to the leaves. So a leaf is written once per batch instead of once per
+ * write.
+ *
+ * Newer message of a key is always higher up on its path than the older one, which it replaces on the way down, so
+ * the first message found descending from the root is the current state of the key. Hence a get looks at the buffer of
+ * every interior node on its way down, under the same lock coupling as the descent. Reads of a range, which walk the
+ * leaves instead of the paths to their keys, have all the messages flushed to the leaves first.
+ *
+ * Outcome of a write (insert of an existing key, filter, merge, remove of a missing key) is decided upfront by looking
+ * up the current value of the key, under the root write lock, and the message carries the resulting value. Only an
+ * upsert with nothing to return doesn't need the lookup.
+ *
+ * Messages are moved only under the write locks of both the nodes, with the child written ahead of the parent (see
+ * prepare_node_txn()), so they are persisted as part of the nodes, in the cp of the write, and recovered with them.
+ *
+ * NOTE: Since all the messages enter through the root, buffered writes are serialized on the root write lock. Writes
+ * to multiple keys, and reads of a range, take m_msg_lock exclusive to flush all the messages first.
+ */
+template < typename K, typename V >
+BtreeMsgBuffer Btree< K, V >::msg_buffer(const BtreeNodePtr& node) const {
+    return BtreeMsgBuffer{node->m_phys_node_buf + node->node_size(), m_bt_cfg.node_size() - node->node_size()};
+}
+
+// Interior node which can't take one more child, same as is_split_needed() of an interior node
+template < typename K, typename V >
+bool Btree< K, V >::is_interior_full(const BtreeNodePtr& node) const {
+    return !node->has_room_for_put(btree_put_type::UPSERT, K::get_max_size(), link_size());
+}
+
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::buffered_write(ReqT& req) {
+    constexpr bool is_put = std::is_same_v< ReqT, BtreeSinglePutRequest > ||
+        std::is_same_v< ReqT, BtreeRangePutRequest< K > > || std::is_same_v< ReqT, BtreeMultiPutRequest< K > >;
+    btree_status_t ret;
+
+    if constexpr (is_single_key_write< ReqT >()) {
+        bool in_tree{false};
+        {
+            std::shared_lock lg{m_msg_lock};
+            m_btree_lock.lock_shared();
+            ret = add_msg(req, in_tree);
+            m_btree_lock.unlock_shared();
+        }
+        if (!in_tree) { return ret; }
+    }
+
+    // Writes to multiple keys or too large for the buffer are written to the leaves, once all the messages are flushed
+    std::unique_lock lg{m_msg_lock};
+    ret = flush_all_msgs(req.m_op_context);
+    if (ret != btree_status_t::success) { return ret; }
+    if constexpr (is_put) {
+        return put_in_tree(req);
+    } else {
+        return remove_in_tree(req);
+    }
+}
+
+/* Adds the single key write as a message to the root buffer, flushing the batches down till it has room. Btree of a
+ * single leaf has no buffer, where it is written to the leaf as is. Message which can't fit even an empty buffer is not
+ * added, with in_tree set for the caller to write it to the leaf.
+ *
+ * NOTE: It expects m_msg_lock and m_btree_lock to be held shared.
+ */
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::add_msg(ReqT& req, bool& in_tree) {
+    void* context = req.m_op_context;
+    while (true) {
+        BtreeNodePtr root;
+        auto ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::WRITE, locktype_t::WRITE, context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        if (root->is_leaf()) {
+            if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+                if (is_split_needed(root, req)) {
+                    unlock_node(root, locktype_t::WRITE);
+                } else {
+                    // Merged value which doesn't fit needs the split as well
+                    ret = do_put(root, locktype_t::WRITE, req);
+                    if (ret != btree_status_t::has_more) { return ret; }
+                }
+            } else {
+                return do_remove(root, locktype_t::WRITE, req);
+            }
+        } else {
+            // Outcome of the write is decided against the current value of the key, its message carries the result
+            V cur_val;
+            bool found{false};
+            bool lookup{true};
+            if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+                lookup = (req.m_put_type != btree_put_type::UPSERT) || req.m_existing_val || req.m_filter_cb;
+            }
+            if (lookup) {
+                ret = find_current_value(root, req.key(), cur_val, found, context);
+                if (ret != btree_status_t::success) {
+                    unlock_node(root, locktype_t::WRITE);
+                    return ret;
+                }
+            }
+
+            btree_msg_type type{btree_msg_type::PUT};
+            sisl::blob val;
+            if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+                if (found) {
+                    if (req.m_existing_val) { req.m_existing_val->deserialize(cur_val.serialize(), true /* copy */); }
+                    if (req.m_filter_cb &&
+                        (req.m_filter_cb(req.key(), cur_val, req.value()) != put_filter_decision::replace)) {
+                        ret = btree_status_t::put_failed;
+                    }
+                }
+                if (((req.m_put_type == btree_put_type::INSERT) && found) ||
+                    ((req.m_put_type == btree_put_type::UPDATE) && !found)) {
+                    ret = btree_status_t::put_failed;
+                }
+                if ((req.m_put_type == btree_put_type::MERGE) && found && req.m_merge_cb) {
+                    req.m_merge_cb(req.key(), cur_val, req.value());
+                    val = cur_val.serialize();
+                } else {
+                    val = req.value().serialize();
+                }
+            } else {
+                type = btree_msg_type::REMOVE;
+                if (!found) {
+                    ret = btree_status_t::not_found;
+                } else if (req.m_outval) {
+                    req.m_outval->deserialize(cur_val.serialize(), true /* copy */);
+                }
+            }
+
+            auto const key = req.key().serialize();
+            auto const size = BtreeMsgBuffer::msg_size(key.size, val.size);
+            if ((ret == btree_status_t::success) && (size > msg_buffer(root).capacity())) {
+                unlock_node(root, locktype_t::WRITE);
+                in_tree = true;
+                return ret;
+            }
+
+            while ((ret == btree_status_t::success) && !msg_buffer(root).has_room(size, msg_buffer(root).find(key))) {
+                ret = flush_msg_batch(root, context);
+            }
+            if (ret == btree_status_t::success) {
+                msg_buffer(root).add(type, key, val);
+                write_node(root, context);
+                m_msgs_buffered.store(true);
+                COUNTER_INCREMENT(m_metrics, btree_msg_buffered_count, 1);
+                if (req.route_tracing) { append_route_trace(req, root, btree_event_t::MUTATE); }
+            }
+            unlock_node(root, locktype_t::WRITE);
+
+            // Root has no room left for the split of the child taking the flush
+            if (ret != btree_status_t::retry) { return ret; }
+        }
+
+        m_btree_lock.unlock_shared();
+        ret = check_split_root(req);
+        m_btree_lock.lock_shared();
+        if (ret != btree_status_t::success) { return ret; }
+    }
+}
+
+/* Looks up the current value of the key under the write locked root, which is the one in the first buffer on the path
+ * to the key with a message of the key, otherwise the one in the leaf. */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::find_current_value(const BtreeNodePtr& root, BtreeKey const& key, V& val, bool& found,
+                                                 void* context) {
+    if (auto const msg = msg_buffer(root).find(key.serialize())) {
+        found = (msg->type == btree_msg_type::PUT);
+        if (found) { val.deserialize(msg->val, true /* copy */); }
+        return btree_status_t::success;
+    }
+
+    BtreeLinkInfo child_info;
+    BtreeNodePtr child_node;
+    auto ret = get_child_and_lock_node(root, root->find(key, nullptr, false).second, child_info, child_node,
+                                       locktype_t::READ, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+    ret = move_to_split_sibling(child_node, child_info, key, context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    BtreeSingleGetRequest greq{&key, &val};
+    greq.m_op_context = context;
+    ret = do_get(child_node, greq);
+    found = (ret == btree_status_t::success);
+    return (ret == btree_status_t::not_found) ? btree_status_t::success : ret;
+}
+
+/* Flushes the largest batch of messages bound to a single child of the node into the child, into its buffer if it is an
+ * interior node or applied to it if it is a leaf. Child which can't take any message of the batch is split, or for an
+ * interior child its own largest batch is flushed first. Node is expected to be write locked and is left locked.
+ *
+ * Returns - btree_status_t::retry if the node itself has to be split first, to make room for the split of the child
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::flush_msg_batch(const BtreeNodePtr& node, void* context) {
+    K key;
+    auto const child_idx = [&node, &key](BtreeMsgBuffer::msg_t const& msg) {
+        key.deserialize(msg.key, false /* copy */);
+        return node->find(key, nullptr, false).second;
+    };
+
+    while (true) {
+        auto buf = msg_buffer(node);
+        if (buf.empty()) { return btree_status_t::success; }
+
+        std::vector< uint32_t > batch_sizes(node->total_entries() + 1, 0);
+        buf.for_each([&](BtreeMsgBuffer::msg_t const& msg) {
+            batch_sizes[child_idx(msg)] += msg.size;
+            return true;
+        });
+        uint32_t const idx = std::max_element(batch_sizes.begin(), batch_sizes.end()) - batch_sizes.begin();
+
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        auto ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::WRITE, locktype_t::WRITE,
+                                           context);
+        if (ret != btree_status_t::success) { return ret; }
+        ret = prepare_node_txn(node, child_node, context);
+        if (ret != btree_status_t::success) {
+            unlock_node(child_node, locktype_t::WRITE);
+            return ret;
+        }
+        buf = msg_buffer(node); // Buffer of the node could be copied for the cp by now
+
+        uint32_t nmoved{0};
+        bool split{false};
+        if (is_repair_needed(child_node, child_info)) {
+            // Keys past the child are in its split not yet linked to the node, which is linked first
+            split = true;
+        } else if (child_node->is_leaf()) {
+            nmoved = buf.erase_if([&](BtreeMsgBuffer::msg_t const& msg) {
+                if (child_idx(msg) != idx) { return false; }
+                if (msg.type == btree_msg_type::REMOVE) {
+                    child_node->remove_one(key, nullptr, nullptr);
+                    return true;
+                }
+                if (!child_node->has_room_for_put(btree_put_type::UPSERT, msg.key.size, msg.val.size)) { return false; }
+                V val;
+                val.deserialize(msg.val, false /* copy */);
+                to_variant_node(child_node)->put(key, val, btree_put_type::UPSERT, nullptr);
+                return true;
+            });
+            split = (nmoved == 0);
+
+            // Leaf emptied by the removes is left to the deferred merges, messages don't merge the leaves on their own
+            if ((nmoved != 0) && m_bt_cfg.m_merge_turned_on && child_node->is_merge_needed(m_bt_cfg) &&
+                ((idx < node->total_entries()) || (child_node->total_entries() != 0))) {
+                defer_merge(node, idx, child_node);
+            }
+        } else {
+            auto child_buf = msg_buffer(child_node);
+            nmoved = buf.erase_if([&](BtreeMsgBuffer::msg_t const& msg) {
+                if ((child_idx(msg) != idx) || !child_buf.has_room(msg.size, child_buf.find(msg.key))) {
+                    return false;
+                }
+                child_buf.add(msg.type, msg.key, msg.val);
+                return true;
+            });
+            if (nmoved == 0) {
+                ret = flush_msg_batch(child_node, context);
+                split = (ret == btree_status_t::retry);
+            }
+        }
+
+        if (split) {
+            if (is_interior_full(node)) {
+                ret = btree_status_t::retry;
+            } else if (is_repair_needed(child_node, child_info)) {
+                ret = repair_split(node, child_node, idx, context);
+            } else {
+                K split_key;
+                ret = split_node(node, child_node, idx, &split_key, context);
+                COUNTER_INCREMENT(m_metrics, btree_split_count, 1);
+            }
+        } else if (nmoved != 0) {
+            ret = transact_write_nodes({}, child_node, node, context);
+            COUNTER_INCREMENT(m_metrics, btree_msg_flush_count, 1);
+        }
+        unlock_node(child_node, locktype_t::WRITE);
+
+        // Child flushed its own batch, or is split, upon which the batch is picked again
+        if ((ret != btree_status_t::success) || (nmoved != 0)) { return ret; }
+    }
+}
+
+/* Flushes all the messages in the subtree of the write locked node down to the leaves, top down, splitting the children
+ * which run out of room on the way.
+ *
+ * Returns - btree_status_t::retry if the node itself has to be split first, to make room for the split of the child
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::flush_subtree(const BtreeNodePtr& node, void* context) {
+    btree_status_t ret{btree_status_t::success};
+    while (!msg_buffer(node).empty()) {
+        ret = flush_msg_batch(node, context);
+        if (ret != btree_status_t::success) { return ret; }
+    }
+    if (node->level() == 1) { return ret; }
+
+    uint32_t idx{0};
+    while ((idx < node->total_entries()) || ((idx == node->total_entries()) && node->has_valid_edge())) {
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::WRITE, locktype_t::WRITE,
+                                      context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        bool const repair = is_repair_needed(child_node, child_info);
+        if (!repair) { ret = flush_subtree(child_node, context); }
+        if (repair || (ret == btree_status_t::retry)) {
+            // Child is split, or its split linked, and flushed again with the split taking its place past it
+            if (is_interior_full(node)) {
+                ret = btree_status_t::retry;
+            } else {
+                ret = prepare_node_txn(node, child_node, context);
+                if (ret != btree_status_t::success) {
+                    // Nothing is modified yet
+                } else if (repair) {
+                    ret = repair_split(node, child_node, idx, context);
+                } else {
+                    K split_key;
+                    ret = split_node(node, child_node, idx, &split_key, context);
+                    COUNTER_INCREMENT(m_metrics, btree_split_count, 1);
+                }
+            }
+            unlock_node(child_node, locktype_t::WRITE);
+            if (ret != btree_status_t::success) { return ret; }
+            continue;
+        }
+
+        unlock_node(child_node, locktype_t::WRITE);
+        if (ret != btree_status_t::success) { return ret; }
+        ++idx;
+    }
+    return btree_status_t::success;
+}
+
+/* Flushes all the messages in the btree down to the leaves, so that the leaves are all there is to read.
+ *
+ * NOTE: It expects m_msg_lock to be held exclusive, so that no message is added meanwhile.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::flush_all_msgs(void* context) {
+    if (!m_msgs_buffered.load()) { return btree_status_t::success; }
+
+    // Split of the root which ran out of room for the split of its child is not tied to any request but its context
+    BtreeSingleRemoveRequest split_req{nullptr, nullptr};
+    split_req.m_op_context = context;
+
+    btree_status_t ret;
+    m_btree_lock.lock_shared();
+    while (true) {
+        BtreeNodePtr root;
+        ret = read_and_lock_node(m_root_node_info.bnode_id(), root, locktype_t::WRITE, locktype_t::WRITE, context);
+        if (ret != btree_status_t::success) { break; }
+        if (!root->is_leaf()) { ret = flush_subtree(root, context); }
+        unlock_node(root, locktype_t::WRITE);
+        if (ret != btree_status_t::retry) { break; }
+
+        m_btree_lock.unlock_shared();
+        ret = check_split_root(split_req);
+        m_btree_lock.lock_shared();
+        if (ret != btree_status_t::success) { break; }
+    }
+    m_btree_lock.unlock_shared();
+
+    if (ret == btree_status_t::success) { m_msgs_buffered.store(false); }
+    return ret;
+}
+
+// Reads which walk the leaves flush all the messages first, which moves them down without changing what they read
+template < typename K, typename V >
+btree_status_t Btree< K, V >::flush_msgs_for_read(void* context) const {
+    if (!is_msg_buffered() || !m_msgs_buffered.load()) { return btree_status_t::success; }
+    std::unique_lock lg{m_msg_lock};
+    return const_cast< Btree< K, V >* >(this)->flush_all_msgs(context);
+}
+
+// Messages of the keys moved to the right node by the split of an interior node move along with them
+template < typename K, typename V >
+void Btree< K, V >::split_msgs(const BtreeNodePtr& child_node1, const BtreeNodePtr& child_node2, K const& split_key) {
+    auto buf1 = msg_buffer(child_node1);
+    auto buf2 = msg_buffer(child_node2);
+    K key;
+    buf1.erase_if([&](BtreeMsgBuffer::msg_t const& msg) {
+        key.deserialize(msg.key, false /* copy */);
+        if (key.compare(split_key) <= 0) { return false; }
+        buf2.add(msg.type, msg.key, msg.val);
+        return true;
+    });
+}
+} // namespace homestore
@@ -32,7 +32,7 @@ btree_status_t Btree< K, V >::post_order_traversal(locktype_t ltype, const auto&
 
     btree_status_t ret{btree_status_t::success};
     if (m_root_node_info.bnode_id() != empty_bnodeid) {
-        read_and_lock_node(m_root_node_info.bnode_id(), root, ltype, ltype, nullptr);
+        ret = read_and_lock_node(m_root_node_info.bnode_id(), root, ltype, ltype, nullptr);
         if (ret != btree_status_t::success) { goto done; }
 
         ret = post_order_traversal(root, ltype, cb);
@@ -58,7 +58,7 @@ btree_status_t Btree< K, V >::post_order_traversal(const BtreeNodePtr& node, loc
         while (i <= node->total_entries()) {
             if (i == node->total_entries()) {
                 if (!node->has_valid_edge()) { break; }
-                child_info.set_bnode_id(node->edge_id());
+                child_info = node->get_edge_value();
             } else {
                 node->get_nth_value(i, &child_info, false /* copy */);
             }
@@ -67,8 +67,23 @@ btree_status_t Btree< K, V >::post_order_traversal(const BtreeNodePtr& node, loc
             ret = read_and_lock_node(child_info.bnode_id(), child, ltype, ltype, nullptr);
             if (ret != btree_status_t::success) { return ret; }
 
+            // Right node of a leaf split not yet linked to this node is visited right after the leaf it split from
+            bnodeid_t split_id{empty_bnodeid};
+            if (child->is_leaf() && is_repair_needed(child, child_info) && is_split_unlinked(node, i, child, nullptr)) {
+                split_id = child->next_bnode();
+            }
+
             ret = post_order_traversal(child, ltype, cb);
             if (ret != btree_status_t::node_freed) { unlock_node(child, ltype); }
+
+            if (split_id != empty_bnodeid) {
+                BtreeNodePtr split_node;
+                ret = read_and_lock_node(split_id, split_node, ltype, ltype, nullptr);
+                if (ret != btree_status_t::success) { return ret; }
+
+                ret = cb(split_node, true /* is_leaf */);
+                if (ret != btree_status_t::node_freed) { unlock_node(split_node, ltype); }
+            }
             ++i;
         }
         return cb(node, false /* is_leaf */);
@@ -85,6 +100,51 @@ void Btree< K, V >::get_all_kvs(std::vector< std::pair< K, V > >& kvs) const {
     });
 }
 
+/* Walks the leaves left to right through their sibling links, calling the callback for every key till it returns false.
+ * Keys are views into the read locked leaf, valid only during the callback. */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::for_each_key(std::function< bool(K const&) > const& cb) const {
+    BtreeNodePtr node;
+
+    m_btree_lock.lock_shared();
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, nullptr);
+    while ((ret == btree_status_t::success) && !node->is_leaf()) {
+        BtreeLinkInfo child_info;
+        if (node->total_entries() == 0) {
+            child_info = node->get_edge_value();
+        } else {
+            node->get_nth_value(0, &child_info, false /* copy */);
+        }
+
+        BtreeNodePtr child_node;
+        ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ, nullptr);
+        unlock_node(node, locktype_t::READ);
+        node = std::move(child_node);
+    }
+    m_btree_lock.unlock_shared();
+    if (ret != btree_status_t::success) { return ret; }
+
+    while (true) {
+        for (uint32_t i{0}; i < node->total_entries(); ++i) {
+            if (!cb(node->get_nth_key< K >(i, false /* copy */))) {
+                unlock_node(node, locktype_t::READ);
+                return btree_status_t::success;
+            }
+        }
+
+        auto const next_id = node->next_bnode();
+        if (next_id == empty_bnodeid) { break; }
+
+        BtreeNodePtr next_node;
+        ret = read_and_lock_node(next_id, next_node, locktype_t::READ, locktype_t::READ, nullptr);
+        unlock_node(node, locktype_t::READ);
+        if (ret != btree_status_t::success) { return ret; }
+        node = std::move(next_node);
+    }
+    unlock_node(node, locktype_t::READ);
+    return btree_status_t::success;
+}
+
 template < typename K, typename V >
 btree_status_t Btree< K, V >::do_destroy(uint64_t& n_freed_nodes, void* context) {
     return post_order_traversal(locktype_t::WRITE,
@@ -95,6 +155,196 @@ btree_status_t Btree< K, V >::do_destroy(uint64_t& n_freed_nodes, void* context)
                                 });
 }
 
+/* Background destroy descends from root till there are enough subtrees to keep all the fibers busy, and then each fiber
+ * picks the next subtree to destroy as it finishes one. Only the interior nodes are read to find their children, while
+ * the leaves, which form the bulk of the btree, are freed by their ids. The nodes above the subtrees are freed last.
+ *
+ * On failure, the nodes freed so far are not restored, hence the btree stays marked as destroyed.
+ */
+template < typename K, typename V >
+folly::Future< std::pair< btree_status_t, uint64_t > >
+Btree< K, V >::destroy_btree_async(std::vector< iomgr::io_fiber_t > const& fibers) {
+    bool expected = false;
+    if (!m_destroyed.compare_exchange_strong(expected, true)) {
+        BT_LOG(DEBUG, "Btree is already being destroyed, ignorining this request");
+        return folly::makeFuture(std::make_pair(btree_status_t::not_found, uint64_t{0}));
+    }
+
+    struct destroy_state {
+        std::vector< bnodeid_t > subtree_ids;
+        std::vector< bnodeid_t > upper_ids;
+        uint16_t subtree_level{0};
+        std::atomic< uint32_t > next_subtree{0};
+        std::atomic< uint64_t > n_freed{0};
+    };
+    auto state = std::make_shared< destroy_state >();
+    auto const root_id = m_root_node_info.bnode_id();
+
+    auto ret = collect_destroy_subtrees(std::max(uint32_cast(fibers.size()), 1u) * destroy_subtrees_per_fiber,
+                                        state->subtree_ids, state->subtree_level, state->upper_ids);
+    if (ret != btree_status_t::success) {
+        BT_LOG(ERROR, "btree(root: {}) unable to read the upper levels to destroy, ret: {}", root_id, ret);
+        return folly::makeFuture(std::make_pair(ret, uint64_t{0}));
+    }
+
+    auto worker = [this, state]() {
+        std::vector< bnodeid_t > batch;
+        btree_status_t ret{btree_status_t::success};
+        for (auto idx = state->next_subtree.fetch_add(1); idx < state->subtree_ids.size();
+             idx = state->next_subtree.fetch_add(1)) {
+            ret = destroy_subtree(state->subtree_ids[idx], state->subtree_level, batch, state->n_freed);
+            if (ret != btree_status_t::success) { break; }
+        }
+        free_destroyed_nodes(batch, state->n_freed);
+        return ret;
+    };
+
+    auto finish = [this, state, root_id](btree_status_t ret) {
+        if (ret == btree_status_t::success) {
+            // Nodes above the subtrees are all interior nodes, accounted as freed only once they are actually freed
+            COUNTER_DECREMENT(m_metrics, btree_int_node_count, state->upper_ids.size());
+            m_total_nodes.fetch_sub(state->upper_ids.size());
+            free_destroyed_nodes(state->upper_ids, state->n_freed);
+            BT_LOG(DEBUG, "btree(root: {}) {} nodes destroyed successfully", root_id, state->n_freed.load());
+        } else {
+            BT_LOG(ERROR, "btree(root: {}) nodes destroyed failed, ret: {}", root_id, ret);
+        }
+        return std::make_pair(ret, state->n_freed.load());
+    };
+
+    if (fibers.empty()) { return folly::makeFuture(finish(worker())); }
+
+    std::vector< folly::Future< btree_status_t > > futs;
+    futs.reserve(fibers.size());
+    for (auto const& fiber : fibers) {
+        auto promise = std::make_shared< folly::Promise< btree_status_t > >();
+        futs.emplace_back(promise->getFuture());
+        iomanager.run_on_forget(fiber, [worker, promise]() { promise->setValue(worker()); });
+    }
+
+    return folly::collectAllUnsafe(futs).thenValue([finish](auto&& tries) {
+        btree_status_t ret{btree_status_t::success};
+        for (auto const& t : tries) {
+            if (t.hasValue() && (t.value() != btree_status_t::success)) { ret = t.value(); }
+        }
+        return finish(ret);
+    });
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::collect_destroy_subtrees(uint32_t min_subtrees, std::vector< bnodeid_t >& subtree_ids,
+                                                       uint16_t& subtree_level, std::vector< bnodeid_t >& upper_ids) {
+    BtreeNodePtr node;
+    auto ret = read_node_impl(m_root_node_info.bnode_id(), node);
+    if (ret != btree_status_t::success) { return ret; }
+
+    subtree_ids.push_back(m_root_node_info.bnode_id());
+    subtree_level = node->level();
+    while ((subtree_level > 0) && (subtree_ids.size() < min_subtrees)) {
+        std::vector< bnodeid_t > child_ids;
+        for (auto const id : subtree_ids) {
+            ret = read_node_impl(id, node);
+            if (ret != btree_status_t::success) { return ret; }
+            get_child_ids(node, child_ids);
+            ret = get_unlinked_split_ids(node, child_ids);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+        upper_ids.insert(upper_ids.end(), subtree_ids.begin(), subtree_ids.end());
+        subtree_ids = std::move(child_ids);
+        --subtree_level;
+    }
+    return btree_status_t::success;
+}
+
+/* Post order walk of the subtree. Level of a node is known from its parent, so that the leaves are never read, except
+ * to find the leaf splits not yet linked to their parent */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::destroy_subtree(bnodeid_t id, uint16_t level, std::vector< bnodeid_t >& batch,
+                                              std::atomic< uint64_t >& n_freed) {
+    if (level > 0) {
+        std::vector< bnodeid_t > child_ids;
+        {
+            BtreeNodePtr node;
+            auto ret = read_node_impl(id, node);
+            if (ret != btree_status_t::success) { return ret; }
+            get_child_ids(node, child_ids);
+            ret = get_unlinked_split_ids(node, child_ids);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        for (auto const child_id : child_ids) {
+            auto const ret = destroy_subtree(child_id, level - 1, batch, n_freed);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+    }
+
+    COUNTER_DECREMENT_IF_ELSE(m_metrics, (level == 0), btree_leaf_node_count, btree_int_node_count, 1);
+    --m_total_nodes;
+    batch.push_back(id);
+    if (batch.size() >= destroy_batch_size) { free_destroyed_nodes(batch, n_freed); }
+    return btree_status_t::success;
+}
+
+template < typename K, typename V >
+void Btree< K, V >::free_destroyed_nodes(std::vector< bnodeid_t >& batch, std::atomic< uint64_t >& n_freed) {
+    if (batch.empty()) { return; }
+    free_node_ids_impl(batch);
+    n_freed.fetch_add(batch.size());
+    batch.clear();
+}
+
+/* Default for the stores which can't free a node without its node object: read each node and free it */
+template < typename K, typename V >
+void Btree< K, V >::free_node_ids_impl(std::vector< bnodeid_t > const& node_ids) {
+    for (auto const id : node_ids) {
+        BtreeNodePtr node;
+        if (read_node_impl(id, node) != btree_status_t::success) {
+            BT_LOG(ERROR, "Unable to read node={} to free, leaking it", id);
+            continue;
+        }
+        node->set_valid_node(false);
+        if (m_bt_cfg.m_optimistic_read_turned_on) { retire_node(node); }
+        free_node_impl(node, nullptr);
+    }
+}
+
+template < typename K, typename V >
+void Btree< K, V >::get_child_ids(const BtreeNodePtr& node, std::vector< bnodeid_t >& child_ids) {
+    BtreeLinkInfo child_info;
+    for (uint32_t i{0}; i < node->total_entries(); ++i) {
+        node->get_nth_value(i, &child_info, false /* copy */);
+        child_ids.push_back(child_info.bnode_id());
+    }
+    if (node->has_valid_edge()) { child_ids.push_back(node->edge_id()); }
+}
+
+/* Right node of a leaf split not yet linked to the parent (see split_node_unlinked()) is only in the sibling chain of
+ * the leaf it split from. Only the btrees which split leaves that way read the leaf children of the node to find them,
+ * the same way descend_to_leaf() moves to them. */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::get_unlinked_split_ids(const BtreeNodePtr& node,
+                                                    std::vector< bnodeid_t >& split_ids) const {
+    if (!m_bt_cfg.m_blink_splits_turned_on || (node->level() != 1)) { return btree_status_t::success; }
+
+    BtreeLinkInfo child_info;
+    for (uint32_t i{0}; i <= node->total_entries(); ++i) {
+        if (i == node->total_entries()) {
+            if (!node->has_valid_edge()) { break; }
+            child_info = node->get_edge_value();
+        } else {
+            node->get_nth_value(i, &child_info, false /* copy */);
+        }
+
+        BtreeNodePtr child;
+        auto const ret = read_node_impl(child_info.bnode_id(), child);
+        if (ret != btree_status_t::success) { return ret; }
+        if (is_repair_needed(child, child_info) && is_split_unlinked(node, i, child, nullptr)) {
+            split_ids.push_back(child->next_bnode());
+        }
+    }
+    return btree_status_t::success;
+}
+
 template < typename K, typename V >
 uint64_t Btree< K, V >::get_btree_node_cnt() const {
     uint64_t cnt = 1; /* increment it for root */
@@ -114,7 +364,8 @@ uint64_t Btree< K, V >::get_child_node_cnt(bnodeid_t bnodeid) const {
     if (!node->is_leaf()) {
         uint32_t i = 0;
         while (i < node->total_entries()) {
-            BtreeLinkInfo p = node->get_nth_key< K >(i, false);
+            BtreeLinkInfo p;
+            node->get_nth_value(i, &p, false);
             cnt += get_child_node_cnt(p.bnode_id()) + 1;
             ++i;
         }
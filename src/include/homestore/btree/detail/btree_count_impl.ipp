@@ -0,0 +1,463 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include <homestore/btree/btree.hpp>
+
+/* Subtree counts: Every entry of an interior node keeps, along with the link to the child, the number of entries in the
+ * leaves under that child. Number of entries before a key is then the sum of the counts of the children left of the
+ * path to the key at every level, plus the position of the key in the leaf, which needs reading only the nodes on the
+ * path. Same way the nth entry is found by descending into the child whose counts cover n.
+ *
+ * Edge child doesn't keep a count, as the edge is part of the node header. Edge is always the right most child of a
+ * node, so its count is never needed to find the entries before a key, as long as only the right most node of every
+ * level has an edge, which is how splits and merges leave the btree. Hence count of any other node is the sum of the
+ * counts of its entries.
+ *
+ * Every write changes the counts on its entire path. Single key writes, which are the bulk of them, run concurrently
+ * with lock coupling as usual and leave the interior nodes untouched on their way down. Once the leaf is written, the
+ * write recounts its path bottom up, recomputing the count of each child on the path from the entries of the child,
+ * with the op context of the write. So the counts change only after the leaf did, as part of the same cp for stores
+ * with checkpoints, and a write which fails at the leaf never touches them. Recount is idempotent, hence concurrent
+ * writes on overlapping paths leave the counts right, whichever order they recount in. Splits and merges too recompute
+ * the counts of the nodes they rearrange from their entries, which can only move a count yet to be recounted up the
+ * path, where the recount gets to it.
+ *
+ * Multi key writes can't know their change upfront. They are applied one at a time holding the btree lock exclusive,
+ * with all the interior nodes on the path write locked, and as the write unwinds, every interior node adjusts the count
+ * of the child it descended into by the number of entries added or removed within.
+ */
+namespace homestore {
+/* Entries in the range are counted along the paths to its start and end keys. While the paths are shared, children of
+ * a node strictly between the two paths are entirely within the range, so are the children right of the start path and
+ * left of the end path once they part. Only their counts are summed up, with the entries of the leaves at the ends of
+ * the paths. Counts lag the leaf by the recount of a concurrent write, but only on the path to the key written, which
+ * never goes through a child counted here unless the key is within the range. So the count is exact for the entries
+ * not being written meanwhile.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::range_count(BtreeKeyRange< K > const& range, uint64_t& count, void* context) const {
+    count = 0;
+    if (!is_subtree_counted()) { return btree_status_t::not_supported; }
+
+    m_btree_lock.lock_shared();
+    BtreeNodePtr node;
+    BtreeNodePtr start_node;
+    BtreeNodePtr end_node;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, context);
+    while ((ret == btree_status_t::success) && node && !node->is_leaf()) {
+        auto const start_idx = node->find(range.start_key(), nullptr, false).second;
+        auto const end_idx = node->find(range.end_key(), nullptr, false).second;
+        bool const end_past = (end_idx == node->total_entries()) && !node->has_valid_edge();
+        if (((start_idx == node->total_entries()) && !node->has_valid_edge()) || (end_idx < start_idx)) {
+            unlock_node(node, locktype_t::READ); // Nothing of the btree is within the range
+            node = nullptr;
+            break;
+        }
+
+        count += children_count(node, start_idx + 1, end_idx);
+        BtreeLinkInfo child_info;
+        if (start_idx == end_idx) {
+            BtreeNodePtr child_node;
+            ret = get_child_and_lock_node(node, start_idx, child_info, child_node, locktype_t::READ, locktype_t::READ,
+                                          context);
+            unlock_node(node, locktype_t::READ);
+            node = std::move(child_node);
+            continue;
+        }
+
+        // Paths part here. Both children are locked before the node is unlocked, so that no entry moves in or out of
+        // the children counted, and left to right as every other walk across a level does.
+        ret = get_child_and_lock_node(node, start_idx, child_info, start_node, locktype_t::READ, locktype_t::READ,
+                                      context);
+        if ((ret == btree_status_t::success) && !end_past) {
+            ret = get_child_and_lock_node(node, end_idx, child_info, end_node, locktype_t::READ, locktype_t::READ,
+                                          context);
+        }
+        unlock_node(node, locktype_t::READ);
+        node = nullptr;
+    }
+
+    if ((ret == btree_status_t::success) && node) {
+        auto const [start_found, start_idx] = node->find(range.start_key(), nullptr, false);
+        auto const [end_found, end_idx] = node->find(range.end_key(), nullptr, false);
+        auto const from = (start_found && !range.is_start_inclusive()) ? start_idx + 1 : start_idx;
+        auto const upto = (end_found && range.is_end_inclusive()) ? end_idx + 1 : end_idx;
+        if (upto > from) { count += upto - from; }
+        unlock_node(node, locktype_t::READ);
+    }
+
+    // Both paths are descended a level at a time, start path first, to keep locking left to right
+    while ((ret == btree_status_t::success) && (start_node || end_node)) {
+        if (start_node) { ret = count_path_side(start_node, range, true /* start_side */, count, context); }
+        if ((ret == btree_status_t::success) && end_node) {
+            ret = count_path_side(end_node, range, false /* start_side */, count, context);
+        }
+    }
+    if (start_node) { unlock_node(start_node, locktype_t::READ); }
+    if (end_node) { unlock_node(end_node, locktype_t::READ); }
+    m_btree_lock.unlock_shared();
+
+    if (ret != btree_status_t::success) { count = 0; }
+    return ret;
+}
+
+/* Count the entries of the locked node on the path to the start or the end key of the range, which are on the side of the
+ * path within the range, then move down to the child on the path, unlocking the node. Node is reset once a leaf is
+ * counted or the path ends.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::count_path_side(BtreeNodePtr& node, BtreeKeyRange< K > const& range, bool start_side,
+                                              uint64_t& count, void* context) const {
+    auto const [found, idx] = node->find(start_side ? range.start_key() : range.end_key(), nullptr, false);
+    btree_status_t ret{btree_status_t::success};
+    BtreeNodePtr child_node;
+    if (node->is_leaf()) {
+        if (start_side) {
+            count += node->total_entries() - ((found && !range.is_start_inclusive()) ? idx + 1 : idx);
+        } else {
+            count += (found && range.is_end_inclusive()) ? idx + 1 : idx;
+        }
+    } else if (start_side) {
+        // Start path never goes through the right most node of a level, which is the only one with an edge
+        BT_NODE_DBG_ASSERT(!node->has_valid_edge(), node, "Node on the start path has an edge");
+        count += children_count(node, idx + 1, node->total_entries());
+        if (idx < node->total_entries()) {
+            BtreeLinkInfo child_info;
+            ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ,
+                                          context);
+        }
+    } else {
+        count += children_count(node, 0, idx);
+        if ((idx < node->total_entries()) || node->has_valid_edge()) {
+            BtreeLinkInfo child_info;
+            ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ,
+                                          context);
+        }
+    }
+    unlock_node(node, locktype_t::READ);
+    node = std::move(child_node);
+    return ret;
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::total_count(uint64_t& count, void* context) const {
+    count = 0;
+    if (!is_subtree_counted()) { return btree_status_t::not_supported; }
+
+    m_btree_lock.lock_shared();
+    auto const ret = count_upto(nullptr, true /* inclusive */, count, context);
+    m_btree_lock.unlock_shared();
+    return ret;
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::get_nth_entry(uint64_t n, K& out_key, V* out_val, void* context) const {
+    if (!is_subtree_counted()) { return btree_status_t::not_supported; }
+
+    m_btree_lock.lock_shared();
+    BtreeNodePtr node;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, context);
+    while ((ret == btree_status_t::success) && !node->is_leaf()) {
+        uint32_t idx{0};
+        BtreeLinkInfo child_info;
+        for (; idx < node->total_entries(); ++idx) {
+            node->get_nth_value(idx, &child_info, false /* copy */);
+            if (n < child_info.subtree_count()) { break; }
+            n -= child_info.subtree_count();
+        }
+
+        BtreeNodePtr child_node;
+        if ((idx == node->total_entries()) && !node->has_valid_edge()) {
+            ret = btree_status_t::not_found;
+        } else {
+            ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ,
+                                          context);
+        }
+        unlock_node(node, locktype_t::READ);
+        if (ret != btree_status_t::success) { goto out; }
+        node = std::move(child_node);
+    }
+
+    if (ret == btree_status_t::success) {
+        if (n < node->total_entries()) {
+            out_key = node->get_nth_key< K >(n, true /* copy */);
+            if (out_val) { node->get_nth_value(n, out_val, true /* copy */); }
+        } else {
+            ret = btree_status_t::not_found;
+        }
+        unlock_node(node, locktype_t::READ);
+    }
+
+out:
+    m_btree_lock.unlock_shared();
+    return ret;
+}
+
+/* Number of entries with key less than the given key, or less than or equal if inclusive. All the entries are counted
+ * if no key is given. Caller is expected to hold the btree lock.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::count_upto(K const* key, bool inclusive, uint64_t& count, void* context) const {
+    count = 0;
+    BtreeNodePtr node;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    while (!node->is_leaf()) {
+        auto const idx = key ? node->find(*key, nullptr, false).second : node->total_entries();
+        BtreeLinkInfo child_info;
+        for (uint32_t i{0}; i < idx; ++i) {
+            node->get_nth_value(i, &child_info, false /* copy */);
+            count += child_info.subtree_count();
+        }
+
+        // Key past the last child of a node without edge doesn't reach here in a consistent btree, all of it is before
+        if ((idx == node->total_entries()) && !node->has_valid_edge()) { break; }
+
+        BtreeNodePtr child_node;
+        ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ, context);
+        unlock_node(node, locktype_t::READ);
+        if (ret != btree_status_t::success) { return ret; }
+        node = std::move(child_node);
+    }
+
+    if (node->is_leaf()) {
+        if (key) {
+            auto const [found, idx] = node->find(*key, nullptr, false);
+            count += (found && inclusive) ? idx + 1 : idx;
+        } else {
+            count += node->total_entries();
+        }
+    }
+    unlock_node(node, locktype_t::READ);
+    return btree_status_t::success;
+}
+
+template < typename K, typename V >
+void Btree< K, V >::lock_for_write(bool exclusive) const {
+    exclusive ? m_btree_lock.lock() : m_btree_lock.lock_shared();
+}
+
+template < typename K, typename V >
+void Btree< K, V >::unlock_for_write(bool exclusive) const {
+    exclusive ? m_btree_lock.unlock() : m_btree_lock.unlock_shared();
+}
+
+// Called before the single key write takes the btree lock
+template < typename K, typename V >
+void Btree< K, V >::begin_leaf_count() {
+    bt_thread_vars()->count_delta = 0;
+}
+
+// Number of entries the write added to or removed from the leaf, under the leaf write lock
+template < typename K, typename V >
+template < typename ReqT >
+void Btree< K, V >::count_leaf_change(int64_t delta) {
+    if constexpr (is_single_key_write< ReqT >()) {
+        bt_thread_vars()->count_delta += delta;
+    } else {
+        m_subtree_delta += delta;
+    }
+}
+
+// Recount the path of the key bottom up, if the single key write changed the number of entries in the leaf. Called
+// after the btree lock is released by the write, with the op context of the write.
+template < typename K, typename V >
+void Btree< K, V >::end_leaf_count(BtreeKey const& key, void* context) {
+    auto tv = bt_thread_vars();
+    if (tv->count_delta == 0) { return; }
+    tv->count_delta = 0;
+
+    m_btree_lock.lock_shared();
+    auto const ret = recount_path(key, context);
+    m_btree_lock.unlock_shared();
+    if (ret != btree_status_t::success) {
+        BT_LOG(ERROR, "Recount of the path to key={} failed {}", key.to_string(), ret);
+        COUNTER_INCREMENT(m_metrics, write_err_cnt, 1);
+    }
+}
+
+/* Recompute the count of the child on the path to the key from the entries of the child, one level at a time from the
+ * parent of the leaf up to the root. Path is read once on the way down, and every node of it is relocked for write on
+ * the way up only to update the count of its child, so the root is write locked just for that. Node split or merged
+ * since may no longer be on the path to the key, which its link version tells, then the level is recounted by walking
+ * down from the root to follow the path as it is at the time. Caller is expected to hold the btree lock shared.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::recount_path(BtreeKey const& key, void* context) {
+    BtreeNodePtr node;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    auto const root_level = node->level();
+    std::vector< std::pair< BtreeNodePtr, uint64_t > > path;
+    path.reserve(root_level);
+    while (!node->is_leaf()) {
+        path.emplace_back(node, node->link_version());
+        auto const idx = node->find(key, nullptr, false).second;
+        if ((node->level() == 1) || ((idx == node->total_entries()) && !node->has_valid_edge())) { break; }
+
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ, context);
+        unlock_node(node, locktype_t::READ);
+        if (ret != btree_status_t::success) { return ret; }
+        node = std::move(child_node);
+    }
+    unlock_node(node, locktype_t::READ);
+
+    for (auto it = path.rbegin(); (it != path.rend()) && (ret == btree_status_t::success); ++it) {
+        auto const& [path_node, link_version] = *it;
+        ret = lock_node(path_node, locktype_t::WRITE, context);
+        if (ret != btree_status_t::success) { break; }
+        if (path_node->is_valid_node() && (path_node->link_version() == link_version)) {
+            ret = recount_child(path_node, key, context);
+            unlock_node(path_node, locktype_t::WRITE);
+        } else {
+            unlock_node(path_node, locktype_t::WRITE);
+            ret = recount_level(key, path_node->level(), context);
+            if (ret == btree_status_t::not_found) { ret = btree_status_t::success; }
+        }
+    }
+
+    // Root split meanwhile, new levels above the path are recounted from the new root
+    for (auto level = root_level + 1; ret == btree_status_t::success; ++level) {
+        ret = recount_level(key, level, context);
+    }
+    return (ret == btree_status_t::not_found) ? btree_status_t::success : ret;
+}
+
+// Recount the child on the path to the key at the level, walking down from the root. Returns not_found if the btree
+// doesn't have the level or the key is past the btree.
+template < typename K, typename V >
+btree_status_t Btree< K, V >::recount_level(BtreeKey const& key, uint16_t level, void* context) {
+    BtreeNodePtr node;
+    auto curlock = locktype_t::READ;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, curlock, curlock, context);
+    if (ret != btree_status_t::success) { return ret; }
+    if (node->level() == level) {
+        unlock_node(node, curlock);
+        curlock = locktype_t::WRITE;
+        ret = read_and_lock_node(m_root_node_info.bnode_id(), node, curlock, curlock, context);
+        if (ret != btree_status_t::success) { return ret; }
+    }
+
+    while (node->level() > level) {
+        auto const idx = node->find(key, nullptr, false).second;
+        if ((idx == node->total_entries()) && !node->has_valid_edge()) {
+            unlock_node(node, curlock);
+            return btree_status_t::not_found;
+        }
+
+        auto const child_lock = (node->level() == level + 1) ? locktype_t::WRITE : locktype_t::READ;
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        ret = get_child_and_lock_node(node, idx, child_info, child_node, child_lock, child_lock, context);
+        unlock_node(node, curlock);
+        if (ret != btree_status_t::success) { return ret; }
+        node = std::move(child_node);
+        curlock = child_lock;
+    }
+
+    // Root may have moved below the level while it was relocked for write
+    ret = (node->level() == level) ? recount_child(node, key, context) : btree_status_t::not_found;
+    unlock_node(node, curlock);
+    return ret;
+}
+
+// Recompute the count of the child of the write locked node, on the path to the key. Edge child is not counted.
+template < typename K, typename V >
+btree_status_t Btree< K, V >::recount_child(const BtreeNodePtr& node, BtreeKey const& key, void* context) {
+    auto const idx = node->find(key, nullptr, false).second;
+    if (idx >= node->total_entries()) { return btree_status_t::success; }
+
+    BtreeLinkInfo child_info;
+    BtreeNodePtr child_node;
+    auto ret =
+        get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    auto const count = subtree_count(child_node);
+    unlock_node(child_node, locktype_t::READ);
+    if (count != child_info.subtree_count()) {
+        child_info.set_subtree_count(count);
+        ret = node->update(idx, child_info);
+        if (ret == btree_status_t::success) { ret = write_node(node, context); }
+    }
+    return ret;
+}
+
+// Size of the value of an interior node entry
+template < typename K, typename V >
+uint32_t Btree< K, V >::link_size() const {
+    return is_subtree_counted() ? BtreeCountedLinkInfo::get_fixed_size() : BtreeLinkInfo::get_fixed_size();
+}
+
+// Link to be written to an interior node entry, which needs to be counted if the btree keeps subtree counts
+template < typename K, typename V >
+BtreeLinkInfo Btree< K, V >::child_link(BtreeLinkInfo link, uint64_t subtree_count) const {
+    if (is_subtree_counted()) { link.set_subtree_count(subtree_count); }
+    return link;
+}
+
+template < typename K, typename V >
+uint64_t Btree< K, V >::subtree_count(const BtreeNodePtr& node) const {
+    if (node->is_leaf()) { return node->total_entries(); }
+    BT_NODE_DBG_ASSERT(!node->has_valid_edge(), node, "Count of a node with edge is not known from its entries");
+    return children_count(node, 0, node->total_entries());
+}
+
+// Sum of the counts of the children of the interior node from the start index upto, not including, the end index
+template < typename K, typename V >
+uint64_t Btree< K, V >::children_count(const BtreeNodePtr& node, uint32_t start_idx, uint32_t end_idx) const {
+    uint64_t count{0};
+    BtreeLinkInfo child_info;
+    for (auto i = start_idx; i < std::min(end_idx, node->total_entries()); ++i) {
+        node->get_nth_value(i, &child_info, false /* copy */);
+        count += child_info.subtree_count();
+    }
+    return count;
+}
+
+// Recompute the count of the child at the index from its entries, the child is expected to be locked
+template < typename K, typename V >
+void Btree< K, V >::set_child_count(const BtreeNodePtr& parent_node, uint32_t idx,
+                                    const BtreeNodePtr& child_node) const {
+    if (!is_subtree_counted() || (idx >= parent_node->total_entries())) { return; }
+
+    BtreeLinkInfo child_info;
+    parent_node->get_nth_value(idx, &child_info, false /* copy */);
+    BT_NODE_DBG_ASSERT_EQ(child_info.bnode_id(), child_node->node_id(), parent_node, "Child mismatch at idx={}", idx);
+    child_info.set_subtree_count(subtree_count(child_node));
+    auto const ret = parent_node->update(idx, child_info);
+    BT_NODE_REL_ASSERT_EQ(ret, btree_status_t::success, parent_node, "Count update of child idx={} failed", idx);
+}
+
+// Adjust the count of the child at the index, as the write descended into it added or removed entries underneath
+template < typename K, typename V >
+void Btree< K, V >::update_child_count(const BtreeNodePtr& node, uint32_t idx, int64_t delta, void* context) {
+    if ((delta == 0) || (idx >= node->total_entries())) { return; }
+
+    BtreeLinkInfo child_info;
+    node->get_nth_value(idx, &child_info, false /* copy */);
+    BT_NODE_DBG_ASSERT_GE(int64_t(child_info.subtree_count()) + delta, 0, node, "Subtree count underflow idx={}",
+                          idx);
+    child_info.set_subtree_count(child_info.subtree_count() + delta);
+    auto const ret = node->update(idx, child_info);
+    BT_NODE_REL_ASSERT_EQ(ret, btree_status_t::success, node, "Count update of child idx={} failed", idx);
+    write_node(node, context);
+}
+} // namespace homestore
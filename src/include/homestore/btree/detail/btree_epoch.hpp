@@ -0,0 +1,163 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace homestore {
+/* EpochReclaimer defers the release of objects unlinked from a shared structure, till all the lock free readers which
+ * could have picked up a reference to them have finished.
+ *
+ * Readers announce the global epoch in one of the reader slots upon entering and clear it upon exit. An object retired
+ * at epoch E is released once every active reader has announced an epoch later than E, i.e started after the object
+ * was unlinked. Unlike a single count of readers in flight, a continuous stream of overlapping readers does not hold
+ * back the reclamation forever, only the readers older than the retired object do.
+ *
+ * Reader slots are picked by hashing the thread id and probing linearly, so readers on different threads mostly touch
+ * their own cache line. Number of slots is bounded, if all of them are taken enter() fails and the reader is expected
+ * to take its locked path instead. Readers are not expected to block while holding a slot, as that holds back the
+ * reclamation of everything retired after it.
+ *
+ * Scanning the reader slots is amortized over a batch of retired objects, i.e a reclaim is attempted only once the
+ * retire list has grown by reclaim_batch since the last attempt. Release of objects happens outside of any lock, by
+ * dropping them.
+ */
+template < typename T >
+class EpochReclaimer {
+private:
+    static constexpr uint32_t num_reader_slots{128};
+    static constexpr uint32_t reclaim_batch{32};
+    static constexpr uint64_t inactive_epoch{0};
+
+    struct alignas(64) reader_slot {
+        std::atomic< uint64_t > epoch{inactive_epoch};
+    };
+
+    std::atomic< uint64_t > m_global_epoch{1};
+    std::array< reader_slot, num_reader_slots > m_slots;
+
+    std::mutex m_retired_mtx;
+    std::vector< std::pair< uint64_t, T > > m_retired; // Retired objects along with the epoch they were retired at
+    std::atomic< uint32_t > m_num_retired{0};
+    std::atomic< uint32_t > m_next_reclaim_at{reclaim_batch}; // Size of retire list to attempt the next reclaim at
+
+public:
+    static constexpr uint32_t no_slot{std::numeric_limits< uint32_t >::max()};
+
+    /* RAII guard of a reader critical section. Reader has to check entered() before going lock free. */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(EpochReclaimer& r) : m_reclaimer{r}, m_slot{r.enter()} {}
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ~ReadGuard() {
+            if (entered()) { m_reclaimer.exit(m_slot); }
+        }
+
+        bool entered() const { return (m_slot != no_slot); }
+
+    private:
+        EpochReclaimer& m_reclaimer;
+        uint32_t m_slot;
+    };
+
+    EpochReclaimer() = default;
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    /// @brief Enters a reader critical section, announcing the current epoch. Returns the slot to be passed to exit(),
+    /// or no_slot if all the reader slots are taken.
+    uint32_t enter() {
+        static thread_local uint32_t const slot_hint =
+            uint32_t(std::hash< std::thread::id >{}(std::this_thread::get_id()) % num_reader_slots);
+
+        uint64_t const epoch = m_global_epoch.load();
+        for (uint32_t i{0}; i < num_reader_slots; ++i) {
+            auto const slot = (slot_hint + i) % num_reader_slots;
+            uint64_t expected{inactive_epoch};
+            if (m_slots[slot].epoch.compare_exchange_strong(expected, epoch)) { return slot; }
+        }
+        return no_slot;
+    }
+
+    /// @brief Exits the reader critical section, attempting a reclaim if enough objects are retired since the last one
+    void exit(uint32_t slot) {
+        m_slots[slot].epoch.store(inactive_epoch, std::memory_order_release);
+        if (is_reclaim_due()) { reclaim(false /* wait */); }
+    }
+
+    /// @brief Retires an object, which is already unlinked and no new reader can reach it. Object is dropped once the
+    /// readers which could have seen it are done.
+    void retire(T obj) {
+        {
+            std::unique_lock lg(m_retired_mtx);
+            m_retired.emplace_back(m_global_epoch.fetch_add(1), std::move(obj));
+            m_num_retired.store(uint32_t(m_retired.size()));
+        }
+        if (is_reclaim_due()) { reclaim(false /* wait */); }
+    }
+
+    /// @brief Releases all the retired objects which none of the active readers could be referencing.
+    ///
+    /// @param wait Whether to wait for the retire list lock, if it is contended
+    void reclaim(bool wait = true) {
+        std::vector< std::pair< uint64_t, T > > released;
+        {
+            std::unique_lock lg(m_retired_mtx, std::defer_lock);
+            if (wait) {
+                lg.lock();
+            } else if (!lg.try_lock()) {
+                return;
+            }
+            if (m_retired.empty()) { return; }
+
+            auto const min_epoch = min_active_epoch();
+            auto it = std::partition(m_retired.begin(), m_retired.end(),
+                                     [min_epoch](auto const& r) { return r.first >= min_epoch; });
+            released.insert(released.end(), std::make_move_iterator(it), std::make_move_iterator(m_retired.end()));
+            m_retired.erase(it, m_retired.end());
+            m_num_retired.store(uint32_t(m_retired.size()));
+            m_next_reclaim_at.store(uint32_t(m_retired.size()) + reclaim_batch);
+        }
+        // Dropping the objects outside the lock releases them
+    }
+
+    uint32_t num_retired() const { return m_num_retired.load(); }
+
+private:
+    bool is_reclaim_due() const {
+        return (m_num_retired.load(std::memory_order_relaxed) >= m_next_reclaim_at.load(std::memory_order_relaxed));
+    }
+
+    uint64_t min_active_epoch() const {
+        uint64_t min_epoch{std::numeric_limits< uint64_t >::max()};
+        for (auto const& s : m_slots) {
+            auto const e = s.epoch.load();
+            if ((e != inactive_epoch) && (e < min_epoch)) { min_epoch = e; }
+        }
+        return min_epoch;
+    }
+};
+} // namespace homestore
@@ -24,6 +24,8 @@ btree_status_t Btree< K, V >::do_get(const BtreeNodePtr& my_node, ReqT& greq) co
     bool found{false};
     uint32_t idx;
 
+    if constexpr (std::is_same_v< BtreeMultiGetRequest< K >, ReqT >) { return do_multi_get(my_node, greq); }
+
     if (my_node->is_leaf()) {
         if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
             std::tie(found, idx) =
@@ -40,6 +42,21 @@ btree_status_t Btree< K, V >::do_get(const BtreeNodePtr& my_node, ReqT& greq) co
         return ret;
     }
 
+    if constexpr (std::is_same_v< BtreeSingleGetRequest, ReqT >) {
+        // Message of the key in the buffer of an interior node is newer than whatever is below it
+        if (is_msg_buffered()) {
+            if (auto const msg = msg_buffer(my_node).find(greq.key().serialize())) {
+                if (msg->type == btree_msg_type::REMOVE) {
+                    ret = btree_status_t::not_found;
+                } else if (greq.m_outval) {
+                    greq.m_outval->deserialize(msg->val, true /* copy */);
+                }
+                unlock_node(my_node, locktype_t::READ);
+                return ret;
+            }
+        }
+    }
+
     BtreeLinkInfo child_info;
     if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
         std::tie(found, idx) = my_node->find(greq.m_range.start_key(), &child_info, true);
@@ -54,6 +71,13 @@ btree_status_t Btree< K, V >::do_get(const BtreeNodePtr& my_node, ReqT& greq) co
     ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ, greq.m_op_context);
     if (ret != btree_status_t::success) { goto out; }
 
+    if constexpr (std::is_same_v< BtreeGetAnyRequest< K >, ReqT >) {
+        ret = move_to_split_sibling(child_node, child_info, greq.m_range.start_key(), greq.m_op_context);
+    } else if constexpr (std::is_same_v< BtreeSingleGetRequest, ReqT >) {
+        ret = move_to_split_sibling(child_node, child_info, greq.key(), greq.m_op_context);
+    }
+    if (ret != btree_status_t::success) { goto out; }
+
     unlock_node(my_node, locktype_t::READ);
     return (do_get(child_node, greq));
 
@@ -61,4 +85,114 @@ out:
     unlock_node(my_node, locktype_t::READ);
     return ret;
 }
+
+/* Resolve all the pending keys of the multi get request which falls within the subtree of my_node. The interior node
+ * lock is retained while descending to each child, so that consecutive keys reuse the already locked path instead of
+ * walking from root again. All keys landing on a leaf are looked up under a single read lock.
+ *
+ * NOTE: It expects my_node to be read locked and it is unlocked upon return.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::do_multi_get(const BtreeNodePtr& my_node, BtreeMultiGetRequest< K >& greq) const {
+    btree_status_t ret{btree_status_t::success};
+    bool const has_my_end{greq.has_end_key()};
+    K my_end_key;
+    if (has_my_end) { my_end_key = greq.end_key(); }
+
+    auto const within_my_range = [&]() {
+        return !greq.is_done() && (!has_my_end || (greq.key().compare(my_end_key) <= 0));
+    };
+
+    if (my_node->is_leaf()) {
+        uint32_t start_idx{0};
+        uint32_t end_idx{0};
+        bool first{true};
+        while (within_my_range()) {
+            auto& entry = greq.cur_entry();
+            auto const [found, idx] = my_node->find(*entry.m_k, entry.m_outval, true);
+            entry.m_found = found;
+            if (found) {
+                if (first) { start_idx = idx; }
+                end_idx = idx;
+                first = false;
+            }
+            greq.advance();
+        }
+        if (greq.route_tracing) { append_route_trace(greq, my_node, btree_event_t::READ, start_idx, end_idx); }
+        unlock_node(my_node, locktype_t::READ);
+        return ret;
+    }
+
+    while (within_my_range()) {
+        if (is_msg_buffered()) {
+            if (auto const msg = msg_buffer(my_node).find(greq.key().serialize())) {
+                auto& entry = greq.cur_entry();
+                entry.m_found = (msg->type == btree_msg_type::PUT);
+                if (entry.m_found && entry.m_outval) { entry.m_outval->deserialize(msg->val, true /* copy */); }
+                greq.advance();
+                continue;
+            }
+        }
+
+        BtreeLinkInfo child_info;
+        auto const [found, idx] = my_node->find(greq.key(), &child_info, true);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(found, idx, my_node);
+        if (greq.route_tracing) { append_route_trace(greq, my_node, btree_event_t::READ, idx, idx); }
+
+        BtreeNodePtr child_node;
+        ret =
+            read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ, greq.m_op_context);
+        if (ret != btree_status_t::success) { break; }
+        ret = move_to_split_sibling(child_node, child_info, greq.key(), greq.m_op_context);
+        if (ret != btree_status_t::success) { break; }
+
+        // Child subtree is bounded by the key at idx, except for edge which inherits the bound of this node. Child
+        // split not yet linked to this node is bounded by its last key, keys past it are looked up again from here.
+        if (is_repair_needed(child_node, child_info) && (child_node->total_entries() != 0)) {
+            greq.set_end_key(child_node->get_last_key< K >());
+        } else if (idx < my_node->total_entries()) {
+            greq.set_end_key(my_node->get_nth_key< K >(idx, true));
+        } else if (has_my_end) {
+            greq.set_end_key(my_end_key);
+        } else {
+            greq.reset_end_key();
+        }
+        // Keys which have a message in this node or above are resolved there, hence the child is bounded by the key
+        // before them, which could be narrower than the bound of the child in this node
+        if (is_msg_buffered()) {
+            if (has_my_end && (greq.end_key().compare(my_end_key) > 0)) { greq.set_end_key(my_end_key); }
+            bound_by_msgs(my_node, greq);
+        }
+
+        ret = do_multi_get(child_node, greq);
+        if (ret != btree_status_t::success) { break; }
+    }
+
+    unlock_node(my_node, locktype_t::READ);
+    return ret;
+}
+
+/* Narrows down the keys the child being descended to by the multi get resolves, to the ones before the first key which
+ * has a message in the node, so that it is resolved from the message once the descent returns to the node. */
+template < typename K, typename V >
+void Btree< K, V >::bound_by_msgs(const BtreeNodePtr& node, BtreeMultiGetRequest< K >& greq) const {
+    auto const buf = msg_buffer(node);
+    if (buf.empty()) { return; }
+
+    auto const& entries = greq.entries();
+    for (auto i = greq.cur_idx() + 1; i < entries.size(); ++i) {
+        if (greq.has_end_key() && (entries[i].m_k->compare(greq.end_key()) > 0)) { return; }
+        if (buf.find(entries[i].m_k->serialize())) {
+            // Duplicates of the key before it are resolved from the message as well
+            auto prev = i - 1;
+            while (entries[prev].m_k->compare(*entries[i].m_k) == 0) {
+                --prev;
+            }
+            K end_key;
+            end_key.deserialize(entries[prev].m_k->serialize(), true /* copy */);
+            greq.set_end_key(end_key);
+            return;
+        }
+    }
+}
 } // namespace homestore
@@ -240,9 +240,20 @@ struct BtreeConfig {
     uint8_t m_ideal_fill_pct{90};
     uint8_t m_suggested_min_pct{30};
     uint8_t m_split_pct{50};
+    uint8_t m_append_split_pct{0}; // Pct of entries moved out on split of the right most node by an append, 0=off
     uint32_t m_max_merge_nodes{3};
+    uint8_t m_merge_fill_pct{0}; // Pct merges fill the nodes upto, short of ideal fill to leave room for puts, 0=ideal
+    uint32_t m_max_deferred_merges{0}; // Defer merges of underfull leaves on removes to rebalance(), upto these, 0=off
     bool m_rebalance_turned_on{false};
     bool m_merge_turned_on{true};
+    bool m_optimistic_read_turned_on{false}; // Version validated lock free interior traversal for get and sweep query
+    bool m_huge_page_nodes{false};          // Back the node buffers of in-memory btree with huge pages
+    uint64_t m_bloom_filter_keys{0};        // Expected number of keys to size the index table bloom filter, 0=off
+    bool m_key_heads_turned_on{false};      // Keep 8 byte key heads in var key node records, if key has key_head()
+    bool m_subtree_counts_turned_on{false}; // Keep entry counts of child subtrees in interior nodes
+    bool m_blink_splits_turned_on{false};   // Split leaves under read locked parent, linking them to parent after
+    bool m_upgrade_locks_turned_on{false};  // Upgrade lock parents of leaves to split or merge, to promote in place
+    uint32_t m_msg_buffer_size{0};          // Bytes at the tail of interior nodes to buffer the writes in, 0=off
 
     btree_node_type m_leaf_node_type{btree_node_type::VAR_OBJECT};
     btree_node_type m_int_node_type{btree_node_type::VAR_KEY};
@@ -267,6 +278,14 @@ public:
     uint32_t split_size(uint32_t filled_size) const { return uint32_cast(filled_size * m_split_pct) / 100; }
     uint32_t ideal_fill_size() const { return m_ideal_fill_size; }
     uint32_t suggested_min_size() const { return m_suggested_min_size; }
+
+    // Nodes are merged only below the suggested min size and only upto the merge fill size, which is kept at least
+    // twice the min size. Merged node is thus left with room for puts before it splits again, and a split leaves nodes
+    // well past the min size, so that keys oscillating around a node boundary don't split and merge it back and forth.
+    uint32_t merge_fill_size() const {
+        if (m_merge_fill_pct == 0) { return m_ideal_fill_size; }
+        return std::max((uint32_t)(m_node_data_size * m_merge_fill_pct) / 100, 2 * m_suggested_min_size);
+    }
     uint32_t node_data_size() const { return m_node_data_size; }
 
     void set_node_data_size(uint32_t data_size) {
@@ -299,7 +318,13 @@ public:
         REGISTER_COUNTER(btree_int_node_count, "Btree Interior node count", "btree_node_count",
                          {"node_type", "interior"}, _publish_as::publish_as_gauge);
         REGISTER_COUNTER(btree_split_count, "Total number of btree node splits");
+        REGISTER_COUNTER(btree_append_split_count, "Total number of asymmetric splits due to appends");
+        REGISTER_COUNTER(btree_blink_split_count, "Total number of leaf splits done before linking them to parent");
         REGISTER_COUNTER(btree_merge_count, "Total number of btree node merges");
+        REGISTER_COUNTER(btree_deferred_merge_count, "Total number of merges deferred by removes to rebalance");
+        REGISTER_COUNTER(btree_subtree_drop_count, "Total number of subtrees dropped by range removes");
+        REGISTER_COUNTER(btree_msg_buffered_count, "Total number of writes buffered in the interior nodes");
+        REGISTER_COUNTER(btree_msg_flush_count, "Total number of message batches flushed down to a child");
         REGISTER_COUNTER(btree_depth, "Depth of btree", _publish_as::publish_as_gauge);
 
         REGISTER_COUNTER(btree_int_node_writes, "Total number of btree interior node writes", "btree_node_writes",
@@ -313,6 +338,10 @@ public:
         REGISTER_HISTOGRAM(btree_leaf_node_occupancy, "Leaf node occupancy", "btree_node_occupancy",
                            {"node_type", "leaf"}, HistogramBucketsType(LinearUpto128Buckets));
         REGISTER_COUNTER(btree_retry_count, "number of retries");
+        REGISTER_COUNTER(btree_optimistic_read_count, "number of reads done through optimistic traversal");
+        REGISTER_COUNTER(btree_optimistic_read_fallbacks, "number of optimistic reads fell back to locked traversal");
+        REGISTER_COUNTER(btree_upgrade_lock_count, "number of upgrade locks taken on parents of leaves to change");
+        REGISTER_COUNTER(btree_lock_promote_count, "number of upgrade locks promoted to write in place");
         REGISTER_COUNTER(write_err_cnt, "number of errors in write");
         REGISTER_COUNTER(query_err_cnt, "number of errors in query");
         REGISTER_COUNTER(read_node_count_in_write_ops, "number of nodes read in write_op");
@@ -0,0 +1,160 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <cstring>
+#include <optional>
+#include <sisl/fds/buffer.hpp>
+#include <sisl/utility/enum.hpp>
+
+namespace homestore {
+ENUM(btree_msg_type, uint8_t, PUT, REMOVE)
+
+/* BtreeMsgBuffer is a view over the message buffer an interior node keeps at the tail of its node buffer, past its node
+ * size, in a btree with buffered messages (see btree_buffer_impl.ipp). Buffer holds the writes yet to be applied to the
+ * subtree under the node, atmost one per key, in the order they were added:
+ *
+ * | msg_buffer_hdr | type | key_size | val_size | key | val | type | key_size | val_size | key | val | ... |
+ *
+ * Keys are compared by their serialized bytes, which is all that is needed to find the message of a key. Buffer is part
+ * of the node buffer, hence persisted and recovered along with the node.
+ */
+class BtreeMsgBuffer {
+public:
+#pragma pack(1)
+    struct msg_buffer_hdr {
+        uint16_t nmsgs{0};
+        uint16_t used_size{0}; // Bytes taken by the messages past the header
+    };
+
+    struct msg_hdr {
+        uint8_t type;
+        uint16_t key_size;
+        uint16_t val_size;
+    };
+#pragma pack()
+
+    struct msg_t {
+        btree_msg_type type;
+        sisl::blob key;
+        sisl::blob val;
+        uint32_t offset; // Offset of the message within the buffer, valid till the buffer is modified
+        uint32_t size;
+    };
+
+private:
+    uint8_t* m_area;
+    uint32_t m_size;
+
+public:
+    BtreeMsgBuffer(uint8_t* area, uint32_t size) : m_area{area}, m_size{size} {}
+
+    static uint32_t msg_size(uint32_t key_size, uint32_t val_size) { return sizeof(msg_hdr) + key_size + val_size; }
+
+    uint32_t num_msgs() const { return hdr()->nmsgs; }
+    bool empty() const { return (hdr()->nmsgs == 0); }
+    uint32_t capacity() const { return m_size - sizeof(msg_buffer_hdr); }
+    uint32_t available_size() const { return capacity() - hdr()->used_size; }
+
+    /// @brief Calls the callback for every message in the order they were added, till it returns false
+    template < typename CbT >
+    void for_each(CbT&& cb) const {
+        uint32_t offset{sizeof(msg_buffer_hdr)};
+        for (uint32_t i{0}; i < hdr()->nmsgs; ++i) {
+            auto const msg = msg_at(offset);
+            if (!cb(msg)) { return; }
+            offset += msg.size;
+        }
+    }
+
+    std::optional< msg_t > find(sisl::blob const& key) const {
+        std::optional< msg_t > ret;
+        for_each([&key, &ret](msg_t const& msg) {
+            if ((msg.key.size == key.size) && (std::memcmp(msg.key.bytes, key.bytes, key.size) == 0)) {
+                ret = msg;
+                return false;
+            }
+            return true;
+        });
+        return ret;
+    }
+
+    /// @brief Whether the message fits in, replacing the existing message of its key if any
+    bool has_room(uint32_t size, std::optional< msg_t > const& existing) const {
+        return (size <= available_size() + (existing ? existing->size : 0));
+    }
+
+    /// @brief Adds the message, replacing the existing message of the key if any. Caller is expected to have checked
+    /// for room through has_room().
+    void add(btree_msg_type type, sisl::blob const& key, sisl::blob const& val) {
+        if (auto const existing = find(key)) { erase(*existing); }
+
+        auto const size = msg_size(key.size, val.size);
+        uint8_t* p = m_area + sizeof(msg_buffer_hdr) + hdr()->used_size;
+        auto* mhdr = r_cast< msg_hdr* >(p);
+        mhdr->type = s_cast< uint8_t >(type);
+        mhdr->key_size = s_cast< uint16_t >(key.size);
+        mhdr->val_size = s_cast< uint16_t >(val.size);
+        std::memcpy(p + sizeof(msg_hdr), key.bytes, key.size);
+        if (val.size != 0) { std::memcpy(p + sizeof(msg_hdr) + key.size, val.bytes, val.size); }
+        hdr()->used_size += size;
+        ++hdr()->nmsgs;
+    }
+
+    void erase(msg_t const& msg) {
+        uint32_t const end = sizeof(msg_buffer_hdr) + hdr()->used_size;
+        std::memmove(m_area + msg.offset, m_area + msg.offset + msg.size, end - msg.offset - msg.size);
+        hdr()->used_size -= msg.size;
+        --hdr()->nmsgs;
+    }
+
+    /// @brief Erases all the messages the predicate returns true for, compacting the rest in a single pass
+    template < typename PredT >
+    uint32_t erase_if(PredT&& pred) {
+        uint32_t const end = sizeof(msg_buffer_hdr) + hdr()->used_size;
+        uint32_t read_offset{sizeof(msg_buffer_hdr)};
+        uint32_t write_offset{sizeof(msg_buffer_hdr)};
+        uint32_t nerased{0};
+        while (read_offset < end) {
+            auto const msg = msg_at(read_offset);
+            if (pred(msg)) {
+                ++nerased;
+            } else {
+                if (write_offset != read_offset) {
+                    std::memmove(m_area + write_offset, m_area + read_offset, msg.size);
+                }
+                write_offset += msg.size;
+            }
+            read_offset += msg.size;
+        }
+        hdr()->used_size = s_cast< uint16_t >(write_offset - sizeof(msg_buffer_hdr));
+        hdr()->nmsgs -= nerased;
+        return nerased;
+    }
+
+private:
+    msg_buffer_hdr* hdr() { return r_cast< msg_buffer_hdr* >(m_area); }
+    msg_buffer_hdr const* hdr() const { return r_cast< msg_buffer_hdr const* >(m_area); }
+
+    msg_t msg_at(uint32_t offset) const {
+        auto const* mhdr = r_cast< msg_hdr const* >(m_area + offset);
+        uint8_t* key = m_area + offset + sizeof(msg_hdr);
+        return msg_t{s_cast< btree_msg_type >(mhdr->type), sisl::blob{key, mhdr->key_size},
+                     sisl::blob{key + mhdr->key_size, mhdr->val_size}, offset,
+                     msg_size(mhdr->key_size, mhdr->val_size)};
+    }
+};
+} // namespace homestore
@@ -37,7 +37,9 @@ btree_status_t Btree< K, V >::do_put(const BtreeNodePtr& my_node, locktype_t cur
     if (my_node->is_leaf()) {
         /* update the leaf node */
         BT_NODE_LOG_ASSERT_EQ(curlock, locktype_t::WRITE, my_node);
+        auto const nentries = my_node->total_entries();
         ret = mutate_write_leaf_node(my_node, req);
+        if (is_subtree_counted()) { count_leaf_change< ReqT >(int64_t(my_node->total_entries()) - nentries); }
         unlock_node(my_node, curlock);
         return ret;
     }
@@ -54,14 +56,15 @@ retry:
             ret = btree_status_t::put_failed;
             goto out;
         }
-    } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+    } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest > ||
+                         std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
         auto const [found, idx] = my_node->find(req.key(), nullptr, true);
         ASSERT_IS_VALID_INTERIOR_CHILD_INDX(found, idx, my_node);
         end_idx = start_idx = idx;
     }
 
-    BT_NODE_DBG_ASSERT((curlock == locktype_t::READ || curlock == locktype_t::WRITE), my_node, "unexpected locktype {}",
-                       curlock);
+    BT_NODE_DBG_ASSERT((curlock == locktype_t::READ || curlock == locktype_t::WRITE || curlock == locktype_t::UPGRADE),
+                       my_node, "unexpected locktype {}", curlock);
 
     if (req.route_tracing) { append_route_trace(req, my_node, btree_event_t::READ, start_idx, end_idx); }
 
@@ -80,8 +83,8 @@ retry:
         // Get the childPtr for given key.
         BtreeLinkInfo child_info;
         BtreeNodePtr child_node;
-        ret = get_child_and_lock_node(my_node, curr_idx, child_info, child_node, locktype_t::READ, locktype_t::WRITE,
-                                      req.m_op_context);
+        ret = get_child_and_lock_node(my_node, curr_idx, child_info, child_node, interior_write_lock< ReqT >(),
+                                      locktype_t::WRITE, req.m_op_context);
         if (ret != btree_status_t::success) {
             if (ret == btree_status_t::not_found) {
                 // Either the node was updated or mynode is freed. Just proceed again from top.
@@ -94,18 +97,50 @@ retry:
         }
 
         // Directly get write lock for leaf, since its an insert.
-        child_cur_lock = (child_node->is_leaf()) ? locktype_t::WRITE : locktype_t::READ;
+        child_cur_lock = (child_node->is_leaf()) ? locktype_t::WRITE : interior_write_lock< ReqT >();
 
         // If the child and child_info link in the parent mismatch, we need to do btree repair, it might have
-        // encountered a crash in-between the split or merge and only partial commit happened.
+        // encountered a crash in-between the split or merge and only partial commit happened, or a leaf split is yet
+        // to be linked to this node.
         if (is_split_needed(child_node, req) || is_repair_needed(child_node, child_info)) {
-            ret = upgrade_node_locks(my_node, child_node, curlock, child_cur_lock, req.m_op_context);
-            if (ret != btree_status_t::success) {
-                BT_NODE_LOG(DEBUG, my_node, "Upgrade of node lock failed, retrying from root");
-                curlock = locktype_t::NONE; // upgrade_node_lock releases all locks on failure
+            if (is_blink_split(child_node, child_info)) {
+                BT_NODE_LOG(TRACE, child_node, "Split node needed, splitting it before linking to parent");
+                ret = split_node_unlinked(child_node, req.m_op_context, is_append_split(child_node, req));
+                unlock_node(child_node, locktype_t::WRITE);
+                child_cur_lock = locktype_t::NONE;
+                if (ret != btree_status_t::success) { goto out; }
+
+                if (req.route_tracing) { append_route_trace(req, child_node, btree_event_t::SPLIT); }
+                COUNTER_INCREMENT(m_metrics, btree_split_count, 1);
+                goto retry; // Walks down to the child again, linking the split to this node
+            }
+
+            // Separator takes an entry in this node, which the splits linked since it was checked by its parent might
+            // have used up. Start over, so that this node is split first.
+            if (is_split_needed(my_node, req)) {
+                unlock_node(child_node, child_cur_lock);
                 child_cur_lock = locktype_t::NONE;
+                ret = btree_status_t::retry;
                 goto out;
             }
+
+            if (curlock == locktype_t::UPGRADE) {
+                ret = promote_node_locks(my_node, child_node, child_cur_lock, req.m_op_context);
+                curlock = locktype_t::WRITE; // Promoted in place, so this node stays locked even on failure
+                if (ret != btree_status_t::success) {
+                    child_cur_lock = locktype_t::NONE;
+                    if (ret == btree_status_t::retry) { goto retry; } // Child changed while released, check again
+                    goto out;
+                }
+            } else {
+                ret = upgrade_node_locks(my_node, child_node, curlock, child_cur_lock, req.m_op_context);
+                if (ret != btree_status_t::success) {
+                    BT_NODE_LOG(DEBUG, my_node, "Upgrade of node lock failed, retrying from root");
+                    curlock = locktype_t::NONE; // upgrade_node_lock releases all locks on failure
+                    child_cur_lock = locktype_t::NONE;
+                    goto out;
+                }
+            }
             curlock = child_cur_lock = locktype_t::WRITE;
 
             if (is_repair_needed(child_node, child_info)) {
@@ -114,7 +149,8 @@ retry:
             } else {
                 K split_key;
                 BT_NODE_LOG(TRACE, my_node, "Split node needed");
-                ret = split_node(my_node, child_node, curr_idx, &split_key, req.m_op_context);
+                ret = split_node(my_node, child_node, curr_idx, &split_key, req.m_op_context,
+                                 is_append_split(child_node, req));
             }
             unlock_node(child_node, locktype_t::WRITE);
             child_cur_lock = locktype_t::NONE;
@@ -143,6 +179,12 @@ retry:
                 BT_NODE_LOG(DEBUG, my_node, "Subrange:idx=[{}-{}],c={},working={}", start_idx, end_idx, curr_idx,
                             req.working_range().to_string());
             }
+        } else if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+            // Narrow down the upper bound of keys the child can accept. For edge child, the bound inherited from the
+            // ancestors continue to apply.
+            if (curr_idx < my_node->total_entries()) {
+                req.set_leaf_end_key(my_node->get_nth_key< K >(curr_idx, true));
+            }
         }
 
 #ifndef NDEBUG
@@ -168,14 +210,24 @@ retry:
             // BT_NODE_DBG_ASSERT_EQ((is_range_put_req(req) || k.compare(pkey) >= 0), true, my_node);
         }
 #endif
-        if (curr_idx == end_idx) {
+        ret = upgrade_lock_leaf_parent(child_node, child_cur_lock, req);
+        if (ret != btree_status_t::success) { goto out; }
+
+        if ((curr_idx == end_idx) && !is_counted_on_unwind< ReqT >()) {
             // If we have reached the last index, unlock before traversing down, because we no longer need
             // this lock. Holding this lock will impact performance unncessarily.
             unlock_node(my_node, curlock);
             curlock = locktype_t::NONE;
         }
 
-        ret = do_put(child_node, child_cur_lock, req);
+        {
+            // Keys put in the child could have been partially applied even on failure
+            auto const prev_delta = m_subtree_delta;
+            ret = do_put(child_node, child_cur_lock, req);
+            if (is_counted_on_unwind< ReqT >()) {
+                update_child_count(my_node, curr_idx, m_subtree_delta - prev_delta, req.m_op_context);
+            }
+        }
         if (ret != btree_status_t::success) { goto out; }
 
         ++curr_idx;
@@ -194,18 +246,54 @@ btree_status_t Btree< K, V >::mutate_write_leaf_node(const BtreeNodePtr& my_node
     if constexpr (std::is_same_v< ReqT, BtreeRangePutRequest< K > >) {
         K last_failed_key;
         ret = to_variant_node(my_node)->multi_put(req.working_range(), req.input_range().start_key(), *req.m_newval,
-                                                  req.m_put_type, &last_failed_key, req.m_filter_cb);
+                                                  req.m_put_type, &last_failed_key, req.m_filter_cb, req.m_merge_cb);
         if (ret == btree_status_t::has_more) {
             req.shift_working_range(std::move(last_failed_key), true /* make it including last_failed_key */);
         } else if (ret == btree_status_t::success) {
             req.shift_working_range();
         }
     } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+        // Merged value may not fit though the value being merged did, start over so that the leaf is split first
+        if ((req.m_put_type == btree_put_type::MERGE) &&
+            !my_node->has_room_for_put(btree_put_type::UPDATE, req.key().serialized_size(),
+                                       leaf_put_value_size(my_node, req))) {
+            return btree_status_t::has_more;
+        }
         if (!to_variant_node(my_node)->put(req.key(), req.value(), req.m_put_type, req.m_existing_val,
-                                           req.m_filter_cb)) {
+                                           req.m_filter_cb, req.m_merge_cb)) {
             ret = btree_status_t::put_failed;
         }
         COUNTER_INCREMENT(m_metrics, btree_obj_count, 1);
+    } else if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+        // Apply all the keys which belongs to this leaf under the same lock. If the node runs out of space, we return
+        // has_more, so that the next descent splits this node once and continues with remaining keys.
+        uint32_t nput{0};
+        while (!req.is_done()) {
+            if (req.has_leaf_end_key() && (req.key().compare(req.leaf_end_key()) > 0)) { break; }
+            if (!my_node->has_room_for_put(req.m_put_type, req.key().serialized_size(),
+                                           leaf_put_value_size(my_node, req))) {
+                break;
+            }
+
+            auto& entry = req.cur_entry();
+            entry.m_done = to_variant_node(my_node)->put(*entry.m_k, *entry.m_v, req.m_put_type, entry.m_existing_val,
+                                                         req.m_filter_cb, req.m_merge_cb);
+            if (entry.m_done) { ++nput; }
+            req.advance();
+        }
+        COUNTER_INCREMENT(m_metrics, btree_obj_count, nput);
+
+        if (!req.is_done()) {
+            ret = btree_status_t::has_more;
+        } else if (req.num_failed() != 0) {
+            ret = btree_status_t::put_failed;
+        }
+
+        if (nput != 0) {
+            if (req.route_tracing) { append_route_trace(req, my_node, btree_event_t::MUTATE); }
+            write_node(my_node, req.m_op_context);
+        }
+        return ret;
     }
 
     if ((ret == btree_status_t::success) || (ret == btree_status_t::has_more)) {
@@ -257,7 +345,8 @@ btree_status_t Btree< K, V >::check_split_root(ReqT& req) {
     if (is_repair_needed(child_node, m_root_node_info)) {
         ret = repair_split(root, child_node, root->total_entries(), req.m_op_context);
     } else {
-        ret = split_node(root, child_node, root->total_entries(), &split_key, req.m_op_context);
+        ret = split_node(root, child_node, root->total_entries(), &split_key, req.m_op_context,
+                         is_append_split(child_node, req));
     }
 
     if (ret != btree_status_t::success) {
@@ -270,7 +359,7 @@ btree_status_t Btree< K, V >::check_split_root(ReqT& req) {
         m_root_node_info = BtreeLinkInfo{root->node_id(), root->link_version()};
         unlock_node(child_node, locktype_t::WRITE);
         COUNTER_INCREMENT(m_metrics, btree_depth, 1);
-        update_new_root_info(root->node_id(), root->link_version());
+        update_new_root_info(root->node_id(), root->link_version(), req.m_op_context);
     }
 
 done:
@@ -280,37 +369,50 @@ done:
 
 template < typename K, typename V >
 btree_status_t Btree< K, V >::split_node(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
-                                         uint32_t parent_ind, K* out_split_key, void* context) {
+                                         uint32_t parent_ind, K* out_split_key, void* context, bool append_split) {
     BtreeNodePtr child_node1 = child_node;
     BtreeNodePtr child_node2;
-    child_node2.reset(child_node1->is_leaf() ? alloc_leaf_node().get() : alloc_interior_node().get());
-
-    if (child_node2 == nullptr) { return (btree_status_t::space_not_avail); }
-
-    btree_status_t ret = btree_status_t::success;
-
-    child_node2->set_next_bnode(child_node1->next_bnode());
-    child_node1->set_next_bnode(child_node2->node_id());
-    child_node2->set_level(child_node1->level());
-    uint32_t child1_filled_size = m_bt_cfg.node_data_size() - child_node1->available_size();
-
-    auto split_size = m_bt_cfg.split_size(child1_filled_size);
-    uint32_t res = child_node1->move_out_to_right_by_size(m_bt_cfg, *child_node2, split_size);
-
-    BT_NODE_REL_ASSERT_GT(res, 0, child_node1,
-                          "Unable to split entries in the child node"); // means cannot split entries
-    BT_NODE_DBG_ASSERT_GT(child_node1->total_entries(), 0, child_node1);
+    btree_status_t ret = split_to_right(child_node1, child_node2, append_split);
+    if (ret != btree_status_t::success) { return ret; }
 
     // Insert the last entry in first child to parent node
     *out_split_key = child_node1->get_last_key< K >();
+    if constexpr (has_shortest_separator_v< K >) {
+        // For variable sized interior keys, promote the shortest key which still separates the two leaves, so that the
+        // interior nodes hold more children. Interior node split has to promote its last key as is, since it is also
+        // the separator of its last child in the level below.
+        auto const int_type = m_bt_cfg.interior_node_type();
+        if (child_node1->is_leaf() &&
+            ((int_type == btree_node_type::VAR_KEY) || (int_type == btree_node_type::VAR_OBJECT) ||
+             (int_type == btree_node_type::COMPACT))) {
+            *out_split_key = K::shortest_separator(*out_split_key, child_node2->get_first_key< K >());
+            BT_NODE_DBG_ASSERT_LE(child_node1->get_last_key< K >().compare(*out_split_key), 0, child_node1);
+        }
+    }
+
+    if (is_msg_buffered() && !child_node1->is_leaf()) { split_msgs(child_node1, child_node2, *out_split_key); }
 
     BT_NODE_LOG(TRACE, parent_node, "Available space for split entry={}", parent_node->available_size());
 
     child_node1->inc_link_version();
 
-    // Update the existing parent node entry to point to second child ptr.
-    parent_node->update(parent_ind, child_node2->link_info());
-    parent_node->insert(parent_ind, *out_split_key, child_node1->link_info());
+    // Left child is left without edge, so its count is known from its entries. So is the right one's, unless it is the
+    // edge of the parent, which is not counted. Counts of both are recomputed, rather than splitting the count of the
+    // child, so that an error in it left by a concurrent write moves up to the count of the parent (see
+    // btree_count_impl.ipp).
+    uint64_t child1_count{0};
+    uint64_t child2_count{0};
+    if (is_subtree_counted()) {
+        child1_count = subtree_count(child_node1);
+        if (parent_ind < parent_node->total_entries()) { child2_count = subtree_count(child_node2); }
+    }
+
+    // Update the existing parent node entry to point to second child ptr. It replaces only the link of the entry, which
+    // takes the same room as before for any node type, so the child split above is never left without its parent.
+    ret = parent_node->update(parent_ind, child_link(child_node2->link_info(), child2_count));
+    BT_NODE_REL_ASSERT_EQ(ret, btree_status_t::success, parent_node, "Link update of split child idx={} failed",
+                          parent_ind);
+    parent_node->insert(parent_ind, *out_split_key, child_link(child_node1->link_info(), child1_count));
 
     BT_NODE_DBG_ASSERT_GT(child_node2->get_first_key< K >().compare(*out_split_key), 0, child_node2);
     BT_NODE_LOG(DEBUG, parent_node, "Split child_node={} with new_child_node={}, split_key={}", child_node1->node_id(),
@@ -325,15 +427,150 @@ btree_status_t Btree< K, V >::split_node(const BtreeNodePtr& parent_node, const
     return ret;
 }
 
+/* Move the entries past the split point of the node to a newly allocated right sibling, which takes its place in the
+ * sibling chain. Neither node is written.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::split_to_right(const BtreeNodePtr& child_node1, BtreeNodePtr& child_node2,
+                                             bool append_split) {
+    child_node2.reset(child_node1->is_leaf() ? alloc_leaf_node().get() : alloc_interior_node().get());
+    if (child_node2 == nullptr) { return (btree_status_t::space_not_avail); }
+
+    child_node2->set_next_bnode(child_node1->next_bnode());
+    child_node1->set_next_bnode(child_node2->node_id());
+    child_node2->set_level(child_node1->level());
+    uint32_t child1_filled_size = child_node1->node_data_size() - child_node1->available_size();
+
+    uint32_t res;
+    if (append_split) {
+        // Appends past the right most node would never land on the left node again, so leave it filled and move only
+        // a small portion to the right, which is where the subsequent appends go.
+        auto const nentries = std::clamp(child_node1->total_entries() * m_bt_cfg.m_append_split_pct / 100, 1u,
+                                         child_node1->total_entries() - 1);
+        res = child_node1->move_out_to_right_by_entries(m_bt_cfg, *child_node2, nentries);
+        COUNTER_INCREMENT(m_metrics, btree_append_split_count, 1);
+    } else {
+        auto split_size = m_bt_cfg.split_size(child1_filled_size);
+        res = child_node1->move_out_to_right_by_size(m_bt_cfg, *child_node2, split_size);
+    }
+
+    BT_NODE_REL_ASSERT_GT(res, 0, child_node1,
+                          "Unable to split entries in the child node"); // means cannot split entries
+    BT_NODE_DBG_ASSERT_GT(child_node1->total_entries(), 0, child_node1);
+    return btree_status_t::success;
+}
+
+/* B-link split: Split the leaf holding only its own write lock, with the parent just read locked, so that the other
+ * operations under the parent are not held up for the split. Right node is linked only through the sibling chain and
+ * the parent link of the left node is left stale, which is the same state a split interrupted by a crash leaves
+ * behind. Separator is inserted into the parent afterwards by repair_split(), by whoever next writes through the
+ * parent, under a brief parent write lock. Till then readers reaching the left node with a key past its last key move
+ * to its right sibling, see move_to_split_sibling().
+ *
+ * Right node takes the new link version of the left node, which is what repair_split() links it with.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::split_node_unlinked(const BtreeNodePtr& child_node, void* context, bool append_split) {
+    BtreeNodePtr child_node2;
+    auto const ret = split_to_right(child_node, child_node2, append_split);
+    if (ret != btree_status_t::success) { return ret; }
+
+    child_node->inc_link_version();
+    child_node2->set_link_version(child_node->link_version());
+
+    BT_NODE_LOG(DEBUG, child_node, "Split unlinked with new_child_node={}", child_node2->node_id());
+    COUNTER_INCREMENT(m_metrics, btree_blink_split_count, 1);
+    return transact_write_nodes({child_node2}, child_node, nullptr, context);
+}
+
+/* Whether the leaf child which needs split can be split without the parent write lock. Child already split and not
+ * yet linked to its parent is linked first, so that a leaf is never more than one hop away from its parent link. */
+template < typename K, typename V >
+bool Btree< K, V >::is_blink_split(const BtreeNodePtr& child_node, const BtreeLinkInfo& child_info) const {
+    return m_bt_cfg.m_blink_splits_turned_on && !is_subtree_counted() && child_node->is_leaf() &&
+        !is_repair_needed(child_node, child_info);
+}
+
+/* Whether the child, whose link version mismatches the parent, is a split not yet linked to the parent as opposed to a
+ * merge. Right node of such a split is not in the parent and continues the sibling chain to the next child in the
+ * parent, whereas the left node of a merge links past the children it absorbed. Merge needs children on the right, so
+ * the last child of the parent can only be a split.
+ */
+template < typename K, typename V >
+bool Btree< K, V >::is_split_unlinked(const BtreeNodePtr& parent_node, uint32_t idx, const BtreeNodePtr& child_node,
+                                      void* context) const {
+    auto const right_id = child_node->next_bnode();
+    if (right_id == empty_bnodeid) { return false; }
+    if ((idx == parent_node->total_entries()) ||
+        ((idx + 1 == parent_node->total_entries()) && !parent_node->has_valid_edge())) {
+        return true;
+    }
+
+    BtreeLinkInfo next_info;
+    if (idx + 1 == parent_node->total_entries()) {
+        next_info = parent_node->get_edge_value();
+    } else {
+        parent_node->get_nth_value(idx + 1, &next_info, false /* copy */);
+    }
+    if (right_id == next_info.bnode_id()) { return false; }
+
+    BtreeNodePtr right_node;
+    if (read_and_lock_node(right_id, right_node, locktype_t::READ, locktype_t::READ, context) !=
+        btree_status_t::success) {
+        return false;
+    }
+    bool const ret = (right_node->next_bnode() == next_info.bnode_id());
+    unlock_node(right_node, locktype_t::READ);
+    return ret;
+}
+
 template < typename K, typename V >
 template < typename ReqT >
 bool Btree< K, V >::is_split_needed(const BtreeNodePtr& node, ReqT& req) const {
     if (!node->is_leaf()) { // if internal node, size is atmost one additional entry, size of K/V
-        return !node->has_room_for_put(btree_put_type::UPSERT, K::get_max_size(), BtreeLinkInfo::get_fixed_size());
+        return !node->has_room_for_put(btree_put_type::UPSERT, K::get_max_size(), link_size());
     } else if constexpr (std::is_same_v< ReqT, BtreeRangePutRequest< K > >) {
-        return !node->has_room_for_put(req.m_put_type, req.first_key_size(), req.m_newval->serialized_size());
-    } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
-        return !node->has_room_for_put(req.m_put_type, req.key().serialized_size(), req.value().serialized_size());
+        return !node->has_room_for_put(req.m_put_type, req.first_key_size(), leaf_put_value_size(node, req));
+    } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest > ||
+                         std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+        return !node->has_room_for_put(req.m_put_type, req.key().serialized_size(), leaf_put_value_size(node, req));
+    } else {
+        return false;
+    }
+}
+
+/* Size of the value the put leaves in the leaf. A merge put grows the existing value by an amount known only after
+ * merging, hence it is merged with the existing value of the key in the leaf, which the caller holds locked. For a
+ * range put, it is the first key of the working range, which is where it left off upon running out of room. */
+template < typename K, typename V >
+template < typename ReqT >
+uint32_t Btree< K, V >::leaf_put_value_size(const BtreeNodePtr& node, ReqT& req) const {
+    if constexpr (std::is_same_v< ReqT, BtreeRangePutRequest< K > >) {
+        if ((req.m_put_type != btree_put_type::MERGE) || !req.m_merge_cb) { return req.m_newval->serialized_size(); }
+        return to_variant_node(node)->merged_value_size(req.working_range().start_key(), *req.m_newval,
+                                                        req.m_merge_cb);
+    } else {
+        if ((req.m_put_type != btree_put_type::MERGE) || !req.m_merge_cb) { return req.value().serialized_size(); }
+        return to_variant_node(node)->merged_value_size(req.key(), req.value(), req.m_merge_cb);
+    }
+}
+
+/* Is the split of the node due to a put appending past the last key of the right most node of its level. This is the
+ * case for monotonically increasing keys (like time ordered or sequence number keys), where the left node after split
+ * would never be inserted again.
+ */
+template < typename K, typename V >
+template < typename ReqT >
+bool Btree< K, V >::is_append_split(const BtreeNodePtr& node, ReqT& req) const {
+    if ((m_bt_cfg.m_append_split_pct == 0) || (node->next_bnode() != empty_bnodeid) || (node->total_entries() < 2)) {
+        return false;
+    }
+
+    if constexpr (std::is_same_v< ReqT, BtreeRangePutRequest< K > >) {
+        return (req.working_range().start_key().compare(node->get_last_key< K >()) > 0);
+    } else if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest > ||
+                         std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+        return (req.key().compare(node->get_last_key< K >()) > 0);
     } else {
         return false;
     }
@@ -342,8 +579,22 @@ bool Btree< K, V >::is_split_needed(const BtreeNodePtr& node, ReqT& req) const {
 template < typename K, typename V >
 btree_status_t Btree< K, V >::repair_split(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node1,
                                            uint32_t parent_split_idx, void* context) {
-    parent_node->update(parent_split_idx, BtreeLinkInfo{child_node1->next_bnode(), child_node1->link_version()});
-    parent_node->insert(parent_split_idx, child_node1->get_last_key< K >(), child_node1->link_info());
+    uint64_t child1_count{0};
+    uint64_t child2_count{0};
+    if (is_subtree_counted()) {
+        child1_count = subtree_count(child_node1);
+        if (parent_split_idx < parent_node->total_entries()) {
+            BtreeLinkInfo child_info;
+            parent_node->get_nth_value(parent_split_idx, &child_info, false /* copy */);
+            child2_count = child_info.subtree_count() - child1_count;
+        }
+    }
+
+    BtreeLinkInfo const child2_link{child_node1->next_bnode(), child_node1->link_version()};
+    auto const ret = parent_node->update(parent_split_idx, child_link(child2_link, child2_count));
+    if (ret != btree_status_t::success) { return ret; }
+    parent_node->insert(parent_split_idx, child_node1->get_last_key< K >(),
+                        child_link(child_node1->link_info(), child1_count));
     return write_node(parent_node, context);
 }
 } // namespace homestore
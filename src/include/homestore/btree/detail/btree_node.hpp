@@ -15,7 +15,10 @@
  *********************************************************************************/
 
 #pragma once
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <iomgr/fiber_lib.hpp>
 
@@ -27,12 +30,16 @@
 #include <homestore/crc.h>
 
 namespace homestore {
-ENUM(locktype_t, uint8_t, NONE, READ, WRITE)
+ENUM(locktype_t, uint8_t, NONE, READ, WRITE, UPGRADE)
 
 #pragma pack(1)
 struct transient_hdr_t {
     mutable iomgr::FiberManagerLib::shared_mutex lock;
-    sisl::atomic_counter< uint16_t > upgraders{0};
+
+    // Taken exclusive by upgrade and write lockers, ahead of the lock above. Holder of the upgrade lock thus excludes
+    // all the other writers and can promote itself to write without releasing the node. It is allocated only for the
+    // interior nodes of btrees with upgrade locks turned on, so the rest neither carry nor take it.
+    std::unique_ptr< iomgr::FiberManagerLib::shared_mutex > upgrade_lock;
 
     /* these variables are accessed without taking lock and are not expected to change after init */
     uint8_t is_leaf_node{0};
@@ -77,6 +84,14 @@ struct persistent_hdr_t {
 };
 #pragma pack()
 
+// Owner of the node buffers, whose lifetime is tied to the node object rather than to the node being freed from the
+// btree. Buffer is handed back to the owner once the last reference to the node object is dropped.
+class BtreeNodeBufOwner {
+public:
+    virtual ~BtreeNodeBufOwner() = default;
+    virtual void release_node_buf(uint8_t* buf) = 0;
+};
+
 class BtreeNode : public sisl::ObjLifeCounter< BtreeNode > {
     using node_find_result_t = std::pair< bool, uint32_t >;
 
@@ -84,6 +99,11 @@ public:
     sisl::atomic_counter< int32_t > m_refcount{0};
     transient_hdr_t m_trans_hdr;
     uint8_t* m_phys_node_buf;
+    BtreeNodeBufOwner* m_buf_owner{nullptr}; // If set, m_phys_node_buf is released to it along with the node object
+
+    // Seqlock style version of the node, incremented on write lock and again on write unlock, so it is odd as long as
+    // the node is write locked. Kept outside the packed transient header to keep the atomic naturally aligned.
+    mutable std::atomic< uint64_t > m_lock_version{0};
 
 public:
     BtreeNode(uint8_t* node_buf, bnodeid_t id, bool init_buf, bool is_leaf, BtreeConfig const& cfg) :
@@ -92,13 +112,22 @@ public:
             new (node_buf) persistent_hdr_t{};
             set_node_id(id);
             set_leaf(is_leaf);
-            set_node_size(cfg.node_size());
+            if (is_leaf || (cfg.m_msg_buffer_size == 0)) {
+                set_node_size(cfg.node_size());
+            } else {
+                // Interior node leaves the tail of the buffer past its node size to the message buffer, starting empty
+                set_node_size(cfg.node_size() - cfg.m_msg_buffer_size);
+                std::memset(node_buf + node_size(), 0, cfg.m_msg_buffer_size);
+            }
         } else {
             DEBUG_ASSERT_EQ(node_id(), id);
             DEBUG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC);
             DEBUG_ASSERT_EQ(version(), BTREE_NODE_VERSION);
         }
         m_trans_hdr.is_leaf_node = is_leaf;
+        if (cfg.m_upgrade_locks_turned_on && !is_leaf) {
+            m_trans_hdr.upgrade_lock = std::make_unique< iomgr::FiberManagerLib::shared_mutex >();
+        }
     }
     virtual ~BtreeNode() = default;
 
@@ -186,7 +215,7 @@ public:
         const auto [found, idx] = find(key, outval, true);
         if (found) {
             if (outkey) { get_nth_key_internal(idx, *outkey, true); }
-            remove(idx);
+            if (remove(idx) != btree_status_t::success) { return false; }
             LOGMSG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC, "{}", get_persistent_header_const()->to_string());
         }
         return found;
@@ -196,7 +225,7 @@ public:
     bool remove_any(const BtreeKeyRange< K >& range, BtreeKey* outkey, BtreeValue* outval) {
         const auto [found, idx] = get_any(range, outkey, outval, true, true);
         if (found) {
-            remove(idx);
+            if (remove(idx) != btree_status_t::success) { return false; }
             LOGMSG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC, "{}", get_persistent_header_const()->to_string());
         }
         return found;
@@ -207,7 +236,7 @@ public:
     virtual bool update_one(const BtreeKey& key, const BtreeValue& val, BtreeValue* outval) {
         const auto [found, idx] = find(key, outval, true);
         if (found) {
-            update(idx, val);
+            if (update(idx, val) != btree_status_t::success) { return false; }
             LOGMSG_ASSERT((magic() == BTREE_NODE_MAGIC), "{}", get_persistent_header_const()->to_string());
         }
         return found;
@@ -274,7 +303,7 @@ public:
     virtual void set_edge_value(const BtreeValue& v) {
         const auto b = v.serialize();
         auto l = r_cast< BtreeLinkInfo::bnode_link_info* >(b.bytes);
-        DEBUG_ASSERT_EQ(b.size, sizeof(BtreeLinkInfo::bnode_link_info));
+        DEBUG_ASSERT_GE(b.size, sizeof(BtreeLinkInfo::bnode_link_info)); // Subtree count, if any, is not kept for edge
         set_edge_info(*l);
     }
 
@@ -291,7 +320,14 @@ public:
         if (l == locktype_t::READ) {
             m_trans_hdr.lock.lock_shared();
         } else if (l == locktype_t::WRITE) {
+            if (m_trans_hdr.upgrade_lock) { m_trans_hdr.upgrade_lock->lock(); }
             m_trans_hdr.lock.lock();
+            m_lock_version.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        } else if (l == locktype_t::UPGRADE) {
+            DEBUG_ASSERT(m_trans_hdr.upgrade_lock != nullptr, "Upgrade lock is not turned on for this node");
+            m_trans_hdr.upgrade_lock->lock();
+            m_trans_hdr.lock.lock_shared();
         }
     }
 
@@ -299,28 +335,75 @@ public:
         if (l == locktype_t::READ) {
             m_trans_hdr.lock.unlock_shared();
         } else if (l == locktype_t::WRITE) {
+            m_lock_version.fetch_add(1, std::memory_order_release);
             m_trans_hdr.lock.unlock();
+            if (m_trans_hdr.upgrade_lock) { m_trans_hdr.upgrade_lock->unlock(); }
+        } else if (l == locktype_t::UPGRADE) {
+            m_trans_hdr.lock.unlock_shared();
+            m_trans_hdr.upgrade_lock->unlock();
         }
     }
 
-    void lock_upgrade() {
-        m_trans_hdr.upgraders.increment(1);
-        this->unlock(locktype_t::READ);
-        this->lock(locktype_t::WRITE);
-        m_trans_hdr.upgraders.decrement(1);
+    /// @brief Starts an optimistic (lock free) read of the node by sampling its lock version. Node content read after
+    /// this call is usable only if validate_optimistic_read() on the returned version succeeds.
+    ///
+    /// @return The current lock version, odd value indicates the node is write locked and is not worth reading.
+    uint64_t optimistic_read_begin() const { return m_lock_version.load(std::memory_order_acquire); }
+
+    /// @brief Validates that the node is not write locked and not modified since the version was sampled.
+    bool validate_optimistic_read(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return ((version & 1) == 0) && (m_lock_version.load(std::memory_order_relaxed) == version);
+    }
+
+    /// @brief Looks up the child link covering the key in the interior node, without taking a lock and without any
+    /// consistency assertions. This is used by optimistic readers, which could observe a node in middle of a
+    /// modification, hence the caller must validate the node version before using the returned link.
+    ///
+    /// @return false if the node does not yield a child link, which is possible only on a torn read
+    bool optimistic_child_link(BtreeKey const& key, BtreeLinkInfo& out_link) const {
+        auto const nentries = total_entries();
+        auto const idx = bsearch_node(key).second;
+        if (idx < nentries) {
+            get_nth_value(idx, &out_link, false /* copy */);
+        } else if (has_valid_edge()) {
+            out_link = get_edge_value();
+        } else {
+            return false;
+        }
+        return (out_link.bnode_id() != empty_bnodeid);
     }
 
-    void lock_acknowledge() { m_trans_hdr.upgraders.decrement(1); }
-    bool any_upgrade_waiters() const { return (!m_trans_hdr.upgraders.testz()); }
+    /// @brief Looks up the key in the leaf node and copies out its value, without taking a lock and without any
+    /// consistency assertions. Like optimistic_child_link(), the caller must validate the node version before using
+    /// the returned value or status.
+    ///
+    /// @return btree_status_t::success or btree_status_t::not_found, btree_status_t::not_supported if the node type
+    /// cannot be read lock free and has to be read locked.
+    virtual btree_status_t optimistic_leaf_get(BtreeKey const& key, BtreeValue& out_val) const {
+        return btree_status_t::not_supported;
+    }
+
+    /// @brief Promotes the upgrade lock held on the node to write lock. Readers are drained in the meantime, but no
+    /// writer could have got in, as all of them wait for the upgrade lock still held. Hence the node is unchanged
+    /// since it was upgrade locked and is released with unlock(locktype_t::WRITE) after.
+    void lock_upgrade() const {
+        m_trans_hdr.lock.unlock_shared();
+        m_trans_hdr.lock.lock();
+        m_lock_version.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
 
 public:
     // Public method which needs to be implemented by variants
     virtual btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) = 0;
-    virtual void remove(uint32_t ind) { remove(ind, ind); }
-    virtual void remove(uint32_t ind_s, uint32_t ind_e) = 0;
+    // Removes and updates can fail for node types which re-encode the node on every change (see CompactNode), leaving
+    // the node untouched, hence their status is not to be ignored.
+    [[nodiscard]] virtual btree_status_t remove(uint32_t ind) { return remove(ind, ind); }
+    [[nodiscard]] virtual btree_status_t remove(uint32_t ind_s, uint32_t ind_e) = 0;
     virtual void remove_all(const BtreeConfig& cfg) = 0;
-    virtual void update(uint32_t ind, const BtreeValue& val) = 0;
-    virtual void update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) = 0;
+    [[nodiscard]] virtual btree_status_t update(uint32_t ind, const BtreeValue& val) = 0;
+    [[nodiscard]] virtual btree_status_t update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) = 0;
 
     virtual uint32_t move_out_to_right_by_entries(const BtreeConfig& cfg, BtreeNode& other_node, uint32_t nentries) = 0;
     virtual uint32_t move_out_to_right_by_size(const BtreeConfig& cfg, BtreeNode& other_node, uint32_t size) = 0;
@@ -354,7 +437,7 @@ public:
     virtual std::string to_string_keys(bool print_friendly = false) const = 0;
 
 protected:
-    node_find_result_t bsearch_node(const BtreeKey& key) const {
+    virtual node_find_result_t bsearch_node(const BtreeKey& key) const {
         DEBUG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC);
         auto [found, idx] = bsearch(-1, total_entries(), key);
         if (found) { DEBUG_ASSERT_LT(idx, total_entries()); }
@@ -484,8 +567,11 @@ public:
 
     friend void intrusive_ptr_release(BtreeNode* node) {
         if (node->m_refcount.decrement_testz(1)) {
+            auto* buf_owner = node->m_buf_owner;
+            auto* buf = node->m_phys_node_buf;
             node->~BtreeNode();
             delete[] uintptr_cast(node);
+            if (buf_owner) { buf_owner->release_node_buf(buf); }
         }
     }
 };
@@ -19,6 +19,7 @@
 #include <homestore/btree/detail/simple_node.hpp>
 #include <homestore/btree/detail/varlen_node.hpp>
 #include <homestore/btree/detail/prefix_node.hpp>
+#include <homestore/btree/detail/compact_node.hpp>
 #include <sisl/fds/utils.hpp>
 // #include <iomgr/iomgr_flip.hpp>
 
@@ -83,6 +84,36 @@ btree_status_t Btree< K, V >::get_child_and_lock_node(const BtreeNodePtr& node,
     return (read_and_lock_node(child_info.bnode_id(), child_node, int_lock_type, leaf_lock_type, context));
 }
 
+/* Child read locked through its parent could have been split with its right node not yet linked to the parent (see
+ * split_node_unlinked()), in which case the keys past the last key of the child are in its right node. If the key is
+ * past the child, the right node is read locked in its place and child_info is updated to the link the right node is
+ * going to be linked with. Last key of the child skipped is returned in skipped_last_key, if asked.
+ *
+ * NOTE: On failure, neither the child nor its right node is left locked.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::move_to_split_sibling(BtreeNodePtr& child_node, BtreeLinkInfo& child_info,
+                                                    BtreeKey const& key, void* context, K* skipped_last_key) const {
+    if (!is_repair_needed(child_node, child_info) || (child_node->next_bnode() == empty_bnodeid) ||
+        (child_node->total_entries() == 0)) {
+        return btree_status_t::success;
+    }
+
+    K last_key = child_node->get_last_key< K >();
+    if (key.compare(last_key) <= 0) { return btree_status_t::success; }
+
+    BtreeNodePtr right_node;
+    auto const ret = read_and_lock_node(child_node->next_bnode(), right_node, locktype_t::READ, locktype_t::READ,
+                                        context);
+    unlock_node(child_node, locktype_t::READ);
+    if (ret != btree_status_t::success) { return ret; }
+
+    child_info = right_node->link_info();
+    child_node = std::move(right_node);
+    if (skipped_last_key) { *skipped_last_key = std::move(last_key); }
+    return btree_status_t::success;
+}
+
 template < typename K, typename V >
 btree_status_t Btree< K, V >::write_node(const BtreeNodePtr& node, void* context) {
     COUNTER_INCREMENT_IF_ELSE(m_metrics, node->is_leaf(), btree_leaf_node_writes, btree_int_node_writes, 1);
@@ -181,6 +212,97 @@ btree_status_t Btree< K, V >::upgrade_node_locks(const BtreeNodePtr& parent_node
     return ret;
 }
 
+/*
+ * This function promotes the upgrade lock held on the parent node to write lock in place. As every writer of the
+ * parent holds its upgrade lock, parent could not have changed meanwhile, hence unlike upgrade_node_locks() there is no
+ * need to validate it and start over from the root. Child node, if given, is released while the parent waits for its
+ * readers to drain, as they could be waiting on the child, and is write locked again after that.
+ *
+ * Returns - success if both the nodes are write locked. Parent node is left write locked irrespective of the outcome,
+ * child node is left unlocked on failure. If the child is modified while it was released, btree_status_t::retry is
+ * returned and the caller is expected to look up the child again in the parent.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::promote_node_locks(const BtreeNodePtr& parent_node, const BtreeNodePtr& child_node,
+                                                 locktype_t child_cur_lock, void* context) {
+    uint64_t child_prev_gen{0};
+    if (child_node) {
+        child_prev_gen = child_node->node_gen();
+        unlock_node(child_node, child_cur_lock);
+    }
+
+    parent_node->lock_upgrade();
+    COUNTER_INCREMENT(m_metrics, btree_lock_promote_count, 1);
+    auto ret = refresh_node(parent_node, true /* for_read_modify_write */, context);
+    if ((ret != btree_status_t::success) || !child_node) { return ret; }
+
+    ret = lock_node(child_node, locktype_t::WRITE, context);
+    if (ret != btree_status_t::success) { return ret; }
+
+    if (!child_node->is_valid_node() || (child_prev_gen != child_node->node_gen())) {
+        unlock_node(child_node, locktype_t::WRITE);
+        return btree_status_t::retry;
+    }
+
+    ret = prepare_node_txn(parent_node, child_node, context);
+    if (ret != btree_status_t::success) { unlock_node(child_node, locktype_t::WRITE); }
+    return ret;
+}
+
+/*
+ * Upgrade lock of a parent of leaves is taken only by the writes which are about to split or merge the leaf they go
+ * to, so that the rest of the writes going through the parent are not serialized on its upgrade lock. Node is expected
+ * to be read locked by the caller, which still holds its parent (or m_btree_lock, for the root) to keep the node from
+ * being split or merged in the meantime. The leaf the key leads to is peeked at without locking it, and if it looks
+ * like the write would split or merge it, the node is relocked with the upgrade lock. Peek can be wrong either way, as
+ * the leaf could change before it is locked, which is then handled by relocking the nodes as without upgrade locks.
+ * Leaf is peeked at only if the store has it in memory, a device read is not worth it for a guess made under the lock.
+ *
+ * Writes of a range of keys could go to more than one leaf, they read lock the node as usual.
+ *
+ * Returns - success with cur_lock updated to the lock held on the node. Upon failure, the node is left unlocked.
+ */
+template < typename K, typename V >
+template < typename ReqT >
+btree_status_t Btree< K, V >::upgrade_lock_leaf_parent(const BtreeNodePtr& node, locktype_t& cur_lock, ReqT& req) {
+    if constexpr (is_single_key_write< ReqT >()) {
+        if (!m_bt_cfg.m_upgrade_locks_turned_on || (cur_lock != locktype_t::READ) || (node->level() != 1)) {
+            return btree_status_t::success;
+        }
+
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        if (!node->optimistic_child_link(req.key(), child_info) ||
+            (peek_node_impl(child_info.bnode_id(), child_node) != btree_status_t::success)) {
+            return btree_status_t::success;
+        }
+
+        // Leaf is not locked, hence it is looked at only if no writer modified it while it was being looked at. It
+        // could not have been freed though, as that needs the node to be write locked.
+        auto const version = child_node->optimistic_read_begin();
+        bool will_change = is_repair_needed(child_node, child_info);
+        if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+            // Leaf split with B-link splits turned on is done under the read locked node, linked to it later
+            if (!will_change && !m_bt_cfg.m_blink_splits_turned_on) {
+                will_change = !child_node->has_room_for_put(req.m_put_type, req.key().serialized_size(),
+                                                            req.value().serialized_size());
+            }
+        } else {
+            will_change = will_change ||
+                (m_bt_cfg.m_merge_turned_on && !is_merge_deferred() && child_node->is_merge_needed(m_bt_cfg));
+        }
+        if (!will_change || !child_node->validate_optimistic_read(version)) { return btree_status_t::success; }
+
+        unlock_node(node, locktype_t::READ);
+        cur_lock = locktype_t::NONE;
+        auto const ret = lock_node(node, locktype_t::UPGRADE, req.m_op_context);
+        if (ret != btree_status_t::success) { return ret; }
+        cur_lock = locktype_t::UPGRADE;
+        COUNTER_INCREMENT(m_metrics, btree_upgrade_lock_count, 1);
+    }
+    return btree_status_t::success;
+}
+
 #if 0
 template < typename K, typename V >
 btree_status_t Btree< K, V >::upgrade_node(const BtreeNodePtr& node, locktype_t prev_lock, void* context,
@@ -230,6 +352,155 @@ void Btree< K, V >::unlock_node(const BtreeNodePtr& node, locktype_t type) const
     observe_lock_time(node, type, time_spent);
 }
 
+/* Locate the leaf node covering the key, without taking any lock on the interior nodes. Interior nodes are read
+ * optimistically and validated against their lock version, so readers do not write to any shared node memory on the
+ * way down. Only the leaf node is read locked and returned upon success. If concurrent modifications keep invalidating
+ * the traversal beyond few attempts, it returns btree_status_t::retry and caller is expected to fallback to the lock
+ * coupled traversal.
+ *
+ * Only the descend is within the epoch of the node reclaimer. Leaf node reached is referenced by then, so the epoch is
+ * exited before blocking on the leaf lock, and the leaf is validated against its version once locked.
+ *
+ * NOTE: It expects the m_btree_lock to be held in shared mode, which prevents root node from being replaced.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::optimistic_find_leaf(BtreeKey const& key, BtreeNodePtr& leaf_node, void* context) const {
+    btree_status_t ret{btree_status_t::retry};
+
+    for (uint32_t attempt{0}; (ret == btree_status_t::retry) && (attempt < max_optimistic_read_attempts); ++attempt) {
+        uint64_t version;
+        {
+            typename EpochReclaimer< BtreeNodePtr >::ReadGuard guard{m_node_reclaimer};
+            if (!guard.entered()) { break; }
+            BtreeNode* leaf;
+            ret = optimistic_descend(key, leaf, version);
+            // Leaf is referenced only within the epoch, which keeps it alive till then even if it is freed meanwhile
+            if (ret == btree_status_t::success) { leaf_node.reset(leaf); }
+        }
+        if (ret == btree_status_t::success) { ret = optimistic_lock_leaf(leaf_node, version, context); }
+    }
+
+    if (ret != btree_status_t::success) { leaf_node.reset(); }
+    if (ret == btree_status_t::success) { COUNTER_INCREMENT(m_metrics, btree_optimistic_read_count, 1); }
+    if (ret == btree_status_t::retry) { COUNTER_INCREMENT(m_metrics, btree_optimistic_read_fallbacks, 1); }
+    return ret;
+}
+
+/* Lookup a single key without taking any node lock at all, if the leaf node type supports reading the value
+ * optimistically. The value is copied out of the leaf and then the leaf version is validated, so a concurrent writer
+ * modifying the leaf in place forces a retry instead of a torn value. Value is handed to the caller only once
+ * validated. Node types which cannot be read lock free are read locked at the leaf as in optimistic_find_leaf.
+ *
+ * NOTE: It expects the m_btree_lock to be held in shared mode. Returns btree_status_t::retry if the caller has to
+ * fallback to lock coupled traversal.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::optimistic_get(BtreeSingleGetRequest& greq) const {
+    btree_status_t ret{btree_status_t::retry};
+
+    for (uint32_t attempt{0}; (ret == btree_status_t::retry) && (attempt < max_optimistic_read_attempts); ++attempt) {
+        BtreeNodePtr leaf_node;
+        uint64_t version;
+        {
+            typename EpochReclaimer< BtreeNodePtr >::ReadGuard guard{m_node_reclaimer};
+            if (!guard.entered()) { break; }
+            BtreeNode* leaf;
+            ret = optimistic_descend(greq.key(), leaf, version);
+            if (ret != btree_status_t::success) { continue; }
+
+            // Read into a local value, so that a torn read never reaches the caller if it falls back
+            V val;
+            ret = leaf->optimistic_leaf_get(greq.key(), val);
+            if (ret == btree_status_t::not_supported) {
+                leaf_node.reset(leaf); // Locked below, outside the epoch, so it is referenced while still within
+            } else if (!leaf->validate_optimistic_read(version) || !leaf->is_valid_node()) {
+                ret = btree_status_t::retry;
+            } else if ((ret == btree_status_t::success) && greq.m_outval) {
+                greq.m_outval->deserialize(val.serialize(), true /* copy */);
+            }
+        }
+
+        // Leaf type can't be read lock free, lock it outside the epoch as the lock could block
+        if (ret == btree_status_t::not_supported) {
+            ret = optimistic_lock_leaf(leaf_node, version, greq.m_op_context);
+            if (ret == btree_status_t::success) { ret = do_get(leaf_node, greq); }
+        }
+    }
+
+    if ((ret == btree_status_t::success) || (ret == btree_status_t::not_found)) {
+        COUNTER_INCREMENT(m_metrics, btree_optimistic_read_count, 1);
+    }
+    if (ret == btree_status_t::retry) { COUNTER_INCREMENT(m_metrics, btree_optimistic_read_fallbacks, 1); }
+    return ret;
+}
+
+/* Descend to the leaf covering the key through version validated interior nodes. Upon success, leaf node is returned
+ * unlocked along with its version sampled while it was still linked from its parent. Caller has to validate the
+ * leaf against this version before trusting anything read from it.
+ *
+ * Nodes are resolved without taking a reference on them, so that the readers don't write to the refcounts of the
+ * shared upper nodes. Caller is expected to be within the epoch of m_node_reclaimer, which keeps the nodes freed in the
+ * meantime alive, and to reference the leaf within the epoch if it is used past it.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::optimistic_descend(BtreeKey const& key, BtreeNode*& leaf_node,
+                                                 uint64_t& leaf_version) const {
+    BtreeNode* node{nullptr};
+    auto ret = peek_node_unref_impl(m_root_node_info.bnode_id(), node);
+    if (ret != btree_status_t::success) { return ret; }
+    auto version = node->optimistic_read_begin();
+
+    while (!node->is_leaf()) {
+        BtreeLinkInfo child_info;
+        if (!node->optimistic_child_link(key, child_info) || !node->validate_optimistic_read(version)) {
+            return btree_status_t::retry;
+        }
+
+        BtreeNode* child_node{nullptr};
+        ret = peek_node_unref_impl(child_info.bnode_id(), child_node);
+        if (ret != btree_status_t::success) { return ret; }
+        auto const child_version = child_node->optimistic_read_begin();
+
+        // Child version is trustable only if the child was still linked from this node when it was sampled
+        if (!node->validate_optimistic_read(version)) { return btree_status_t::retry; }
+
+        // Split not yet linked to this node is left to the lock coupled traversal, which follows it to the right node.
+        // Link version read here is validated along with the rest of the child, as the split changes its version.
+        if (child_info.link_version() != child_node->link_version()) { return btree_status_t::retry; }
+        node = child_node;
+        version = child_version;
+    }
+
+    leaf_node = node;
+    leaf_version = version;
+    return btree_status_t::success;
+}
+
+/* Read lock the leaf reached through optimistic_descend(). Leaf still covers the key only if it is not modified since
+ * it was reached through a validated parent link.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::optimistic_lock_leaf(BtreeNodePtr const& leaf_node, uint64_t leaf_version,
+                                                   void* context) const {
+    auto ret = lock_node(leaf_node, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+    if (!leaf_node->validate_optimistic_read(leaf_version) || !leaf_node->is_valid_node()) {
+        unlock_node(leaf_node, locktype_t::READ);
+        return btree_status_t::retry;
+    }
+    return btree_status_t::success;
+}
+
+template < typename K, typename V >
+void Btree< K, V >::retire_node(const BtreeNodePtr& node) {
+    m_node_reclaimer.retire(node);
+}
+
+template < typename K, typename V >
+void Btree< K, V >::release_retired_nodes() const {
+    m_node_reclaimer.reclaim();
+}
+
 template < typename K, typename V >
 BtreeNodePtr Btree< K, V >::alloc_leaf_node() {
     BtreeNodePtr n = alloc_node(true /* is_leaf */);
@@ -262,6 +533,21 @@ BtreeNode* Btree< K, V >::init_node(uint8_t* node_buf, uint32_t node_ctx_size, b
     BtreeNode* n{nullptr};
     btree_node_type node_type = is_leaf ? m_bt_cfg.leaf_node_type() : m_bt_cfg.interior_node_type();
 
+    if (!is_leaf && is_subtree_counted()) {
+        // Interior nodes of btree with subtree counts keep the count of each child along with its link
+        switch (node_type) {
+        case btree_node_type::FIXED:
+            return create_node< SimpleNode< K, BtreeCountedLinkInfo > >(node_ctx_size, node_buf, id, init_buf, false,
+                                                                        this->m_bt_cfg);
+        case btree_node_type::VAR_KEY:
+            return create_node< VarKeySizeNode< K, BtreeCountedLinkInfo > >(node_ctx_size, node_buf, id, init_buf,
+                                                                            false, this->m_bt_cfg);
+        default:
+            BT_REL_ASSERT(false, "Subtree counts are not supported for interior node type {}", node_type);
+            return nullptr;
+        }
+    }
+
     switch (node_type) {
     case btree_node_type::VAR_OBJECT:
         n = is_leaf ? create_node< VarObjSizeNode< K, V > >(node_ctx_size, node_buf, id, init_buf, true, this->m_bt_cfg)
@@ -295,6 +581,12 @@ BtreeNode* Btree< K, V >::init_node(uint8_t* node_buf, uint32_t node_ctx_size, b
                                                                  this->m_bt_cfg);
         break;
 
+    case btree_node_type::COMPACT:
+        n = is_leaf ? create_node< CompactNode< K, V > >(node_ctx_size, node_buf, id, init_buf, true, this->m_bt_cfg)
+                    : create_node< CompactNode< K, BtreeLinkInfo > >(node_ctx_size, node_buf, id, init_buf, false,
+                                                                     this->m_bt_cfg);
+        break;
+
     default:
         BT_REL_ASSERT(false, "Unsupported node type {}", node_type);
         break;
@@ -315,6 +607,8 @@ void Btree< K, V >::free_node(const BtreeNodePtr& node, locktype_t cur_lock, voi
     }
     --m_total_nodes;
 
+    // Optimistic readers could still be holding a link to this node, retain the node object till they are done
+    if (m_bt_cfg.m_optimistic_read_turned_on) { retire_node(node); }
     free_node_impl(node, context);
     // intrusive_ptr_release(node.get());
 }
@@ -343,7 +637,8 @@ void Btree< K, V >::_start_of_lock(const BtreeNodePtr& node, locktype_t ltype, c
 
     info.start_time = Clock::now();
     info.node = node.get();
-    if (ltype == locktype_t::WRITE) {
+    if ((ltype == locktype_t::WRITE) || (ltype == locktype_t::UPGRADE)) {
+        // Upgrade locked node is tracked along with the write locked ones, as it stays there once promoted
         bt_thread_vars()->wr_locked_nodes.push_back(info);
         LOGTRACEMOD(btree, "ADDING node {} to write locked nodes list, its size={}", (void*)info.node,
                     bt_thread_vars()->wr_locked_nodes.size());
@@ -359,7 +654,7 @@ void Btree< K, V >::_start_of_lock(const BtreeNodePtr& node, locktype_t ltype, c
 template < typename K, typename V >
 bool Btree< K, V >::remove_locked_node(const BtreeNodePtr& node, locktype_t ltype, btree_locked_node_info* out_info) {
     auto pnode_infos =
-        (ltype == locktype_t::WRITE) ? &bt_thread_vars()->wr_locked_nodes : &bt_thread_vars()->rd_locked_nodes;
+        (ltype == locktype_t::READ) ? &bt_thread_vars()->rd_locked_nodes : &bt_thread_vars()->wr_locked_nodes;
 
     if (!pnode_infos->empty()) {
         auto info = pnode_infos->back();
@@ -367,7 +662,7 @@ bool Btree< K, V >::remove_locked_node(const BtreeNodePtr& node, locktype_t ltyp
             *out_info = info;
             pnode_infos->pop_back();
             LOGTRACEMOD(btree, "REMOVING node {} from {} locked nodes list, its size = {}", (void*)info.node,
-                        (ltype == locktype_t::WRITE) ? "write" : "read", pnode_infos->size());
+                        (ltype == locktype_t::READ) ? "read" : "write", pnode_infos->size());
             return true;
         } else if (pnode_infos->size() > 1) {
             info = pnode_infos->at(pnode_infos->size() - 2);
@@ -376,7 +671,7 @@ bool Btree< K, V >::remove_locked_node(const BtreeNodePtr& node, locktype_t ltyp
                 pnode_infos->at(pnode_infos->size() - 2) = pnode_infos->back();
                 pnode_infos->pop_back();
                 LOGTRACEMOD(btree, "REMOVING node {} from {} locked nodes list, its size = {}", (void*)info.node,
-                            (ltype == locktype_t::WRITE) ? "write" : "read", pnode_infos->size());
+                            (ltype == locktype_t::READ) ? "read" : "write", pnode_infos->size());
                 return true;
             }
         }
@@ -126,7 +126,15 @@ btree_status_t Btree< K, V >::do_traversal_query(const BtreeNodePtr& my_node, Bt
         ret = read_and_lock_node(child_info.bnode_id(), child_node, child_cur_lock, child_cur_lock, nullptr);
         if (ret != btree_status_t::success) { break; }
 
-        if (idx == end_idx) {
+        // Child split not yet linked to this node has rest of its entries in its right node, which is reachable only
+        // through the child. It can't be linked while this node is read locked, so hold it till the right node is read.
+        // Child changed otherwise, say merged, links to a node this node has already, which is not to be read twice.
+        auto const split_right_id = (is_repair_needed(child_node, child_info) &&
+                                     is_split_unlinked(my_node, idx, child_node, qreq.m_op_context))
+            ? child_node->next_bnode()
+            : empty_bnodeid;
+
+        if ((idx == end_idx) && (split_right_id == empty_bnodeid)) {
             // If we have reached the last index, unlock before traversing down, because we no longer need
             // this lock. Holding this lock will impact performance unncessarily.
             unlock_node(my_node, locktype_t::READ);
@@ -135,6 +143,13 @@ btree_status_t Btree< K, V >::do_traversal_query(const BtreeNodePtr& my_node, Bt
         // TODO - pass sub range if child is leaf
         ret = do_traversal_query(child_node, qreq, out_values);
         if (ret == btree_status_t::has_more) { break; }
+
+        if (split_right_id != empty_bnodeid) {
+            ret = read_and_lock_node(split_right_id, child_node, child_cur_lock, child_cur_lock, nullptr);
+            if (ret != btree_status_t::success) { break; }
+            ret = do_traversal_query(child_node, qreq, out_values);
+            if (ret == btree_status_t::has_more) { break; }
+        }
         ++idx;
     }
 done:
@@ -143,6 +158,97 @@ done:
     return ret;
 }
 
+/* Sweep the working range from its end towards its start, returning entries in descending order of keys. Leaf nodes
+ * are linked only to their next sibling, hence to move to the previous leaf, it walks down again from root with the
+ * separator key bounding the current leaf on its left (left fence). All keys in the preceding leaves are <= left fence,
+ * so the walk for the left fence lands on the previous leaf.
+ *
+ * NOTE: It expects my_node (root) to be read locked and it is unlocked upon return.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::do_reverse_sweep_query(BtreeNodePtr& my_node, BtreeQueryRequest< K >& qreq,
+                                                     std::vector< std::pair< K, V > >& out_values) const {
+    BT_NODE_DBG_ASSERT_GT(qreq.batch_size(), 0, my_node);
+
+    BtreeKeyRange< K > range{qreq.working_range()};
+    K search_key{range.end_key()};
+    std::optional< K > left_fence;
+    uint32_t count{0};
+    btree_status_t ret;
+
+    while (true) {
+        ret = descend_to_leaf(my_node, search_key, qreq, left_fence);
+        if (ret != btree_status_t::success) { return ret; }
+
+        uint32_t start_ind{0};
+        uint32_t end_ind{0};
+        auto const cur_count = to_variant_node(my_node)->multi_get_reverse(range, qreq.batch_size() - count, start_ind,
+                                                                           end_ind, &out_values, qreq.filter());
+        count += cur_count;
+        if (qreq.route_tracing) {
+            append_route_trace(qreq, my_node, btree_event_t::READ, start_ind, start_ind + cur_count);
+        }
+
+        if (count >= qreq.batch_size()) {
+            ret = btree_status_t::has_more;
+            break;
+        }
+
+        // Leftmost leaf or the preceding leaves are all before the range start
+        if (!left_fence) { break; }
+        auto const x = left_fence->compare(range.start_key());
+        if ((x < 0) || ((x == 0) && !range.is_start_inclusive())) { break; }
+
+        // Entries already returned shouldn't be picked again, in case they moved to the previous leaf meanwhile
+        if (cur_count) { range.set_end_key(K{out_values.back().first}, false /* inclusive */); }
+        search_key = std::move(*left_fence);
+
+        unlock_node(my_node, locktype_t::READ);
+        ret = read_and_lock_node(m_root_node_info.bnode_id(), my_node, locktype_t::READ, locktype_t::READ,
+                                 qreq.m_op_context);
+        if (ret != btree_status_t::success) { return ret; }
+    }
+
+    unlock_node(my_node, locktype_t::READ);
+    return ret;
+}
+
+/* Walk down from the read locked my_node to the leaf covering the key. Upon successful return, my_node is the read
+ * locked leaf node and left_fence, if set, is the separator bounding the leaf from its left, i.e all keys in the leaves
+ * preceding it are <= left_fence. Left fence is not set for the leftmost leaf. On failure, no node is left locked.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::descend_to_leaf(BtreeNodePtr& my_node, K const& key, BtreeQueryRequest< K >& qreq,
+                                              std::optional< K >& left_fence) const {
+    left_fence.reset();
+    while (!my_node->is_leaf()) {
+        BtreeLinkInfo child_info;
+        auto const [isfound, idx] = my_node->find(key, &child_info, false);
+        ASSERT_IS_VALID_INTERIOR_CHILD_INDX(isfound, idx, my_node);
+        if (qreq.route_tracing) { append_route_trace(qreq, my_node, btree_event_t::READ, idx, idx); }
+
+        // Deeper the level, tighter the fence
+        if (idx > 0) { left_fence = my_node->get_nth_key< K >(idx - 1, true /* copy */); }
+
+        BtreeNodePtr child_node;
+        auto ret = read_and_lock_node(child_info.bnode_id(), child_node, locktype_t::READ, locktype_t::READ,
+                                      qreq.m_op_context);
+        if (ret == btree_status_t::success) {
+            // Right node of a split not yet linked to this node is fenced by the last key of the split node
+            auto const child_id = child_node->node_id();
+            K last_key;
+            ret = move_to_split_sibling(child_node, child_info, key, qreq.m_op_context, &last_key);
+            if ((ret == btree_status_t::success) && (child_node->node_id() != child_id)) {
+                left_fence = std::move(last_key);
+            }
+        }
+        unlock_node(my_node, locktype_t::READ);
+        if (ret != btree_status_t::success) { return ret; }
+        my_node = std::move(child_node);
+    }
+    return btree_status_t::success;
+}
+
 #ifdef SERIALIZABLE_QUERY_IMPLEMENTATION
 btree_status_t do_serialzable_query(const BtreeNodePtr& my_node, BtreeSerializableQueryRequest& qreq,
                                     std::vector< std::pair< K, V > >& out_values) {
@@ -14,6 +14,7 @@
  *
  *********************************************************************************/
 #pragma once
+#include <cstring>
 #include <homestore/btree/btree.hpp>
 
 namespace homestore {
@@ -36,6 +37,7 @@ btree_status_t Btree< K, V >::do_remove(const BtreeNodePtr& my_node, locktype_t
         } else if constexpr (std::is_same_v< ReqT, BtreeRangeRemoveRequest< K > >) {
             removed_count = to_variant_node(my_node)->multi_remove(req.working_range(), req.m_filter_cb);
             modified = (removed_count != 0);
+            req.m_removed_count += removed_count;
             req.shift_working_range();
         } else if constexpr (std::is_same_v< ReqT, BtreeRemoveAnyRequest< K > >) {
             if ((modified = my_node->remove_any(req.m_range, req.m_outkey, req.m_outval))) { ++removed_count; }
@@ -48,6 +50,7 @@ btree_status_t Btree< K, V >::do_remove(const BtreeNodePtr& my_node, locktype_t
             COUNTER_DECREMENT(m_metrics, btree_obj_count, removed_count);
             if (req.route_tracing) { append_route_trace(req, my_node, btree_event_t::REMOVE); }
         }
+        if (is_subtree_counted()) { count_leaf_change< ReqT >(-int64_t(removed_count)); }
 
         unlock_node(my_node, curlock);
         return modified ? btree_status_t::success : btree_status_t::not_found;
@@ -71,6 +74,42 @@ retry:
             ret = btree_status_t::not_found;
             goto out_return;
         }
+
+        // Children entirely within the range are unlinked and freed as a whole, instead of visiting and emptying
+        // every leaf underneath. Filtered removes need to look at each entry, so they take the regular path.
+        uint32_t cover_start, cover_end;
+        // Leaves split and not yet linked to their parent are not reachable from the dropped subtrees, hence it is
+        // not done with B-link splits.
+        if (!req.m_filter_cb && !m_bt_cfg.m_blink_splits_turned_on &&
+            find_covered_children(my_node, req.working_range(), start_idx, end_idx, cover_start, cover_end)) {
+            if (curlock == locktype_t::UPGRADE) {
+                curlock = locktype_t::WRITE; // Promoted in place, so this node stays locked even on failure
+                ret = promote_node_locks(my_node, nullptr, locktype_t::NONE, req.m_op_context);
+                if (ret != btree_status_t::success) { goto out_return; }
+            } else if (curlock != locktype_t::WRITE) {
+                auto const prev_gen = my_node->node_gen();
+                unlock_node(my_node, curlock);
+                curlock = locktype_t::NONE;
+
+                ret = lock_node(my_node, locktype_t::WRITE, req.m_op_context);
+                if (ret != btree_status_t::success) { goto out_return; }
+                curlock = locktype_t::WRITE;
+                if (!my_node->is_valid_node() || (prev_gen != my_node->node_gen())) {
+                    ret = btree_status_t::retry;
+                    goto out_return;
+                }
+            }
+
+            ret = drop_subtrees(my_node, cover_start, cover_end, req.m_op_context);
+            if (ret == btree_status_t::success) {
+                req.m_subtrees_dropped = true;
+                if (req.route_tracing) { append_route_trace(req, my_node, btree_event_t::REMOVE); }
+                at_least_one_child_modified = btree_status_t::success;
+                goto retry;
+            }
+            // Node with no room to unlink the children in place has them emptied one leaf at a time instead
+            if (ret != btree_status_t::space_not_avail) { goto out_return; }
+        }
     } else if constexpr (std::is_same_v< ReqT, BtreeRemoveAnyRequest< K > >) {
         auto const matched = my_node->match_range< K >(req.m_range, start_idx, end_idx);
         if (!matched) {
@@ -85,15 +124,49 @@ retry:
     while (curr_idx <= end_idx) {
         BtreeLinkInfo child_info;
         BtreeNodePtr child_node;
-        ret = get_child_and_lock_node(my_node, curr_idx, child_info, child_node, locktype_t::READ, locktype_t::WRITE,
-                                      req.m_op_context);
+        ret = get_child_and_lock_node(my_node, curr_idx, child_info, child_node, interior_write_lock< ReqT >(),
+                                      locktype_t::WRITE, req.m_op_context);
         if (ret != btree_status_t::success) {
             unlock_node(my_node, curlock);
             return ret;
         }
 
+        child_cur_lock = child_node->is_leaf() ? locktype_t::WRITE : interior_write_lock< ReqT >();
+
+        // Child split not yet linked to this node is linked before removing from it, otherwise the keys moved to the
+        // right would be looked up in the child. If this node has no room for the separator, the split is left to be
+        // linked by the put which goes through this node after splitting it.
+        if (is_repair_needed(child_node, child_info) &&
+            is_split_unlinked(my_node, curr_idx, child_node, req.m_op_context)) {
+            if (!my_node->has_room_for_put(btree_put_type::UPSERT, K::get_max_size(), link_size())) {
+                unlock_node(child_node, child_cur_lock);
+                unlock_node(my_node, curlock);
+                return btree_status_t::retry;
+            }
+
+            if (curlock == locktype_t::UPGRADE) {
+                ret = promote_node_locks(my_node, child_node, child_cur_lock, req.m_op_context);
+                curlock = locktype_t::WRITE; // Promoted in place, so this node stays locked even on failure
+                if (ret == btree_status_t::retry) { goto retry; } // Child changed while released, check again
+                if (ret != btree_status_t::success) { goto out_return; }
+            } else {
+                ret = upgrade_node_locks(my_node, child_node, curlock, child_cur_lock, req.m_op_context);
+                if (ret != btree_status_t::success) { return ret; }
+            }
+            curlock = child_cur_lock = locktype_t::WRITE;
+
+            BT_NODE_LOG(TRACE, child_node, "Node repair needed");
+            ret = repair_split(my_node, child_node, curr_idx, req.m_op_context);
+            unlock_node(child_node, locktype_t::WRITE);
+            child_cur_lock = locktype_t::NONE;
+            if (ret != btree_status_t::success) {
+                unlock_node(my_node, locktype_t::WRITE);
+                return ret;
+            }
+            goto retry;
+        }
+
         // Check if child node is minimal.
-        child_cur_lock = child_node->is_leaf() ? locktype_t::WRITE : locktype_t::READ;
         if (child_node->is_merge_needed(m_bt_cfg) || is_repair_needed(child_node, child_info)) {
             uint32_t node_end_idx = my_node->total_entries();
             if (!my_node->has_valid_edge()) { --node_end_idx; }
@@ -101,10 +174,20 @@ retry:
                 node_end_idx = curr_idx + m_bt_cfg.m_max_merge_nodes - 1;
             }
 
-            if (node_end_idx > curr_idx) {
-                // If we are unable to upgrade the node, ask the caller to retry.
-                ret = upgrade_node_locks(my_node, child_node, curlock, child_cur_lock, req.m_op_context);
-                if (ret != btree_status_t::success) { return ret; }
+            // Merge of an underfull leaf is left to rebalance(), in deferred merge mode
+            if ((node_end_idx > curr_idx) &&
+                (is_repair_needed(child_node, child_info) || !child_node->is_leaf() ||
+                 !defer_merge(my_node, curr_idx, child_node))) {
+                if (curlock == locktype_t::UPGRADE) {
+                    ret = promote_node_locks(my_node, child_node, child_cur_lock, req.m_op_context);
+                    curlock = locktype_t::WRITE; // Promoted in place, so this node stays locked even on failure
+                    if (ret == btree_status_t::retry) { goto retry; } // Child changed while released, check again
+                    if (ret != btree_status_t::success) { goto out_return; }
+                } else {
+                    // If we are unable to upgrade the node, ask the caller to retry.
+                    ret = upgrade_node_locks(my_node, child_node, curlock, child_cur_lock, req.m_op_context);
+                    if (ret != btree_status_t::success) { return ret; }
+                }
                 curlock = child_cur_lock = locktype_t::WRITE;
 
                 if (is_repair_needed(child_node, child_info)) {
@@ -166,14 +249,23 @@ retry:
         }
 #endif
 
-        if (curr_idx == end_idx) {
+        ret = upgrade_lock_leaf_parent(child_node, child_cur_lock, req);
+        if (ret != btree_status_t::success) { goto out_return; }
+
+        if ((curr_idx == end_idx) && !is_counted_on_unwind< ReqT >()) {
             // If we have reached the last index, unlock before traversing down, because we no longer need
             // this lock. Holding this lock will impact performance unncessarily.
             unlock_node(my_node, curlock);
             curlock = locktype_t::NONE;
         }
 
-        ret = do_remove(child_node, child_cur_lock, req);
+        {
+            auto const prev_delta = m_subtree_delta;
+            ret = do_remove(child_node, child_cur_lock, req);
+            if (is_counted_on_unwind< ReqT >()) {
+                update_child_count(my_node, curr_idx, m_subtree_delta - prev_delta, req.m_op_context);
+            }
+        }
         if (ret == btree_status_t::success) { at_least_one_child_modified = btree_status_t::success; }
         ++curr_idx;
     }
@@ -204,6 +296,7 @@ btree_status_t Btree< K, V >::check_collapse_root(ReqT& req) {
     }
 
     BT_NODE_DBG_ASSERT_EQ(root->has_valid_edge(), true, root);
+    BT_NODE_DBG_ASSERT(!is_msg_buffered() || msg_buffer(root).empty(), root, "Collapsing root with buffered messages");
     ret = read_and_lock_node(root->edge_id(), child, locktype_t::WRITE, locktype_t::WRITE, req.m_op_context);
     if (ret != btree_status_t::success) {
         unlock_node(root, locktype_t::WRITE);
@@ -214,7 +307,7 @@ btree_status_t Btree< K, V >::check_collapse_root(ReqT& req) {
 
     free_node(root, locktype_t::WRITE, req.m_op_context);
     m_root_node_info = child->link_info();
-    update_new_root_info(m_root_node_info.bnode_id(), m_root_node_info.link_version());
+    update_new_root_info(m_root_node_info.bnode_id(), m_root_node_info.link_version(), req.m_op_context);
     unlock_node(child, locktype_t::WRITE);
 
     // TODO: Have a precommit code here to notify the change in root node id
@@ -229,6 +322,11 @@ template < typename K, typename V >
 btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const BtreeNodePtr& leftmost_node,
                                           uint32_t start_idx, uint32_t end_idx, void* context) {
     if (!m_bt_cfg.m_merge_turned_on) { return btree_status_t::merge_not_required; }
+    // Messages are bound to the key range of their node, which the merge changes, hence interior nodes are merged only
+    // with their buffers empty, as they are for the writes to multiple keys which flush all the messages first
+    if (is_msg_buffered() && !leftmost_node->is_leaf() && !msg_buffer(leftmost_node).empty()) {
+        return btree_status_t::merge_not_required;
+    }
     btree_status_t ret{btree_status_t::success};
     folly::small_vector< BtreeNodePtr, 3 > old_nodes;
     folly::small_vector< BtreeNodePtr, 3 > new_nodes;
@@ -267,13 +365,27 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
         if (ret != btree_status_t::success) { goto out; }
         BT_NODE_LOG_ASSERT_EQ(child->is_valid_node(), true, child);
 
+        // Child whose split is not yet linked to parent would leave its right node unlinked, and interior child with
+        // messages would leave them out of its range, merge upto the one before
+        if (is_repair_needed(child, child_info) ||
+            (is_msg_buffered() && !child->is_leaf() && !msg_buffer(child).empty())) {
+            unlock_node(child, locktype_t::WRITE);
+            end_idx = indx - 1;
+            break;
+        }
+
         old_nodes.push_back(child);
         total_size += child->occupied_size();
     }
 
-    // Determine if packing the nodes would result in reducing the number of nodes, if so go with that. If else
-    // we revert back to rebalancing the nodes.
-    num_nodes = (total_size == 0) ? 1 : (total_size - 1) / m_bt_cfg.ideal_fill_size() + 1;
+    if (old_nodes.empty()) {
+        ret = btree_status_t::merge_not_required;
+        goto out;
+    }
+
+    // Determine if packing the nodes upto the merge fill size would result in reducing the number of nodes, if so go
+    // with that. If else we revert back to rebalancing the nodes.
+    num_nodes = (total_size == 0) ? 1 : (total_size - 1) / m_bt_cfg.merge_fill_size() + 1;
     if (num_nodes >= (old_nodes.size() + 1)) {
         // Only option is to rebalance the nodes across. If we are asked not to do so, skip it.
         if (!m_bt_cfg.m_rebalance_turned_on) {
@@ -391,7 +503,7 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
         // If the end_idx is the parent's edge, the space is not released eventually.
         auto excess_releasing_nodes =
             old_nodes.size() - new_nodes.size() - (parent_node->total_entries() == end_idx) ? 1 : 0;
-        auto minimum_releasing_excess_size = excess_releasing_nodes * (BtreeLinkInfo::get_fixed_size());
+        auto minimum_releasing_excess_size = excess_releasing_nodes * link_size();
 
         // aside from releasing size due to excess node, K::get_max_size is needed for each updating element
         // at worst case (linkinfo and record remain the same for old and new nodes). The number of updating elements
@@ -407,8 +519,19 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
         }
     }
 
-    // Now it is time to commit things and at this point no going back, since in-place write nodes are modified
+    // Now it is time to commit things. The room check above doesn't hold for the node types which re-encode the parent
+    // on every update (see CompactNode), which could still find no room for the new separators. So the parent and the
+    // leftmost node, the only nodes modified in-place, are restored to what they were in that case.
     {
+        std::vector< uint8_t > parent_buf;
+        std::vector< uint8_t > leftmost_buf;
+        if (is_reencoded_node(parent_node)) {
+            parent_buf.assign(parent_node->m_phys_node_buf, parent_node->m_phys_node_buf + m_bt_cfg.node_size());
+            leftmost_buf.assign(leftmost_node->m_phys_node_buf,
+                                leftmost_node->m_phys_node_buf + m_bt_cfg.node_size());
+        }
+        btree_status_t pret{btree_status_t::success};
+
         for (uint32_t i{0}; i < leftmost_src.ith_nodes.size(); ++i) {
             auto const idx = leftmost_src.ith_nodes[i];
             leftmost_node->copy_by_entries(m_bt_cfg, *old_nodes[idx], 0,
@@ -421,7 +544,7 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
         // First remove the excess entries between new nodes and old nodes
         auto excess = old_nodes.size() - new_nodes.size();
         if (excess) {
-            parent_node->remove(start_idx + 1, start_idx + excess);
+            pret = parent_node->remove(start_idx + 1, start_idx + excess);
             end_idx -= excess;
         }
 
@@ -431,11 +554,13 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
         auto cur_idx = end_idx;
         BtreeNodePtr last_new_node = nullptr;
         bnodeid_t next_node_id = old_nodes.back()->next_bnode();
-        for (auto it = new_nodes.rbegin(); it != new_nodes.rend(); ++it) {
+        for (auto it = new_nodes.rbegin(); (it != new_nodes.rend()) && (pret == btree_status_t::success); ++it) {
             (*it)->set_next_bnode(next_node_id);
             auto this_node_id = (*it)->node_id();
-            if ((*it)->total_entries())
-                parent_node->update(cur_idx--, (*it)->get_last_key< K >(), BtreeLinkInfo{this_node_id, 0});
+            if ((*it)->total_entries()) {
+                pret = parent_node->update(cur_idx--, (*it)->get_last_key< K >(),
+                                           child_link(BtreeLinkInfo{this_node_id, 0}));
+            }
             last_new_node = *it;
             next_node_id = this_node_id;
         }
@@ -444,16 +569,38 @@ btree_status_t Btree< K, V >::merge_nodes(const BtreeNodePtr& parent_node, const
 
         // Finally update the leftmost node with latest key
         leftmost_node->set_next_bnode(next_node_id);
-        if (leftmost_node->total_entries()) {
+        if ((pret == btree_status_t::success) && leftmost_node->total_entries()) {
             leftmost_node->inc_link_version();
-            parent_node->update(start_idx, leftmost_node->get_last_key< K >(), leftmost_node->link_info());
+            pret = parent_node->update(start_idx, leftmost_node->get_last_key< K >(),
+                                       child_link(leftmost_node->link_info()));
         }
 
-        if (parent_node->total_entries() && !parent_node->has_valid_edge()) {
+        if ((pret == btree_status_t::success) && parent_node->total_entries() && !parent_node->has_valid_edge()) {
             if (parent_node->compare_nth_key(plast_key, parent_node->total_entries() - 1)) {
                 auto last_node = new_nodes.size() > 0 ? new_nodes[new_nodes.size() - 1] : leftmost_node;
                 last_node->inc_link_version();
-                parent_node->update(parent_node->total_entries() - 1, plast_key, last_node->link_info());
+                pret = parent_node->update(parent_node->total_entries() - 1, plast_key,
+                                           child_link(last_node->link_info()));
+            }
+        }
+
+        if (pret != btree_status_t::success) {
+            BT_NODE_LOG(DEBUG, parent_node,
+                        "Merge is needed, however the parent has no room to re-encode the new keys, status={}, so "
+                        "not proceeding with merge",
+                        enum_name(pret));
+            BT_NODE_REL_ASSERT(!parent_buf.empty(), parent_node, "Merge failed midway on a node which can't roll back");
+            std::memcpy(parent_node->m_phys_node_buf, parent_buf.data(), parent_buf.size());
+            std::memcpy(leftmost_node->m_phys_node_buf, leftmost_buf.data(), leftmost_buf.size());
+            ret = btree_status_t::merge_not_required;
+            goto out;
+        }
+
+        if (is_subtree_counted()) {
+            // Entries are redistributed across the nodes, their counts are recomputed from the entries they now have
+            set_child_count(parent_node, start_idx, leftmost_node);
+            for (uint32_t i{0}; i < new_nodes.size(); ++i) {
+                set_child_count(parent_node, start_idx + 1 + i, new_nodes[i]);
             }
         }
 
@@ -547,6 +694,191 @@ out:
     return ret;
 }
 
+/* Find the children of the interior node whose entire key space falls within the range. Child i holds the keys in
+ * (key[i-1], key[i]], so only the children bounded by keys on both sides in this node qualify, never the first child or
+ * the edge child, whose bounds are known only to the parent.
+ */
+template < typename K, typename V >
+bool Btree< K, V >::find_covered_children(const BtreeNodePtr& node, BtreeKeyRange< K > const& range,
+                                          uint32_t start_idx, uint32_t end_idx, uint32_t& cover_start,
+                                          uint32_t& cover_end) const {
+    if (node->total_entries() == 0) { return false; }
+    auto const last_idx = std::min(end_idx, node->total_entries() - 1);
+
+    uint32_t idx = std::max(start_idx, 1u);
+    while ((idx <= last_idx) && (node->get_nth_key< K >(idx - 1, false).compare(range.start_key()) < 0)) {
+        ++idx;
+    }
+    cover_start = idx;
+
+    while (idx <= last_idx) {
+        auto const x = node->get_nth_key< K >(idx, false).compare(range.end_key());
+        if ((x > 0) || ((x == 0) && !range.is_end_inclusive())) { break; }
+        ++idx;
+    }
+    if (idx == cover_start) { return false; }
+    cover_end = idx - 1;
+    return true;
+}
+
+/* Unlink the children [start_idx, end_idx] of the parent node, without modifying any of the nodes within them. Nodes on
+ * the right edge of the subtree left of the dropped ones are relinked at every level to the nodes which followed the
+ * dropped subtrees, so that the sibling chains skip the dropped nodes. Dropped subtrees are freed only after the remove
+ * is done, see free_dropped_subtrees().
+ *
+ * NOTE: It expects the parent node to be write locked and start_idx to be atleast 1, it remains locked upon return.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::drop_subtrees(const BtreeNodePtr& parent_node, uint32_t start_idx, uint32_t end_idx,
+                                            void* context) {
+    auto const right_most_idx = [](const BtreeNodePtr& node) {
+        return node->has_valid_edge() ? node->total_entries() : node->total_entries() - 1;
+    };
+
+    BtreeLinkInfo child_info;
+    BtreeNodePtr left_node;
+    BtreeNodePtr drop_node;
+    auto ret = get_child_and_lock_node(parent_node, start_idx - 1, child_info, left_node, locktype_t::WRITE,
+                                       locktype_t::WRITE, context);
+    if (ret != btree_status_t::success) { return ret; }
+    ret = get_child_and_lock_node(parent_node, end_idx, child_info, drop_node, locktype_t::READ, locktype_t::READ,
+                                  context);
+    if (ret != btree_status_t::success) {
+        unlock_node(left_node, locktype_t::WRITE);
+        return ret;
+    }
+
+    // The node types which re-encode on every change (see CompactNode) could find no room to remove the dropped
+    // children, so such a parent is unlinked from them ahead of relinking the levels below, while nothing is changed
+    // yet, and is restored if relinking fails. Other parents never fail to remove and are unlinked after relinking.
+    uint16_t const dropped_level = parent_node->level() - 1;
+    uint64_t nobjs{0};
+    std::vector< bnodeid_t > dropped_ids;
+    for (auto idx = start_idx; idx <= end_idx; ++idx) {
+        parent_node->get_nth_value(idx, &child_info, false /* copy */);
+        dropped_ids.push_back(child_info.bnode_id());
+        if (is_subtree_counted()) { nobjs += child_info.subtree_count(); }
+    }
+    bool const unlink_first = is_reencoded_node(parent_node);
+    std::vector< uint8_t > parent_buf;
+    if (unlink_first) {
+        parent_buf.assign(parent_node->m_phys_node_buf, parent_node->m_phys_node_buf + m_bt_cfg.node_size());
+        ret = parent_node->remove(start_idx, end_idx);
+        if (ret != btree_status_t::success) {
+            BT_NODE_LOG(DEBUG, parent_node, "No room to remove the children idx=[{}-{}] to drop, status={}", start_idx,
+                        end_idx, enum_name(ret));
+            unlock_node(drop_node, locktype_t::READ);
+            unlock_node(left_node, locktype_t::WRITE);
+            return ret;
+        }
+    }
+    ret = prepare_node_txn(parent_node, left_node, context);
+
+    // Walk down the right edges of the subtree on the left and of the last dropped subtree together, top down. Both the
+    // nodes of a level stay locked till the nodes of the next level are locked, so that the dropped node can't split
+    // underneath and its next link is still the node following it when the left node is relinked to it.
+    BtreeNodePtr node = left_node;
+    while (ret == btree_status_t::success) {
+        node->set_next_bnode(drop_node->next_bnode());
+        if (node != left_node) {
+            ret = write_node(node, context);
+            if (ret != btree_status_t::success) { break; }
+        }
+        if (node->is_leaf()) {
+            BT_NODE_DBG_ASSERT_EQ(drop_node->is_leaf(), true, node, "Dropped subtree height mismatch");
+            break;
+        }
+
+        BtreeNodePtr child_node;
+        BtreeNodePtr drop_child;
+        ret = get_child_and_lock_node(node, right_most_idx(node), child_info, child_node, locktype_t::WRITE,
+                                      locktype_t::WRITE, context);
+        if (ret != btree_status_t::success) { break; }
+        ret = get_child_and_lock_node(drop_node, right_most_idx(drop_node), child_info, drop_child, locktype_t::READ,
+                                      locktype_t::READ, context);
+        if (ret != btree_status_t::success) {
+            unlock_node(child_node, locktype_t::WRITE);
+            break;
+        }
+        ret = prepare_node_txn(node, child_node, context);
+        if (ret != btree_status_t::success) {
+            unlock_node(drop_child, locktype_t::READ);
+            unlock_node(child_node, locktype_t::WRITE);
+            break;
+        }
+
+        if (node != left_node) { unlock_node(node, locktype_t::WRITE); }
+        unlock_node(drop_node, locktype_t::READ);
+        node = std::move(child_node);
+        drop_node = std::move(drop_child);
+    }
+    if (node != left_node) { unlock_node(node, locktype_t::WRITE); }
+    unlock_node(drop_node, locktype_t::READ);
+    if (ret != btree_status_t::success) {
+        if (unlink_first) { std::memcpy(parent_node->m_phys_node_buf, parent_buf.data(), parent_buf.size()); }
+        unlock_node(left_node, locktype_t::WRITE);
+        return ret;
+    }
+    if (!unlink_first) {
+        ret = parent_node->remove(start_idx, end_idx);
+        BT_NODE_REL_ASSERT_EQ(ret, btree_status_t::success, parent_node, "Remove of dropped children failed");
+    }
+
+    BT_NODE_LOG(DEBUG, parent_node, "Dropped children idx=[{}-{}], left child={}", start_idx, end_idx,
+                left_node->node_id());
+    ret = transact_write_nodes({}, left_node, parent_node, context);
+    unlock_node(left_node, locktype_t::WRITE);
+    if (ret != btree_status_t::success) { return ret; }
+
+    {
+        std::unique_lock lg(m_dropped_mtx);
+        for (auto const id : dropped_ids) {
+            m_dropped_subtrees.emplace_back(id, dropped_level);
+        }
+    }
+    m_drop_gen.fetch_add(1);
+
+    // Leaves are not read to free them, so the entries within are known only from the subtree counts
+    if (is_subtree_counted()) { m_subtree_delta -= int64_t(nobjs); }
+    COUNTER_DECREMENT(m_metrics, btree_obj_count, nobjs);
+    COUNTER_INCREMENT(m_metrics, btree_subtree_drop_count, dropped_ids.size());
+    return ret;
+}
+
+/* Free the subtrees dropped by the range removes, by their ids. Only the interior nodes are read to find their
+ * children, none of the nodes are locked and the leaves are not read at all. Operations which descended into a dropped
+ * subtree before it was unlinked hold m_btree_lock shared till they are done, and so do the cursors as long as they are
+ * positioned on a leaf, so that they are waited out by acquiring it exclusively once before freeing. Hence it is called
+ * after the remove has released m_btree_lock. Cursors released in the meantime see m_drop_gen bumped and reposition
+ * from root, instead of relocking a leaf which could be freed by then.
+ */
+template < typename K, typename V >
+void Btree< K, V >::free_dropped_subtrees() {
+    std::vector< std::pair< bnodeid_t, uint16_t > > subtrees;
+    {
+        std::unique_lock lg(m_dropped_mtx);
+        subtrees.swap(m_dropped_subtrees);
+    }
+    if (subtrees.empty()) { return; }
+
+    run_subtree_free([this, subtrees = std::move(subtrees)]() {
+        m_btree_lock.lock();
+        m_btree_lock.unlock();
+
+        std::vector< bnodeid_t > batch;
+        std::atomic< uint64_t > n_freed{0};
+        for (auto const& [id, level] : subtrees) {
+            auto const ret = destroy_subtree(id, level, batch, n_freed);
+            if (ret != btree_status_t::success) {
+                BT_LOG(ERROR, "Unable to read the dropped subtree under node={}, leaking it, status={}", id,
+                       enum_name(ret));
+            }
+        }
+        free_destroyed_nodes(batch, n_freed);
+        BT_LOG(DEBUG, "Freed {} nodes of {} dropped subtrees", n_freed.load(), subtrees.size());
+    });
+}
+
 template < typename K, typename V >
 btree_status_t Btree< K, V >::repair_merge(const BtreeNodePtr& parent_node, const BtreeNodePtr& left_child,
                                            uint32_t parent_merge_idx, void* context) {
@@ -555,6 +887,7 @@ btree_status_t Btree< K, V >::repair_merge(const BtreeNodePtr& parent_node, cons
     folly::small_vector< BtreeNodePtr, 3 > old_nodes;
     folly::small_vector< BtreeNodePtr, 3 > new_nodes;
     bnodeid_t next_nodeid;
+    std::vector< uint8_t > parent_buf;
 
     // Get next 2 entries after left child which were merge would have happend, from parent point of view. The 2 entries
     // is an example, but generically it is m_max_merge_nodes - 1 from left child are gathered.
@@ -579,6 +912,9 @@ btree_status_t Btree< K, V >::repair_merge(const BtreeNodePtr& parent_node, cons
     }
 
     // Now do a diff between old and new and anything not found from old in new nodes has to be removed.
+    if (is_reencoded_node(parent_node)) {
+        parent_buf.assign(parent_node->m_phys_node_buf, parent_node->m_phys_node_buf + m_bt_cfg.node_size());
+    }
     upto_idx = new_nodes.size();
     for (auto& old_node : old_nodes) {
         for (uint32_t new_idx{0}; new_idx < new_nodes.size(); ++new_idx) {
@@ -588,15 +924,33 @@ btree_status_t Btree< K, V >::repair_merge(const BtreeNodePtr& parent_node, cons
             }
         }
         if (upto_idx < new_nodes.size()) { break; }
-        parent_node->remove(parent_merge_idx + 1);
+        ret = parent_node->remove(parent_merge_idx + 1);
+        if (ret != btree_status_t::success) { break; }
     }
 
     BT_NODE_REL_ASSERT_LE(upto_idx, old_nodes.size(), parent_node);
-    for (uint32_t i{0}; i < upto_idx; ++i) {
-        parent_node->insert(parent_merge_idx + 1 + i, new_nodes[i]->get_last_key< K >(),
-                            BtreeLinkInfo{new_nodes[i]->node_id(), left_child->link_version()});
+    for (uint32_t i{0}; (i < upto_idx) && (ret == btree_status_t::success); ++i) {
+        ret = parent_node->insert(parent_merge_idx + 1 + i, new_nodes[i]->get_last_key< K >(),
+                                  child_link(BtreeLinkInfo{new_nodes[i]->node_id(), left_child->link_version()}));
+    }
+    if (ret == btree_status_t::success) {
+        ret = parent_node->update(parent_merge_idx, child_link(left_child->link_info()));
+    }
+    if (ret != btree_status_t::success) {
+        // Parent which re-encodes on every change (see CompactNode) found no room, leave it as it was to be repaired
+        // by a later write
+        BT_NODE_LOG(DEBUG, parent_node, "No room to repair the merge of child idx={}, status={}", parent_merge_idx,
+                    enum_name(ret));
+        BT_NODE_REL_ASSERT(!parent_buf.empty(), parent_node, "Repair failed midway on a node which can't roll back");
+        std::memcpy(parent_node->m_phys_node_buf, parent_buf.data(), parent_buf.size());
+        goto done;
+    }
+    if (is_subtree_counted()) {
+        set_child_count(parent_node, parent_merge_idx, left_child);
+        for (uint32_t i{0}; i < upto_idx; ++i) {
+            set_child_count(parent_node, parent_merge_idx + 1 + i, new_nodes[i]);
+        }
     }
-    parent_node->update(parent_merge_idx, left_child->link_info());
     ret = transact_write_nodes(new_nodes, left_child, parent_node, context);
 
 done:
@@ -610,4 +964,142 @@ done:
     }
     return ret;
 }
+
+/* Deferred merges: Leaf found underfull by a remove is not merged right away, instead a key within the leaf is recorded
+ * for rebalance() to merge it later. Remove thus neither waits for the sibling locks nor dirties the siblings and the
+ * parent, and a leaf which is refilled by then is not merged at all. Once the deferred merges are at the max, removes
+ * merge on their own as usual.
+ *
+ * Returns - true if the merge is deferred, false if it has to be merged right away
+ */
+template < typename K, typename V >
+bool Btree< K, V >::defer_merge(const BtreeNodePtr& parent_node, uint32_t idx, const BtreeNodePtr& child_node) {
+    if (!is_merge_deferred()) { return false; }
+
+    // Any key within the child leads to it, empty child is reached through its key in parent. Child merged with its
+    // right siblings is never the edge, hence always has its key in parent.
+    K key = (child_node->total_entries() != 0) ? child_node->get_first_key< K >()
+                                               : parent_node->get_nth_key< K >(idx, true /* copy */);
+
+    std::unique_lock lg{m_merge_mtx};
+    if ((m_deferred_merges.size() >= m_bt_cfg.m_max_deferred_merges) && (m_deferred_merges.count(key) == 0)) {
+        return false;
+    }
+    if (m_deferred_merges.insert(std::move(key)).second) {
+        COUNTER_INCREMENT(m_metrics, btree_deferred_merge_count, 1);
+    }
+    return true;
+}
+
+template < typename K, typename V >
+btree_status_t Btree< K, V >::rebalance(void* context, uint32_t max_merges) {
+    btree_status_t ret{btree_status_t::success};
+    for (uint32_t n{0}; (max_merges == 0) || (n < max_merges); ++n) {
+        K key;
+        {
+            std::unique_lock lg{m_merge_mtx};
+            if (m_deferred_merges.empty()) { break; }
+            key = std::move(m_deferred_merges.extract(m_deferred_merges.begin()).value());
+        }
+
+        lock_for_write(is_subtree_counted());
+        ret = merge_deferred(key, context);
+        unlock_for_write(is_subtree_counted());
+
+        if (ret == btree_status_t::merge_not_required) {
+            ret = btree_status_t::success;
+        } else if (ret != btree_status_t::success) {
+            // Left to be merged by the next rebalance
+            std::unique_lock lg{m_merge_mtx};
+            m_deferred_merges.insert(std::move(key));
+            break;
+        }
+    }
+    return ret;
+}
+
+template < typename K, typename V >
+uint64_t Btree< K, V >::deferred_merges_count() const {
+    std::unique_lock lg{m_merge_mtx};
+    return m_deferred_merges.size();
+}
+
+/* Merge the leaf which has the key with its right siblings, if it is still underfull. Interior nodes above the parent
+ * of the leaf are read locked on the way down. Parent is relocked while its own parent is still held, with upgrade lock
+ * to be promoted in place same as the removes, or with write lock right away if upgrade locks are not turned on.
+ *
+ * NOTE: It expects the caller to hold the m_btree_lock for write.
+ */
+template < typename K, typename V >
+btree_status_t Btree< K, V >::merge_deferred(K const& key, void* context) {
+    auto const parent_lock = m_bt_cfg.m_upgrade_locks_turned_on ? locktype_t::UPGRADE : locktype_t::WRITE;
+    auto const relock_parent = [&](BtreeNodePtr const& n) {
+        unlock_node(n, locktype_t::READ);
+        return lock_node(n, parent_lock, context);
+    };
+
+    BtreeNodePtr node;
+    auto ret = read_and_lock_node(m_root_node_info.bnode_id(), node, locktype_t::READ, locktype_t::READ, context);
+    if (ret != btree_status_t::success) { return ret; }
+    if (node->level() == 1) {
+        ret = relock_parent(node);
+        if (ret != btree_status_t::success) { return ret; }
+    }
+    auto curlock = (node->level() == 1) ? parent_lock : locktype_t::READ;
+
+    while (curlock == locktype_t::READ) {
+        auto const idx = node->find(key, nullptr, false).second;
+        if (node->is_leaf() || ((idx == node->total_entries()) && !node->has_valid_edge())) {
+            unlock_node(node, curlock);
+            return btree_status_t::merge_not_required;
+        }
+
+        BtreeLinkInfo child_info;
+        BtreeNodePtr child_node;
+        ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::READ, locktype_t::READ, context);
+        if ((ret == btree_status_t::success) && (child_node->level() == 1)) { ret = relock_parent(child_node); }
+        unlock_node(node, curlock);
+        if (ret != btree_status_t::success) { return ret; }
+        node = std::move(child_node);
+        curlock = (node->level() == 1) ? parent_lock : locktype_t::READ;
+    }
+
+    if (curlock == locktype_t::UPGRADE) {
+        curlock = locktype_t::WRITE; // Promoted in place, so this node stays locked even on failure
+        ret = promote_node_locks(node, nullptr, locktype_t::NONE, context);
+        if (ret != btree_status_t::success) {
+            unlock_node(node, curlock);
+            return ret;
+        }
+    }
+
+    // Child is merged with upto m_max_merge_nodes - 1 of its right siblings, same as in do_remove()
+    auto const idx = node->find(key, nullptr, false).second;
+    uint32_t end_idx = node->has_valid_edge() ? node->total_entries() : node->total_entries() - 1;
+    if (end_idx > (idx + m_bt_cfg.m_max_merge_nodes - 1)) { end_idx = idx + m_bt_cfg.m_max_merge_nodes - 1; }
+    if ((node->total_entries() == 0) || (idx >= end_idx)) {
+        unlock_node(node, curlock);
+        return btree_status_t::merge_not_required;
+    }
+
+    BtreeLinkInfo child_info;
+    BtreeNodePtr child_node;
+    ret = get_child_and_lock_node(node, idx, child_info, child_node, locktype_t::WRITE, locktype_t::WRITE, context);
+    if (ret != btree_status_t::success) {
+        unlock_node(node, curlock);
+        return ret;
+    }
+
+    // Leaf refilled since the remove, or split and not yet linked to the parent, is left as is
+    if (!child_node->is_merge_needed(m_bt_cfg) || is_repair_needed(child_node, child_info)) {
+        ret = btree_status_t::merge_not_required;
+    } else {
+        ret = prepare_node_txn(node, child_node, context);
+        if (ret == btree_status_t::success) { ret = merge_nodes(node, child_node, idx, end_idx, context); }
+        if (ret == btree_status_t::success) { COUNTER_INCREMENT(m_metrics, btree_merge_count, 1); }
+    }
+    unlock_node(child_node, locktype_t::WRITE);
+    unlock_node(node, curlock);
+    return ret;
+}
 } // namespace homestore
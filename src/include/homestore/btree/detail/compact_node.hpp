@@ -0,0 +1,623 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <sisl/logging/logging.h>
+#include <homestore/btree/detail/variant_node.hpp>
+#include <homestore/btree/btree_kv.hpp>
+#include "homestore/index/index_internal.hpp"
+
+SISL_LOGGING_DECL(btree)
+
+namespace homestore {
+#pragma pack(1)
+struct compact_node_header {
+    uint16_t m_data_size;  // Size of all the encoded entries, which start right after this header
+    uint16_t m_nrestarts;  // Number of restart slots at the tail of the node
+
+    uint16_t data_size() const { return m_data_size; }
+    uint16_t num_restarts() const { return m_nrestarts; }
+};
+
+struct compact_entry_hdr {
+    uint16_t m_shared_len : 15; // Length of the prefix shared with the previous key
+    uint16_t m_restart : 1;     // Is this entry a restart point (stores full key)
+    uint16_t m_suffix_len;      // Length of the key bytes stored in this entry after the shared prefix
+    uint16_t m_value_len;
+};
+
+struct compact_restart_slot {
+    uint16_t m_index;  // Index of the entry which is a restart point
+    uint16_t m_offset; // Offset of that entry from the start of the entries area
+};
+#pragma pack()
+
+// Internal format of compact node:
+// [Persistent Header][compact node header][Entry][Entry]... ... [Restart Slot][Restart Slot]
+// where each Entry is [compact entry hdr][key suffix][value]
+//
+// Keys are front coded, i.e. every entry stores only the bytes of its serialized key which differ from the previous
+// key. To avoid decoding from the start of the node for every access, some entries are stored with the full key
+// (restart points), at least one every restart_interval entries when space permits. Restart points are chosen afresh
+// on every encode of the node, only the first entry is always one. Restart slots at the tail of the node record the
+// index and offset of every restart point, so binary search happens on the restart keys directly from the node
+// buffer, followed by a short linear scan from the restart point.
+//
+// Front coding is effective when the serialized bytes of the keys sort in the same order as K::compare(), which is
+// typically the case for string keys. It is also what bounds the space accounting: removing an entry never grows the
+// encoded node. Since that is not guaranteed for other keys, update() and remove() return space_not_avail when the
+// re-encoded entries do not fit, leaving the node untouched.
+//
+// Since the entries are front coded, any insert/remove/update re-encodes the node. This trades CPU on writes for a
+// higher fanout, which makes this node type suitable for read mostly indices with long variable sized keys.
+//
+// NOTE: Keys are reconstructed from the encoded bytes, hence get_nth_key() always returns a copy of the key, even if
+// asked for a view (copy = false). Values are stored contiguously and honour the copy flag.
+template < typename K, typename V >
+class CompactNode : public VariantNode< K, V > {
+private:
+    static constexpr uint32_t restart_interval{16};
+    static constexpr uint32_t max_shared_len{0x7FFF};
+
+    // Decoded form of a set of entries, used to re-encode the node on mutation
+    struct entry_ref {
+        uint32_t key_off;
+        uint32_t key_len;
+        uint32_t val_off;
+        uint32_t val_len;
+    };
+
+    struct decoded_entries {
+        std::vector< uint8_t > arena;
+        std::vector< entry_ref > refs;
+
+        void add(uint32_t pos, uint8_t const* k, uint32_t klen, uint8_t const* v, uint32_t vlen) {
+            entry_ref ref{uint32_cast(arena.size()), klen, uint32_cast(arena.size() + klen), vlen};
+            arena.insert(arena.end(), k, k + klen);
+            arena.insert(arena.end(), v, v + vlen);
+            refs.insert(refs.begin() + pos, ref);
+        }
+        void add(uint32_t pos, sisl::blob const& k, sisl::blob const& v) { add(pos, k.bytes, k.size, v.bytes, v.size); }
+        uint8_t const* key(uint32_t i) const { return arena.data() + refs[i].key_off; }
+        uint8_t const* val(uint32_t i) const { return arena.data() + refs[i].val_off; }
+        uint32_t size() const { return uint32_cast(refs.size()); }
+    };
+
+public:
+    using BtreeNode::get_nth_key_internal;
+    using BtreeNode::get_nth_key_size;
+    using BtreeNode::get_nth_obj_size;
+    using BtreeNode::get_nth_value;
+    using BtreeNode::get_nth_value_size;
+    using BtreeNode::to_string;
+    using VariantNode< K, V >::get_nth_value;
+
+    CompactNode(uint8_t* node_buf, bnodeid_t id, bool init, bool is_leaf, const BtreeConfig& cfg) :
+            VariantNode< K, V >(node_buf, id, init, is_leaf, cfg) {
+        this->set_node_type(btree_node_type::COMPACT);
+        if (init) {
+            get_compact_header()->m_data_size = 0;
+            get_compact_header()->m_nrestarts = 0;
+        }
+    }
+
+    virtual ~CompactNode() = default;
+
+    uint32_t occupied_size() const override {
+        return get_compact_header_const()->m_data_size +
+            (get_compact_header_const()->m_nrestarts * sizeof(compact_restart_slot));
+    }
+
+    uint32_t available_size() const override { return capacity() - occupied_size(); }
+
+    /* Insert the key and value in provided index
+     * Assumption: Node lock is already taken */
+    btree_status_t insert(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        DEBUG_ASSERT_LE(ind, this->total_entries());
+        decoded_entries ents;
+        decode(ents, 0, this->total_entries());
+        ents.add(ind, key.serialize(), val.serialize());
+        if (!encode(ents, 0, ents.size())) {
+            LOGTRACEMOD(btree, "No space to insert key={} in compact node={}", key.to_string(), this->node_id());
+            return btree_status_t::space_not_avail;
+        }
+        this->inc_gen();
+#ifndef NDEBUG
+        validate_sanity();
+#endif
+        return btree_status_t::success;
+    }
+
+    [[nodiscard]] btree_status_t update(uint32_t ind, const BtreeValue& val) override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false);
+            this->set_edge_value(val);
+            this->inc_gen();
+            return btree_status_t::success;
+        }
+        K key = BtreeNode::get_nth_key< K >(ind, true);
+        return update(ind, key, val);
+    }
+
+    /* Update the key and value in the provided index. Since the node is re-encoded, an update with a larger key or
+     * value could find no room, in which case the node is left untouched and space_not_avail is returned. */
+    [[nodiscard]] btree_status_t update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+        DEBUG_ASSERT_LE(ind, this->total_entries());
+
+        // If we are updating the edge value, none of the other logic matter. Just update edge value and move on
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false);
+            this->set_edge_value(val);
+            this->inc_gen();
+            return btree_status_t::success;
+        }
+
+        decoded_entries ents;
+        decode(ents, 0, this->total_entries());
+        ents.refs.erase(ents.refs.begin() + ind);
+        ents.add(ind, key.serialize(), val.serialize());
+        if (!encode(ents, 0, ents.size())) {
+            LOGTRACEMOD(btree, "No space to update entry {} in compact node={}", ind, this->node_id());
+            return btree_status_t::space_not_avail;
+        }
+        this->inc_gen();
+        return btree_status_t::success;
+    }
+
+    /* Remove the entries [ind_s, ind_e]. Removal shortens the shared prefix of the entry after the removed ones, which
+     * is always paid for by the removed entries as long as the serialized keys sort like K::compare(). For the keys
+     * that don't, the node is left untouched and space_not_avail is returned. */
+    [[nodiscard]] btree_status_t remove(uint32_t ind_s, uint32_t ind_e) override {
+        uint32_t const total_entries = this->total_entries();
+        DEBUG_ASSERT_GE(total_entries, ind_s);
+        DEBUG_ASSERT_GE(total_entries, ind_e);
+
+        bool const remove_edge = (ind_e == total_entries);
+        V last_1_val;
+        if (remove_edge) {
+            DEBUG_ASSERT(!this->is_leaf() && this->has_valid_edge(), "Removing edge of a leaf or invalid edge");
+            get_nth_value(ind_s - 1, &last_1_val, true);
+            --ind_s;
+            --ind_e;
+        }
+
+        decoded_entries ents;
+        decode(ents, 0, total_entries);
+        ents.refs.erase(ents.refs.begin() + ind_s, ents.refs.begin() + ind_e + 1);
+        if (!encode(ents, 0, ents.size())) {
+            LOGTRACEMOD(btree, "No space to re-encode compact node={} after removing [{}-{}]", this->node_id(), ind_s,
+                        ind_e);
+            return btree_status_t::space_not_avail;
+        }
+        if (remove_edge) { this->set_edge_value(last_1_val); }
+        this->inc_gen();
+        return btree_status_t::success;
+    }
+
+    void remove_all(const BtreeConfig& cfg) override {
+        this->sub_entries(this->total_entries());
+        this->invalidate_edge();
+        this->inc_gen();
+        get_compact_header()->m_data_size = 0;
+        get_compact_header()->m_nrestarts = 0;
+    }
+
+    uint32_t move_out_to_right_by_entries(const BtreeConfig& cfg, BtreeNode& o, uint32_t nentries) override {
+        nentries = std::min(nentries, this->total_entries());
+        if (nentries == 0) { return 0; /* Nothing to move */ }
+        return move_out_to_right(static_cast< CompactNode& >(o), nentries);
+    }
+
+    uint32_t move_out_to_right_by_size(const BtreeConfig& cfg, BtreeNode& o, uint32_t size_to_move) override {
+        if (this->total_entries() == 0) { return 0; /* Nothing to move */ }
+
+        // Move entries from the right end, always leaving at least one entry in this node
+        uint32_t nentries{0};
+        uint32_t ind = this->total_entries() - 1;
+        while (ind > 0) {
+            auto const sz = entry_max_size(get_nth_key_size(ind), get_nth_value_size(ind));
+            if (sz > size_to_move) { break; }
+            size_to_move -= sz;
+            ++nentries;
+            --ind;
+        }
+        return move_out_to_right(static_cast< CompactNode& >(o), nentries);
+    }
+
+    uint32_t num_entries_by_size(uint32_t start_idx, uint32_t size) const override {
+        auto idx = start_idx;
+        uint32_t cum_size{0};
+
+        while (idx < this->total_entries()) {
+            cum_size += entry_max_size(get_nth_key_size(idx), get_nth_value_size(idx));
+            if (cum_size > size) { break; }
+            ++idx;
+        }
+        return idx - start_idx;
+    }
+
+    uint32_t copy_by_size(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx, uint32_t copy_size) override {
+        auto& other = static_cast< const CompactNode& >(o);
+        return append_from(other, start_idx, other.num_entries_by_size(start_idx, copy_size));
+    }
+
+    uint32_t copy_by_entries(const BtreeConfig& cfg, const BtreeNode& o, uint32_t start_idx,
+                             uint32_t nentries) override {
+        auto& other = static_cast< const CompactNode& >(o);
+        return append_from(other, start_idx, std::min(nentries, other.total_entries() - start_idx));
+    }
+
+    bool has_room_for_put(btree_put_type put_type, uint32_t key_size, uint32_t value_size) const override {
+        // Without the neighbouring keys we cannot tell how much of the key is shared, so assume none is. A new entry
+        // could also become a restart point.
+        auto needed_size = key_size + value_size;
+        if ((put_type == btree_put_type::UPSERT) || (put_type == btree_put_type::INSERT) ||
+            (put_type == btree_put_type::MERGE)) {
+            needed_size += sizeof(compact_entry_hdr) + sizeof(compact_restart_slot);
+        }
+        return (available_size() >= needed_size);
+    }
+
+    void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copy) const override {
+        DEBUG_ASSERT_LT(ind, this->total_entries());
+        auto& key_buf = scratch_key_buf();
+        seek_nth(ind, key_buf);
+        out_key.deserialize(sisl::blob{key_buf.data(), uint32_cast(key_buf.size())}, true /* copy */);
+    }
+
+    uint32_t get_nth_key_size(uint32_t ind) const override {
+        auto const* e = nth_entry(ind);
+        return e->m_shared_len + e->m_suffix_len;
+    }
+
+    uint32_t get_nth_value_size(uint32_t ind) const override { return nth_entry(ind)->m_value_len; }
+
+    void get_nth_value(uint32_t ind, BtreeValue* out_val, bool copy) const override {
+        if (ind == this->total_entries()) {
+            DEBUG_ASSERT_EQ(this->is_leaf(), false, "get_nth_value out-of-bound");
+            DEBUG_ASSERT_EQ(this->has_valid_edge(), true, "get_nth_value out-of-bound");
+            *(BtreeLinkInfo*)out_val = this->get_edge_value();
+        } else {
+            auto const* e = nth_entry(ind);
+            out_val->deserialize(sisl::blob{const_cast< uint8_t* >(entry_value(e)), e->m_value_len}, copy);
+        }
+    }
+
+    uint8_t* get_node_context() override { return uintptr_cast(this) + sizeof(CompactNode< K, V >); }
+
+    std::string to_string(bool print_friendly = false) const override {
+        auto str = fmt::format(
+            "{}id={} level={} nEntries={} {} free_space={} restarts={}{} ",
+            (print_friendly ? "---------------------------------------------------------------------\n" : ""),
+            this->node_id(), this->level(), this->total_entries(), (this->is_leaf() ? "LEAF" : "INTERIOR"),
+            available_size(), get_compact_header_const()->num_restarts(),
+            (this->next_bnode() == empty_bnodeid) ? "" : fmt::format(" next_node={}", this->next_bnode()));
+        if (!this->is_leaf() && (this->has_valid_edge())) {
+            fmt::format_to(std::back_inserter(str), "edge_id={}.{}", this->edge_info().m_bnodeid,
+                           this->edge_info().m_link_version);
+        }
+        for (uint32_t i{0}; i < this->total_entries(); ++i) {
+            V val;
+            get_nth_value(i, &val, false);
+            fmt::format_to(std::back_inserter(str), "{}Entry{} [Key={} Val={}]", (print_friendly ? "\n\t" : " "), i + 1,
+                           BtreeNode::get_nth_key< K >(i, false).to_string(), val.to_string());
+        }
+        return str;
+    }
+
+    std::string to_string_keys(bool print_friendly = false) const override {
+        auto str = fmt::format("{}{}.{} nEntries={} {} ",
+                               (print_friendly ? "------------------------------------------------------------\n" : ""),
+                               this->node_id(), this->link_version(), this->total_entries(),
+                               (this->is_leaf() ? "LEAF" : "INTERIOR"));
+        if (!this->is_leaf() && (this->has_valid_edge())) {
+            fmt::format_to(std::back_inserter(str), "edge_id={}.{}", this->edge_info().m_bnodeid,
+                           this->edge_info().m_link_version);
+        }
+        if (this->total_entries() == 0) {
+            fmt::format_to(std::back_inserter(str), " [EMPTY] ");
+            return str;
+        }
+
+        // Keys are decoded in a single pass over the node, instead of seeking from a restart point for every key
+        decoded_entries ents;
+        decode(ents, 0, this->total_entries());
+        K key;
+        fmt::format_to(std::back_inserter(str), "{}[", (print_friendly ? "\n" : " "));
+        for (uint32_t i{0}; i < ents.size(); ++i) {
+            key.deserialize(sisl::blob{const_cast< uint8_t* >(ents.key(i)), ents.refs[i].key_len}, false);
+            fmt::format_to(std::back_inserter(str), "{}{}", key.to_string(), (i == ents.size() - 1) ? "" : ", ");
+        }
+        fmt::format_to(std::back_inserter(str), "]");
+        return str;
+    }
+
+#ifndef NDEBUG
+    void validate_sanity() {
+        if (this->total_entries() == 0) { return; }
+
+        // validate if keys are in ascending order
+        K prev_key = BtreeNode::get_nth_key< K >(0, false);
+        for (uint32_t i{1}; i < this->total_entries(); ++i) {
+            K key = BtreeNode::get_nth_key< K >(i, false);
+            if (prev_key.compare(key) > 0) {
+                DEBUG_ASSERT(false, "Found non sorted entry: {} -> {}", prev_key.to_string(), key.to_string());
+            }
+            prev_key = std::move(key);
+        }
+    }
+#endif
+
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        auto const nrestarts = get_compact_header_const()->m_nrestarts;
+        if (nrestarts == 0) { return std::make_pair(false, 0u); }
+
+        // Binary search on restart keys, which are stored in full in the node, to find the last restart point whose key
+        // is <= the search key.
+        K nth_key;
+        int start{-1};
+        int end = int_cast(nrestarts);
+        while ((end - start) > 1) {
+            int const mid = start + (end - start) / 2;
+            auto const* e = entry_at(restart_slot(uint32_cast(mid))->m_offset);
+            nth_key.K::deserialize(sisl::blob{const_cast< uint8_t* >(entry_key_suffix(e)), e->m_suffix_len}, false);
+            int const x = nth_key.K::compare(key);
+            if (x == 0) {
+                return std::make_pair(true, uint32_cast(restart_slot(uint32_cast(mid))->m_index));
+            } else if (x > 0) {
+                end = mid;
+            } else {
+                start = mid;
+            }
+        }
+        if (start < 0) { return std::make_pair(false, 0u); }
+
+        // Scan the entries after the restart point, till the next restart point
+        auto const* slot = restart_slot(uint32_cast(start));
+        uint32_t const next_restart = uint32_cast(start) + 1;
+        uint32_t const scan_end =
+            (next_restart < nrestarts) ? restart_slot(next_restart)->m_index : this->total_entries();
+        auto& key_buf = scratch_key_buf();
+        auto const* e = entry_at(slot->m_offset);
+        key_buf.assign(entry_key_suffix(e), entry_key_suffix(e) + e->m_suffix_len);
+        for (uint32_t ind = slot->m_index + 1; ind < scan_end; ++ind) {
+            e = next_entry(e);
+            append_key(e, key_buf);
+            nth_key.K::deserialize(sisl::blob{key_buf.data(), uint32_cast(key_buf.size())}, false);
+            int const x = nth_key.K::compare(key);
+            if (x >= 0) { return std::make_pair((x == 0), ind); }
+        }
+        return std::make_pair(false, scan_end);
+    }
+
+private:
+    uint32_t move_out_to_right(CompactNode& other, uint32_t nentries) {
+        auto const this_gen = this->node_gen();
+        auto const other_gen = other.node_gen();
+        auto const this_nentries = this->total_entries();
+
+        decoded_entries ents;
+        decode(ents, 0, this_nentries);
+        other.decode(ents, 0, other.total_entries());
+
+        // Moved entries followed by the existing entries of the other node, shrink if they don't fit
+        while ((nentries > 0) && !other.encode(ents, this_nentries - nentries, ents.size())) {
+            --nentries;
+        }
+        if (nentries == 0) { return 0; }
+
+        if (!this->is_leaf() && (other.total_entries() != 0)) {
+            // Incase this node is an edge node, move the stick to the right hand side node
+            other.set_edge_info(this->edge_info());
+            this->invalidate_edge();
+        }
+        encode(ents, 0, this_nentries - nentries);
+
+        this->set_gen(this_gen + 1);
+        other.set_gen(other_gen + 1);
+        return nentries;
+    }
+
+    uint32_t append_from(const CompactNode& other, uint32_t start_idx, uint32_t nentries) {
+        auto const this_gen = this->node_gen();
+        auto const this_nentries = this->total_entries();
+
+        decoded_entries ents;
+        decode(ents, 0, this_nentries);
+        other.decode(ents, start_idx, start_idx + nentries);
+        while ((nentries > 0) && !encode(ents, 0, this_nentries + nentries)) {
+            --nentries;
+        }
+        this->set_gen(this_gen + 1);
+
+        // If we copied everything from start_idx till end and if its an edge node, need to copy the edge id as well.
+        if (other.has_valid_edge() && ((start_idx + nentries) == other.total_entries())) {
+            this->set_edge_info(other.edge_info());
+        }
+        return nentries;
+    }
+
+    // Decode the entries [start, end) of this node and append them to the decoded entries
+    void decode(decoded_entries& out, uint32_t start, uint32_t end) const {
+        if (start >= end) { return; }
+        std::vector< uint8_t > key_buf;
+        auto const* e = seek_nth(start, key_buf);
+        for (uint32_t ind = start; ind < end; ++ind) {
+            if (ind != start) {
+                e = next_entry(e);
+                append_key(e, key_buf);
+            }
+            out.add(out.size(), key_buf.data(), uint32_cast(key_buf.size()), entry_value(e), e->m_value_len);
+        }
+    }
+
+    // Encode the decoded entries [begin, end) as the only entries of this node. Returns false without modifying the
+    // node, if they don't fit.
+    bool encode(decoded_entries const& ents, uint32_t begin, uint32_t end) {
+        auto const shared_len = [&ents](uint32_t prev, uint32_t cur) -> uint32_t {
+            auto const len = std::min(ents.refs[prev].key_len, ents.refs[cur].key_len);
+            auto const* p = ents.key(prev);
+            auto const* c = ents.key(cur);
+            uint32_t n{0};
+            while ((n < len) && (n < max_shared_len) && (p[n] == c[n])) {
+                ++n;
+            }
+            return n;
+        };
+
+        // First pass to compute the minimum size, where only the first entry is a restart point. Restart points of the
+        // earlier encoding are not carried over, so that the node does not accumulate them over the mutations.
+        uint32_t total_size{sizeof(compact_restart_slot)};
+        for (uint32_t i{begin}; i < end; ++i) {
+            auto const& r = ents.refs[i];
+            total_size += sizeof(compact_entry_hdr) + r.key_len - ((i == begin) ? 0 : shared_len(i - 1, i)) + r.val_len;
+        }
+        if (total_size > capacity()) { return false; }
+
+        // Second pass to write the entries, adding restart points to keep the scans short as long as space permits.
+        uint32_t budget = capacity() - total_size;
+        std::vector< compact_restart_slot > slots;
+        uint8_t* ptr = entries_area();
+        uint32_t since_restart{0};
+        for (uint32_t i{begin}; i < end; ++i) {
+            auto const& r = ents.refs[i];
+            uint32_t shared = (i == begin) ? 0 : shared_len(i - 1, i);
+            bool restart = (i == begin);
+            if (!restart && (since_restart + 1 >= restart_interval) &&
+                (shared + sizeof(compact_restart_slot) <= budget)) {
+                budget -= shared + sizeof(compact_restart_slot);
+                restart = true;
+            }
+            if (restart) {
+                shared = 0;
+                since_restart = 0;
+                slots.push_back(
+                    compact_restart_slot{s_cast< uint16_t >(i - begin), s_cast< uint16_t >(ptr - entries_area())});
+            } else {
+                ++since_restart;
+            }
+
+            auto* e = r_cast< compact_entry_hdr* >(ptr);
+            e->m_shared_len = shared;
+            e->m_restart = restart ? 1 : 0;
+            e->m_suffix_len = r.key_len - shared;
+            e->m_value_len = r.val_len;
+            ptr += sizeof(compact_entry_hdr);
+            std::memcpy(ptr, ents.key(i) + shared, r.key_len - shared);
+            ptr += r.key_len - shared;
+            std::memcpy(ptr, ents.val(i), r.val_len);
+            ptr += r.val_len;
+        }
+
+        get_compact_header()->m_data_size = s_cast< uint16_t >(ptr - entries_area());
+        get_compact_header()->m_nrestarts = s_cast< uint16_t >(slots.size());
+        if (!slots.empty()) {
+            std::memcpy(uintptr_cast(restart_slot_mutable(0)), slots.data(),
+                        slots.size() * sizeof(compact_restart_slot));
+        }
+        this->set_total_entries(end - begin);
+        return true;
+    }
+
+    // Walk from the restart point at or before ind upto ind, reconstructing the key of ind in the key_buf. Returns the
+    // entry at ind.
+    const compact_entry_hdr* seek_nth(uint32_t ind, std::vector< uint8_t >& key_buf) const {
+        auto const* slot = restart_slot_for(ind);
+        auto const* e = entry_at(slot->m_offset);
+        key_buf.assign(entry_key_suffix(e), entry_key_suffix(e) + e->m_suffix_len);
+        for (uint32_t i = slot->m_index; i < ind; ++i) {
+            e = next_entry(e);
+            append_key(e, key_buf);
+        }
+        return e;
+    }
+
+    const compact_entry_hdr* nth_entry(uint32_t ind) const {
+        DEBUG_ASSERT_LT(ind, this->total_entries());
+        auto const* slot = restart_slot_for(ind);
+        auto const* e = entry_at(slot->m_offset);
+        for (uint32_t i = slot->m_index; i < ind; ++i) {
+            e = next_entry(e);
+        }
+        return e;
+    }
+
+    // Last restart slot whose entry index is <= ind. First entry is always a restart point.
+    const compact_restart_slot* restart_slot_for(uint32_t ind) const {
+        uint32_t lo{0};
+        uint32_t hi = get_compact_header_const()->m_nrestarts;
+        while ((hi - lo) > 1) {
+            uint32_t const mid = lo + (hi - lo) / 2;
+            if (restart_slot(mid)->m_index <= ind) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        return restart_slot(lo);
+    }
+
+    static void append_key(const compact_entry_hdr* e, std::vector< uint8_t >& key_buf) {
+        key_buf.resize(e->m_shared_len);
+        key_buf.insert(key_buf.end(), entry_key_suffix(e), entry_key_suffix(e) + e->m_suffix_len);
+    }
+
+    static std::vector< uint8_t >& scratch_key_buf() {
+        static thread_local std::vector< uint8_t > s_key_buf;
+        return s_key_buf;
+    }
+
+    static uint32_t entry_max_size(uint32_t key_size, uint32_t value_size) {
+        return sizeof(compact_entry_hdr) + key_size + value_size + sizeof(compact_restart_slot);
+    }
+
+    static const uint8_t* entry_key_suffix(const compact_entry_hdr* e) {
+        return r_cast< const uint8_t* >(e) + sizeof(compact_entry_hdr);
+    }
+    static const uint8_t* entry_value(const compact_entry_hdr* e) { return entry_key_suffix(e) + e->m_suffix_len; }
+    static const compact_entry_hdr* next_entry(const compact_entry_hdr* e) {
+        return r_cast< const compact_entry_hdr* >(entry_value(e) + e->m_value_len);
+    }
+
+    const compact_entry_hdr* entry_at(uint16_t offset) const {
+        return r_cast< const compact_entry_hdr* >(entries_area_const() + offset);
+    }
+
+    uint32_t capacity() const { return this->node_data_size() - sizeof(compact_node_header); }
+
+    uint8_t* entries_area() { return this->node_data_area() + sizeof(compact_node_header); }
+    const uint8_t* entries_area_const() const { return this->node_data_area_const() + sizeof(compact_node_header); }
+
+    const compact_restart_slot* restart_slot(uint32_t i) const {
+        return r_cast< const compact_restart_slot* >(this->node_data_area_const() + this->node_data_size() -
+                                                     (get_compact_header_const()->m_nrestarts - i) *
+                                                         sizeof(compact_restart_slot));
+    }
+    compact_restart_slot* restart_slot_mutable(uint32_t i) {
+        return r_cast< compact_restart_slot* >(this->node_data_area() + this->node_data_size() -
+                                               (get_compact_header()->m_nrestarts - i) * sizeof(compact_restart_slot));
+    }
+
+    inline compact_node_header* get_compact_header() { return r_cast< compact_node_header* >(this->node_data_area()); }
+    inline const compact_node_header* get_compact_header_const() const {
+        return r_cast< const compact_node_header* >(this->node_data_area_const());
+    }
+};
+} // namespace homestore
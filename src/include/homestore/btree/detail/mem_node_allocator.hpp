@@ -0,0 +1,285 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <sys/mman.h>
+
+#include <sisl/fds/utils.hpp>
+#include <sisl/logging/logging.h>
+#include <homestore/btree/detail/btree_node.hpp>
+
+namespace homestore {
+/* MemNodeAllocator is a slab allocator for the node buffers of in-memory btrees, shared by all the in-memory btrees of
+ * the process.
+ *
+ * Node sizes are rounded up to a size class, which are the powers of 2 and the midpoints between them (..., 2K, 3K, 4K,
+ * 6K, 8K, ...), so trees of different node sizes waste at most a third of a buffer and trees of similar node sizes
+ * share the slabs. Each size class carves its buffers out of its own slabs, and every buffer is aligned to a cache
+ * line. Freed buffers go back to the free list of their slab and are reused for subsequent allocations, and a slab
+ * which has all of its buffers freed is returned to the system, except for one spare slab per size class kept to
+ * avoid thrashing on split/merge at the boundary.
+ *
+ * Slabs are sized to hold 64 nodes but are capped at 2MB, so the size classes of large nodes have fewer nodes per slab,
+ * down to a single node for nodes of 2MB and above. Slabs can optionally be backed by huge pages, in which case they
+ * are rounded up to a multiple of 2MB. If explicit huge pages are not available, it falls back to regular memory
+ * advised for transparent huge pages. Since huge page backing is a property
+ * of the slab, there is one allocator instance with and one without.
+ *
+ * Free list of a slab is kept outside the node buffers, so that a freed buffer retains its contents until it is
+ * allocated again. As the buffer owner of the nodes, the buffers are returned only when the last reference to the node
+ * object is dropped, so readers still holding a freed node never see its buffer reused underneath.
+ */
+class MemNodeAllocator : public BtreeNodeBufOwner {
+private:
+    static constexpr uint32_t cache_line_size{64};
+    static constexpr uint32_t min_nodes_per_slab{64};
+    static constexpr size_t huge_page_size{2 * 1024 * 1024};
+    static constexpr size_t max_slab_size{huge_page_size}; // Larger size classes have fewer nodes per slab, down to 1
+    static constexpr uint32_t min_size_class_shift{8};  // Smallest size class is 256 bytes
+    static constexpr uint32_t max_size_class_shift{24}; // Largest size class is 16MB
+    static constexpr uint32_t num_size_classes{2 * (max_size_class_shift - min_size_class_shift + 1)};
+
+    struct size_class;
+    struct slab_info {
+        uint8_t* base{nullptr};
+        bool mmapped{false};
+        size_class* sclass{nullptr};
+        std::vector< uint32_t > free_slots;
+    };
+
+    struct size_class {
+        uint32_t node_stride{0};
+        size_t slab_size{0};
+        uint32_t nodes_per_slab{0};
+
+        mutable std::mutex mtx;
+        std::vector< slab_info* > partial_slabs; // Slabs with atleast one free buffer, allocations are served from
+        uint64_t num_in_use{0};
+        uint32_t num_slabs{0};
+        uint32_t num_empty_slabs{0};
+    };
+
+    bool m_huge_pages;
+    std::array< size_class, num_size_classes > m_classes;
+
+    // All slabs of all size classes by their base address, to find the slab of a buffer being freed
+    mutable std::shared_mutex m_slabs_mtx;
+    std::map< uintptr_t, std::unique_ptr< slab_info > > m_slabs;
+
+public:
+    explicit MemNodeAllocator(bool huge_pages) : m_huge_pages{huge_pages} {
+        for (uint32_t i{0}; i < num_size_classes; ++i) {
+            auto& sc = m_classes[i];
+            sc.node_stride = class_stride(i);
+            sc.slab_size = slab_size_of(sc.node_stride);
+            sc.nodes_per_slab = uint32_cast(sc.slab_size / sc.node_stride);
+        }
+    }
+
+    MemNodeAllocator(const MemNodeAllocator&) = delete;
+    MemNodeAllocator& operator=(const MemNodeAllocator&) = delete;
+
+    ~MemNodeAllocator() override {
+        uint64_t in_use{0};
+        for (auto& sc : m_classes) {
+            in_use += sc.num_in_use;
+        }
+        if (in_use != 0) {
+            // Some node objects still hold their buffers, leave the slabs as is instead of freeing memory in use
+            LOGWARN("Node allocator destroyed with {} node buffers in use, leaking {} slabs", in_use, m_slabs.size());
+            return;
+        }
+        for (auto& [base, slab] : m_slabs) {
+            release_slab(*slab);
+        }
+    }
+
+    /// @brief Returns the process wide node allocator, with or without huge page backing. Btrees hold on to the
+    /// returned pointer, so the allocator outlives all the nodes of the btrees.
+    static std::shared_ptr< MemNodeAllocator > instance(bool huge_pages) {
+        static std::shared_ptr< MemNodeAllocator > s_allocator{std::make_shared< MemNodeAllocator >(false)};
+        static std::shared_ptr< MemNodeAllocator > s_huge_page_allocator{std::make_shared< MemNodeAllocator >(true)};
+        return huge_pages ? s_huge_page_allocator : s_allocator;
+    }
+
+    /// @brief Allocates a cache line aligned node buffer of atleast node_size bytes, nullptr if memory is not available
+    uint8_t* alloc(uint32_t node_size) {
+        auto& sc = m_classes[size_class_index(node_size)];
+        std::unique_lock lg(sc.mtx);
+        if (sc.partial_slabs.empty()) {
+            auto slab = new_slab(sc);
+            if (slab == nullptr) { return nullptr; }
+            sc.partial_slabs.push_back(slab);
+            ++sc.num_empty_slabs;
+        }
+
+        auto* slab = sc.partial_slabs.back();
+        if (slab->free_slots.size() == sc.nodes_per_slab) { --sc.num_empty_slabs; }
+        auto const slot = slab->free_slots.back();
+        slab->free_slots.pop_back();
+        if (slab->free_slots.empty()) { sc.partial_slabs.pop_back(); }
+        ++sc.num_in_use;
+        return slab->base + (size_t(slot) * sc.node_stride);
+    }
+
+    /// @brief Returns the node buffer to its slab. Slab is released to the system if all of its buffers are free,
+    /// unless it is the only spare slab of its size class.
+    void free(uint8_t* buf) {
+        slab_info* slab = find_slab(buf);
+        RELEASE_ASSERT(slab != nullptr, "Freeing node buffer {} not allocated by this allocator", (void*)buf);
+
+        auto& sc = *slab->sclass;
+        bool release{false};
+        {
+            std::unique_lock lg(sc.mtx);
+            if (slab->free_slots.empty()) { sc.partial_slabs.push_back(slab); }
+            slab->free_slots.push_back(uint32_cast((buf - slab->base) / sc.node_stride));
+            --sc.num_in_use;
+
+            if (slab->free_slots.size() == sc.nodes_per_slab) {
+                if (sc.num_empty_slabs == 0) {
+                    ++sc.num_empty_slabs; // Keep it as spare
+                } else {
+                    sc.partial_slabs.erase(std::find(sc.partial_slabs.begin(), sc.partial_slabs.end(), slab));
+                    --sc.num_slabs;
+                    release = true;
+                }
+            }
+        }
+
+        if (release) {
+            // Slab is no longer reachable from its size class, so nobody else could be allocating from it
+            std::unique_lock lg(m_slabs_mtx);
+            release_slab(*slab);
+            m_slabs.erase(r_cast< uintptr_t >(slab->base));
+        }
+    }
+
+    /// @brief Number of node buffers in use, of the size class of the given node size
+    uint64_t num_in_use(uint32_t node_size) const {
+        auto& sc = m_classes[size_class_index(node_size)];
+        std::unique_lock lg(sc.mtx);
+        return sc.num_in_use;
+    }
+
+    /// @brief Number of slabs held, of the size class of the given node size
+    size_t num_slabs(uint32_t node_size) const {
+        auto& sc = m_classes[size_class_index(node_size)];
+        std::unique_lock lg(sc.mtx);
+        return sc.num_slabs;
+    }
+
+    /// @brief Size of the buffers handed out for the given node size
+    uint32_t alloc_size(uint32_t node_size) const { return m_classes[size_class_index(node_size)].node_stride; }
+
+    size_t slab_size(uint32_t node_size) const { return m_classes[size_class_index(node_size)].slab_size; }
+
+    void release_node_buf(uint8_t* buf) override { free(buf); }
+
+private:
+    slab_info* new_slab(size_class& sc) {
+        auto slab = std::make_unique< slab_info >();
+        slab->sclass = &sc;
+        if (m_huge_pages && (sc.slab_size % huge_page_size == 0)) {
+            void* mem = ::mmap(nullptr, sc.slab_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (mem != MAP_FAILED) {
+                slab->base = r_cast< uint8_t* >(mem);
+                slab->mmapped = true;
+            }
+        }
+
+        if (slab->base == nullptr) {
+            slab->base = r_cast< uint8_t* >(std::aligned_alloc(cache_line_size, sc.slab_size));
+            if (slab->base == nullptr) {
+                LOGERROR("Unable to allocate node slab of size={}", sc.slab_size);
+                return nullptr;
+            }
+#ifdef MADV_HUGEPAGE
+            if (m_huge_pages) { ::madvise(slab->base, sc.slab_size, MADV_HUGEPAGE); }
+#endif
+        }
+
+        // Hand out the buffers in increasing order of address
+        slab->free_slots.reserve(sc.nodes_per_slab);
+        for (uint32_t i{sc.nodes_per_slab}; i > 0; --i) {
+            slab->free_slots.push_back(i - 1);
+        }
+        ++sc.num_slabs;
+
+        auto* ret = slab.get();
+        std::unique_lock lg(m_slabs_mtx);
+        m_slabs.emplace(r_cast< uintptr_t >(ret->base), std::move(slab));
+        return ret;
+    }
+
+    slab_info* find_slab(uint8_t* buf) const {
+        std::shared_lock lg(m_slabs_mtx);
+        auto it = m_slabs.upper_bound(r_cast< uintptr_t >(buf));
+        if (it == m_slabs.begin()) { return nullptr; }
+        --it;
+        auto* slab = it->second.get();
+        return (buf < slab->base + slab->sclass->slab_size) ? slab : nullptr;
+    }
+
+    void release_slab(slab_info& slab) {
+        if (slab.mmapped) {
+            ::munmap(slab.base, slab.sclass->slab_size);
+        } else {
+            std::free(slab.base);
+        }
+    }
+
+    // Slab holds min_nodes_per_slab nodes, but no more than max_slab_size unless a single node is larger than that.
+    // Huge page backed slabs are a multiple of the huge page size.
+    size_t slab_size_of(uint32_t node_stride) const {
+        auto const target = std::min(power_of_2_ceil(size_t(node_stride) * min_nodes_per_slab), max_slab_size);
+        auto const sz = size_t(node_stride) * std::max(target / node_stride, size_t{1});
+        return m_huge_pages ? sisl::round_up(sz, huge_page_size) : sz;
+    }
+
+    // Size classes are 2^n and 3 * 2^(n-1), in increasing order
+    static uint32_t class_stride(uint32_t idx) {
+        uint32_t const base = 1u << (min_size_class_shift + (idx / 2));
+        return (idx % 2 == 0) ? base : (base + base / 2);
+    }
+
+    static uint32_t size_class_index(uint32_t node_size) {
+        auto const sz = sisl::round_up(std::max(node_size, cache_line_size), cache_line_size);
+        for (uint32_t i{0}; i < num_size_classes; ++i) {
+            if (class_stride(i) >= sz) { return i; }
+        }
+        RELEASE_ASSERT(false, "Node size {} is larger than the largest size class", node_size);
+        return num_size_classes - 1;
+    }
+
+    static size_t power_of_2_ceil(size_t n) {
+        size_t p{1};
+        while (p < n) {
+            p <<= 1;
+        }
+        return p;
+    }
+};
+} // namespace homestore
@@ -181,9 +181,11 @@ public:
     ///         If all keys were upserted successfully, the method returns std::nullopt.
     ///         If the method ran out of space in the node, the method returns the key that was last upserted
     btree_status_t multi_put(BtreeKeyRange< K > const& keys, BtreeKey const& first_input_key, BtreeValue const& val,
-                             btree_put_type put_type, K* last_failed_key,
-                             put_filter_cb_t const& filter_cb = nullptr) override {
+                             btree_put_type put_type, K* last_failed_key, put_filter_cb_t const& filter_cb = nullptr,
+                             put_merge_cb_t const& merge_cb = nullptr) override {
         DEBUG_ASSERT_EQ(this->is_leaf(), true, "Multi put entries on node are supported only for leaf nodes");
+        // Values of a prefix share the base value, merging every entry individually would defeat it
+        if (put_type == btree_put_type::MERGE) { return btree_status_t::not_supported; }
         if constexpr (std::is_base_of_v< BtreeIntervalKey, K > && std::is_base_of_v< BtreeIntervalValue, V >) {
             uint32_t modified{0};
 
@@ -456,17 +458,17 @@ public:
         return btree_status_t::success;
     }
 
-    void update(uint32_t idx, BtreeValue const& val) override {
-        update(idx, BtreeNode::get_nth_key< K >(idx, false), val);
+    btree_status_t update(uint32_t idx, BtreeValue const& val) override {
+        return update(idx, BtreeNode::get_nth_key< K >(idx, false), val);
     }
 
-    void update(uint32_t idx, BtreeKey const& key, BtreeValue const& val) override {
+    btree_status_t update(uint32_t idx, BtreeKey const& key, BtreeValue const& val) override {
         // If we are updating the edge value, none of the other logic matter. Just update edge value and move on
         if (idx == this->total_entries()) {
             DEBUG_ASSERT_EQ(this->is_leaf(), false);
             this->set_edge_value(val);
             this->inc_gen();
-            return;
+            return btree_status_t::success;
         }
 
         if (!has_room(1u)) {
@@ -474,7 +476,7 @@ public:
                 compact();
             } else {
                 LOGMSG_ASSERT(false, "Even after compaction there is no room for update");
-                return;
+                return btree_status_t::space_not_avail;
             }
         }
         write_suffix(idx, add_prefix(key, val), key, val);
@@ -483,9 +485,10 @@ public:
 #ifndef NDEBUG
         validate_sanity();
 #endif
+        return btree_status_t::success;
     }
 
-    void remove(uint32_t idx) override {
+    btree_status_t remove(uint32_t idx) override {
         if (idx == this->total_entries()) {
             DEBUG_ASSERT(!this->is_leaf() && this->has_valid_edge(),
                          "idx={} == num_entries={} for leaf or non-edge node", idx, this->total_entries());
@@ -505,12 +508,14 @@ public:
             this->dec_entries();
         }
         this->inc_gen();
+        return btree_status_t::success;
     }
 
-    void remove(uint32_t idx_s, uint32_t idx_e) override {
+    btree_status_t remove(uint32_t idx_s, uint32_t idx_e) override {
         for (auto idx{idx_s}; idx < idx_e; ++idx) {
             remove(idx);
         }
+        return btree_status_t::success;
     }
 
     void remove_all(BtreeConfig const& cfg) override {
@@ -649,6 +654,18 @@ public:
 
     std::string to_string_keys(bool print_friendly = false) const override { return "NOT Supported"; }
 
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        return this->typed_bsearch(key, [this](uint32_t idx, K& out_key) {
+            suffix_entry const* sentry = get_suffix_entry_c(idx);
+            if constexpr (std::is_base_of_v< BtreeIntervalKey, K >) {
+                out_key.K::deserialize(get_prefix_entry_c(sentry->prefix_slot)->key_buf(), sentry->key_buf(), false);
+            } else {
+                DEBUG_ASSERT(false, "Prefix node holds only interval keys");
+            }
+        });
+    }
+
 private:
     uint16_t add_prefix(BtreeKey const& key, BtreeValue const& val) {
         auto const slot_num = alloc_prefix();
@@ -59,7 +59,7 @@ public:
         return btree_status_t::success;
     }
 
-    void update(uint32_t ind, const BtreeValue& val) override {
+    btree_status_t update(uint32_t ind, const BtreeValue& val) override {
         set_nth_value(ind, val);
 
         // TODO: Check if we need to upgrade the gen and impact of doing  so with performance. It is especially
@@ -68,9 +68,10 @@ public:
 #ifndef NDEBUG
         validate_sanity();
 #endif
+        return btree_status_t::success;
     }
 
-    void update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+    btree_status_t update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
         if (ind == this->total_entries()) {
             DEBUG_ASSERT_EQ(this->is_leaf(), false);
             this->set_edge_value(val);
@@ -78,10 +79,11 @@ public:
             set_nth_obj(ind, key, val);
         }
         this->inc_gen();
+        return btree_status_t::success;
     }
 
     // ind_s and ind_e are inclusive
-    void remove(uint32_t ind_s, uint32_t ind_e) override {
+    btree_status_t remove(uint32_t ind_s, uint32_t ind_e) override {
         uint32_t total_entries = this->total_entries();
         DEBUG_ASSERT_GE(total_entries, ind_s, "node={}", to_string());
         DEBUG_ASSERT_GE(total_entries, ind_e, "node={}", to_string());
@@ -104,6 +106,7 @@ public:
 #ifndef NDEBUG
         validate_sanity();
 #endif
+        return btree_status_t::success;
     }
 
     void remove_all(const BtreeConfig& cfg) override {
@@ -202,8 +205,23 @@ public:
         }
     }
 
+    btree_status_t optimistic_leaf_get(BtreeKey const& key, BtreeValue& out_val) const override {
+        // Fixed size entries can be read in place without any lock, a torn read yields garbage but never reads outside
+        // the node area as long as the search is bounded by the entries sampled upfront.
+        auto const nentries = std::min(this->total_entries(), this->node_data_size() / get_nth_obj_size(0));
+        auto const [found, idx] = bsearch_upto(key, nentries);
+        if (!found) { return btree_status_t::not_found; }
+
+        sisl::blob b{const_cast< uint8_t* >(this->node_data_area_const() + (get_nth_obj_size(idx) * idx) +
+                                            get_nth_key_size(idx)),
+                     dummy_value< V >.serialized_size()};
+        out_val.deserialize(b, true /* copy */);
+        return btree_status_t::success;
+    }
+
     bool has_room_for_put(btree_put_type put_type, uint32_t key_size, uint32_t value_size) const override {
-        return ((put_type == btree_put_type::UPSERT) || (put_type == btree_put_type::INSERT))
+        return ((put_type == btree_put_type::UPSERT) || (put_type == btree_put_type::INSERT) ||
+                (put_type == btree_put_type::MERGE))
             ? (get_available_entries() > 0)
             : true;
     }
@@ -341,6 +359,40 @@ public:
         return (this->node_data_area_const() + (get_nth_obj_size(ind) * ind));
     }
 
+    /// @brief Finds the first entry whose key is >= the given key, by comparing the native integer keys in-place.
+    ///
+    /// The loop narrows down the window without any data dependent branches (the conditional is expected to be
+    /// compiled into a cmov), so random lookups do not pay for branch mispredictions and there is neither key
+    /// deserialization nor virtual compare per probe. Entries are interleaved as [key][value] in the node, hence the
+    /// keys are read at obj size stride.
+    std::pair< bool, uint32_t > native_lower_bound(const BtreeKey& key, uint32_t nentries) const {
+        using native_t = typename K::native_key_t;
+        DEBUG_ASSERT_EQ(sizeof(native_t), get_nth_key_size(0), "Native key type size mismatch with serialized size");
+
+        auto const native_key_at = [base = this->node_data_area_const(),
+                                    stride = get_nth_obj_size(0)](uint32_t ind) -> native_t {
+            native_t k;
+            std::memcpy(&k, base + (stride * ind), sizeof(native_t));
+            return k;
+        };
+
+        uint32_t n = nentries;
+        if (n == 0) { return std::make_pair(false, 0u); }
+
+        native_t search_key;
+        std::memcpy(&search_key, key.serialize().bytes, sizeof(native_t));
+
+        uint32_t lo{0};
+        while (n > 1) {
+            uint32_t const half = n / 2;
+            lo = (native_key_at(lo + half) < search_key) ? (lo + half) : lo;
+            n -= half;
+        }
+        lo += (native_key_at(lo) < search_key) ? 1u : 0u;
+        bool const found = (lo < nentries) && (native_key_at(lo) == search_key);
+        return std::make_pair(found, lo);
+    }
+
     void set_nth_key(uint32_t ind, BtreeKey* key) {
         uint8_t* entry = this->node_data_area() + (get_nth_obj_size(ind) * ind);
         sisl::blob b = key->serialize();
@@ -351,7 +403,7 @@ public:
         sisl::blob b = v.serialize();
         if (ind >= this->total_entries()) {
             RELEASE_ASSERT_EQ(this->is_leaf(), false, "setting value outside bounds on leaf node");
-            DEBUG_ASSERT_EQ(b.size, sizeof(BtreeLinkInfo::bnode_link_info),
+            DEBUG_ASSERT_GE(b.size, sizeof(BtreeLinkInfo::bnode_link_info),
                             "Invalid value size being set for non-leaf node");
             this->set_edge_info(*r_cast< BtreeLinkInfo::bnode_link_info* >(b.bytes));
         } else {
@@ -359,5 +411,21 @@ public:
             std::memcpy(entry, b.bytes, b.size);
         }
     }
+
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        return bsearch_upto(key, this->total_entries());
+    }
+
+    std::pair< bool, uint32_t > bsearch_upto(const BtreeKey& key, uint32_t nentries) const {
+        if constexpr (is_native_int_key_v< K >) {
+            return native_lower_bound(key, nentries);
+        } else {
+            return this->typed_bsearch(key, nentries, [base = this->node_data_area_const(), stride = get_nth_obj_size(0),
+                                             key_size = get_nth_key_size(0)](uint32_t ind, K& out_key) {
+                out_key.K::deserialize(sisl::blob{const_cast< uint8_t* >(base + (stride * ind)), key_size}, false);
+            });
+        }
+    }
 };
 } // namespace homestore
@@ -78,6 +78,35 @@ public:
         return count;
     }
 
+    /// @brief Gets the entries in the node within the specified range in descending order of keys.
+    ///
+    /// Same as multi_get, except that it picks upto max_count entries from the end of the matched range and returns
+    /// them largest key first.
+    ///
+    /// @param start_idx Upon return, index of the smallest key picked
+    /// @param end_idx Upon return, index of the largest key picked
+    /// @return Number of entries picked, excluding the entries rejected by the filter callback
+    virtual uint32_t multi_get_reverse(BtreeKeyRange< K > const& range, uint32_t max_count, uint32_t& start_idx,
+                                       uint32_t& end_idx, std::vector< std::pair< K, V > >* out_values = nullptr,
+                                       get_filter_cb_t const& filter_cb = nullptr) const {
+        if (!match_range(range, start_idx, end_idx)) { return 0; }
+
+        uint32_t count = std::min(end_idx - start_idx + 1, max_count);
+        start_idx = end_idx + 1 - count;
+        if (out_values || filter_cb) {
+            for (auto i{end_idx + 1}; i-- > start_idx;) {
+                K key = get_nth_key< K >(i, (out_values != nullptr) /* copy */);
+                V val = get_nth_value(i, (out_values != nullptr) /* copy */);
+                if (!filter_cb || filter_cb(key, val)) {
+                    if (out_values) { out_values->emplace_back(std::move(key), std::move(val)); }
+                } else {
+                    --count;
+                }
+            }
+        }
+        return count;
+    }
+
     /// @brief Gets any entry in the node that has a key within the specified range.
     ///
     /// This method returns any entry in the node that has a key within the specified range. The method does a  binary
@@ -193,10 +222,12 @@ public:
     /// @param existing_val [optional] A pointer to a value to store the value of the existing entry if it was updated.
     /// @param filter_cb [optional] A callback function to be called for each entry found in the node that has a key. It
     /// is used as an filter to remove anything that needn't be updated.
+    /// @param merge_cb [optional] Merge operator for the put type "Merge", which merges val into a copy of the existing
+    /// value to produce the value to be updated with. If the entry does not exist, val is inserted as is.
     /// @return A boolean indicating whether the operation was successful.
     ///
     virtual bool put(BtreeKey const& key, BtreeValue const& val, btree_put_type put_type, BtreeValue* existing_val,
-                     put_filter_cb_t const& filter_cb = nullptr) {
+                     put_filter_cb_t const& filter_cb = nullptr, put_merge_cb_t const& merge_cb = nullptr) {
         LOGMSG_ASSERT_EQ(magic(), BTREE_NODE_MAGIC, "Magic mismatch on btree_node {}",
                          get_persistent_header_const()->to_string());
         bool ret = true;
@@ -223,15 +254,37 @@ public:
             ret = (insert(idx, key, val) == btree_status_t::success);
         } else if (put_type == btree_put_type::UPDATE) {
             if (!found) return false;
-            update(idx, key, val);
+            ret = (update(idx, key, val) == btree_status_t::success);
         } else if (put_type == btree_put_type::UPSERT) {
-            (found) ? update(idx, key, val) : (void)insert(idx, key, val);
+            ret = (((found) ? update(idx, key, val) : insert(idx, key, val)) == btree_status_t::success);
+        } else if (put_type == btree_put_type::MERGE) {
+            DEBUG_ASSERT(merge_cb, "Merge put without a merge operator");
+            if (!found) {
+                ret = (insert(idx, key, val) == btree_status_t::success);
+            } else {
+                V merged_val;
+                get_nth_value(idx, &merged_val, true /* copy */);
+                merge_cb(key, merged_val, val);
+                ret = (update(idx, key, merged_val) == btree_status_t::success);
+            }
         } else {
             DEBUG_ASSERT(false, "Wrong put_type {}", put_type);
         }
         return ret;
     }
 
+    /// @brief Size of the value a merge put of the key leaves in this node, which is the existing value merged with val
+    /// if the key exists, otherwise val itself.
+    uint32_t merged_value_size(BtreeKey const& key, BtreeValue const& val, put_merge_cb_t const& merge_cb) const {
+        auto const [found, idx] = find(key, nullptr, false);
+        if (!found) { return val.serialized_size(); }
+
+        V merged_val;
+        get_nth_value(idx, &merged_val, true /* copy */);
+        merge_cb(key, merged_val, val);
+        return merged_val.serialized_size();
+    }
+
     /// @brief Put a batch of key/values into this node
     ///
     /// This method updates all entries in the node that have keys within the specified range.
@@ -247,17 +300,21 @@ public:
     ///     put_filter_decision::replace, the entry is upserted with the new value.
     ///     put_filter_decision::remove, the entry is removed from the node.
     ///     put_filter_decision::keep, the entry is not modified and the method moves on to the next entry.
+    /// @param merge_cb Merge operator for the put type "Merge", which produces the new value of every entry in the
+    /// range by merging val into it. Filter callback, if any, is passed the merged value as the new value.
     /// @return Btree status typically .
     ///         If all keys were upserted successfully, the method returns btree_status_t::success.
     ///         If the method ran out of space in the node, the method returns the key that was last put and the status
     ///         as btree_status_t::has_more
     virtual btree_status_t multi_put(BtreeKeyRange< K > const& keys, BtreeKey const&, BtreeValue const& val,
                                      btree_put_type put_type, K* last_failed_key,
-                                     put_filter_cb_t const& filter_cb = nullptr) {
-        if (put_type != btree_put_type::UPDATE) {
+                                     put_filter_cb_t const& filter_cb = nullptr,
+                                     put_merge_cb_t const& merge_cb = nullptr) {
+        if ((put_type != btree_put_type::UPDATE) && (put_type != btree_put_type::MERGE)) {
             DEBUG_ASSERT(false, "For non-interval keys multi-put should be really update and cannot insert");
             return btree_status_t::not_supported;
         }
+        DEBUG_ASSERT((put_type != btree_put_type::MERGE) || merge_cb, "Merge put without a merge operator");
         DEBUG_ASSERT_EQ(this->is_leaf(), true, "Multi put entries on node are supported only for leaf nodes");
 
         // Match the key range to get start and end idx. If none of the ranges here matches, we have to return not_found
@@ -265,22 +322,35 @@ public:
         uint32_t end_idx;
         if (!this->match_range(keys, start_idx, end_idx)) { return btree_status_t::not_found; }
 
-        const auto new_val_size = val.serialized_size();
         for (auto idx{start_idx}; idx <= end_idx; ++idx) {
-            if (!has_room_for_put(put_type, get_nth_key_size(idx), new_val_size)) {
+            // Entries in range are only updated in place, hence the room needed is that of an update
+            V merged_val;
+            BtreeValue const* new_val = &val;
+            if (put_type == btree_put_type::MERGE) {
+                get_nth_value(idx, &merged_val, true /* copy */);
+                merge_cb(get_nth_key< K >(idx, false), merged_val, val);
+                new_val = &merged_val;
+            }
+
+            if (!has_room_for_put(btree_put_type::UPDATE, get_nth_key_size(idx), new_val->serialized_size())) {
                 if (last_failed_key) { this->get_nth_key_internal(idx, *last_failed_key, true); }
                 return btree_status_t::has_more;
             }
+            btree_status_t ret{btree_status_t::success};
             if (filter_cb) {
-                auto decision = filter_cb(get_nth_key< K >(idx, false), get_nth_value(idx, false), val);
+                auto decision = filter_cb(get_nth_key< K >(idx, false), get_nth_value(idx, false), *new_val);
                 if (decision == put_filter_decision::replace) {
-                    this->update(idx, val);
+                    ret = this->update(idx, *new_val);
                 } else if (decision == put_filter_decision::remove) {
-                    this->remove(idx);
-                    --idx;
+                    ret = this->remove(idx);
+                    if (ret == btree_status_t::success) { --idx; }
                 }
             } else {
-                update(idx, val);
+                ret = update(idx, *new_val);
+            }
+            if (ret != btree_status_t::success) {
+                if (last_failed_key) { this->get_nth_key_internal(idx, *last_failed_key, true); }
+                return btree_status_t::has_more;
             }
         }
         return btree_status_t::success;
@@ -299,7 +369,11 @@ public:
         auto ret = removed_count;
         for (uint32_t count = 0; count < removed_count; ++count) {
             if (!filter_cb || filter_cb(get_nth_key< K >(start_idx, false), get_nth_value(start_idx, false))) {
-                this->remove(start_idx);
+                if (this->remove(start_idx) != btree_status_t::success) {
+                    // Node could not be re-encoded without this entry, leave the rest of the range as is
+                    ret -= removed_count - count;
+                    break;
+                }
             } else {
                 ++start_idx; // Skipping the entry
                 --ret;
@@ -307,5 +381,44 @@ public:
         }
         return ret;
     }
+
+protected:
+    /// @brief Binary searches for the first entry whose key is >= the given key, with the concrete key type known at
+    /// compile time.
+    ///
+    /// Unlike BtreeNode::bsearch(), which calls virtual compare_nth_key() and deserializes into a new key for every
+    /// probe, this method reuses a single key object and makes non-virtual (qualified) calls to K::compare(). The
+    /// concrete node provides how to load the nth key from its raw serialized bytes, which is inlined as well.
+    ///
+    /// @param key The key to search for.
+    /// @param load_nth_key Callable with signature void(uint32_t ind, K& out_key), which deserializes the nth key in
+    /// place without copying the key bytes.
+    /// @return A pair of found flag and the index of the matching entry or the first entry greater than the key.
+    template < typename KeyLoaderT >
+    std::pair< bool, uint32_t > typed_bsearch(BtreeKey const& key, KeyLoaderT&& load_nth_key) const {
+        return typed_bsearch(key, total_entries(), std::forward< KeyLoaderT >(load_nth_key));
+    }
+
+    // Searches only the first nentries, for callers which sampled the entry count upfront
+    template < typename KeyLoaderT >
+    std::pair< bool, uint32_t > typed_bsearch(BtreeKey const& key, uint32_t nentries, KeyLoaderT&& load_nth_key) const {
+        K nth_key;
+        int start{-1};
+        int end = int_cast(nentries);
+
+        while ((end - start) > 1) {
+            int const mid = start + (end - start) / 2;
+            load_nth_key(uint32_cast(mid), nth_key);
+            int const x = nth_key.K::compare(key);
+            if (x == 0) {
+                return std::make_pair(true, uint32_cast(mid));
+            } else if (x > 0) {
+                end = mid;
+            } else {
+                start = mid;
+            }
+        }
+        return std::make_pair(false, uint32_cast(end));
+    }
 };
 } // namespace homestore
\ No newline at end of file
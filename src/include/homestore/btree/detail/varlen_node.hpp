@@ -62,8 +62,8 @@ public:
         if (init) {
             // Tail arena points to the edge of the node as data arena grows backwards. Entire space is now available
             // except for the header itself
-            get_var_node_header()->m_init_available_space = cfg.node_data_size();
-            get_var_node_header()->m_tail_arena_offset = cfg.node_data_size();
+            get_var_node_header()->m_init_available_space = this->node_data_size();
+            get_var_node_header()->m_tail_arena_offset = this->node_data_size();
             get_var_node_header()->m_available_space =
                 get_var_node_header()->m_tail_arena_offset - sizeof(var_node_header);
         }
@@ -105,20 +105,20 @@ public:
 
     /* Update a value in a given index to the provided value. It will support change in size of the new value.
      * Assumption: Node lock is already taken, size check for the node to support new value is already done */
-    void update(uint32_t ind, const BtreeValue& val) override {
+    btree_status_t update(uint32_t ind, const BtreeValue& val) override {
         // If we are updating the edge value, none of the other logic matter. Just update edge value and move on
         if (ind == this->total_entries()) {
             DEBUG_ASSERT_EQ(this->is_leaf(), false);
             this->set_edge_value(val);
             this->inc_gen();
-        } else {
-            K key = BtreeNode::get_nth_key< K >(ind, true);
-            update(ind, key, val);
+            return btree_status_t::success;
         }
+        K key = BtreeNode::get_nth_key< K >(ind, true);
+        return update(ind, key, val);
     }
 
     // TODO - currently we do not support variable size key
-    void update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
+    btree_status_t update(uint32_t ind, const BtreeKey& key, const BtreeValue& val) override {
         LOGTRACEMOD(btree, "Update called:{}", to_string());
         DEBUG_ASSERT_LE(ind, this->total_entries());
 
@@ -127,7 +127,7 @@ public:
             DEBUG_ASSERT_EQ(this->is_leaf(), false);
             this->set_edge_value(val);
             this->inc_gen();
-            return;
+            return btree_status_t::success;
         }
 
         // Determine if we are doing same size update or smaller size update, in that case, reuse the space.
@@ -150,17 +150,20 @@ public:
             if (val_ptr != vblob.bytes) { std::memcpy(val_ptr, vblob.bytes, vblob.size); }
             set_nth_key_len(get_nth_record_mutable(ind), kblob.size);
             set_nth_value_len(get_nth_record_mutable(ind), vblob.size);
+            set_nth_key_head(get_nth_record_mutable(ind), kblob);
             get_var_node_header()->m_available_space += cur_obj_size - new_obj_size;
             this->inc_gen();
-        } else {
-            remove(ind, ind);
-            insert(ind, key, val);
-            LOGTRACEMOD(btree, "Size changed for either key or value. Had to delete and insert :{}", to_string());
+            return btree_status_t::success;
         }
+
+        remove(ind, ind);
+        auto const ret = insert(ind, key, val);
+        LOGTRACEMOD(btree, "Size changed for either key or value. Had to delete and insert :{}", to_string());
+        return ret;
     }
 
     // ind_s and ind_e are inclusive
-    void remove(uint32_t ind_s, uint32_t ind_e) override {
+    btree_status_t remove(uint32_t ind_s, uint32_t ind_e) override {
         uint32_t total_entries = this->total_entries();
         assert(total_entries >= ind_s);
         assert(total_entries >= ind_e);
@@ -188,14 +191,15 @@ public:
             this->sub_entries(no_of_elem);
         }
         this->inc_gen();
+        return btree_status_t::success;
     }
 
     void remove_all(const BtreeConfig& cfg) override {
         this->sub_entries(this->total_entries());
         this->invalidate_edge();
         this->inc_gen();
-        get_var_node_header()->m_init_available_space = cfg.node_data_size();
-        get_var_node_header()->m_tail_arena_offset = cfg.node_data_size();
+        get_var_node_header()->m_init_available_space = this->node_data_size();
+        get_var_node_header()->m_tail_arena_offset = this->node_data_size();
         get_var_node_header()->m_available_space = get_var_node_header()->m_tail_arena_offset - sizeof(var_node_header);
 #ifndef NDEBUG
         validate_sanity();
@@ -467,11 +471,13 @@ public:
         assert(ind < this->total_entries());
         assert(kb.size == get_nth_key_size(ind));
         memcpy(uintptr_cast(get_nth_obj(ind)), kb.bytes, kb.size);
+        set_nth_key_head(get_nth_record_mutable(ind), kb);
     }
 
     bool has_room_for_put(btree_put_type put_type, uint32_t key_size, uint32_t value_size) const override {
         auto needed_size = key_size + value_size;
-        if ((put_type == btree_put_type::UPSERT) || (put_type == btree_put_type::INSERT)) {
+        if ((put_type == btree_put_type::UPSERT) || (put_type == btree_put_type::INSERT) ||
+            (put_type == btree_put_type::MERGE)) {
             needed_size += get_record_size();
         }
         return (available_size() >= needed_size);
@@ -480,6 +486,7 @@ public:
     virtual uint32_t get_record_size() const = 0;
     virtual void set_nth_key_len(uint8_t* rec_ptr, uint32_t key_len) = 0;
     virtual void set_nth_value_len(uint8_t* rec_ptr, uint32_t value_len) = 0;
+    virtual void set_nth_key_head(uint8_t* rec_ptr, sisl::blob const& key_blob) {}
 
     void get_nth_key_internal(uint32_t ind, BtreeKey& out_key, bool copy) const override {
         assert(ind < this->total_entries());
@@ -617,6 +624,7 @@ protected:
         // Create a new record
         set_nth_key_len(rec_ptr, key_blob.size);
         set_nth_value_len(rec_ptr, val_blob.size);
+        set_nth_key_head(rec_ptr, key_blob);
         set_record_data_offset(rec_ptr, get_var_node_header()->m_tail_arena_offset);
 
         // Copy the contents of key and value in the offset
@@ -742,11 +750,20 @@ protected:
     }
 };
 
+// Variable key size node optionally keeps an 8 byte head of the key in each record, if the key type provides one and
+// the config turns it on. Records are packed at the start of the node data area, so the search compares the heads
+// sitting in few adjacent cache lines, instead of reading the keys scattered across the node, and reads the full keys
+// only to break the ties between equal heads. Whether the records have heads is decided by the config, just like the
+// node type, so it can't be changed for an existing btree.
 template < typename K, typename V >
 class VarKeySizeNode : public VariableNode< K, V > {
+private:
+    bool const m_key_heads;
+
 public:
     VarKeySizeNode(uint8_t* node_buf, bnodeid_t id, bool init, bool is_leaf, const BtreeConfig& cfg) :
-            VariableNode< K, V >(node_buf, id, init, is_leaf, cfg) {
+            VariableNode< K, V >(node_buf, id, init, is_leaf, cfg),
+            m_key_heads{has_key_head_v< K > && cfg.m_key_heads_turned_on} {
         this->set_node_type(btree_node_type::VAR_KEY);
     }
     virtual ~VarKeySizeNode() = default;
@@ -755,7 +772,9 @@ public:
         return r_cast< const var_key_record* >(this->get_nth_record(ind))->m_key_len;
     }
     uint32_t get_nth_value_size(uint32_t ind) const override { return dummy_value< V >.serialized_size(); }
-    uint32_t get_record_size() const override { return sizeof(var_key_record); }
+    uint32_t get_record_size() const override {
+        return m_key_heads ? sizeof(var_key_head_record) : sizeof(var_key_record);
+    }
 
     void set_nth_key_len(uint8_t* rec_ptr, uint32_t key_len) override {
         r_cast< var_key_record* >(rec_ptr)->m_key_len = key_len;
@@ -763,13 +782,92 @@ public:
     void set_nth_value_len(uint8_t* rec_ptr, uint32_t value_len) override {
         assert(value_len == dummy_value< V >.serialized_size());
     }
+    void set_nth_key_head(uint8_t* rec_ptr, sisl::blob const& key_blob) override {
+        if constexpr (has_key_head_v< K >) {
+            if (m_key_heads) {
+                K key;
+                key.K::deserialize(key_blob, false);
+                r_cast< var_key_head_record* >(rec_ptr)->m_key_head = key.key_head();
+            }
+        }
+    }
+
+    uint8_t* get_node_context() override { return uintptr_cast(this) + sizeof(VarKeySizeNode< K, V >); }
+
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        if constexpr (has_key_head_v< K >) {
+            if (m_key_heads) { return head_bsearch(key); }
+        }
+        return this->typed_bsearch(key, [this](uint32_t ind, K& out_key) { load_nth_key(ind, out_key); });
+    }
 
 private:
+    void load_nth_key(uint32_t ind, K& out_key) const {
+        out_key.K::deserialize(
+            sisl::blob{const_cast< uint8_t* >(this->get_nth_obj(ind)),
+                       r_cast< const var_key_record* >(this->get_nth_record(ind))->m_key_len},
+            false);
+    }
+
+    uint64_t get_nth_key_head(uint32_t ind) const {
+        return r_cast< const var_key_head_record* >(this->get_nth_record(ind))->m_key_head;
+    }
+
+    /* Narrows down to the entries whose heads are equal to the head of the key, only one of which could match the
+     * key, by searching the heads alone. Full keys are compared only within those entries, if there are any. */
+    std::pair< bool, uint32_t > head_bsearch(const BtreeKey& key) const {
+        uint64_t const head = s_cast< K const& >(key).key_head();
+        int start{-1};
+        int end = int_cast(this->total_entries());
+
+        // Find the first entry with head >= key head, followed by the first entry with head > key head
+        while ((end - start) > 1) {
+            int const mid = start + (end - start) / 2;
+            if (get_nth_key_head(uint32_cast(mid)) < head) {
+                start = mid;
+            } else {
+                end = mid;
+            }
+        }
+        int const first_equal = end;
+        end = int_cast(this->total_entries());
+        while ((end - start) > 1) {
+            int const mid = start + (end - start) / 2;
+            if (get_nth_key_head(uint32_cast(mid)) <= head) {
+                start = mid;
+            } else {
+                end = mid;
+            }
+        }
+
+        // Entries in [first_equal, end) share the head with the key, break the tie with the full keys
+        K nth_key;
+        start = first_equal - 1;
+        while ((end - start) > 1) {
+            int const mid = start + (end - start) / 2;
+            load_nth_key(uint32_cast(mid), nth_key);
+            int const x = nth_key.K::compare(key);
+            if (x == 0) {
+                return std::make_pair(true, uint32_cast(mid));
+            } else if (x > 0) {
+                end = mid;
+            } else {
+                start = mid;
+            }
+        }
+        return std::make_pair(false, uint32_cast(end));
+    }
+
 #pragma pack(1)
     struct var_key_record : public btree_obj_record {
         uint16_t m_key_len : 14;
         uint16_t reserved : 2;
     };
+
+    struct var_key_head_record : public var_key_record {
+        uint64_t m_key_head;
+    };
 #pragma pack()
 };
 
@@ -796,6 +894,13 @@ public:
         r_cast< var_value_record* >(rec_ptr)->m_value_len = value_len;
     }
 
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        return this->typed_bsearch(key, [this, key_size = get_nth_key_size(0)](uint32_t ind, K& out_key) {
+            out_key.K::deserialize(sisl::blob{const_cast< uint8_t* >(this->get_nth_obj(ind)), key_size}, false);
+        });
+    }
+
 private:
 #pragma pack(1)
     struct var_value_record : public btree_obj_record {
@@ -830,6 +935,16 @@ public:
         r_cast< var_obj_record* >(rec_ptr)->m_value_len = value_len;
     }
 
+protected:
+    std::pair< bool, uint32_t > bsearch_node(const BtreeKey& key) const override {
+        return this->typed_bsearch(key, [this](uint32_t ind, K& out_key) {
+            out_key.K::deserialize(
+                sisl::blob{const_cast< uint8_t* >(this->get_nth_obj(ind)),
+                           r_cast< const var_obj_record* >(this->get_nth_record(ind))->m_key_len},
+                false);
+        });
+    }
+
 private:
 #pragma pack(1)
     struct var_obj_record : public btree_obj_record {
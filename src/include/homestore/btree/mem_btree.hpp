@@ -15,31 +15,44 @@
  *********************************************************************************/
 #pragma once
 #include "btree.ipp"
+#include <homestore/btree/detail/mem_node_allocator.hpp>
 
 namespace homestore {
-template < typename K, typename V >
-class MemBtree : public Btree< K, V > {
-private:
-    std::vector< std::shared_ptr< uint8_t[] > > node_buf_ptr_vec;
+/* Holds the node allocator of MemBtree. It is a base class listed ahead of Btree, so that it is constructed before and
+ * destroyed after the Btree base, whose members (root, retired nodes etc.) release their nodes into the allocator. */
+struct MemNodeAllocatorHolder {
+    std::shared_ptr< MemNodeAllocator > m_node_allocator;
+
+    explicit MemNodeAllocatorHolder(bool huge_pages) : m_node_allocator{MemNodeAllocator::instance(huge_pages)} {}
+};
 
+template < typename K, typename V >
+class MemBtree : private MemNodeAllocatorHolder, public Btree< K, V > {
 public:
-    MemBtree(const BtreeConfig& cfg) : Btree< K, V >(cfg) {
+    MemBtree(const BtreeConfig& cfg) : MemNodeAllocatorHolder(cfg.m_huge_page_nodes), Btree< K, V >(cfg) {
         BT_LOG(INFO, "New {} being created: Node size {}", btree_store_type(), cfg.node_size());
     }
 
     virtual ~MemBtree() {
+        // Btree could already be destroyed in the background, in which case there is nothing to free
         const auto [ret, free_node_cnt] = this->destroy_btree(nullptr);
-        BT_LOG_ASSERT_EQ(ret, btree_status_t::success, "btree destroy failed");
+        BT_LOG_ASSERT((ret == btree_status_t::success) || (ret == btree_status_t::not_found), "btree destroy failed");
+
+        // Node objects retained for optimistic readers hold their buffers, release them before the allocator goes
+        this->release_retired_nodes();
     }
 
     std::string btree_store_type() const override { return "MEM_BTREE"; }
 
+    MemNodeAllocator const& node_allocator() const { return *m_node_allocator; }
+
 private:
     BtreeNodePtr alloc_node(bool is_leaf) override {
-        std::shared_ptr< uint8_t[] > ptr(new uint8_t[this->m_bt_cfg.node_size()]);
-        node_buf_ptr_vec.emplace_back(ptr);
+        uint8_t* buf = m_node_allocator->alloc(this->m_bt_cfg.node_size());
+        if (buf == nullptr) { return nullptr; }
 
-        auto new_node = this->init_node(ptr.get(), 0u, bnodeid_t{0}, true, is_leaf);
+        auto new_node = this->init_node(buf, 0u, bnodeid_t{0}, true, is_leaf);
+        new_node->m_buf_owner = m_node_allocator.get();
         new_node->set_node_id(bnodeid_t{r_cast< std::uintptr_t >(new_node)});
         new_node->m_refcount.increment();
         return BtreeNodePtr{new_node};
@@ -52,6 +65,13 @@ private:
         return btree_status_t::success;
     }
 
+    btree_status_t peek_node_impl(bnodeid_t id, BtreeNodePtr& node) const override { return read_node_impl(id, node); }
+
+    btree_status_t peek_node_unref_impl(bnodeid_t id, BtreeNode*& node) const override {
+        node = r_cast< BtreeNode* >(id);
+        return btree_status_t::success;
+    }
+
     btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const override {
         return btree_status_t::success;
     }
@@ -70,11 +90,11 @@ private:
             this->write_node(node, context);
         }
         this->write_node(child_node, context);
-        this->write_node(parent_node, context);
+        if (parent_node) { this->write_node(parent_node, context); }
         return btree_status_t::success;
     }
 
-    void update_new_root_info(bnodeid_t root_node, uint64_t version) override {}
+    void update_new_root_info(bnodeid_t root_node, uint64_t version, void* context) override {}
 
 #if 0
     static void ref_node(MemBtreeNode* bn) {
@@ -205,6 +205,7 @@ public:
     }
 
     iomgr::io_fiber_t pick_blocking_io_fiber() const;
+    std::vector< iomgr::io_fiber_t > const& blocking_io_fibers() const { return m_cp_io_fibers; }
 
 private:
     void cp_ref(CP* cp);
@@ -0,0 +1,110 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include <sisl/fds/buffer.hpp>
+
+namespace homestore {
+/* BlockedBloomFilter is a bloom filter whose bits for a key are all within one cache line sized block, so that both
+ * add and lookup touch exactly one cache line irrespective of the number of hash functions.
+ *
+ * Upper half of the key hash picks the block and the lower half sets one bit in each of the 8 words of the block, with
+ * a different odd multiplier per word. Masks of all the words are computed in a branch free loop, which compilers
+ * turn into vector multiplies and shifts, and the lookup checks all the words without an early exit.
+ *
+ * Keys can only be added, never removed. Adds and lookups can run concurrently, words are updated atomically.
+ */
+class BlockedBloomFilter {
+public:
+    static constexpr uint32_t block_size{64};    // One cache line
+    static constexpr uint32_t bits_per_key{10}; // Gives about 1% false positives at the sized number of keys
+
+private:
+    static constexpr uint32_t words_per_block{block_size / sizeof(uint64_t)};
+    static constexpr uint32_t block_bits{block_size * 8};
+    static constexpr uint32_t salts[words_per_block]{0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                                                     0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+    struct alignas(block_size) block_t {
+        std::atomic< uint64_t > words[words_per_block];
+    };
+
+    uint64_t m_num_blocks;
+    std::unique_ptr< block_t[] > m_blocks;
+
+public:
+    /// @brief Creates an empty filter sized for the given number of keys
+    explicit BlockedBloomFilter(uint64_t num_keys) :
+            m_num_blocks{std::max((num_keys * bits_per_key + block_bits - 1) / block_bits, uint64_t{1})},
+            m_blocks{new block_t[m_num_blocks]()} {}
+
+    BlockedBloomFilter(const BlockedBloomFilter&) = delete;
+    BlockedBloomFilter& operator=(const BlockedBloomFilter&) = delete;
+
+    void add(uint64_t hash) {
+        uint64_t masks[words_per_block];
+        word_masks(uint32_t(hash), masks);
+
+        auto& b = block_of(hash);
+        for (uint32_t i{0}; i < words_per_block; ++i) {
+            b.words[i].fetch_or(masks[i], std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Returns false only if the key of this hash was never added
+    bool may_contain(uint64_t hash) const {
+        uint64_t masks[words_per_block];
+        word_masks(uint32_t(hash), masks);
+
+        auto const& b = block_of(hash);
+        uint64_t missing{0};
+        for (uint32_t i{0}; i < words_per_block; ++i) {
+            missing |= masks[i] & ~b.words[i].load(std::memory_order_relaxed);
+        }
+        return (missing == 0);
+    }
+
+    uint64_t num_blocks() const { return m_num_blocks; }
+    uint64_t size() const { return m_num_blocks * block_size; }
+
+    /// @brief Hash of the serialized key, mixed so that all 64 bits are usable by the filter
+    static uint64_t hash(sisl::blob const& b) {
+        uint64_t h = std::hash< std::string_view >{}(std::string_view{r_cast< const char* >(b.bytes), b.size});
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+private:
+    block_t& block_of(uint64_t hash) const { return m_blocks[((hash >> 32) * m_num_blocks) >> 32]; }
+
+    static void word_masks(uint32_t h, uint64_t (&masks)[words_per_block]) {
+        for (uint32_t i{0}; i < words_per_block; ++i) {
+            masks[i] = uint64_t{1} << ((h * salts[i]) >> 26);
+        }
+    }
+};
+} // namespace homestore
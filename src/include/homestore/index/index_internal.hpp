@@ -28,7 +28,7 @@ using bnodeid_t = uint64_t;
 typedef int64_t cp_id_t;
 
 static constexpr uint64_t indx_sb_magic{0xbedabb1e};
-static constexpr uint32_t indx_sb_version{0x2};
+static constexpr uint32_t indx_sb_version{0x3};
 
 #pragma pack(1)
 struct index_table_sb {
@@ -41,6 +41,9 @@ struct index_table_sb {
     bnodeid_t root_node{empty_bnodeid}; // Btree Root Node ID
     uint64_t link_version{0};
     int64_t index_size{0}; // Size of the Index
+    uint8_t subtree_counted{0}; // Links in the interior nodes carry the entry counts of the child subtrees
+    uint8_t key_heads{0};       // Var key node records carry the key heads ahead of the keys
+    uint32_t msg_buffer_size{0}; // Bytes at the tail of the interior nodes which buffer the writes
     // seq_id_t last_seq_id{-1};           // TODO: See if this is needed
 
     uint32_t user_sb_size; // Size of the user superblk
@@ -55,6 +58,12 @@ public:
     virtual uuid_t uuid() const = 0;
     virtual uint64_t used_size() const = 0;
     virtual void destroy() = 0;
+
+    // Called upon cp switchover to apply the merges deferred by the removes, in background between the cps
+    virtual void trigger_deferred_merges() {}
+
+    // Called upon cp switchover to rebuild the bloom filter in background, if it is stale or yet to be built
+    virtual void check_bloom_filter() {}
 };
 
 enum class index_buf_state_t : uint8_t {
@@ -0,0 +1,300 @@
+/*********************************************************************************
+ * Modifications Copyright 2017-2019 eBay Inc.
+ *
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software distributed
+ * under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations under the License.
+ *
+ *********************************************************************************/
+#pragma once
+#include <functional>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include <homestore/homestore.hpp>
+#include <homestore/index/index_table.hpp>
+
+namespace homestore {
+/* IndexSnapshot reads an index table as it was persisted by the last completed cp, giving a stable view for long scans
+ * like backups or consistency checks, without quiescing the writers.
+ *
+ * Nodes are flushed in place at cp, so the device holds the btree as of the last completed cp till the next cp flush
+ * starts. Opening the snapshot pins those buffers in the write back cache, which defers the flush of the next cp till
+ * the snapshot is closed, or till index_snapshot_max_pin_ms has passed, after which the flush proceeds and the reads of
+ * the snapshot fail with btree_status_t::cp_mismatch till it is reopened. Writers keep writing into the current cp in
+ * the meantime, which only grows the dirty buffers the deferred flush has to write. Snapshot walks the btree from the
+ * root as of the cp, reading each node as a private copy, either from the cache if it is not dirtied since the cp or
+ * from the device. It doesn't take any btree or node lock other than for copying a cached node, and doesn't see any of
+ * the writes after the cp.
+ *
+ * In a btree with buffered messages, the messages in the interior nodes are newer than the entries of their keys below,
+ * so a get stops at the first message of the key on the way down, and a scan merges the messages within the range with
+ * the leaf entries, skipping the removed keys.
+ *
+ * NOTE: As the cp flush is held back while the snapshot is open, it should be closed as soon as the reads are done. A
+ * scan cut short by the invalidation can't be resumed from where it stopped, the reopened snapshot is of a later cp.
+ */
+template < typename K, typename V >
+class IndexSnapshot {
+public:
+    // Callback per entry in key order, key and value are views valid only during the callback. Returning false stops
+    // the scan.
+    using scan_cb_t = std::function< bool(K const&, V const&) >;
+
+private:
+    // Node over the private copy of the persisted buffer, node is released before the buffer
+    struct snap_node_t {
+        IndexBufferPtr buf;
+        BtreeNodePtr node;
+    };
+
+    struct key_less {
+        bool operator()(K const& k1, K const& k2) const { return (k1.compare(k2) < 0); }
+    };
+
+    // Newest message of each key within a scanned range, value is empty for a removed key
+    using msg_map_t = std::map< K, std::optional< V >, key_less >;
+
+    IndexTable< K, V > const& m_table;
+    bool m_pinned{false};
+    uint64_t m_pin_gen{0};
+    cp_id_t m_cp_id{-1};
+    BtreeLinkInfo m_root;
+
+public:
+    explicit IndexSnapshot(IndexTable< K, V > const& table) : m_table{table} {}
+    IndexSnapshot(const IndexSnapshot&) = delete;
+    IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+    ~IndexSnapshot() { close(); }
+
+    /// @brief Opens the snapshot as of the last completed cp, holding back the flush of the next cp till closed.
+    ///
+    /// @return btree_status_t::success if opened, btree_status_t::retry if a cp flush is in progress, in which case
+    /// open needs to be retried once the flush is completed
+    btree_status_t open() {
+        if (m_pinned) { return btree_status_t::success; }
+
+        auto const cp_id = wb_cache().pin_persisted_bufs(m_pin_gen);
+        if (!cp_id) { return btree_status_t::retry; }
+        m_pinned = true;
+        m_cp_id = *cp_id;
+        m_root = m_table.snapshot_root(m_cp_id);
+        return btree_status_t::success;
+    }
+
+    /// @brief Closes the snapshot, letting the deferred cp flush proceed
+    void close() {
+        if (!m_pinned) { return; }
+        m_pinned = false;
+        wb_cache().unpin_persisted_bufs(m_pin_gen);
+    }
+
+    bool is_open() const { return m_pinned; }
+
+    /// @brief Id of the cp the snapshot reads the index as of
+    cp_id_t cp_id() const { return m_cp_id; }
+
+    /// @brief Gets the value of the key as of the snapshot
+    ///
+    /// @return btree_status_t::success if found, btree_status_t::not_found if the key didn't exist as of the snapshot,
+    /// btree_status_t::cp_mismatch if the snapshot was open for too long and is invalidated by a cp flush
+    btree_status_t get(K const& key, V& out_val) const {
+        snap_node_t leaf;
+        std::optional< bool > msg_put;
+        auto ret = descend(key, leaf, &out_val, &msg_put);
+        if (msg_put) { return *msg_put ? btree_status_t::success : btree_status_t::not_found; }
+        if ((ret != btree_status_t::success) || !leaf.node) { return ret; }
+        return leaf.node->find(key, &out_val, true /* copy_val */).first ? btree_status_t::success
+                                                                          : btree_status_t::not_found;
+    }
+
+    /// @brief Scans the range as of the snapshot, calling the callback for every entry in key order
+    ///
+    /// @return btree_status_t::success if the entire range is scanned or stopped by the callback,
+    /// btree_status_t::cp_mismatch if the snapshot is invalidated by a cp flush, otherwise error reading the nodes
+    btree_status_t scan(BtreeKeyRange< K > const& range, scan_cb_t const& cb) const {
+        return do_scan(range, false /* copy */, cb);
+    }
+
+    /// @brief Queries the range as of the snapshot, appending copies of all the entries within to out_values
+    btree_status_t query(BtreeKeyRange< K > const& range, std::vector< std::pair< K, V > >& out_values) const {
+        return do_scan(range, true /* copy */, [&out_values](K const& k, V const& v) {
+            out_values.emplace_back(k, v);
+            return true;
+        });
+    }
+
+private:
+    btree_status_t do_scan(BtreeKeyRange< K > const& range, bool copy, scan_cb_t const& cb) const {
+        snap_node_t leaf;
+        auto ret = descend(range.start_key(), leaf);
+        if (ret != btree_status_t::success) { return ret; }
+
+        msg_map_t msgs;
+        if (m_table.is_msg_buffered() && (m_root.bnode_id() != empty_bnodeid)) {
+            ret = collect_msgs(m_root.bnode_id(), range, msgs);
+            if (ret != btree_status_t::success) { return ret; }
+        }
+
+        // Calls back for the messages till the key (all of them if null), returns false if the callback stopped
+        auto mit = msgs.begin();
+        auto const call_msgs_upto = [&mit, &msgs, &cb](K const* upto) {
+            for (; (mit != msgs.end()) && (!upto || (mit->first.compare(*upto) <= 0)); ++mit) {
+                if (mit->second && !cb(mit->first, *mit->second)) { return false; }
+            }
+            return true;
+        };
+        if (!leaf.node) {
+            call_msgs_upto(nullptr);
+            return btree_status_t::success;
+        }
+
+        auto [found, idx] = leaf.node->find(range.start_key(), nullptr, false);
+        if (found && !range.is_start_inclusive()) { ++idx; }
+
+        K key;
+        V val;
+        while (true) {
+            for (; idx < leaf.node->total_entries(); ++idx) {
+                key = leaf.node->template get_nth_key< K >(idx, copy);
+                auto const x = key.compare(range.end_key());
+                if ((x > 0) || ((x == 0) && !range.is_end_inclusive())) {
+                    call_msgs_upto(nullptr);
+                    return btree_status_t::success;
+                }
+
+                // Entry with a message of its key is stale, the message is called back in its place
+                bool const stale = (mit != msgs.end()) && (mit->first.compare(key) == 0);
+                if (!call_msgs_upto(&key)) { return btree_status_t::success; }
+                if (stale) { continue; }
+
+                leaf.node->get_nth_value(idx, &val, copy);
+                if (!cb(key, val)) { return btree_status_t::success; }
+            }
+
+            auto const next_id = leaf.node->next_bnode();
+            if (next_id == empty_bnodeid) {
+                call_msgs_upto(nullptr);
+                return btree_status_t::success;
+            }
+            ret = read_node(next_id, leaf);
+            if (ret != btree_status_t::success) { return ret; }
+            idx = 0;
+        }
+    }
+
+    // Collects the messages within the range from the buffers of the interior nodes of the subtree. Messages of a key
+    // are only on its path from the root, the one higher up being newer, so the first one found for a key is kept.
+    btree_status_t collect_msgs(bnodeid_t id, BtreeKeyRange< K > const& range, msg_map_t& msgs) const {
+        snap_node_t node;
+        auto ret = read_node(id, node);
+        if ((ret != btree_status_t::success) || node.node->is_leaf()) { return ret; }
+
+        m_table.msg_buffer(node.node).for_each([&range, &msgs](BtreeMsgBuffer::msg_t const& msg) {
+            K key;
+            key.deserialize(msg.key, true /* copy */);
+            auto const x = key.compare(range.start_key());
+            auto const y = key.compare(range.end_key());
+            if ((x < 0) || ((x == 0) && !range.is_start_inclusive()) || (y > 0) ||
+                ((y == 0) && !range.is_end_inclusive())) {
+                return true;
+            }
+
+            std::optional< V > val;
+            if (msg.type == btree_msg_type::PUT) {
+                val.emplace();
+                val->deserialize(msg.val, true /* copy */);
+            }
+            msgs.try_emplace(std::move(key), std::move(val));
+            return true;
+        });
+        if (node.node->level() == 1) { return btree_status_t::success; } // Leaves have no buffers
+
+        auto const start_idx = node.node->find(range.start_key(), nullptr, false).second;
+        auto const end_idx = node.node->find(range.end_key(), nullptr, false).second;
+        for (auto idx = start_idx; (ret == btree_status_t::success) && (idx <= end_idx); ++idx) {
+            BtreeLinkInfo child_info;
+            if (idx < node.node->total_entries()) {
+                node.node->get_nth_value(idx, &child_info, false /* copy */);
+            } else if (node.node->has_valid_edge()) {
+                child_info = node.node->get_edge_value();
+            } else {
+                break;
+            }
+            ret = collect_msgs(child_info.bnode_id(), range, msgs);
+        }
+        return ret;
+    }
+
+    // Descends from the root as of the snapshot to the leaf which has the key, leaf is empty if the btree has no
+    // entries at or past the key. If msg_put is given, descend stops at the first message of the key on the way, with
+    // msg_put set to whether it is a put, whose value is copied to msg_val.
+    btree_status_t descend(K const& key, snap_node_t& leaf, V* msg_val = nullptr,
+                           std::optional< bool >* msg_put = nullptr) const {
+        DEBUG_ASSERT(m_pinned, "Snapshot read without opening it");
+        if (m_root.bnode_id() == empty_bnodeid) { return btree_status_t::success; }
+
+        snap_node_t node;
+        auto ret = read_node(m_root.bnode_id(), node);
+        while ((ret == btree_status_t::success) && !node.node->is_leaf()) {
+            if (msg_put && m_table.is_msg_buffered()) {
+                if (auto const msg = m_table.msg_buffer(node.node).find(key.serialize())) {
+                    *msg_put = (msg->type == btree_msg_type::PUT);
+                    if (**msg_put) { msg_val->deserialize(msg->val, true /* copy */); }
+                    return btree_status_t::success;
+                }
+            }
+
+            auto const idx = node.node->find(key, nullptr, false).second;
+            BtreeLinkInfo child_info;
+            if (idx < node.node->total_entries()) {
+                node.node->get_nth_value(idx, &child_info, false /* copy */);
+            } else if (node.node->has_valid_edge()) {
+                child_info = node.node->get_edge_value();
+            } else {
+                return btree_status_t::success;
+            }
+            ret = read_node(child_info.bnode_id(), node);
+
+            // Split persisted before it was linked to the parent has the keys past the child in its right node
+            if ((ret == btree_status_t::success) && (child_info.link_version() != node.node->link_version()) &&
+                (node.node->next_bnode() != empty_bnodeid) && (node.node->total_entries() != 0) &&
+                (key.compare(node.node->template get_last_key< K >()) > 0)) {
+                ret = read_node(node.node->next_bnode(), node);
+            }
+        }
+
+        if (ret == btree_status_t::success) { leaf = std::move(node); }
+        return ret;
+    }
+
+    btree_status_t read_node(bnodeid_t id, snap_node_t& out) const {
+        snap_node_t n;
+        try {
+            n.buf = wb_cache().read_persisted_buf(id, m_pin_gen);
+        } catch (std::exception& e) { return btree_status_t::node_read_failed; }
+        if (!n.buf) { return btree_status_t::cp_mismatch; }
+
+        bool const is_leaf = BtreeNode::identify_leaf_node(n.buf->raw_buffer());
+        n.node = BtreeNodePtr{m_table.init_node(n.buf->raw_buffer(), 0 /* node_ctx_size */, id, false /* init_buf */,
+                                                is_leaf)};
+#ifndef NO_CHECKSUM
+        if (!n.node->verify_node(m_table.m_bt_cfg)) {
+            LOGERROR("CRC Mismatch for node: {} read as of cp {}", n.node->to_string(), m_cp_id);
+            return btree_status_t::crc_mismatch;
+        }
+#endif
+        out.node.reset(); // Node over the buffer is released before the buffer
+        out = std::move(n);
+        return btree_status_t::success;
+    }
+};
+} // namespace homestore
@@ -15,10 +15,16 @@
  *********************************************************************************/
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <shared_mutex>
 #include <vector>
 #include <atomic>
+#include <condition_variable>
 #include <homestore/btree/btree.ipp>
+#include <homestore/btree/btree_bulk_loader.hpp>
 #include <homestore/index/index_internal.hpp>
+#include <homestore/index/index_bloom_filter.hpp>
 #include <homestore/superblk_handler.hpp>
 #include <homestore/index_service.hpp>
 #include <homestore/checkpoint/cp_mgr.hpp>
@@ -27,38 +33,122 @@
 SISL_LOGGING_DECL(wbcache)
 
 namespace homestore {
+template < typename K, typename V >
+class IndexSnapshot;
 
 template < typename K, typename V >
 class IndexTable : public IndexTableBase, public Btree< K, V > {
+    friend class IndexSnapshot< K, V >;
+
 private:
     superblk< index_table_sb > m_sb;
 
+    // Root of the btree as of each cp it was changed in, so that the snapshots can find the root as of the last cp
+    mutable std::mutex m_cp_roots_mtx;
+    std::map< cp_id_t, BtreeLinkInfo > m_cp_roots;
+
+    // Optional bloom filter to answer the lookups of missing keys without descending the btree. Filter in m_bloom is
+    // consulted only when ready. While it is being rebuilt in the background, puts are added to both the current and
+    // the one being built, which replaces the current once it has scanned all the keys.
+    std::shared_ptr< BlockedBloomFilter > m_bloom;
+    std::shared_ptr< BlockedBloomFilter > m_bloom_building;
+    iomgr::FiberManagerLib::shared_mutex m_bloom_put_mtx; // Held shared by the puts, from filter add till leaf write
+    std::atomic< bool > m_bloom_ready{false};
+    std::atomic< bool > m_bloom_rebuilding{false};
+    std::atomic< bool > m_bloom_stopped{false};
+    std::atomic< uint64_t > m_bloom_gen{0};      // Bumped when puts are not tracked by the filter (range put)
+    std::atomic< uint64_t > m_bloom_capacity{0}; // Number of keys the filter is sized for
+    std::atomic< uint64_t > m_bloom_num_keys{0}; // Number of keys in the filter when it was built
+    std::atomic< uint64_t > m_bloom_num_added{0};
+    std::atomic< uint64_t > m_bloom_num_removed{0};
+    mutable std::atomic< uint64_t > m_bloom_num_filtered{0}; // Lookups answered as not found by the filter
+
+    // Merges deferred by the removes are applied in background upon cp switchover, one at a time
+    std::atomic< bool > m_rebalancing{false};
+    std::atomic< bool > m_rebalance_stopped{false};
+
+    // Number of background tasks (bloom filter rebuild, deferred merges, freeing dropped subtrees) in flight, which
+    // the index table waits for before it is destroyed
+    std::mutex m_bg_mtx;
+    std::condition_variable m_bg_cv;
+    uint32_t m_bg_tasks{0};
+
+    // Interior nodes with subtree counts have links of a different size, var key nodes with key heads have records of
+    // a different layout and interior nodes with message buffers are of a different size, hence the index has to be
+    // recovered with the same layout as it was created with
+    void check_config(const BtreeConfig& cfg) const {
+        if (cfg.m_subtree_counts_turned_on != (m_sb->subtree_counted != 0)) {
+            throw std::runtime_error(fmt::format("Index table created with subtree counts={} is recovered with {}",
+                                                 (m_sb->subtree_counted != 0), cfg.m_subtree_counts_turned_on));
+        }
+        if (cfg.m_key_heads_turned_on != (m_sb->key_heads != 0)) {
+            throw std::runtime_error(fmt::format("Index table created with key heads={} is recovered with {}",
+                                                 (m_sb->key_heads != 0), cfg.m_key_heads_turned_on));
+        }
+        if (cfg.m_msg_buffer_size != m_sb->msg_buffer_size) {
+            throw std::runtime_error(fmt::format("Index table created with message buffer size={} is recovered with {}",
+                                                 m_sb->msg_buffer_size, cfg.m_msg_buffer_size));
+        }
+    }
+
 public:
     IndexTable(uuid_t uuid, uuid_t parent_uuid, uint32_t user_sb_size, const BtreeConfig& cfg) :
             Btree< K, V >{cfg}, m_sb{"index"} {
+        disable_optimistic_read();
+        if (is_bloom_filter_enabled()) {
+            // New index is empty, filter sized for the expected keys is ready right away
+            std::atomic_store(&m_bloom, std::make_shared< BlockedBloomFilter >(cfg.m_bloom_filter_keys));
+            m_bloom_capacity.store(cfg.m_bloom_filter_keys);
+            m_bloom_ready.store(true);
+        }
         m_sb.create(sizeof(index_table_sb));
         m_sb->uuid = uuid;
         m_sb->parent_uuid = parent_uuid;
         m_sb->user_sb_size = user_sb_size;
+        m_sb->subtree_counted = cfg.m_subtree_counts_turned_on ? 1 : 0;
+        m_sb->key_heads = cfg.m_key_heads_turned_on ? 1 : 0;
+        m_sb->msg_buffer_size = cfg.m_msg_buffer_size;
 
         auto status = init();
         if (status != btree_status_t::success) { throw std::runtime_error(fmt::format("Unable to create root node")); }
     }
 
     IndexTable(superblk< index_table_sb >&& sb, const BtreeConfig& cfg) : Btree< K, V >{cfg}, m_sb{std::move(sb)} {
+        check_config(cfg);
+        disable_optimistic_read();
         Btree< K, V >::set_root_node_info(BtreeLinkInfo{m_sb->root_node, m_sb->link_version});
+        m_cp_roots.emplace(cp_id_t{-1}, BtreeLinkInfo{m_sb->root_node, m_sb->link_version}); // Before any cp since boot
+        // Bloom filter of the recovered index is rebuilt in background upon the first cp switchover
+    }
+
+    ~IndexTable() {
+        m_bloom_stopped.store(true);
+        m_rebalance_stopped.store(true);
+        std::unique_lock lg{m_bg_mtx};
+        m_bg_cv.wait(lg, [this]() { return (m_bg_tasks == 0); });
     }
 
+    // Nodes are freed in background on the cp io fibers, by their ids without reading the leaves, each batch as part
+    // of the cp current at the time. Hence it must not be called from one of the cp io fibers. Deferred merges in
+    // flight are stopped and waited for, before any node is freed underneath them.
     void destroy() override {
-        auto cpg = hs()->cp_mgr().cp_guard();
-        auto op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
-        Btree< K, V >::destroy_btree(op_context);
+        m_rebalance_stopped.store(true);
+        {
+            std::unique_lock lg{m_bg_mtx};
+            m_bg_cv.wait(lg, [this]() { return !m_rebalancing.load(); });
+        }
+
+        auto const [ret, n_freed] = Btree< K, V >::destroy_btree_async(hs()->cp_mgr().blocking_io_fibers()).get();
+        if ((ret != btree_status_t::success) && (ret != btree_status_t::not_found)) {
+            BT_LOG(ERROR, "Index table destroy failed after freeing {} nodes, ret={}", n_freed, ret);
+        }
     }
 
     btree_status_t init() {
         auto cp = hs()->cp_mgr().cp_guard();
-        auto ret = Btree< K, V >::init((void*)cp.context(cp_consumer_t::INDEX_SVC));
-        update_new_root_info(Btree< K, V >::root_node_id(), Btree< K, V >::root_link_version());
+        auto const context = (void*)cp.context(cp_consumer_t::INDEX_SVC);
+        auto ret = Btree< K, V >::init(context);
+        update_new_root_info(Btree< K, V >::root_node_id(), Btree< K, V >::root_link_version(), context);
         return ret;
     }
 
@@ -68,28 +158,272 @@ public:
     const superblk< index_table_sb >& mutable_super_blk() const { return m_sb; }
     std::string btree_store_type() const override { return "INDEX_BTREE"; }
 
-    void update_new_root_info(bnodeid_t root_node, uint64_t version) override {
+    // Root is recorded against the cp of the op which changed it, the one its nodes are flushed as part of
+    void update_new_root_info(bnodeid_t root_node, uint64_t version, void* context) override {
+        {
+            auto const cp_id = r_cast< CPContext* >(context)->id();
+            std::unique_lock lg{m_cp_roots_mtx};
+            m_cp_roots.insert_or_assign(cp_id, BtreeLinkInfo{root_node, version});
+
+            // One cp is flushed at a time, so the last completed cp is atmost two behind the current one. Snapshots are
+            // only taken of the last completed cp, so the roots older than the one as of two cps back are not needed.
+            auto it = m_cp_roots.upper_bound(cp_id - 2);
+            if (it != m_cp_roots.begin()) { m_cp_roots.erase(m_cp_roots.begin(), std::prev(it)); }
+        }
         m_sb->root_node = root_node;
         m_sb->link_version = version;
         m_sb.write();
         BT_LOG(DEBUG, "Updated index superblk root bnode_id {} version {}", root_node, version);
     }
 
+    // Build the index from a sorted stream of key/values, all the nodes built are flushed as part of a single CP
+    template < typename IterT >
+    btree_status_t bulk_load(IterT begin, IterT end, uint8_t fill_pct) {
+        auto cpg = hs()->cp_mgr().cp_guard();
+        BtreeBulkLoader< K, V > loader{*this, fill_pct};
+        return loader.load(begin, end, (void*)cpg.context(cp_consumer_t::INDEX_SVC));
+    }
+
     template < typename ReqT >
     btree_status_t put(ReqT& put_req) {
         auto cpg = hs()->cp_mgr().cp_guard();
         put_req.m_op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
-        return Btree< K, V >::put(put_req);
+        if (!is_bloom_filter_enabled()) { return Btree< K, V >::put(put_req); }
+
+        // Keys are added to the filter ahead of the put, so that a get never misses a key which the put made visible.
+        // Filter gets the keys of failed puts as well, which is only a false positive. A filter which is invalidated or
+        // outgrown by the puts is rebuilt upon the next cp switchover, not by the puts themselves.
+        btree_status_t ret;
+        {
+            std::shared_lock lg{m_bloom_put_mtx};
+            bloom_on_put(put_req);
+            ret = Btree< K, V >::put(put_req);
+        }
+        bloom_count_put(put_req, ret);
+        return ret;
     }
 
     template < typename ReqT >
     btree_status_t remove(ReqT& remove_req) {
         auto cpg = hs()->cp_mgr().cp_guard();
         remove_req.m_op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
-        return Btree< K, V >::remove(remove_req);
+        auto const ret = Btree< K, V >::remove(remove_req);
+        if (is_bloom_filter_enabled() && (ret == btree_status_t::success)) { bloom_on_remove(remove_req); }
+        return ret;
+    }
+
+    template < typename ReqT >
+    btree_status_t get(ReqT& get_req) const {
+        if constexpr (std::is_same_v< ReqT, BtreeSingleGetRequest >) {
+            if (is_bloom_filter_enabled() && !bloom_may_contain(get_req.key())) { return btree_status_t::not_found; }
+        } else if constexpr (std::is_same_v< ReqT, BtreeGetAnyRequest< K > >) {
+            // Messages flushed down before the read are written as part of the current cp
+            if (this->is_msg_buffered()) {
+                auto cpg = hs()->cp_mgr().cp_guard();
+                get_req.m_op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
+                return Btree< K, V >::get(get_req);
+            }
+        }
+        return Btree< K, V >::get(get_req);
+    }
+
+    btree_status_t query(BtreeQueryRequest< K >& query_req, std::vector< std::pair< K, V > >& out_values) const {
+        if (!this->is_msg_buffered()) { return Btree< K, V >::query(query_req, out_values); }
+
+        // Messages flushed down before the read are written as part of the current cp
+        auto cpg = hs()->cp_mgr().cp_guard();
+        query_req.m_op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
+        return Btree< K, V >::query(query_req, out_values);
+    }
+
+    void trigger_deferred_merges() override {
+        if (!this->is_merge_deferred() || (this->deferred_merges_count() == 0) || m_rebalance_stopped.load()) {
+            return;
+        }
+        bool expected{false};
+        if (!m_rebalancing.compare_exchange_strong(expected, true)) { return; }
+        run_in_background(index_service().rebalance_fiber(), [this]() {
+            apply_deferred_merges();
+            std::unique_lock lg{m_bg_mtx};
+            m_rebalancing.store(false);
+        });
+    }
+
+    bool is_rebalancing() const { return m_rebalancing.load(); }
+
+    /// @brief Rebuilds the bloom filter in background if it is yet to be built since recovery, or has outgrown its
+    /// size or has too many stale keys. Called upon cp switchover, so a full scan is done at most once per cp. Lookups
+    /// are never filtered till it is rebuilt.
+    void check_bloom_filter() override {
+        if (!is_bloom_filter_enabled()) { return; }
+        if (!m_bloom_ready.load() || is_bloom_filter_stale()) { trigger_bloom_rebuild(); }
+    }
+
+    /// @brief Applies the merges deferred by the removes so far, each as part of the cp current at the time it is
+    /// merged. Merges deferred meanwhile are left for the next round.
+    void apply_deferred_merges() {
+        for (auto n = this->deferred_merges_count(); (n != 0) && !m_rebalance_stopped.load(); --n) {
+            auto cpg = hs()->cp_mgr().cp_guard();
+            if (this->rebalance((void*)cpg.context(cp_consumer_t::INDEX_SVC), 1 /* max_merges */) !=
+                btree_status_t::success) {
+                break;
+            }
+        }
     }
 
+    bool is_bloom_filter_enabled() const { return (this->m_bt_cfg.m_bloom_filter_keys != 0); }
+    bool is_bloom_filter_ready() const { return m_bloom_ready.load(); }
+    bool is_bloom_filter_rebuilding() const { return m_bloom_rebuilding.load(); }
+    uint64_t bloom_filtered_count() const { return m_bloom_num_filtered.load(); }
+
 protected:
+    ///////////////////////////////////// Bloom Filter Methods /////////////////////////////////////
+    // Called ahead of the put with m_bloom_put_mtx held shared
+    template < typename ReqT >
+    void bloom_on_put(ReqT const& put_req) {
+        if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+            bloom_add(put_req.key());
+        } else if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+            for (auto const& e : put_req.entries()) {
+                bloom_add(*e.m_k);
+            }
+        } else {
+            // Keys created by a range put can't be enumerated, filter has to be rebuilt unless the put only modifies
+            // the existing keys, which update and merge of a range do.
+            if ((put_req.m_put_type != btree_put_type::UPDATE) && (put_req.m_put_type != btree_put_type::MERGE)) {
+                invalidate_bloom_filter();
+            }
+        }
+    }
+
+    // Only the keys the put added count towards the filter getting outgrown
+    template < typename ReqT >
+    void bloom_count_put(ReqT const& put_req, btree_status_t ret) {
+        if constexpr (std::is_same_v< ReqT, BtreeSinglePutRequest >) {
+            if (ret == btree_status_t::success) { m_bloom_num_added.fetch_add(1); }
+        } else if constexpr (std::is_same_v< ReqT, BtreeMultiPutRequest< K > >) {
+            for (auto const& e : put_req.entries()) {
+                if (e.m_done) { m_bloom_num_added.fetch_add(1); }
+            }
+        }
+    }
+
+    // Filter being built is loaded before the current one, which pairs with the rebuild publishing the new filter as
+    // current before it clears the one being built. So the key is added to the new filter, either as the one being
+    // built or as the current one, unless the rebuild is yet to start, in which case its scan picks up the key.
+    void bloom_add(BtreeKey const& key) {
+        auto const h = BlockedBloomFilter::hash(key.serialize());
+        auto building = std::atomic_load(&m_bloom_building);
+        auto bloom = std::atomic_load(&m_bloom);
+        if (building) { building->add(h); }
+        if (bloom && (bloom != building)) { bloom->add(h); }
+    }
+
+    // Entries of the subtrees dropped as a whole by a range remove are not counted, which is a large number of keys
+    // removed at once, hence the filter is marked as stale.
+    template < typename ReqT >
+    void bloom_on_remove(ReqT const& remove_req) {
+        if constexpr (std::is_same_v< ReqT, BtreeRangeRemoveRequest< K > >) {
+            if (remove_req.m_subtrees_dropped) {
+                m_bloom_num_removed.fetch_add(m_bloom_capacity.load());
+            } else {
+                m_bloom_num_removed.fetch_add(remove_req.m_removed_count);
+            }
+        } else {
+            m_bloom_num_removed.fetch_add(1);
+        }
+    }
+
+    // Filter has more keys than it is sized for or too many stale keys which are removed
+    bool is_bloom_filter_stale() const {
+        auto const capacity = m_bloom_capacity.load();
+        return (m_bloom_num_keys.load() + m_bloom_num_added.load() > capacity) ||
+            (m_bloom_num_removed.load() > capacity / 2);
+    }
+
+    bool bloom_may_contain(BtreeKey const& key) const {
+        if (!m_bloom_ready.load()) { return true; }
+
+        auto bloom = std::atomic_load(&m_bloom);
+        if (bloom->may_contain(BlockedBloomFilter::hash(key.serialize()))) { return true; }
+        m_bloom_num_filtered.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Order of bumping the generation before marking the filter not ready pairs with the rebuild marking it ready
+    // before checking the generation, so that a range put racing with the rebuild always leaves the filter not ready.
+    void invalidate_bloom_filter() {
+        m_bloom_gen.fetch_add(1);
+        m_bloom_ready.store(false);
+    }
+
+    void trigger_bloom_rebuild() {
+        bool expected{false};
+        if (!m_bloom_rebuilding.compare_exchange_strong(expected, true)) { return; }
+        run_in_background([this]() {
+            rebuild_bloom_filter();
+            m_bloom_rebuilding.store(false);
+        });
+    }
+
+    /* Builds a new filter by scanning all the keys in the btree. Puts issued during the scan are added to the new
+     * filter as well, so that a key is either added by its put or picked up by the scan. A range put which invalidates
+     * the filter before the scan starts, is waited for in the same way, so that the scan finds the keys it created. */
+    void rebuild_bloom_filter() {
+        auto const gen = m_bloom_gen.load();
+        auto const capacity = std::max(this->m_bt_cfg.m_bloom_filter_keys,
+                                       2 * (m_bloom_num_keys.load() + m_bloom_num_added.load()));
+        auto bloom = std::make_shared< BlockedBloomFilter >(capacity);
+
+        m_bloom_num_added.store(0);
+        m_bloom_num_removed.store(0);
+        std::atomic_store(&m_bloom_building, bloom);
+
+        // Puts which added their keys before the filter being built was set, are waited for to finish their leaf
+        // writes, so that the scan finds their keys. Puts after this add their keys to the filter being built. Keys of
+        // the puts buffered in the interior nodes are flushed to the leaves for the scan.
+        { std::unique_lock lg{m_bloom_put_mtx}; }
+        auto ret = btree_status_t::success;
+        if (this->is_msg_buffered()) {
+            auto cpg = hs()->cp_mgr().cp_guard();
+            ret = this->flush_msgs_for_read((void*)cpg.context(cp_consumer_t::INDEX_SVC));
+        }
+
+        uint64_t num_keys{0};
+        if (ret == btree_status_t::success) {
+            ret = this->for_each_key([&bloom, &num_keys, this](K const& key) {
+                bloom->add(BlockedBloomFilter::hash(key.serialize()));
+                ++num_keys;
+                return !m_bloom_stopped.load();
+            });
+        }
+
+        if ((ret == btree_status_t::success) && !m_bloom_stopped.load()) {
+            // Publish the new filter before it stops receiving the puts
+            std::atomic_store(&m_bloom, bloom);
+            m_bloom_capacity.store(capacity);
+            m_bloom_num_keys.store(num_keys);
+            m_bloom_ready.store(true);
+            if (m_bloom_gen.load() != gen) { m_bloom_ready.store(false); }
+            BT_LOG(INFO, "Rebuilt bloom filter with {} keys, size={} bytes", num_keys, bloom->size());
+        } else {
+            BT_LOG(WARN, "Bloom filter rebuild aborted, ret={}", ret);
+        }
+        std::atomic_store(&m_bloom_building, std::shared_ptr< BlockedBloomFilter >{});
+    }
+
+    // Root as of the given cp, which is empty if the index was created after the cp
+    BtreeLinkInfo snapshot_root(cp_id_t cp_id) const {
+        std::unique_lock lg{m_cp_roots_mtx};
+        auto it = m_cp_roots.upper_bound(cp_id);
+        if (it == m_cp_roots.begin()) { return BtreeLinkInfo{}; }
+        return std::prev(it)->second;
+    }
+
+    // Node ids are block ids resolved through the write back cache, a stale link picked by an optimistic reader could
+    // read a freed block into the cache. Hence index tables always use lock coupled reads.
+    void disable_optimistic_read() { this->m_bt_cfg.m_optimistic_read_turned_on = false; }
+
     ////////////////// Override Implementation of underlying store requirements //////////////////
     BtreeNodePtr alloc_node(bool is_leaf) override {
         return wb_cache().alloc_buf([this, is_leaf](const IndexBufferPtr& idx_buf) -> BtreeNodePtr {
@@ -124,14 +458,13 @@ protected:
                                         void* context) override {
         CPContext* cp_ctx = r_cast< CPContext* >(context);
         auto left_child_idx_node = IndexBtreeNode::convert(left_child_node.get());
-        auto parent_idx_node = IndexBtreeNode::convert(parent_node.get());
         auto& left_child_buf = left_child_idx_node->m_idx_buf;
-        auto& parent_buf = parent_idx_node->m_idx_buf;
 
         // Write new nodes in the list as standalone outside transacted pairs.
         // Write the new right child nodes, left node and parent in order.
         // Create the relationship of right child to the left node via prepend_to_chain below.
-        // Parent and left node are linked in the prepare_node_txn
+        // Parent and left node are linked in the prepare_node_txn. Split not linked to the parent yet comes without
+        // parent, which is written later by the repair of the split, after its own prepare_node_txn.
         for (const auto& right_child_node : new_nodes) {
             auto right_child = IndexBtreeNode::convert(right_child_node.get());
             write_node_impl(right_child_node, context);
@@ -141,7 +474,8 @@ protected:
         auto trace_index_bufs = [&]() {
             std::string str;
             str = fmt::format("cp {} left {} parent {}", cp_ctx->id(), left_child_buf->to_string(),
-                              parent_buf->to_string());
+                              parent_node ? IndexBtreeNode::convert(parent_node.get())->m_idx_buf->to_string()
+                                          : std::string{"none"});
             for (const auto& right_child_node : new_nodes) {
                 auto right_child = IndexBtreeNode::convert(right_child_node.get());
                 fmt::format_to(std::back_inserter(str), " right {}", right_child->m_idx_buf->to_string());
@@ -151,7 +485,7 @@ protected:
 
         LOGTRACEMOD(wbcache, "{}", trace_index_bufs());
         write_node_impl(left_child_node, context);
-        write_node_impl(parent_node, context);
+        if (parent_node) { write_node_impl(parent_node, context); }
 
         return btree_status_t::success;
     }
@@ -170,6 +504,11 @@ protected:
         } catch (std::exception& e) { return btree_status_t::node_read_failed; }
     }
 
+    // Only the nodes in the wb cache are peeked at, a node not in the cache is never read from the device for it
+    btree_status_t peek_node_impl(bnodeid_t id, BtreeNodePtr& node) const override {
+        return wb_cache().peek_buf(id, node) ? btree_status_t::success : btree_status_t::not_found;
+    }
+
     btree_status_t refresh_node(const BtreeNodePtr& node, bool for_read_modify_write, void* context) const override {
         CPContext* cp_ctx = (CPContext*)context;
         if (cp_ctx == nullptr) { return btree_status_t::success; }
@@ -250,6 +589,39 @@ protected:
         wb_cache().free_buf(n->m_idx_buf, r_cast< CPContext* >(context));
         n->~IndexBtreeNode();
     }
+
+    // Nodes of a btree destroyed in the background are freed by their ids, so that the leaves are never read into the
+    // cache only to be freed. Each batch is freed as part of the CP current at the time, instead of holding back the CP
+    // for the entire destroy.
+    void free_node_ids_impl(std::vector< bnodeid_t > const& node_ids) override {
+        auto cpg = hs()->cp_mgr().cp_guard();
+        auto cp_ctx = cpg.context(cp_consumer_t::INDEX_SVC);
+        for (auto const id : node_ids) {
+            BtreeNodePtr node;
+            wb_cache().free_buf(id, node, cp_ctx);
+            if (node) { IndexBtreeNode::convert(node.get())->~IndexBtreeNode(); }
+        }
+    }
+
+    // Subtrees dropped by a range remove are freed in the background, instead of holding up the remove
+    void run_subtree_free(std::function< void() > free_fn) override { run_in_background(std::move(free_fn)); }
+
+    void run_in_background(std::function< void() > fn) {
+        run_in_background(hs()->cp_mgr().pick_blocking_io_fiber(), std::move(fn));
+    }
+
+    void run_in_background(iomgr::io_fiber_t fiber, std::function< void() > fn) {
+        {
+            std::unique_lock lg{m_bg_mtx};
+            ++m_bg_tasks;
+        }
+        iomanager.run_on_forget(fiber, [this, fn = std::move(fn)]() {
+            fn();
+            std::unique_lock lg{m_bg_mtx};
+            --m_bg_tasks;
+            m_bg_cv.notify_all();
+        });
+    }
 };
 
 } // namespace homestore
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <boost/intrusive_ptr.hpp>
 #include <sisl/utility/atomic_counter.hpp>
 #include <homestore/blk.h>
@@ -50,6 +51,12 @@ public:
 
     virtual void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer) = 0;
 
+    /// @brief Look up the node of the buffer only if it is in the cache, without reading it from the device
+    /// @param id Node id of the buffer
+    /// @param node Node of the buffer, if it is in the cache
+    /// @return Whether the buffer is in the cache
+    virtual bool peek_buf(bnodeid_t id, BtreeNodePtr& node) = 0;
+
     /// @brief Start a chain of related btree buffers. Typically a chain is creating from second and third pairs and
     /// then first is prepended to the chain. In case the second buffer is already with the WB cache, it will create a
     /// new buffer for both second and third. We append the buffers to a list in dependency chain.
@@ -70,10 +77,34 @@ public:
     /// @param context
     virtual void free_buf(const IndexBufferPtr& buf, CPContext* context) = 0;
 
+    /// @brief Free the buffer by its node id, without having to read the buffer. If the buffer is in the cache, it is
+    /// removed from the cache and its node is returned.
+    /// @param id Node id of the buffer to free
+    /// @param node Node of the buffer, if it was in the cache
+    /// @param context
+    virtual void free_buf(bnodeid_t id, BtreeNodePtr& node, CPContext* context) = 0;
+
     /// @brief Copy buffer
     /// @param cur_buf
     /// @return
     virtual IndexBufferPtr copy_buffer(const IndexBufferPtr& cur_buf, const CPContext* context) const = 0;
+
+    /// @brief Pin the buffers as persisted by the last completed cp, so that they can be read till unpinned. Any cp
+    /// flush which would overwrite them is deferred till all the pins are released, but not longer than
+    /// index_snapshot_max_pin_ms, after which the flush proceeds and the pins are invalidated.
+    /// @param pin_gen Generation of the pin, to be passed to read and unpin
+    /// @return Id of the last completed cp, or nullopt if a cp flush is in progress or waiting to start
+    virtual std::optional< cp_id_t > pin_persisted_bufs(uint64_t& pin_gen) = 0;
+
+    /// @brief Release the pin taken by pin_persisted_bufs, starting the deferred cp flush if it is the last pin
+    virtual void unpin_persisted_bufs(uint64_t pin_gen) = 0;
+
+    /// @brief Read the copy of the buffer persisted by the last completed cp. Caller is expected to hold the pin.
+    /// @param id Node id of the buffer
+    /// @param pin_gen Generation of the pin held
+    /// @return Private copy of the buffer, either copied from the cache if it is not dirtied since or read from the
+    /// device. nullptr if the pin is invalidated by a cp flush, since the buffer read could be of a later cp.
+    virtual IndexBufferPtr read_persisted_buf(bnodeid_t id, uint64_t pin_gen) = 0;
 };
 
 } // namespace homestore
@@ -47,6 +47,10 @@ private:
     mutable std::mutex m_index_map_mtx;
     std::map< uuid_t, std::shared_ptr< IndexTableBase > > m_index_map;
 
+    // Deferred merges of all the index tables are applied on this fiber of a low priority reactor of its own, so that
+    // they do not compete with the cp io for the cp fibers
+    iomgr::io_fiber_t m_rebalance_fiber{nullptr};
+
 public:
     IndexService(std::unique_ptr< IndexServiceCallbacks > cbs);
 
@@ -69,9 +73,18 @@ public:
     uint64_t used_size() const;
     uint32_t node_size() const;
 
+    // Start applying the merges deferred by all the index tables, in background
+    void trigger_deferred_merges();
+
+    // Rebuild the bloom filters of the index tables which are stale or yet to be built since recovery, in background
+    void check_bloom_filters();
+
     IndexWBCacheBase& wb_cache() { return *m_wb_cache; }
 
+    iomgr::io_fiber_t rebalance_fiber() const { return m_rebalance_fiber; }
+
 private:
+    void start_rebalance_thread();
     void meta_blk_found(const sisl::byte_view& buf, void* meta_cookie);
 };
 
@@ -5,6 +5,16 @@ namespace homestore {
 IndexCPCallbacks::IndexCPCallbacks(IndexWBCache* wb_cache) : m_wb_cache{wb_cache} {}
 
 std::unique_ptr< CPContext > IndexCPCallbacks::on_switchover_cp(CP* cur_cp, CP* new_cp) {
+    if (cur_cp) {
+        // Merges deferred so far are applied in background, as part of the new cp
+        index_service().trigger_deferred_merges();
+
+        // So are the rebuilds of the bloom filters, which the writes only mark as invalidated or outgrown
+        index_service().check_bloom_filters();
+    } else {
+        // First cp after the boot follows the last cp flushed before
+        m_wb_cache->set_persisted_cp(new_cp->id() - 1);
+    }
     return std::make_unique< IndexCPContext >(new_cp);
 }
 
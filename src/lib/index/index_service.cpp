@@ -13,6 +13,8 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <sys/resource.h>
+
 #include <homestore/homestore.hpp>
 #include <homestore/index_service.hpp>
 #include <homestore/index/index_internal.hpp>
@@ -74,15 +76,46 @@ void IndexService::start() {
     // Register to CP for flush dirty buffers
     hs()->cp_mgr().register_consumer(cp_consumer_t::INDEX_SVC,
                                      std::move(std::make_unique< IndexCPCallbacks >(m_wb_cache.get())));
+
+    start_rebalance_thread();
+}
+
+void IndexService::start_rebalance_thread() {
+    struct Context {
+        std::condition_variable cv;
+        std::mutex mtx;
+        bool started{false};
+    };
+    auto ctx = std::make_shared< Context >();
+
+    iomanager.create_reactor("index_rebalance", iomgr::INTERRUPT_LOOP, 1u, [this, &ctx](bool is_started) {
+        if (is_started) {
+            // Merges are only a space optimization, run them at a lower priority than the io and cp threads. It is
+            // not made an idle priority thread, since each merge holds the cp and the node locks while it runs.
+            if (::setpriority(PRIO_PROCESS, 0 /* calling thread */, 10) != 0) {
+                LOGWARN("Unable to lower the priority of index rebalance thread, errno={}", errno);
+            }
+            {
+                std::unique_lock< std::mutex > lk{ctx->mtx};
+                m_rebalance_fiber = iomanager.sync_io_capable_fibers()[0];
+                ctx->started = true;
+            }
+            ctx->cv.notify_one();
+        }
+    });
+
+    std::unique_lock< std::mutex > lk{ctx->mtx};
+    ctx->cv.wait(lk, [&ctx] { return ctx->started; });
 }
 
 void IndexService::stop() {
-    std::unique_lock lg(m_index_map_mtx);
+    // CP switchover walks all the tables to start their background work, hence the map is locked only after the flush
     auto fut = homestore::hs()->cp_mgr().trigger_cp_flush(true /* force */);
     auto success = std::move(fut).get();
     HS_REL_ASSERT_EQ(success, true, "CP Flush failed");
     LOGINFO("CP Flush completed");
 
+    std::unique_lock lg(m_index_map_mtx);
     for (auto [id, tbl] : m_index_map) {
         tbl->destroy();
     }
@@ -99,6 +132,20 @@ void IndexService::remove_index_table(const std::shared_ptr< IndexTableBase >& t
     m_index_map.erase(tbl->uuid());
 }
 
+void IndexService::trigger_deferred_merges() {
+    std::unique_lock lg(m_index_map_mtx);
+    for (auto& [id, table] : m_index_map) {
+        table->trigger_deferred_merges();
+    }
+}
+
+void IndexService::check_bloom_filters() {
+    std::unique_lock lg(m_index_map_mtx);
+    for (auto& [id, table] : m_index_map) {
+        table->check_bloom_filter();
+    }
+}
+
 uint32_t IndexService::node_size() const { return hs()->device_mgr()->atomic_page_size(HSDevType::Fast); }
 
 uint64_t IndexService::used_size() const {
@@ -152,6 +152,8 @@ retry:
     }
 }
 
+bool IndexWBCache::peek_buf(bnodeid_t id, BtreeNodePtr& node) { return m_cache.get(BlkId{id}, node); }
+
 std::pair< bool, bool > IndexWBCache::create_chain(IndexBufferPtr& second, IndexBufferPtr& third, CPContext* cp_ctx) {
     bool second_copied{false}, third_copied{false};
     auto chain = second;
@@ -202,12 +204,22 @@ void IndexWBCache::free_buf(const IndexBufferPtr& buf, CPContext* cp_ctx) {
     m_vdev->free_blk(buf->m_blkid, s_cast< VDevCPContext* >(cp_ctx));
 }
 
+void IndexWBCache::free_buf(bnodeid_t id, BtreeNodePtr& node, CPContext* cp_ctx) {
+    auto const blkid = BlkId{id};
+    node.reset();
+    m_cache.remove(blkid, node); // Buffer need not be in cache, if it was never read or already evicted
+
+    resource_mgr().inc_free_blk(m_node_size);
+    m_vdev->free_blk(blkid, s_cast< VDevCPContext* >(cp_ctx));
+}
+
 //////////////////// CP Related API section /////////////////////////////////
 
 folly::Future< bool > IndexWBCache::async_cp_flush(IndexCPContext* cp_ctx) {
     LOGTRACEMOD(wbcache, "cp_ctx {}", cp_ctx->to_string());
     if (!cp_ctx->any_dirty_buffers()) {
         CP_PERIODIC_LOG(DEBUG, cp_ctx->id(), "Btree does not have any dirty buffers to flush");
+        set_persisted_cp(cp_ctx->id());
         return folly::makeFuture< bool >(true); // nothing to flush
     }
 
@@ -218,6 +230,30 @@ folly::Future< bool > IndexWBCache::async_cp_flush(IndexCPContext* cp_ctx) {
     // cp_ctx->check_cycle();
 #endif
 
+    auto fut = cp_ctx->get_future();
+    {
+        std::unique_lock lg{m_pin_mtx};
+        if (m_pin_count != 0) {
+            // Buffers of the last cp are being read by snapshots, last of them to unpin starts the flush, unless they
+            // hold it back for too long
+            auto const max_pin_ms = HS_DYNAMIC_CONFIG(generic.index_snapshot_max_pin_ms);
+            CP_PERIODIC_LOG(DEBUG, cp_ctx->id(), "Deferring flush till {} snapshot readers unpin, for atmost {}ms",
+                            m_pin_count, max_pin_ms);
+            m_deferred_flush_ctx = cp_ctx;
+            m_pin_timer_hdl = iomanager.schedule_global_timer(
+                uint64_cast(max_pin_ms) * 1000 * 1000, false /* recurring */, nullptr /* cookie */,
+                iomgr::reactor_regex::all_worker,
+                [this, pin_gen = m_flush_gen](void*) { on_pin_timeout(pin_gen); }, false /* wait_to_schedule */);
+            return fut;
+        }
+        m_flushing = true;
+        ++m_flush_gen;
+    }
+    start_cp_flush(cp_ctx);
+    return fut;
+}
+
+void IndexWBCache::start_cp_flush(IndexCPContext* cp_ctx) {
     cp_ctx->prepare_flush_iteration();
 
     for (auto& fiber : m_cp_flush_fibers) {
@@ -232,7 +268,6 @@ folly::Future< bool > IndexWBCache::async_cp_flush(IndexCPContext* cp_ctx) {
             m_vdev->submit_batch();
         });
     }
-    return std::move(cp_ctx->get_future());
 }
 
 void IndexWBCache::do_flush_one_buf(IndexCPContext* cp_ctx, IndexBufferPtr buf, bool part_of_batch) {
@@ -259,6 +294,7 @@ void IndexWBCache::process_write_completion(IndexCPContext* cp_ctx, IndexBufferP
         iomanager.run_on_forget(hs()->cp_mgr().pick_blocking_io_fiber(), [this, cp_ctx]() {
             LOGTRACEMOD(wbcache, "Initiating CP flush");
             m_vdev->cp_flush(cp_ctx); // This is a blocking io call
+            on_cp_flush_done(cp_ctx);
             cp_ctx->complete(true);
         });
     }
@@ -324,6 +360,90 @@ void IndexWBCache::get_next_bufs_internal(IndexCPContext* cp_ctx, uint32_t max_c
     }
 }
 
+void IndexWBCache::on_cp_flush_done(IndexCPContext* cp_ctx) {
+    std::unique_lock lg{m_pin_mtx};
+    m_flushing = false;
+    m_persisted_cp_id = cp_ctx->id();
+}
+
+void IndexWBCache::set_persisted_cp(cp_id_t cp_id) {
+    std::unique_lock lg{m_pin_mtx};
+    m_persisted_cp_id = cp_id;
+}
+
+//////////////////// Persisted Buffers API section /////////////////////////////////
+/* Buffers are flushed in place to their blkid, so the device has exactly the buffers persisted by the last completed
+ * cp, except while a cp flush is in progress. Blocks freed since are not reused till the cp which freed them is
+ * flushed, hence none of the blocks reachable as of the last completed cp are overwritten as long as no cp flush runs.
+ * Foreground writes continue into the current cp while pinned, only its flush is held back.
+ */
+std::optional< cp_id_t > IndexWBCache::pin_persisted_bufs(uint64_t& pin_gen) {
+    std::unique_lock lg{m_pin_mtx};
+    if (m_flushing || m_deferred_flush_ctx) { return std::nullopt; }
+    ++m_pin_count;
+    pin_gen = m_flush_gen;
+    return m_persisted_cp_id;
+}
+
+void IndexWBCache::unpin_persisted_bufs(uint64_t pin_gen) {
+    IndexCPContext* deferred_ctx{nullptr};
+    iomgr::timer_handle_t timer_hdl{iomgr::null_timer_handle};
+    {
+        std::unique_lock lg{m_pin_mtx};
+        if (pin_gen != m_flush_gen) { return; } // Pin was already dropped when it timed out
+        HS_DBG_ASSERT_GT(m_pin_count, 0u, "Unpin of persisted buffers without pin");
+        if ((--m_pin_count == 0) && m_deferred_flush_ctx) {
+            deferred_ctx = std::exchange(m_deferred_flush_ctx, nullptr);
+            timer_hdl = std::exchange(m_pin_timer_hdl, iomgr::null_timer_handle);
+            m_flushing = true;
+            ++m_flush_gen;
+        }
+    }
+    if (deferred_ctx) {
+        iomanager.cancel_timer(timer_hdl, false /* wait */); // Timer firing meanwhile finds its pins gone
+        start_cp_flush(deferred_ctx);
+    }
+}
+
+// Snapshots held the flush back for too long, drop their pins and start the flush. Their subsequent reads see the
+// bumped generation and fail, instead of reading the buffers being overwritten.
+void IndexWBCache::on_pin_timeout(uint64_t pin_gen) {
+    IndexCPContext* deferred_ctx{nullptr};
+    {
+        std::unique_lock lg{m_pin_mtx};
+        if ((pin_gen != m_flush_gen) || !m_deferred_flush_ctx) { return; }
+        LOGWARNMOD(wbcache, "Snapshot readers held back cp {} flush for {}ms, invalidating {} of them",
+                   m_deferred_flush_ctx->id(), HS_DYNAMIC_CONFIG(generic.index_snapshot_max_pin_ms), m_pin_count);
+        deferred_ctx = std::exchange(m_deferred_flush_ctx, nullptr);
+        m_pin_timer_hdl = iomgr::null_timer_handle;
+        m_pin_count = 0;
+        m_flushing = true;
+        ++m_flush_gen;
+    }
+    start_cp_flush(deferred_ctx);
+}
+
+IndexBufferPtr IndexWBCache::read_persisted_buf(bnodeid_t id, uint64_t pin_gen) {
+    auto const blkid = BlkId{id};
+    auto buf = std::make_shared< IndexBuffer >(blkid, m_node_size, m_vdev->align_size());
+
+    // Cached buffer which is clean is same as the persisted one. Node lock keeps it from being modified while copying.
+    BtreeNodePtr node;
+    bool clean{false};
+    if (m_cache.get(blkid, node)) {
+        node->lock(locktype_t::READ);
+        auto const& cur_buf = IndexBtreeNode::convert(node.get())->m_idx_buf;
+        clean = cur_buf->is_clean();
+        if (clean) { std::memcpy(buf->raw_buffer(), cur_buf->raw_buffer(), m_node_size); }
+        node->unlock(locktype_t::READ);
+    }
+    if (!clean) { m_vdev->sync_read(r_cast< char* >(buf->raw_buffer()), m_node_size, blkid); }
+
+    // Flush started before the read completed could have overwritten the buffer with that of the later cp
+    std::unique_lock lg{m_pin_mtx};
+    return (pin_gen == m_flush_gen) ? buf : nullptr;
+}
+
 IndexBtreeNode* IndexBtreeNode::convert(BtreeNode* bt_node) {
     return r_cast< IndexBtreeNode* >(bt_node->get_node_context());
 }
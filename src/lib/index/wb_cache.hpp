@@ -41,6 +41,17 @@ private:
     std::vector< iomgr::io_fiber_t > m_cp_flush_fibers;
     std::mutex m_flush_mtx;
 
+    // Buffers persisted by the last completed cp are pinned by the snapshot readers, cp flush which would overwrite
+    // them on the device waits in m_deferred_flush_ctx till the last of them is unpinned, or till the pins time out.
+    // m_flush_gen is bumped by every flush started, which invalidates the pins taken before it.
+    std::mutex m_pin_mtx;
+    uint32_t m_pin_count{0};
+    bool m_flushing{false};
+    IndexCPContext* m_deferred_flush_ctx{nullptr};
+    cp_id_t m_persisted_cp_id{-1};
+    uint64_t m_flush_gen{0};
+    iomgr::timer_handle_t m_pin_timer_hdl{iomgr::null_timer_handle};
+
 public:
     IndexWBCache(const std::shared_ptr< VirtualDev >& vdev, const std::shared_ptr< sisl::Evictor >& evictor,
                  uint32_t node_size);
@@ -49,16 +60,27 @@ public:
     void realloc_buf(const IndexBufferPtr& buf) override;
     void write_buf(const BtreeNodePtr& node, const IndexBufferPtr& buf, CPContext* cp_ctx) override;
     void read_buf(bnodeid_t id, BtreeNodePtr& node, node_initializer_t&& node_initializer) override;
+    bool peek_buf(bnodeid_t id, BtreeNodePtr& node) override;
     std::pair< bool, bool > create_chain(IndexBufferPtr& second, IndexBufferPtr& third, CPContext* cp_ctx) override;
     void prepend_to_chain(const IndexBufferPtr& first, const IndexBufferPtr& second) override;
     void free_buf(const IndexBufferPtr& buf, CPContext* cp_ctx) override;
+    void free_buf(bnodeid_t id, BtreeNodePtr& node, CPContext* cp_ctx) override;
 
     //////////////////// CP Related API section /////////////////////////////////
     folly::Future< bool > async_cp_flush(IndexCPContext* context);
     IndexBufferPtr copy_buffer(const IndexBufferPtr& cur_buf, const CPContext *cp_ctx) const;
+    void set_persisted_cp(cp_id_t cp_id);
+
+    //////////////////// Persisted Buffers API section /////////////////////////////////
+    std::optional< cp_id_t > pin_persisted_bufs(uint64_t& pin_gen) override;
+    void unpin_persisted_bufs(uint64_t pin_gen) override;
+    IndexBufferPtr read_persisted_buf(bnodeid_t id, uint64_t pin_gen) override;
 
 private:
     void start_flush_threads();
+    void on_pin_timeout(uint64_t pin_gen);
+    void start_cp_flush(IndexCPContext* cp_ctx);
+    void on_cp_flush_done(IndexCPContext* cp_ctx);
     void process_write_completion(IndexCPContext* cp_ctx, IndexBufferPtr pbuf);
     void do_flush_one_buf(IndexCPContext* cp_ctx, const IndexBufferPtr buf, bool part_of_batch);
     std::pair< IndexBufferPtr, bool > on_buf_flush_done(IndexCPContext* cp_ctx, IndexBufferPtr& buf);
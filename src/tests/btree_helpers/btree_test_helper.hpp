@@ -26,11 +26,119 @@
 #include <boost/algorithm/string.hpp>
 
 #include <homestore/btree/mem_btree.hpp>
+#include <homestore/btree/btree_bulk_loader.hpp>
+#include <homestore/btree/btree_cursor.hpp>
+#include <homestore/btree/btree_parallel_scan.hpp>
 #include "test_common/range_scheduler.hpp"
 #include "shadow_map.hpp"
 
 static constexpr uint32_t g_node_size{4096};
 
+/* Btree which lets the tests split a leaf the way a B-link put does and leave it unlinked from its parent, which the
+ * put otherwise links right after, so that the reads and writes through such a leaf can be tested deterministically.
+ */
+template < typename K, typename V, template < typename, typename > class BtreeT >
+class UnlinkedSplitBtree : public BtreeT< K, V > {
+public:
+    using BtreeT< K, V >::BtreeT;
+
+    // Splits the leaf which has the key, returning the leaf and its new right node
+    btree_status_t split_leaf_unlinked(K const& key, void* context, BtreeNodePtr* out_left = nullptr,
+                                       BtreeNodePtr* out_right = nullptr) {
+        BtreeNodePtr parent;
+        BtreeNodePtr leaf;
+        BtreeLinkInfo leaf_info;
+        auto ret = lock_leaf(key, locktype_t::WRITE, parent, leaf, leaf_info, context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        ret = this->split_node_unlinked(leaf, context, false /* append_split */);
+        if (ret == btree_status_t::success) {
+            if (out_left) { *out_left = leaf; }
+            if (out_right) {
+                ret = this->read_and_lock_node(leaf->next_bnode(), *out_right, locktype_t::READ, locktype_t::READ,
+                                               context);
+                if (ret == btree_status_t::success) { this->unlock_node(*out_right, locktype_t::READ); }
+            }
+        }
+        this->unlock_node(leaf, locktype_t::WRITE);
+        this->unlock_node(parent, locktype_t::READ);
+        return ret;
+    }
+
+    // Whether the leaf which has the key is split and not yet linked to its parent
+    bool is_leaf_split_unlinked(K const& key, void* context) {
+        BtreeNodePtr parent;
+        BtreeNodePtr leaf;
+        BtreeLinkInfo leaf_info;
+        if (lock_leaf(key, locktype_t::READ, parent, leaf, leaf_info, context) != btree_status_t::success) {
+            return false;
+        }
+        bool const ret = this->is_repair_needed(leaf, leaf_info);
+        this->unlock_node(leaf, locktype_t::READ);
+        this->unlock_node(parent, locktype_t::READ);
+        return ret;
+    }
+
+    // Sets the link version of the leaf which has the key, leaving its parent link as is. Leaf whose version differs
+    // from its parent link without being split looks like a leaf merged and not yet repaired.
+    btree_status_t set_leaf_link_version(K const& key, uint64_t version, void* context,
+                                         uint64_t* old_version = nullptr) {
+        BtreeNodePtr parent;
+        BtreeNodePtr leaf;
+        BtreeLinkInfo leaf_info;
+        auto ret = lock_leaf(key, locktype_t::WRITE, parent, leaf, leaf_info, context);
+        if (ret != btree_status_t::success) { return ret; }
+
+        if (old_version) { *old_version = leaf->link_version(); }
+        leaf->set_link_version(version);
+        ret = this->write_node(leaf, context);
+        this->unlock_node(leaf, locktype_t::WRITE);
+        this->unlock_node(parent, locktype_t::READ);
+        return ret;
+    }
+
+    // Number of leaf splits across the btree which are not yet linked to their parent
+    uint64_t num_unlinked_splits() {
+        uint64_t n{0};
+        this->post_order_traversal(locktype_t::READ, [this, &n](const auto& node, bool is_leaf) -> btree_status_t {
+            if (is_leaf) { return btree_status_t::success; }
+            std::vector< bnodeid_t > split_ids;
+            auto const ret = this->get_unlinked_split_ids(node, split_ids);
+            n += split_ids.size();
+            return ret;
+        });
+        return n;
+    }
+
+private:
+    // Locks the leaf the parent links for the key, without following the unlinked splits, along with its parent
+    btree_status_t lock_leaf(K const& key, locktype_t leaf_lock, BtreeNodePtr& parent, BtreeNodePtr& leaf,
+                             BtreeLinkInfo& leaf_info, void* context) {
+        auto ret = this->read_and_lock_node(this->root_node_id(), parent, locktype_t::READ, locktype_t::READ, context);
+        if (ret != btree_status_t::success) { return ret; }
+        if (parent->is_leaf()) {
+            this->unlock_node(parent, locktype_t::READ);
+            return btree_status_t::not_supported; // Root has no parent to leave it unlinked from
+        }
+
+        while (true) {
+            auto const idx = parent->find(key, nullptr, false).second;
+            BtreeNodePtr child;
+            ret = this->get_child_and_lock_node(parent, idx, leaf_info, child, locktype_t::READ, leaf_lock, context);
+            if (ret != btree_status_t::success) {
+                this->unlock_node(parent, locktype_t::READ);
+                return ret;
+            }
+            if (child->is_leaf()) {
+                leaf = std::move(child);
+                return btree_status_t::success;
+            }
+            this->unlock_node(parent, locktype_t::READ);
+            parent = std::move(child);
+        }
+    }
+};
+
 template < typename TestType >
 struct BtreeTestHelper {
     using T = TestType;
@@ -62,6 +170,8 @@ struct BtreeTestHelper {
         m_operations["range_put"] = std::bind(&BtreeTestHelper::range_put_random, this);
         m_operations["range_remove"] = std::bind(&BtreeTestHelper::range_remove_existing_random, this);
         m_operations["query"] = std::bind(&BtreeTestHelper::query_random, this);
+        m_operations["get"] = std::bind(&BtreeTestHelper::get_random, this);
+        m_operations["count"] = std::bind(&BtreeTestHelper::count_random, this);
     }
 
     void TearDown() {}
@@ -121,6 +231,48 @@ public:
         do_put(start_k, btree_put_type::INSERT, V::generate_rand());
     }
 
+    void multi_put(std::vector< uint64_t > const& keys) {
+        std::vector< K > ks;
+        std::vector< V > vs;
+        std::vector< V > existing_vs(keys.size());
+        ks.reserve(keys.size());
+        vs.reserve(keys.size());
+
+        std::vector< typename BtreeMultiPutRequest< K >::entry_t > entries;
+        for (size_t i{0}; i < keys.size(); ++i) {
+            ks.emplace_back(K{keys[i]});
+            vs.emplace_back(V::generate_rand());
+            entries.push_back({&ks[i], &vs[i], &existing_vs[i]});
+        }
+
+        auto mreq = BtreeMultiPutRequest< K >{std::move(entries), btree_put_type::INSERT};
+        auto const ret = m_bt->put(mreq);
+        ASSERT_EQ((ret == btree_status_t::success), (mreq.num_failed() == 0)) << "multi_put status mismatch";
+
+        for (auto const& e : mreq.entries()) {
+            auto const& key = (const K&)*e.m_k;
+            ASSERT_EQ(e.m_done, !m_shadow_map.exists(key)) << "multi_put outcome mismatch for key " << key;
+            m_shadow_map.put_and_check(key, (const V&)*e.m_v, (const V&)*e.m_existing_val, e.m_done);
+        }
+    }
+
+    void bulk_load(uint32_t start_k, uint32_t end_k, uint8_t fill_pct, void* context = nullptr) {
+        std::vector< std::pair< K, V > > kvs;
+        kvs.reserve(end_k - start_k + 1);
+        for (uint64_t k{start_k}; k <= end_k; ++k) {
+            kvs.emplace_back(K{k}, V::generate_rand());
+        }
+
+        BtreeBulkLoader< K, V > loader{*m_bt, fill_pct};
+        ASSERT_EQ(loader.load(kvs.cbegin(), kvs.cend(), context), btree_status_t::success)
+            << "bulk_load failed for " << start_k << "-" << end_k;
+        ASSERT_EQ(loader.num_entries(), kvs.size()) << "bulk_load didn't load all entries";
+
+        for (auto const& [k, v] : kvs) {
+            m_shadow_map.put_and_check(k, v, v, true /* expected_success */);
+        }
+    }
+
     void range_put(uint32_t start_k, uint32_t end_k, V const& value, bool update) {
         K start_key = K{start_k};
         K end_key = K{end_k};
@@ -138,6 +290,39 @@ public:
         }
     }
 
+    void merge_put(uint64_t k) {
+        K key = K{k};
+        V operand = V::generate_rand();
+        auto sreq = BtreeSinglePutRequest{&key, &operand, btree_put_type::MERGE, nullptr /* existing_val */,
+                                          nullptr /* filter_cb */, merge_op()};
+        ASSERT_EQ(m_bt->put(sreq), btree_status_t::success) << "merge put failed for key " << k;
+        m_shadow_map.merge(key, operand);
+    }
+
+    void range_merge(uint32_t start_k, uint32_t end_k) {
+        K start_key = K{start_k};
+        K end_key = K{end_k};
+        V operand = V::generate_rand();
+
+        auto preq = BtreeRangePutRequest< K >{BtreeKeyRange< K >{start_key, true, end_key, true},
+                                              btree_put_type::MERGE,
+                                              &operand,
+                                              nullptr /* app_context */,
+                                              std::numeric_limits< uint32_t >::max(),
+                                              nullptr /* filter_cb */,
+                                              merge_op()};
+        auto const ret = m_bt->put(preq);
+        ASSERT_TRUE((ret == btree_status_t::success) || (ret == btree_status_t::not_found))
+            << "range merge failed for " << start_k << "-" << end_k;
+        m_shadow_map.range_merge(start_key, end_key, operand);
+    }
+
+    static put_merge_cb_t merge_op() {
+        return [](BtreeKey const&, BtreeValue& existing, BtreeValue const& operand) {
+            s_cast< V& >(existing) = V::merge(s_cast< V const& >(existing), s_cast< V const& >(operand));
+        };
+    }
+
     void range_put_random() {
         bool is_update{true};
         if constexpr (std::is_same_v< V, TestIntervalValue >) { is_update = false; }
@@ -239,6 +424,169 @@ public:
         }
     }
 
+    void do_reverse_query(uint32_t start_k, uint32_t end_k, uint32_t batch_size) {
+        std::vector< std::pair< K, V > > out_vector;
+        m_shadow_map.guard().lock();
+        uint32_t remaining = m_shadow_map.num_elems_in_range(start_k, end_k);
+        auto it = std::make_reverse_iterator(m_shadow_map.map_const().upper_bound(K{end_k}));
+
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
+                                    BtreeQueryType::REVERSE_SWEEP_QUERY, batch_size};
+        while (remaining > 0) {
+            out_vector.clear();
+            auto const ret = m_bt->query(qreq, out_vector);
+            auto const expected_count = std::min(remaining, batch_size);
+
+            ASSERT_EQ(out_vector.size(), expected_count) << "Received incorrect value on reverse query pagination";
+            remaining -= expected_count;
+
+            if (remaining == 0) {
+                ASSERT_EQ(ret, btree_status_t::success) << "Expected success on reverse query";
+            } else {
+                ASSERT_EQ(ret, btree_status_t::has_more) << "Expected reverse query to return has_more";
+            }
+
+            for (size_t idx{0}; idx < out_vector.size(); ++idx) {
+                ASSERT_EQ(out_vector[idx].first.compare(it->first), 0)
+                    << "Reverse query returned key=" << out_vector[idx].first << " expected key=" << it->first;
+                ASSERT_EQ(out_vector[idx].second, it->second)
+                    << "Reverse query doesn't return correct data for key=" << it->first << " idx=" << idx;
+                ++it;
+            }
+        }
+        out_vector.clear();
+        auto ret = m_bt->query(qreq, out_vector);
+        ASSERT_EQ(ret, btree_status_t::success) << "Expected success on reverse query";
+        ASSERT_EQ(out_vector.size(), 0) << "Received incorrect value on empty reverse query pagination";
+
+        m_shadow_map.guard().unlock();
+    }
+
+    // Query the range in one go by walking down every child of the interior nodes in the range
+    void do_traversal_query(uint32_t start_k, uint32_t end_k) {
+        std::vector< std::pair< K, V > > out_vector;
+        m_shadow_map.guard().lock();
+        uint32_t const expected_count = m_shadow_map.num_elems_in_range(start_k, end_k);
+        auto it = m_shadow_map.map_const().lower_bound(K{start_k});
+
+        BtreeQueryRequest< K > qreq{BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true},
+                                    BtreeQueryType::TREE_TRAVERSAL_QUERY, UINT32_MAX};
+        auto const ret = m_bt->query(qreq, out_vector);
+        ASSERT_EQ(ret, btree_status_t::success) << "Expected success on traversal query";
+        ASSERT_EQ(out_vector.size(), expected_count) << "Received incorrect value on traversal query";
+        for (size_t idx{0}; idx < out_vector.size(); ++idx) {
+            ASSERT_EQ(out_vector[idx].first.compare(it->first), 0)
+                << "Traversal query returned key=" << out_vector[idx].first << " expected key=" << it->first;
+            ASSERT_EQ(out_vector[idx].second, it->second)
+                << "Traversal query doesn't return correct data for key=" << it->first << " idx=" << idx;
+            ++it;
+        }
+
+        m_shadow_map.guard().unlock();
+    }
+
+    // Scan the range through cursor, releasing it every release_every entries and removing the last returned entry
+    // behind its back, so that the cursor has to reposition itself
+    void cursor_query(uint32_t start_k, uint32_t end_k, uint32_t release_every) {
+        BtreeCursor< K, V > cursor{*m_bt, BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}};
+        auto it = m_shadow_map.map_const().lower_bound(K{start_k});
+        auto const end_it = m_shadow_map.map_const().upper_bound(K{end_k});
+        uint32_t count{0};
+
+        while (cursor.next() == btree_status_t::success) {
+            ASSERT_NE(it, end_it) << "Cursor returned unexpected key=" << cursor.key();
+            ASSERT_EQ(cursor.key().compare(it->first), 0)
+                << "Cursor returned key=" << cursor.key() << " expected key=" << it->first;
+            ASSERT_EQ(cursor.value(), it->second) << "Cursor doesn't return correct data for key=" << it->first;
+
+            auto const k = it->first.key();
+            ++it;
+            if ((release_every != 0) && ((++count % release_every) == 0)) {
+                cursor.release();
+                remove_one(k);
+            }
+        }
+        ASSERT_EQ(it, end_it) << "Cursor didn't return all the keys in range " << start_k << "-" << end_k;
+    }
+
+    // Scan the range in parallel on all the fibers, either merging the results or collecting them per partition
+    void parallel_scan(uint32_t start_k, uint32_t end_k, bool per_partition, uint32_t* num_partitions = nullptr) {
+        BtreeParallelScan< K, V > scanner{*m_bt, BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}};
+        std::vector< std::pair< K, V > > out_vector;
+        btree_status_t ret;
+        if (per_partition) {
+            std::mutex mtx;
+            std::map< uint32_t, std::vector< std::pair< K, V > > > part_results;
+            ret = scanner
+                      .scan(m_fibers,
+                            [&mtx, &part_results](uint32_t part, K const& k, V const& v) {
+                                std::unique_lock lg(mtx);
+                                part_results[part].emplace_back(k, v);
+                                return true;
+                            })
+                      .get();
+            for (auto& [part, results] : part_results) {
+                auto const& range = scanner.partitions()[part];
+                for (auto const& [k, v] : results) {
+                    auto const sx = k.compare(range.start_key());
+                    auto const ex = k.compare(range.end_key());
+                    ASSERT_TRUE(((sx > 0) || ((sx == 0) && range.is_start_inclusive())) &&
+                                ((ex < 0) || ((ex == 0) && range.is_end_inclusive())))
+                        << "Key=" << k << " delivered for partition " << part << " is outside of it";
+                }
+                out_vector.insert(out_vector.end(), results.begin(), results.end());
+            }
+        } else {
+            ret = scanner.scan(m_fibers, out_vector).get();
+        }
+        ASSERT_EQ(ret, btree_status_t::success) << "Expected success on parallel scan";
+        LOGINFO("Parallel scan of range {}-{} split into {} partitions", start_k, end_k, scanner.partitions().size());
+        if (num_partitions) { *num_partitions = uint32_cast(scanner.partitions().size()); }
+
+        std::shared_lock lg{m_shadow_map.guard()}; // Keys outside the range could be written meanwhile
+        auto it = m_shadow_map.map_const().lower_bound(K{start_k});
+        ASSERT_EQ(out_vector.size(), m_shadow_map.num_elems_in_range(start_k, end_k))
+            << "Parallel scan returned incorrect number of entries";
+        for (size_t idx{0}; idx < out_vector.size(); ++idx, ++it) {
+            ASSERT_EQ(out_vector[idx].first.compare(it->first), 0)
+                << "Parallel scan returned key=" << out_vector[idx].first << " expected key=" << it->first;
+            ASSERT_EQ(out_vector[idx].second, it->second)
+                << "Parallel scan doesn't return correct data for key=" << it->first;
+        }
+    }
+
+    // Validate range count and every nth entry against the shadow map, applicable only if btree keeps subtree counts
+    void validate_counts(uint32_t start_k, uint32_t end_k) const {
+        uint64_t count;
+        ASSERT_EQ(m_bt->total_count(count), btree_status_t::success) << "Expected success on total count";
+        ASSERT_EQ(count, m_shadow_map.size()) << "Total count mismatch";
+
+        ASSERT_EQ(m_bt->range_count(BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}, count),
+                  btree_status_t::success)
+            << "Expected success on range count";
+        ASSERT_EQ(count, m_shadow_map.num_elems_in_range(start_k, end_k))
+            << "Range count mismatch for range " << start_k << "-" << end_k;
+        ASSERT_EQ(m_bt->range_count(BtreeKeyRange< K >{K{start_k}, false, K{end_k}, false}, count),
+                  btree_status_t::success)
+            << "Expected success on range count";
+        auto const excl = m_shadow_map.num_elems_in_range(start_k, end_k) - (m_shadow_map.exists(K{start_k}) ? 1 : 0) -
+            (((end_k != start_k) && m_shadow_map.exists(K{end_k})) ? 1 : 0);
+        ASSERT_EQ(count, (start_k == end_k) ? 0 : excl) << "Exclusive range count mismatch";
+
+        uint64_t n{0};
+        for (auto const& [key, value] : m_shadow_map.map_const()) {
+            K out_key;
+            V out_val;
+            ASSERT_EQ(m_bt->get_nth_entry(n, out_key, &out_val), btree_status_t::success)
+                << "Expected success on get nth entry n=" << n;
+            ASSERT_EQ(out_key.compare(key), 0) << "Nth entry n=" << n << " key=" << out_key << " expected=" << key;
+            ASSERT_EQ(out_val, value) << "Nth entry n=" << n << " doesn't return correct data";
+            ++n;
+        }
+        K out_key;
+        ASSERT_EQ(m_bt->get_nth_entry(n, out_key), btree_status_t::not_found) << "Expected not found past last entry";
+    }
+
     void query_random() {
         static thread_local std::uniform_int_distribution< uint32_t > s_rand_range_generator{1, 100};
 
@@ -246,6 +594,25 @@ public:
         do_query(start_k, end_k, 79);
     }
 
+    // Range count of keys no one else is working on should be exact, even as the writes elsewhere recount their paths
+    void count_random() {
+        static thread_local std::uniform_int_distribution< uint32_t > s_rand_range_generator{1, 100};
+
+        auto const [start_k, end_k] = m_shadow_map.pick_random_non_working_keys(s_rand_range_generator(m_re));
+        uint64_t count;
+        ASSERT_EQ(m_bt->range_count(BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}, count),
+                  btree_status_t::success)
+            << "Expected success on range count";
+        m_shadow_map.guard().lock_shared();
+        auto const expected = m_shadow_map.num_elems_in_range(start_k, end_k);
+        m_shadow_map.guard().unlock_shared();
+        ASSERT_EQ(count, expected) << "Range count mismatch for range " << start_k << "-" << end_k;
+
+        if (start_k < m_max_range_input) {
+            m_shadow_map.remove_keys_from_working(start_k, std::min(end_k, m_max_range_input - 1));
+        }
+    }
+
     ////////////////////// All get operation variants ///////////////////////////////
     void get_all() const {
         m_shadow_map.foreach ([this](K key, V value) {
@@ -274,6 +641,12 @@ public:
         }
     }
 
+    void get_random() {
+        auto const [start_k, end_k] = m_shadow_map.pick_random_non_working_keys(1);
+        get_specific(start_k);
+        if (start_k < m_max_range_input) { m_shadow_map.remove_keys_from_working(start_k, start_k); }
+    }
+
     void get_any(uint32_t start_k, uint32_t end_k) const {
         auto out_k = std::make_unique< K >();
         auto out_v = std::make_unique< V >();
@@ -293,6 +666,28 @@ public:
         }
     }
 
+    void multi_get(std::vector< uint64_t > const& keys) const {
+        std::vector< K > ks;
+        std::vector< V > out_vs(keys.size());
+        ks.reserve(keys.size());
+
+        std::vector< typename BtreeMultiGetRequest< K >::entry_t > entries;
+        for (size_t i{0}; i < keys.size(); ++i) {
+            ks.emplace_back(K{keys[i]});
+            entries.push_back({&ks[i], &out_vs[i]});
+        }
+
+        auto mreq = BtreeMultiGetRequest< K >{std::move(entries)};
+        auto const ret = m_bt->get(mreq);
+        ASSERT_EQ((ret == btree_status_t::success), (mreq.num_not_found() == 0)) << "multi_get status mismatch";
+
+        for (auto const& e : mreq.entries()) {
+            auto const& key = (const K&)*e.m_k;
+            ASSERT_EQ(e.m_found, m_shadow_map.exists(key)) << "multi_get outcome mismatch for key " << key;
+            if (e.m_found) { m_shadow_map.validate_data(key, (const V&)*e.m_outval); }
+        }
+    }
+
     void multi_op_execute(const std::vector< std::pair< std::string, int > >& op_list) {
         preload(SISL_OPTIONS["preload_size"].as< uint32_t >());
         run_in_parallel(op_list);
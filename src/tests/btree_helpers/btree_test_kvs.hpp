@@ -68,6 +68,8 @@ private:
     uint64_t m_key{0};
 
 public:
+    using native_key_t = uint64_t;
+
     TestFixedKey() = default;
     TestFixedKey(uint64_t k) : m_key{k} {}
     TestFixedKey(const TestFixedKey& other) : TestFixedKey(other.serialize(), true) {}
@@ -227,6 +229,20 @@ public:
     bool operator<(const TestVarLenKey& o) const { return (compare(o) < 0); }
     bool operator==(const TestVarLenKey& other) const { return (compare(other) == 0); }
 
+    // Key with the shortest serialized size in [left, right), limiting the candidates to keep the split cheap
+    static TestVarLenKey shortest_separator(TestVarLenKey const& left, TestVarLenKey const& right) {
+        TestVarLenKey sep{left};
+        auto const end = std::min(right.m_key, left.m_key + 16);
+        for (auto k = left.m_key + 1; k < end; ++k) {
+            if (idx_to_key(k)->size() < idx_to_key(sep.m_key)->size()) { sep.m_key = k; }
+        }
+        return sep;
+    }
+
+    // Head of the serialized key, which starts with the key in hex. Only 6 of its 8 hex digits are taken, so that the
+    // heads of every 16 adjacent keys are equal and the ties are broken by comparing the full keys.
+    uint64_t key_head() const { return byte_key_head(sisl::blob{serialize().bytes, 6}); }
+
     uint64_t key() const { return m_key; }
     uint64_t start_key(const BtreeKeyRange< TestVarLenKey >& range) const {
         const TestVarLenKey& k = (const TestVarLenKey&)(range.start_key());
@@ -238,6 +254,67 @@ public:
     }
 };
 
+// String key whose serialized bytes sort in the same order as compare(), e.g. path like keys with long common
+// prefixes.
+class TestStrKey : public BtreeKey {
+private:
+    std::string m_key;
+
+public:
+    TestStrKey() = default;
+    TestStrKey(std::string k) : BtreeKey(), m_key{std::move(k)} {}
+    TestStrKey(const BtreeKey& other) : TestStrKey(other.serialize(), true) {}
+    TestStrKey(const TestStrKey& other) = default;
+    TestStrKey(TestStrKey&& other) = default;
+    TestStrKey& operator=(const TestStrKey& other) = default;
+    TestStrKey& operator=(TestStrKey&& other) = default;
+    TestStrKey(const sisl::blob& b, bool copy) : BtreeKey() { deserialize(b, copy); }
+    virtual ~TestStrKey() = default;
+
+    sisl::blob serialize() const override {
+        return sisl::blob{r_cast< uint8_t* >(const_cast< char* >(m_key.data())), uint32_cast(m_key.size())};
+    }
+    uint32_t serialized_size() const override { return uint32_cast(m_key.size()); }
+    static bool is_fixed_size() { return false; }
+    static uint32_t get_fixed_size() {
+        assert(0);
+        return 0;
+    }
+    static uint32_t get_max_size() { return g_max_keysize; }
+
+    void deserialize(const sisl::blob& b, bool copy) override { m_key.assign(r_cast< const char* >(b.bytes), b.size); }
+
+    int compare(const BtreeKey& o) const override {
+        auto const x = m_key.compare(s_cast< const TestStrKey& >(o).m_key);
+        return (x < 0) ? -1 : ((x > 0) ? 1 : 0);
+    }
+
+    uint64_t key_head() const { return byte_key_head(serialize()); }
+
+    static TestStrKey shortest_separator(TestStrKey const& left, TestStrKey const& right) {
+        return TestStrKey{shortest_byte_separator(left.serialize(), right.serialize())};
+    }
+
+    std::string to_string() const { return m_key; }
+    friend std::ostream& operator<<(std::ostream& os, const TestStrKey& k) {
+        os << k.to_string();
+        return os;
+    }
+
+    bool operator<(const TestStrKey& o) const { return (compare(o) < 0); }
+    bool operator==(const TestStrKey& other) const { return (compare(other) == 0); }
+
+    std::string const& key() const { return m_key; }
+};
+
+// Same as TestStrKey, but without the separator shortening (shortest_separator() of the base returns a TestStrKey and
+// hence is not detected for this type), to compare against.
+class TestStrKeyFullSeparator : public TestStrKey {
+public:
+    using TestStrKey::TestStrKey;
+    TestStrKeyFullSeparator() = default;
+};
+
 class TestIntervalKey : public BtreeIntervalKey {
 private:
 #pragma pack(1)
@@ -397,6 +474,11 @@ public:
 
     uint32_t value() const { return m_val; }
 
+    // Merge operator used to test merge puts, accumulates the operand like a counter
+    static TestFixedValue merge(TestFixedValue const& existing, TestFixedValue const& operand) {
+        return TestFixedValue{existing.m_val + operand.m_val};
+    }
+
 private:
     uint32_t m_val;
 };
@@ -446,6 +528,15 @@ public:
 
     std::string value() const { return m_val; }
 
+    // Merge operator used to test merge puts, mixes the existing value into the operand, retaining the operand size
+    static TestVarLenValue merge(TestVarLenValue const& existing, TestVarLenValue const& operand) {
+        std::string merged{operand.m_val};
+        for (size_t i{0}; !existing.m_val.empty() && (i < merged.size()); ++i) {
+            merged[i] = 'a' + ((merged[i] + existing.m_val[i % existing.m_val.size()]) % 26);
+        }
+        return TestVarLenValue{merged};
+    }
+
 private:
     std::string m_val;
 };
@@ -24,6 +24,24 @@ public:
         m_range_scheduler.put_key(key.key());
     }
 
+    void merge(const K& key, const V& operand) {
+        std::lock_guard lock{m_mutex};
+        auto it = m_map.find(key);
+        if (it == m_map.end()) {
+            m_map.insert(std::make_pair(key, operand));
+            m_range_scheduler.put_key(key.key());
+        } else {
+            it->second = V::merge(it->second, operand);
+        }
+    }
+
+    void range_merge(const K& start_key, const K& end_key, const V& operand) {
+        std::lock_guard lock{m_mutex};
+        for (auto it = m_map.lower_bound(start_key); (it != m_map.end()) && (it->first.compare(end_key) <= 0); ++it) {
+            it->second = V::merge(it->second, operand);
+        }
+    }
+
     void range_upsert(uint64_t start_k, uint32_t count, const V& val) {
         std::lock_guard lock{m_mutex};
         for (uint32_t i{0}; i < count; ++i) {
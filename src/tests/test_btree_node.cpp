@@ -21,6 +21,7 @@
 #include <homestore/btree/detail/simple_node.hpp>
 #include <homestore/btree/detail/varlen_node.hpp>
 #include <homestore/btree/detail/prefix_node.hpp>
+#include <homestore/btree/detail/compact_node.hpp>
 #include "btree_helpers/btree_test_kvs.hpp"
 
 static constexpr uint32_t g_node_size{4096};
@@ -60,6 +61,12 @@ struct PrefixIntervalBtreeTest {
     using ValueType = TestIntervalValue;
 };
 
+struct CompactNodeTest {
+    using NodeType = CompactNode< TestVarLenKey, TestVarLenValue >;
+    using KeyType = TestVarLenKey;
+    using ValueType = TestVarLenValue;
+};
+
 template < typename TestType >
 struct NodeTest : public testing::Test {
     using T = TestType;
@@ -293,6 +300,16 @@ struct NodeTest : public testing::Test {
             << "Node key " << k << " is incorrect presence compared to shadow map";
     }
 
+    void validate_find(uint32_t k) const {
+        K key{k};
+        auto const [found, idx] = m_node1->find(key, nullptr, false);
+        auto const it = m_shadow_map.lower_bound(key);
+        ASSERT_EQ(found, ((it != m_shadow_map.end()) && (it->first == key)))
+            << "Node find of key " << k << " presence is incorrect compared to shadow map";
+        ASSERT_EQ(idx, uint32_cast(std::distance(m_shadow_map.begin(), it)))
+            << "Node find of key " << k << " didn't return the lower bound index";
+    }
+
     void validate_key_order() const {
         ASSERT_EQ(this->m_node1->template validate_key_order< K >(), true)
             << "Key order validation of node1 has failed";
@@ -325,7 +342,7 @@ private:
 };
 
 using NodeTypes = testing::Types< FixedLenNodeTest, VarKeySizeNodeTest, VarValueSizeNodeTest, VarObjSizeNodeTest,
-                                  PrefixIntervalBtreeTest >;
+                                  PrefixIntervalBtreeTest, CompactNodeTest >;
 TYPED_TEST_SUITE(NodeTest, NodeTypes);
 
 TYPED_TEST(NodeTest, SequentialInsert) {
@@ -350,6 +367,17 @@ TYPED_TEST(NodeTest, ReverseInsert) {
     this->validate_get_any(98, 102);
 }
 
+TYPED_TEST(NodeTest, FindLowerBound) {
+    this->validate_find(0);
+    uint32_t i{1};
+    for (; (i < 200 && this->has_room()); i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t k{0}; k <= i + 1; ++k) {
+        this->validate_find(k);
+    }
+}
+
 TYPED_TEST(NodeTest, Remove) {
     this->put_list({0, 1, 2, g_max_keys / 2, g_max_keys / 2 + 1, g_max_keys / 2 - 1});
     this->remove(0);
@@ -456,6 +484,79 @@ TYPED_TEST(NodeTest, Move) {
     this->validate_key_order();
 }
 
+TEST(CompactNode, FrontCodedDensity) {
+    BtreeConfig cfg{g_node_size};
+    cfg.set_node_data_size(cfg.node_size() - sizeof(persistent_hdr_t));
+    auto var_buf = std::unique_ptr< uint8_t[] >(new uint8_t[g_node_size]);
+    auto compact_buf = std::unique_ptr< uint8_t[] >(new uint8_t[g_node_size]);
+    VarKeySizeNode< TestStrKey, TestFixedValue > var_node{var_buf.get(), 1ul, true, true, cfg};
+    CompactNode< TestStrKey, TestFixedValue > compact_node{compact_buf.get(), 2ul, true, true, cfg};
+
+    // Path like keys of an index share most of their leading bytes, which compact node stores only once per restart
+    // point
+    const auto path_key = [](uint32_t k) {
+        return TestStrKey{fmt::format("/volumes/vol-0042/snapshots/snap-0007/blocks/{:012}", k)};
+    };
+    const auto fill = [&path_key](auto& node) {
+        uint32_t k{0};
+        while (true) {
+            auto const key = path_key(k);
+            TestFixedValue val{TestFixedValue::generate_rand()};
+            if (!node.has_room_for_put(btree_put_type::INSERT, key.serialized_size(), val.serialized_size())) { break; }
+            if (!node.put(key, val, btree_put_type::INSERT, nullptr)) { break; }
+            ++k;
+        }
+        return k;
+    };
+    auto const var_count = fill(var_node);
+    auto const compact_count = fill(compact_node);
+    auto const ratio = static_cast< double >(compact_count) / var_count;
+    LOGINFO("Entries in a {} byte node: var_key={} compact={} ratio={:.2f}", g_node_size, var_count, compact_count,
+            ratio);
+    ASSERT_GE(ratio, 2.0) << "Compact node is expected to hold at least twice the entries of var key node, but holds "
+                          << compact_count << " vs " << var_count;
+
+    for (uint32_t k{0}; k < compact_count; ++k) {
+        auto const key = path_key(k);
+        auto const [found, idx] = compact_node.find(key, nullptr, false);
+        ASSERT_TRUE(found) << "Key " << key << " not found in compact node";
+        ASSERT_EQ(idx, k) << "Key " << key << " found in unexpected index";
+        ASSERT_EQ(compact_node.get_nth_key< TestStrKey >(idx, false).key(), key.key()) << "Reconstructed key mismatch";
+    }
+
+    // Remove every other entry and put them back. The restart points are chosen afresh on every encode, so the node
+    // should hold the same number of entries as before.
+    for (uint32_t k{0}; k < compact_count / 2; ++k) {
+        ASSERT_EQ(compact_node.remove(k), btree_status_t::success) << "Remove failed for index " << k;
+    }
+    for (uint32_t k{0}; k < compact_count / 2; ++k) {
+        auto const key = path_key(2 * k);
+        ASSERT_TRUE(compact_node.put(key, TestFixedValue{TestFixedValue::generate_rand()}, btree_put_type::INSERT,
+                                     nullptr))
+            << "Unable to put back key " << key;
+    }
+    ASSERT_EQ(compact_node.total_entries(), compact_count) << "Compact node lost room after remove and re-insert";
+    ASSERT_FALSE(compact_node.to_string_keys().empty()) << "Expected keys to be printed";
+}
+
+TEST(SeparatorKey, ShortestByteSeparator) {
+    auto const sep = [](std::string const& l, std::string const& r) {
+        return shortest_byte_separator(sisl::blob{r_cast< const uint8_t* >(l.data()), uint32_cast(l.size())},
+                                       sisl::blob{r_cast< const uint8_t* >(r.data()), uint32_cast(r.size())});
+    };
+    ASSERT_EQ(sep("abcxyz", "abezz"), "abd") << "Expected truncated separator between differing bytes";
+    ASSERT_EQ(sep("abcxyz", "abdzz"), "abcxyz") << "No room to increment, left key itself is the separator";
+    ASSERT_EQ(sep("abc", "abcdef"), "abc") << "Left key being prefix of right is the shortest separator";
+    ASSERT_EQ(sep("abc", "abe"), "abc") << "Incremented byte is not shorter than left key";
+
+    for (auto const& [l, r] : std::vector< std::pair< std::string, std::string > >{
+             {"apple_pie_recipe", "banana_bread"}, {"key0001234", "key0009"}, {"zz\xff", "zz\xff\x01"}}) {
+        auto const s = sep(l, r);
+        ASSERT_LE(l, s) << "Separator " << s << " is less than left key " << l;
+        ASSERT_LT(s, r) << "Separator " << s << " is not less than right key " << r;
+    }
+}
+
 SISL_OPTIONS_ENABLE(logging, test_btree_node)
 SISL_OPTION_GROUP(test_btree_node,
                   (num_iters, "", "num_iters", "number of iterations for rand ops",
@@ -13,10 +13,13 @@
  * specific language governing permissions and limitations under the License.
  *
  *********************************************************************************/
+#include <map>
+
 #include <gtest/gtest.h>
 #include <boost/uuid/random_generator.hpp>
 
 #include <sisl/utility/enum.hpp>
+#include <homestore/index/index_snapshot.hpp>
 #include "common/homestore_config.hpp"
 #include "common/resource_mgr.hpp"
 #include "test_common/homestore_test_common.hpp"
@@ -63,7 +66,15 @@ struct BtreeTest : public BtreeTestHelper< TestType >, public ::testing::Test {
         std::shared_ptr< IndexTableBase > on_index_table_found(superblk< index_table_sb >&& sb) override {
             LOGINFO("Index table recovered");
             LOGINFO("Root bnode_id {} version {}", sb->root_node, sb->link_version);
-            m_test->m_bt = std::make_shared< typename T::BtreeType >(std::move(sb), m_test->m_cfg);
+            // Node layouts (subtree counts, key heads, message buffers) are fixed at creation, so take them from the
+            // superblock found
+            auto cfg = m_test->m_cfg;
+            cfg.m_subtree_counts_turned_on = (sb->subtree_counted != 0);
+            cfg.m_key_heads_turned_on = (sb->key_heads != 0);
+            cfg.m_msg_buffer_size = sb->msg_buffer_size;
+            auto const uuid = sb->uuid;
+            m_test->m_bt = std::make_shared< typename T::BtreeType >(std::move(sb), cfg);
+            m_test->m_recovered_tables[uuid] = m_test->m_bt;
             return m_test->m_bt;
         }
 
@@ -105,12 +116,28 @@ struct BtreeTest : public BtreeTestHelper< TestType >, public ::testing::Test {
     }
 
     void restart_homestore() {
+        m_recovered_tables.clear();
         test_common::HSTestHelper::start_homestore(
             "test_index_btree",
             {{HS_SERVICE::META, {}}, {HS_SERVICE::INDEX, {.index_svc_cbs = new TestIndexServiceCallbacks(this)}}},
             nullptr, true /* restart */);
     }
 
+    // Replaces the table created by SetUp with one created with the config the test has set in m_cfg. Table of SetUp
+    // is destroyed along with its superblock, so that it is neither written to nor recovered upon restart.
+    uuid_t recreate_btree() {
+        hs()->index_service().remove_index_table(this->m_bt);
+        this->m_bt->destroy();
+        this->m_bt->mutable_super_blk().destroy();
+        this->m_bt.reset();
+
+        auto const uuid = boost::uuids::random_generator()();
+        this->m_bt =
+            std::make_shared< typename T::BtreeType >(uuid, boost::uuids::random_generator()(), 0, this->m_cfg);
+        hs()->index_service().add_index_table(this->m_bt);
+        return uuid;
+    }
+
     void destroy_btree() {
         auto cpg = hs()->cp_mgr().cp_guard();
         auto op_context = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
@@ -118,6 +145,8 @@ struct BtreeTest : public BtreeTestHelper< TestType >, public ::testing::Test {
         ASSERT_EQ(ret, btree_status_t::success) << "btree destroy failed";
         this->m_bt.reset();
     }
+
+    std::map< uuid_t, std::shared_ptr< typename T::BtreeType > > m_recovered_tables;
 };
 
 using BtreeTypes = testing::Types< FixedLenBtree, VarKeySizeBtree, VarValueSizeBtree, VarObjSizeBtree >;
@@ -255,6 +284,522 @@ TYPED_TEST(BtreeTest, RangeUpdate) {
     LOGINFO("RangeUpdate test end");
 }
 
+TYPED_TEST(BtreeTest, RangeRemoveDropSubtrees) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush the cp", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    auto const nodes_before = this->m_bt->get_btree_node_cnt();
+    auto const free_blks_before = hs()->resource_mgr().cur_free_blk_cnt();
+
+    LOGINFO("Step 2: Remove the middle range which covers whole subtrees, from a tree of {} nodes", nodes_before);
+    this->range_remove_any(num_entries / 8, num_entries - num_entries / 8);
+    this->get_all();
+    this->query_all();
+    auto const nodes_after = this->m_bt->get_btree_node_cnt();
+    LOGINFO("After range remove btree has {} nodes", nodes_after);
+    if (nodes_before > 4) { ASSERT_LT(nodes_after, nodes_before); }
+
+    // Dropped subtrees are freed in background by their node ids, blocks of all the unlinked nodes are freed
+    auto const freed_blks = [free_blks_before]() { return hs()->resource_mgr().cur_free_blk_cnt() - free_blks_before; };
+    for (uint32_t i{0}; (i < 100) && (freed_blks() < int64_t(nodes_before - nodes_after)); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_GE(freed_blks(), int64_t(nodes_before - nodes_after)) << "Nodes of the dropped subtrees are not freed";
+
+    LOGINFO("Step 3: Reinsert into the dropped range, flush the cp and validate after restart");
+    for (uint32_t i{num_entries / 4}; i < num_entries / 2; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    this->print(std::string("before.txt"));
+
+    this->destroy_btree();
+    this->restart_homestore();
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    this->print(std::string("after.txt"));
+    this->compare_files("before.txt", "after.txt");
+    this->do_query(0, num_entries - 1, 1000);
+}
+
+TYPED_TEST(BtreeTest, DestroyInBackground) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries and flush the cp", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    auto const num_nodes = this->m_bt->get_btree_node_cnt();
+    auto const free_blks_before = hs()->resource_mgr().cur_free_blk_cnt();
+    LOGINFO("Step 2: Destroy the index of {} nodes, which frees the nodes by their ids on the cp io fibers", num_nodes);
+    this->m_bt->destroy();
+    ASSERT_EQ(hs()->resource_mgr().cur_free_blk_cnt() - free_blks_before, int64_t(num_nodes))
+        << "Not all the node blocks are freed";
+
+    LOGINFO("Step 3: Flush the cp with the freed blocks and destroy again, which should be a no-op");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    auto const free_blks_after = hs()->resource_mgr().cur_free_blk_cnt();
+    this->m_bt->destroy();
+    ASSERT_EQ(hs()->resource_mgr().cur_free_blk_cnt(), free_blks_after) << "Destroyed index freed blocks again";
+}
+
+TYPED_TEST(BtreeTest, DeferredMerges) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index which defers the merges, insert {} entries and flush the cp", num_entries);
+    this->m_cfg.m_max_deferred_merges = 1000;
+    this->m_cfg.m_merge_fill_pct = 70;
+    this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    LOGINFO("Step 2: Remove 7 of every 8 entries, deferring the merges of the leaves left underfull");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        if (i % 8 != 0) { this->remove_one(i); }
+    }
+    ASSERT_GT(this->m_bt->deferred_merges_count(), 0u) << "Expected the removes to defer the merges";
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 3: Flush the cp, whose switchover applies the deferred merges on the rebalance fiber");
+    auto const num_nodes = this->m_bt->get_btree_node_cnt();
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    auto const merges_pending = [this]() {
+        return this->m_bt->is_rebalancing() || (this->m_bt->deferred_merges_count() != 0);
+    };
+    for (uint32_t i{0}; (i < 500) && merges_pending(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_EQ(this->m_bt->deferred_merges_count(), 0u) << "Deferred merges are not applied after cp switchover";
+    ASSERT_LT(this->m_bt->get_btree_node_cnt(), num_nodes) << "Deferred merges didn't merge any leaves";
+    this->get_all();
+    this->query_all_paginate(80);
+
+    LOGINFO("Step 4: Flush the merges and reinsert the removed entries into the merged leaves");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        if (i % 8 != 0) { this->put(i, btree_put_type::INSERT); }
+    }
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 5: Defer the merges again and destroy the index while they are being applied");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        if (i % 8 != 0) { this->remove_one(i); }
+    }
+    test_common::HSTestHelper::trigger_cp(false /* wait */);
+    this->m_bt->destroy();
+    ASSERT_FALSE(this->m_bt->is_rebalancing()) << "Destroy returned with the deferred merges still being applied";
+}
+
+TYPED_TEST(BtreeTest, BulkLoadCpFlush) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Bulk load {} entries as part of a single cp", num_entries);
+    {
+        auto cpg = hs()->cp_mgr().cp_guard();
+        this->bulk_load(0, num_entries - 1, 80, (void*)cpg.context(cp_consumer_t::INDEX_SVC));
+    }
+    this->get_all();
+
+    LOGINFO("Step 2: Flush the cp, which writes the children ahead of their parents as chained by the loader");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    this->print(std::string("before.txt"));
+
+    LOGINFO("Step 3: Restart homestore and validate the recovered btree");
+    this->restart_homestore();
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    this->print(std::string("after.txt"));
+    this->get_all();
+    this->do_query(0, num_entries - 1, 1000);
+    this->compare_files("before.txt", "after.txt");
+}
+
+TYPED_TEST(BtreeTest, SubtreeCounts) {
+    if constexpr ((TestFixture::T::interior_node_type != btree_node_type::FIXED) &&
+                  (TestFixture::T::interior_node_type != btree_node_type::VAR_KEY)) {
+        GTEST_SKIP() << "Subtree counts are not supported for this interior node type";
+    }
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index with subtree counts, insert {} entries and remove every third", num_entries);
+    this->m_cfg.m_subtree_counts_turned_on = true;
+    auto const uuid = this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t i{0}; i < num_entries; i += 3) {
+        this->remove_one(i);
+    }
+    this->validate_counts(0, num_entries - 1);
+
+    LOGINFO("Step 2: Flush the cp and restart, the recovered counts should match the entries");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    this->restart_homestore();
+    ASSERT_EQ(this->m_recovered_tables.count(uuid), 1u) << "Index with subtree counts is not recovered";
+    this->m_bt = this->m_recovered_tables[uuid];
+    this->validate_counts(0, num_entries - 1);
+    this->get_all();
+
+    LOGINFO("Step 3: Counts keep up with writes after recovery");
+    for (uint32_t i{0}; i < num_entries; i += 3) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->validate_counts(0, num_entries - 1);
+}
+
+TYPED_TEST(BtreeTest, MessageBuffers) {
+    if constexpr ((TestFixture::T::interior_node_type != btree_node_type::FIXED) &&
+                  (TestFixture::T::interior_node_type != btree_node_type::VAR_KEY)) {
+        GTEST_SKIP() << "Message buffers are supported only on fixed and variable key size interior nodes";
+    }
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index with message buffers, insert {} entries and remove every third", num_entries);
+    this->m_cfg.m_msg_buffer_size = this->m_cfg.node_size() / 4;
+    auto const uuid = this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t i{0}; i < num_entries; i += 3) {
+        this->remove_one(i);
+    }
+    this->get_all();
+
+    LOGINFO("Step 2: Flush the cp, snapshot of it should see the writes still buffered in the interior nodes");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    {
+        using K = typename TestFixture::K;
+        using V = typename TestFixture::V;
+        IndexSnapshot< K, V > snap{*this->m_bt};
+        ASSERT_EQ(snap.open(), btree_status_t::success) << "Expected snapshot to open with no cp flush in progress";
+        std::vector< std::pair< K, V > > out_vector;
+        ASSERT_EQ(snap.query(BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}, out_vector),
+                  btree_status_t::success)
+            << "Expected success on snapshot query";
+        auto const& expected = this->m_shadow_map.map_const();
+        ASSERT_EQ(out_vector.size(), expected.size()) << "Snapshot doesn't return all the keys";
+        auto it = expected.begin();
+        for (auto const& [k, v] : out_vector) {
+            ASSERT_EQ(k.compare(it->first), 0) << "Snapshot returned key=" << k << " expected key=" << it->first;
+            ASSERT_EQ(v, it->second) << "Snapshot doesn't return correct data for key=" << k;
+            ++it;
+        }
+        V val;
+        ASSERT_EQ(snap.get(K{0}, val), btree_status_t::not_found) << "Snapshot sees the removed key";
+        ASSERT_EQ(snap.get(K{1}, val), btree_status_t::success) << "Snapshot doesn't see the inserted key";
+        ASSERT_EQ(val, expected.at(K{1})) << "Snapshot doesn't return correct data for key=1";
+    }
+
+    LOGINFO("Step 3: Restart, the buffered writes should be recovered along with their nodes");
+    this->restart_homestore();
+    ASSERT_EQ(this->m_recovered_tables.count(uuid), 1u) << "Index with message buffers is not recovered";
+    this->m_bt = this->m_recovered_tables[uuid];
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 4: Writes after recovery are buffered and flushed down as before");
+    for (uint32_t i{0}; i < num_entries; i += 3) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t i{1}; i < num_entries; i += 3) {
+        this->remove_one(i);
+    }
+    this->get_all();
+    this->query_all();
+}
+
+TYPED_TEST(BtreeTest, UpgradeLocks) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index with upgrade locks, insert {} entries splitting the leaves", num_entries);
+    this->m_cfg.m_upgrade_locks_turned_on = true;
+    this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all();
+
+    // Leaves written by the inserts are in the wb cache, so they are peeked at to upgrade lock their parents
+    auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+    auto const upgrades =
+        counters["number of upgrade locks taken on parents of leaves to change"].template get< uint64_t >();
+    auto const write_ops = counters["number of btree operations"].template get< uint64_t >();
+    LOGINFO("Upgrade locks taken={} across {} operations", upgrades, write_ops);
+    ASSERT_GT(upgrades, 0u) << "Cached leaves are not peeked at to upgrade lock their parents";
+    ASSERT_LT(upgrades, write_ops) << "Upgrade locks are taken by writes not changing the leaves";
+}
+
+TYPED_TEST(BtreeTest, BloomFilter) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index with bloom filter sized for {} keys and insert every other key", num_entries / 4);
+    this->m_cfg.m_bloom_filter_keys = num_entries / 4;
+    this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Lookup all keys, while the filter which has outgrown its size is rebuilt in background");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->get_specific(i);
+    }
+    while (this->m_bt->is_bloom_filter_rebuilding()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_EQ(this->m_bt->is_bloom_filter_ready(), true) << "Bloom filter is not ready after rebuild";
+
+    LOGINFO("Step 3: Lookup all keys again, missing keys are answered by the rebuilt filter");
+    auto const filtered_before = this->m_bt->bloom_filtered_count();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->get_specific(i);
+    }
+    ASSERT_GT(this->m_bt->bloom_filtered_count(), filtered_before) << "Bloom filter didn't answer any missing key";
+
+    LOGINFO("Step 4: Remove some keys, reinsert the others and validate");
+    for (uint32_t i{0}; i < num_entries; i += 8) {
+        this->remove_one(i);
+    }
+    for (uint32_t i{1}; i < num_entries; i += 4) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 5: Range merge only modifies the existing keys, which should leave the filter usable");
+    while (this->m_bt->is_bloom_filter_rebuilding()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    ASSERT_EQ(this->m_bt->is_bloom_filter_ready(), true) << "Bloom filter is not ready before range merge";
+    this->range_merge(0, num_entries / 2);
+    ASSERT_EQ(this->m_bt->is_bloom_filter_ready(), true) << "Range merge invalidated the bloom filter";
+    this->get_all();
+}
+
+TYPED_TEST(BtreeTest, BloomFilterRebuildAfterRecovery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Create an index with bloom filter, insert every other key and flush the cp");
+    this->m_cfg.m_bloom_filter_keys = num_entries / 2;
+    auto const uuid = this->recreate_btree();
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    auto const wait_for_rebuild = [this]() {
+        auto& bt = *this->m_bt;
+        for (uint32_t i{0}; (i < 500) && (bt.is_bloom_filter_rebuilding() || !bt.is_bloom_filter_ready()); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    };
+
+    LOGINFO("Step 2: Restart, the recovered index has no filter till it is rebuilt and lookups are not filtered");
+    this->restart_homestore();
+    ASSERT_EQ(this->m_recovered_tables.count(uuid), 1u) << "Index with bloom filter is not recovered";
+    this->m_bt = this->m_recovered_tables[uuid];
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    auto const filtered_before = this->m_bt->bloom_filtered_count();
+    if (!this->m_bt->is_bloom_filter_ready()) {
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            this->get_specific(i);
+        }
+    }
+    ASSERT_EQ(this->m_bt->bloom_filtered_count(), filtered_before) << "Lookups filtered before filter is rebuilt";
+
+    LOGINFO("Step 3: Cp switchover rebuilds the filter of the index in background, without any writes to it");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    wait_for_rebuild();
+    ASSERT_EQ(this->m_bt->is_bloom_filter_ready(), true) << "Bloom filter is not rebuilt after recovery";
+
+    LOGINFO("Step 4: Lookup all keys, missing keys are answered by the rebuilt filter");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->get_specific(i);
+    }
+    ASSERT_GT(this->m_bt->bloom_filtered_count(), filtered_before) << "Bloom filter didn't answer any missing key";
+
+    LOGINFO("Step 5: Range remove all the keys, which leaves the filter with too many stale keys to be rebuilt");
+    this->range_remove_any(0, num_entries - 1);
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    wait_for_rebuild();
+    auto const filtered_after = this->m_bt->bloom_filtered_count();
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->get_specific(i);
+    }
+    ASSERT_EQ(this->m_bt->bloom_filtered_count() - filtered_after, num_entries)
+        << "Bloom filter is not rebuilt after the range remove";
+}
+
+TYPED_TEST(BtreeTest, SnapshotScan) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+
+    LOGINFO("Step 1: Insert {} entries, remove some of them and flush the cp", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t i{0}; i < num_entries; i += 10) {
+        this->remove_one(i);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    auto const cp_map = this->m_shadow_map.map_const();
+
+    auto validate_snapshot = [](IndexSnapshot< K, V > const& snap, std::map< K, V > const& expected, uint32_t start_k,
+                                uint32_t end_k) {
+        std::vector< std::pair< K, V > > out_vector;
+        ASSERT_EQ(snap.query(BtreeKeyRange< K >{K{start_k}, true, K{end_k}, true}, out_vector),
+                  btree_status_t::success)
+            << "Expected success on snapshot query";
+
+        auto it = expected.lower_bound(K{start_k});
+        for (auto const& [k, v] : out_vector) {
+            ASSERT_NE(it, expected.end()) << "Snapshot returned unexpected key=" << k;
+            ASSERT_EQ(k.compare(it->first), 0) << "Snapshot returned key=" << k << " expected key=" << it->first;
+            ASSERT_EQ(v, it->second) << "Snapshot doesn't return correct data for key=" << k;
+            ++it;
+        }
+        ASSERT_TRUE((it == expected.end()) || (it->first.compare(K{end_k}) > 0))
+            << "Snapshot didn't return all the keys in range " << start_k << "-" << end_k;
+    };
+
+    LOGINFO("Step 2: Open snapshot and write more entries, which the snapshot shouldn't see");
+    IndexSnapshot< K, V > snap{*this->m_bt};
+    ASSERT_EQ(snap.open(), btree_status_t::success) << "Expected snapshot to open with no cp flush in progress";
+    for (uint32_t i{0}; i < num_entries; i += 10) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    for (uint32_t i{1}; i < num_entries; i += 3) {
+        this->remove_one(i);
+    }
+    this->range_put(num_entries / 4, num_entries / 2, V::generate_rand(), true /* update */);
+    validate_snapshot(snap, cp_map, 0, num_entries - 1);
+    validate_snapshot(snap, cp_map, num_entries / 3, num_entries / 2);
+
+    V val;
+    ASSERT_EQ(snap.get(K{10}, val), btree_status_t::not_found) << "Snapshot sees the key inserted after the cp";
+    ASSERT_EQ(snap.get(K{11}, val), btree_status_t::success) << "Snapshot doesn't see the key removed after the cp";
+    ASSERT_EQ(val, cp_map.at(K{11})) << "Snapshot doesn't return correct data for key=11";
+
+    LOGINFO("Step 3: Trigger cp while snapshot is open, its flush is deferred and snapshot view stays the same");
+    test_common::HSTestHelper::trigger_cp(false /* wait */);
+    for (uint32_t i{2}; i < num_entries; i += 7) {
+        this->remove_one(i);
+    }
+    validate_snapshot(snap, cp_map, 0, num_entries - 1);
+    this->get_all();
+
+    LOGINFO("Step 4: Close the snapshot and flush, the new snapshot sees all the writes");
+    snap.close();
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    ASSERT_EQ(snap.open(), btree_status_t::success) << "Expected snapshot to open with no cp flush in progress";
+    validate_snapshot(snap, this->m_shadow_map.map_const(), 0, num_entries - 1);
+
+    LOGINFO("Step 5: Snapshot left open holds back the cp flush only till the max pin time, then it is invalidated");
+    HS_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.generic.index_snapshot_max_pin_ms = 100;
+        HS_SETTINGS_FACTORY().save();
+    });
+    for (uint32_t i{3}; i < num_entries; i += 11) {
+        this->remove_one(i);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    std::vector< std::pair< K, V > > out_vector;
+    ASSERT_EQ(snap.query(BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}, out_vector),
+              btree_status_t::cp_mismatch)
+        << "Expected the snapshot to be invalidated by the cp flush";
+    ASSERT_EQ(snap.get(K{0}, val), btree_status_t::cp_mismatch) << "Expected the snapshot to be invalidated";
+    snap.close();
+    HS_SETTINGS_FACTORY().modifiable_settings([](auto& s) {
+        s.generic.index_snapshot_max_pin_ms = 10000;
+        HS_SETTINGS_FACTORY().save();
+    });
+
+    ASSERT_EQ(snap.open(), btree_status_t::success) << "Expected snapshot to reopen after the flush";
+    validate_snapshot(snap, this->m_shadow_map.map_const(), 0, num_entries - 1);
+    snap.close();
+    this->query_all();
+}
+
+TYPED_TEST(BtreeTest, BlinkSplitUnlinkedCp) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+
+    LOGINFO("Step 1: Create an index with B-link splits, insert {} entries and flush the cp", num_entries);
+    this->m_cfg.m_blink_splits_turned_on = true;
+    auto bt = std::make_shared< UnlinkedSplitBtree< K, V, IndexTable > >(
+        boost::uuids::random_generator()(), boost::uuids::random_generator()(), 0, this->m_cfg);
+    hs()->index_service().add_index_table(bt);
+    this->m_bt = bt;
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+
+    LOGINFO("Step 2: Split the middle leaf unlinked, which has no parent to order its right node before");
+    BtreeNodePtr left;
+    BtreeNodePtr right;
+    {
+        auto cpg = hs()->cp_mgr().cp_guard();
+        auto cp_ctx = (void*)cpg.context(cp_consumer_t::INDEX_SVC);
+        ASSERT_EQ(bt->split_leaf_unlinked(K{num_entries / 2}, cp_ctx, &left, &right), btree_status_t::success)
+            << "Unable to split the leaf of key " << num_entries / 2;
+    }
+    auto const right_first_k = uint32_cast(right->template get_first_key< K >().key());
+    auto const right_last_k = uint32_cast(right->template get_last_key< K >().key());
+    IndexBufferPtr const left_buf = IndexBtreeNode::convert(left.get())->m_idx_buf;
+    IndexBufferPtr const right_buf = IndexBtreeNode::convert(right.get())->m_idx_buf;
+    left.reset();
+    right.reset();
+
+    // Left node links the right node, hence the right node has to reach the device first
+    ASSERT_EQ(right_buf->m_next_buffer.lock(), left_buf) << "Left node is not flushed after its new right node";
+    ASSERT_FALSE(left_buf->m_wait_for_leaders.testz()) << "Left node doesn't wait for its new right node to flush";
+    ASSERT_EQ(left_buf->m_next_buffer.lock(), nullptr) << "Left node is chained to a parent it isn't linked from";
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Split is linked to the parent already";
+
+    LOGINFO("Step 3: Flush the cp with the split unlinked, snapshot of the cp reaches the right node {}-{} through "
+            "the left node",
+            right_first_k, right_last_k);
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Cp flush is not expected to link the split";
+    auto const validate_snapshot = [&]() {
+        IndexSnapshot< K, V > snap{*bt};
+        ASSERT_EQ(snap.open(), btree_status_t::success) << "Expected snapshot to open with no cp flush in progress";
+        std::vector< std::pair< K, V > > out_vector;
+        ASSERT_EQ(snap.query(BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}, out_vector),
+                  btree_status_t::success)
+            << "Expected success on snapshot query";
+        auto const& expected = this->m_shadow_map.map_const();
+        ASSERT_EQ(out_vector.size(), expected.size()) << "Snapshot returned incorrect number of entries";
+        auto it = expected.begin();
+        for (auto const& [k, v] : out_vector) {
+            ASSERT_EQ(k.compare(it->first), 0) << "Snapshot returned key=" << k << " expected key=" << it->first;
+            ASSERT_EQ(v, it->second) << "Snapshot doesn't return correct data for key=" << k;
+            ++it;
+        }
+        V val;
+        ASSERT_EQ(snap.get(K{right_last_k}, val), btree_status_t::success) << "Snapshot misses key=" << right_last_k;
+        ASSERT_EQ(val, expected.at(K{right_last_k})) << "Snapshot doesn't return correct data for key=" << right_last_k;
+    };
+    validate_snapshot();
+
+    LOGINFO("Step 4: Read through the unlinked split, then remove from its right node, which links it");
+    this->get_all();
+    this->do_query(right_first_k - 3, right_last_k + 3, 4);
+    this->do_reverse_query(right_first_k - 3, right_last_k + 3, 4);
+    this->cursor_query(right_first_k, right_last_k, 0);
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Reads are not expected to link the split";
+    this->remove_one(right_first_k + 1);
+    ASSERT_FALSE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Remove didn't link the split";
+
+    LOGINFO("Step 5: Flush the cp with the split linked and validate the snapshot again");
+    test_common::HSTestHelper::trigger_cp(true /* wait */);
+    validate_snapshot();
+    this->get_all();
+    this->query_all();
+}
+
 TYPED_TEST(BtreeTest, CpFlush) {
     LOGINFO("CpFlush test start");
 
@@ -420,7 +965,15 @@ struct BtreeConcurrentTest : public BtreeTestHelper< TestType >, public ::testin
         std::shared_ptr< IndexTableBase > on_index_table_found(superblk< index_table_sb >&& sb) override {
             LOGINFO("Index table recovered");
             LOGINFO("Root bnode_id {} version {}", sb->root_node, sb->link_version);
-            m_test->m_bt = std::make_shared< typename T::BtreeType >(std::move(sb), m_test->m_cfg);
+            // Node layouts (subtree counts, key heads, message buffers) are fixed at creation, so take them from the
+            // superblock found
+            auto cfg = m_test->m_cfg;
+            cfg.m_subtree_counts_turned_on = (sb->subtree_counted != 0);
+            cfg.m_key_heads_turned_on = (sb->key_heads != 0);
+            cfg.m_msg_buffer_size = sb->msg_buffer_size;
+            auto const uuid = sb->uuid;
+            m_test->m_bt = std::make_shared< typename T::BtreeType >(std::move(sb), cfg);
+            m_test->m_recovered_tables[uuid] = m_test->m_bt;
             return m_test->m_bt;
         }
 
@@ -460,6 +1013,8 @@ struct BtreeConcurrentTest : public BtreeTestHelper< TestType >, public ::testin
         BtreeTestHelper< TestType >::TearDown();
         test_common::HSTestHelper::shutdown_homestore();
     }
+
+    std::map< uuid_t, std::shared_ptr< typename T::BtreeType > > m_recovered_tables;
 };
 
 TYPED_TEST_SUITE(BtreeConcurrentTest, BtreeTypes);
@@ -15,6 +15,7 @@
 #include <random>
 #include <map>
 #include <memory>
+#include <thread>
 #include <gtest/gtest.h>
 #include <iomgr/io_environment.hpp>
 #include <sisl/options/options.h>
@@ -90,6 +91,14 @@ struct PrefixIntervalBtreeTest {
     static constexpr btree_node_type interior_node_type = btree_node_type::FIXED;
 };
 
+struct CompactBtreeTest {
+    using BtreeType = MemBtree< TestVarLenKey, TestVarLenValue >;
+    using KeyType = TestVarLenKey;
+    using ValueType = TestVarLenValue;
+    static constexpr btree_node_type leaf_node_type = btree_node_type::COMPACT;
+    static constexpr btree_node_type interior_node_type = btree_node_type::COMPACT;
+};
+
 template < typename TestType >
 struct BtreeTest : public BtreeTestHelper< TestType >, public ::testing::Test {
     using T = TestType;
@@ -103,11 +112,18 @@ struct BtreeTest : public BtreeTestHelper< TestType >, public ::testing::Test {
         this->m_bt = std::make_shared< typename T::BtreeType >(this->m_cfg);
         this->m_bt->init(nullptr);
     }
+
+    // Replaces the btree created by SetUp with one created with the config the test has set in m_cfg
+    void recreate_btree() {
+        this->m_bt.reset();
+        this->m_bt = std::make_shared< typename T::BtreeType >(this->m_cfg);
+        this->m_bt->init(nullptr);
+    }
 };
 
 // TODO Enable PrefixIntervalBtreeTest later
 using BtreeTypes = testing::Types</* PrefixIntervalBtreeTest, */FixedLenBtreeTest, VarKeySizeBtreeTest,
-                                   VarValueSizeBtreeTest, VarObjSizeBtreeTest >;
+                                   VarValueSizeBtreeTest, VarObjSizeBtreeTest, CompactBtreeTest >;
 TYPED_TEST_SUITE(BtreeTest, BtreeTypes);
 
 TYPED_TEST(BtreeTest, SequentialInsert) {
@@ -192,6 +208,293 @@ TYPED_TEST(BtreeTest, RandomInsert) {
     this->get_all();
 }
 
+TYPED_TEST(BtreeTest, MultiPut) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint64_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+
+    const auto entries_iter1 = num_entries / 2;
+    LOGINFO("Step 1: Do random multi put of {} entries in batches of 500", entries_iter1);
+    for (uint32_t i{0}; i < entries_iter1; i += 500) {
+        this->multi_put(std::vector< uint64_t >(vec.begin() + i, vec.begin() + std::min(i + 500, entries_iter1)));
+    }
+
+    std::random_shuffle(vec.begin(), vec.end());
+    LOGINFO("Step 2: Do random multi put of all {} entries, where half of them are expected to fail", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 1000) {
+        this->multi_put(std::vector< uint64_t >(vec.begin() + i, vec.begin() + std::min(i + 1000, num_entries)));
+    }
+
+    LOGINFO("Step 3: Query all entries and validate with pagination of 75 entries");
+    this->query_all_paginate(75);
+    this->get_all();
+}
+
+TYPED_TEST(BtreeTest, MultiGet) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for every alternate key of {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    std::vector< uint64_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+
+    LOGINFO("Step 2: Do random multi get of all keys in batches of 300, half of which are expected to be missing");
+    for (uint32_t i{0}; i < num_entries; i += 300) {
+        this->multi_get(std::vector< uint64_t >(vec.begin() + i, vec.begin() + std::min(i + 300, num_entries)));
+    }
+
+    LOGINFO("Step 3: Do multi get of only the existing keys in one batch");
+    std::vector< uint64_t > existing;
+    for (uint64_t k{0}; k < num_entries; k += 2) {
+        existing.push_back(k);
+    }
+    this->multi_get(existing);
+}
+
+TYPED_TEST(BtreeTest, OptimisticRead) {
+    // Optimistic read is honored only for fixed size interior nodes, others should transparently use lock coupling
+    this->m_cfg.m_optimistic_read_turned_on = true;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    LOGINFO("Step 2: Get all entries 1-by-1 and query with pagination of 80 entries");
+    this->get_all();
+    this->query_all_paginate(80);
+
+    LOGINFO("Step 3: Remove half the entries to merge nodes and validate reads again");
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->remove_one(i);
+    }
+    this->get_all();
+    this->get_any(0, num_entries / 2);
+    this->query_all_paginate(80);
+
+    auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+    auto const optimistic_reads =
+        counters["number of reads done through optimistic traversal"].template get< uint64_t >();
+    auto const fallbacks =
+        counters["number of optimistic reads fell back to locked traversal"].template get< uint64_t >();
+    LOGINFO("Optimistic reads={} fallbacks={}", optimistic_reads, fallbacks);
+    if constexpr (TestFixture::T::interior_node_type == btree_node_type::FIXED) {
+        // Without concurrent writers, every read should complete on the optimistic path
+        ASSERT_GE(optimistic_reads, num_entries) << "Reads did not take the optimistic path";
+        ASSERT_EQ(fallbacks, 0u) << "Reads fell back to the locked traversal without concurrent writers";
+    } else {
+        ASSERT_EQ(optimistic_reads, 0u) << "Optimistic read taken on variable size interior nodes";
+    }
+}
+
+TYPED_TEST(BtreeTest, MessageBuffers) {
+    if constexpr ((TestFixture::T::interior_node_type != btree_node_type::FIXED) &&
+                  (TestFixture::T::interior_node_type != btree_node_type::VAR_KEY)) {
+        GTEST_SKIP() << "Message buffers are supported only on fixed and variable key size interior nodes";
+    }
+    this->m_cfg.m_msg_buffer_size = this->m_cfg.node_size() / 4;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do random insert for {} entries, buffered in the interior nodes", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put_random();
+    }
+    LOGINFO("Step 2: Get all entries 1-by-1 and in batches, while the writes are still buffered");
+    this->get_all();
+    std::vector< uint64_t > keys;
+    for (uint64_t k{0}; k < num_entries; k += 3) {
+        keys.push_back(k);
+    }
+    this->multi_get(keys);
+
+    LOGINFO("Step 3: Remove and update random entries and validate reads again");
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->remove_random();
+        this->put(i, btree_put_type::UPSERT);
+    }
+    this->get_all();
+    this->multi_get(keys);
+    this->query_all_paginate(80);
+
+    LOGINFO("Step 4: Range remove and validate the buffered writes flushed down");
+    this->range_remove_any(num_entries / 4, num_entries / 2);
+    for (uint32_t i{0}; i < num_entries / 4; ++i) {
+        this->remove_random();
+    }
+    this->get_all();
+    this->query_all();
+
+    auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+    auto const buffered = counters["Total number of writes buffered in the interior nodes"].template get< uint64_t >();
+    auto const flushed = counters["Total number of message batches flushed down to a child"].template get< uint64_t >();
+    LOGINFO("Buffered writes={} flushed batches={}", buffered, flushed);
+    ASSERT_GT(buffered, 0u) << "No write was buffered in the interior nodes";
+    ASSERT_GT(flushed, 0u) << "No buffered message batch was flushed down";
+}
+
+TYPED_TEST(BtreeTest, BulkLoad) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Bulk load {} entries with 80% fill", num_entries);
+    this->bulk_load(0, num_entries - 1, 80);
+
+    LOGINFO("Step 2: Get all entries 1-by-1 and query with pagination of 75 entries");
+    this->get_all();
+    this->query_all_paginate(75);
+
+    LOGINFO("Step 3: Bulk load on a non empty btree should fail");
+    std::vector< std::pair< typename TestFixture::K, typename TestFixture::V > > kvs;
+    kvs.emplace_back(typename TestFixture::K{0}, TestFixture::V::generate_rand());
+    BtreeBulkLoader< typename TestFixture::K, typename TestFixture::V > loader{*this->m_bt};
+    ASSERT_EQ(loader.load(kvs.cbegin(), kvs.cend(), nullptr), btree_status_t::not_supported);
+
+    LOGINFO("Step 4: Remove and insert entries on the bulk loaded btree and validate");
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->remove_one(i);
+    }
+    for (uint32_t i{0}; i < num_entries / 4; i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all();
+}
+
+TYPED_TEST(BtreeTest, BulkLoadMinFill) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Bulk load {} entries with 0% fill, which still packs atleast 2 entries per node", num_entries);
+    this->bulk_load(0, num_entries - 1, 0);
+    ASSERT_LT(this->m_bt->get_btree_node_cnt(), num_entries) << "Bulk load built nodes with a single entry";
+
+    LOGINFO("Step 2: Get all entries 1-by-1 and query all");
+    this->get_all();
+    this->query_all();
+}
+
+TYPED_TEST(BtreeTest, CursorQuery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Scan all entries and a sub range through cursor");
+    this->cursor_query(0, num_entries - 1, 0);
+    this->cursor_query(num_entries / 3, num_entries / 2, 0);
+
+    LOGINFO("Step 3: Scan through cursor, modifying the btree behind it every 50 entries");
+    this->cursor_query(0, num_entries - 1, 50);
+    this->query_all();
+
+    LOGINFO("Step 4: Scan a range past the last key");
+    this->cursor_query(num_entries - 10, num_entries + 100, 0);
+}
+
+TYPED_TEST(BtreeTest, ReverseQuery) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Reverse query all entries with and without pagination");
+    this->do_reverse_query(0, num_entries - 1, num_entries);
+    this->do_reverse_query(0, num_entries - 1, 75);
+
+    LOGINFO("Step 3: Reverse query latest 10 entries before a key");
+    this->do_reverse_query(0, num_entries / 2, 10);
+
+    LOGINFO("Step 4: Remove alternate entries and reverse query sub ranges");
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->remove_one(i);
+    }
+    this->do_reverse_query(num_entries / 4, (3 * num_entries) / 4, 33);
+    this->do_reverse_query(num_entries + 100, num_entries + 500, 5);
+}
+
+TYPED_TEST(BtreeTest, NodeMemoryReclaim) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    auto const& allocator = this->m_bt->node_allocator();
+    auto const node_size = this->m_cfg.node_size();
+
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    auto const peak_nodes = allocator.num_in_use(node_size);
+    auto const peak_slabs = allocator.num_slabs(node_size);
+
+    LOGINFO("Step 2: Remove all entries from a tree of {} nodes in {} slabs", peak_nodes, peak_slabs);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->remove_one(i);
+    }
+    LOGINFO("After remove: {} nodes in {} slabs", allocator.num_in_use(node_size), allocator.num_slabs(node_size));
+    if (peak_nodes > 1) { ASSERT_LT(allocator.num_in_use(node_size), peak_nodes) << "Freed nodes are not reclaimed"; }
+    ASSERT_LE(allocator.num_slabs(node_size), peak_slabs) << "Slabs grew while the tree shrunk";
+
+    LOGINFO("Step 3: Reinsert all entries, which should reuse the reclaimed node buffers");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    ASSERT_LE(allocator.num_slabs(node_size), peak_slabs + 1) << "Reclaimed node buffers are not reused";
+    this->get_all();
+
+    LOGINFO("Step 4: Nodes of a btree with a different node size come from their own size class");
+    BtreeConfig cfg{node_size / 2};
+    cfg.m_leaf_node_type = this->m_cfg.m_leaf_node_type;
+    cfg.m_int_node_type = this->m_cfg.m_int_node_type;
+    auto const in_use_before = allocator.num_in_use(node_size);
+    {
+        auto small_bt = std::make_unique< typename TestFixture::T::BtreeType >(cfg);
+        small_bt->init(nullptr);
+        ASSERT_GE(allocator.num_in_use(node_size / 2), 1u) << "Root of the small node btree is not allocated";
+        ASSERT_LE(allocator.alloc_size(node_size / 2), node_size / 2 + node_size / 4) << "Size class is too coarse";
+        ASSERT_EQ(allocator.num_in_use(node_size), in_use_before) << "Small node btree allocated from the wrong class";
+    }
+    ASSERT_EQ(allocator.num_in_use(node_size / 2), 0u) << "Nodes of the destroyed btree are not released";
+}
+
+TYPED_TEST(BtreeTest, AppendSplit) {
+    this->m_cfg.m_append_split_pct = 10;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries with append split", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    auto const append_split_nodes = this->m_bt->get_btree_node_cnt();
+
+    LOGINFO("Step 2: Do the same inserts on a btree which always splits in half");
+    auto cfg = this->m_cfg;
+    cfg.m_append_split_pct = 0;
+    auto half_split_bt = std::make_unique< typename TestFixture::T::BtreeType >(cfg);
+    half_split_bt->init(nullptr);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        auto key = typename TestFixture::K{i};
+        auto value = TestFixture::V::generate_rand();
+        auto sreq = BtreeSinglePutRequest{&key, &value, btree_put_type::INSERT};
+        ASSERT_EQ(half_split_bt->put(sreq), btree_status_t::success);
+    }
+    auto const half_split_nodes = half_split_bt->get_btree_node_cnt();
+    LOGINFO("Append split btree has {} nodes, half split btree has {} nodes", append_split_nodes, half_split_nodes);
+    ASSERT_LE(append_split_nodes, half_split_nodes) << "Append split did not pack the nodes better";
+
+    LOGINFO("Step 3: Insert in between the packed nodes and validate");
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->remove_one(i);
+    }
+    for (uint32_t i{0}; i < num_entries; i += 4) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all_paginate(80);
+}
+
 TYPED_TEST(BtreeTest, RangeUpdate) {
     // Forward sequential insert
     const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
@@ -209,6 +512,291 @@ TYPED_TEST(BtreeTest, RangeUpdate) {
     this->do_query(0, num_entries - 1, 75);
 }
 
+TYPED_TEST(BtreeTest, MergePut) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for even keys upto {}", num_entries);
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Merge put all keys, which merges into even keys and inserts odd keys");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->merge_put(i);
+    }
+    this->get_all();
+
+    LOGINFO("Step 3: Merge put random keys repeatedly");
+    std::uniform_int_distribution< uint32_t > s_rand_key_generator{0, num_entries - 1};
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->merge_put(s_rand_key_generator(g_re));
+    }
+    this->get_all();
+
+    LOGINFO("Step 4: Range merge of random intervals between [1-50] for 100 times");
+    std::uniform_int_distribution< uint32_t > s_rand_range_generator{1, 50};
+    for (uint32_t i{0}; i < 100; ++i) {
+        auto const start_k = s_rand_key_generator(g_re);
+        this->range_merge(start_k, std::min(start_k + s_rand_range_generator(g_re), num_entries - 1));
+    }
+    this->get_all();
+    this->query_all_paginate(75);
+}
+
+TYPED_TEST(BtreeTest, KeyHeads) {
+    // Key heads are kept only by the var key size nodes, others should ignore the config
+    this->m_cfg.m_key_heads_turned_on = true;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint32_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+
+    LOGINFO("Step 1: Do random insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(vec[i], btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all_paginate(80);
+
+    LOGINFO("Step 2: Remove random entries and a range, which shifts the records along with their heads");
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->remove_one(vec[i]);
+    }
+    this->range_remove_any(num_entries / 4, num_entries / 2);
+    this->get_all();
+
+    LOGINFO("Step 3: Reinsert the removed entries and validate");
+    for (uint32_t i{0}; i < num_entries / 2; ++i) {
+        this->put(vec[i], btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all();
+}
+
+TYPED_TEST(BtreeTest, SubtreeCounts) {
+    // Subtree counts are kept only by the fixed and var key size interior nodes
+    if constexpr ((TestFixture::T::interior_node_type != btree_node_type::FIXED) &&
+                  (TestFixture::T::interior_node_type != btree_node_type::VAR_KEY)) {
+        GTEST_SKIP() << "Subtree counts not supported for this interior node type";
+    } else {
+        uint64_t count;
+        ASSERT_EQ(this->m_bt->total_count(count), btree_status_t::not_supported)
+            << "Expected count to be unsupported without subtree counts";
+
+        this->m_cfg.m_subtree_counts_turned_on = true;
+        this->recreate_btree();
+
+        const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+        std::vector< uint32_t > vec(num_entries);
+        iota(vec.begin(), vec.end(), 0);
+        std::random_shuffle(vec.begin(), vec.end());
+
+        LOGINFO("Step 1: Do random insert for {} entries and validate counts", num_entries);
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            this->put(vec[i], btree_put_type::INSERT);
+        }
+        this->validate_counts(num_entries / 4, num_entries / 2);
+        this->validate_counts(0, num_entries - 1);
+
+        LOGINFO("Step 2: Remove random entries and a range, which merges nodes and drops subtrees");
+        for (uint32_t i{0}; i < num_entries / 2; ++i) {
+            this->remove_one(vec[i]);
+        }
+        this->range_remove_any(num_entries / 8, num_entries - num_entries / 8);
+        this->validate_counts(num_entries / 16, num_entries / 2);
+        this->get_all();
+
+        LOGINFO("Step 3: Reinsert the removed entries and validate counts");
+        for (uint32_t i{0}; i < num_entries / 2; ++i) {
+            this->put(vec[i], btree_put_type::INSERT);
+        }
+        this->validate_counts(num_entries / 3, num_entries / 3);
+        this->validate_counts(0, num_entries - 1);
+        this->query_all();
+    }
+}
+
+TYPED_TEST(BtreeTest, BlinkSplits) {
+    this->m_cfg.m_blink_splits_turned_on = true;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    std::vector< uint64_t > vec(num_entries);
+    iota(vec.begin(), vec.end(), 0);
+    std::random_shuffle(vec.begin(), vec.end());
+
+    LOGINFO("Step 1: Do random insert for {} entries, splitting leaves before linking them to parent", num_entries);
+    for (auto const k : vec) {
+        this->put(k, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all_paginate(80);
+    this->cursor_query(0, num_entries - 1, 0);
+
+    LOGINFO("Step 2: Remove half the entries one by one and a range, to merge the split leaves");
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        this->remove_one(i);
+    }
+    this->range_remove_any(num_entries / 4, num_entries / 2);
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 3: Reinsert the alternate keys removed and append past the last key");
+    for (uint32_t i{0}; i < num_entries; i += 2) {
+        if ((i < num_entries / 4) || (i > num_entries / 2)) { this->put(i, btree_put_type::INSERT); }
+    }
+    for (uint32_t i{num_entries}; i < num_entries + num_entries / 4; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->multi_get(vec);
+    this->query_all_paginate(80);
+}
+
+TYPED_TEST(BtreeTest, BlinkSplitUnlinked) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    this->m_cfg.m_blink_splits_turned_on = true;
+    auto bt = std::make_shared< UnlinkedSplitBtree< K, V, MemBtree > >(this->m_cfg);
+    bt->init(nullptr);
+    this->m_bt = bt;
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Insert {} entries and split the middle leaf, leaving it unlinked from its parent", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    auto const mid_k = num_entries / 2;
+    BtreeNodePtr left;
+    BtreeNodePtr right;
+    ASSERT_EQ(bt->split_leaf_unlinked(K{mid_k}, nullptr, &left, &right), btree_status_t::success)
+        << "Unable to split the leaf of key " << mid_k;
+    auto const left_last_k = uint32_cast(left->template get_last_key< K >().key());
+    auto const right_first_k = uint32_cast(right->template get_first_key< K >().key());
+    auto const right_last_k = uint32_cast(right->template get_last_key< K >().key());
+    left.reset();
+    right.reset();
+    ASSERT_EQ(right_first_k, left_last_k + 1) << "Right node of the split doesn't continue from the left node";
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Split is linked to the parent already";
+
+    LOGINFO("Step 2: Read the keys in the right node {}-{}, reached only through the left node", right_first_k,
+            right_last_k);
+    for (uint32_t k{left_last_k - 2}; k <= right_last_k + 2; ++k) {
+        this->get_specific(k);
+    }
+    std::vector< uint64_t > keys;
+    for (uint32_t k{left_last_k - 2}; k <= right_last_k + 2; ++k) {
+        keys.push_back(k);
+    }
+    this->multi_get(keys);
+    this->do_query(left_last_k - 2, right_last_k + 2, 3);
+    this->do_query(right_first_k, right_last_k, UINT32_MAX);
+    this->do_reverse_query(left_last_k - 2, right_last_k + 2, 3);
+    this->do_reverse_query(right_first_k, right_last_k, UINT32_MAX);
+    this->do_traversal_query(left_last_k - 2, right_last_k + 2);
+    this->do_traversal_query(0, num_entries - 1);
+    this->cursor_query(right_first_k, right_last_k, 0);
+    this->cursor_query(left_last_k - 2, right_last_k + 2, 0);
+    this->get_all();
+    this->query_all_paginate(80);
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Reads are not expected to link the split";
+
+    LOGINFO("Step 3: Remove a key from the right node, which links the split to the parent first");
+    this->remove_one(right_first_k + 1);
+    ASSERT_FALSE(bt->is_leaf_split_unlinked(K{right_first_k}, nullptr)) << "Remove didn't link the split";
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 4: Split another leaf unlinked and update a key in its right node, which links the split first");
+    ASSERT_EQ(bt->split_leaf_unlinked(K{num_entries / 4}, nullptr, nullptr, &right), btree_status_t::success)
+        << "Unable to split the leaf of key " << num_entries / 4;
+    auto const put_k = uint32_cast(right->template get_first_key< K >().key());
+    right.reset();
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{put_k}, nullptr)) << "Split is linked to the parent already";
+    this->get_specific(put_k);
+    this->put(put_k, btree_put_type::UPSERT);
+    ASSERT_FALSE(bt->is_leaf_split_unlinked(K{put_k}, nullptr)) << "Put didn't link the split";
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 5: Change the link version of the first leaf as a merge would, its right node is already linked");
+    uint64_t old_version;
+    ASSERT_EQ(bt->set_leaf_link_version(K{0}, UINT64_MAX, nullptr, &old_version), btree_status_t::success)
+        << "Unable to set the link version of the first leaf";
+    ASSERT_TRUE(bt->is_leaf_split_unlinked(K{0}, nullptr)) << "First leaf link version is not changed";
+    this->do_traversal_query(0, num_entries - 1);
+    ASSERT_EQ(bt->set_leaf_link_version(K{0}, old_version, nullptr), btree_status_t::success)
+        << "Unable to restore the link version of the first leaf";
+    this->get_all();
+}
+
+TYPED_TEST(BtreeTest, BlinkSplitUnlinkedDestroy) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    this->m_cfg.m_blink_splits_turned_on = true;
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+
+    for (bool const in_background : {false, true}) {
+        LOGINFO("Step {}: Split a middle and the last leaf unlinked, then destroy the btree {}", in_background ? 2 : 1,
+                in_background ? "in background" : "in place");
+        auto bt = std::make_shared< UnlinkedSplitBtree< K, V, MemBtree > >(this->m_cfg);
+        bt->init(nullptr);
+        this->m_bt = bt;
+        this->m_shadow_map.range_erase(K{0}, K{num_entries - 1});
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            this->put(i, btree_put_type::INSERT);
+        }
+        for (auto const k : {num_entries / 4, num_entries - 1}) {
+            ASSERT_EQ(bt->split_leaf_unlinked(K{k}, nullptr), btree_status_t::success)
+                << "Unable to split the leaf of key " << k;
+        }
+        ASSERT_EQ(bt->num_unlinked_splits(), 2u) << "Splits are not left unlinked";
+
+        // Right nodes of the splits are only in the sibling chain, the destroy has to follow it to free them
+        auto const num_nodes = bt->allocated_node_cnt();
+        auto const [ret, n_freed] = in_background ? bt->destroy_btree_async({}).get() : bt->destroy_btree(nullptr);
+        ASSERT_EQ(ret, btree_status_t::success) << "Destroy failed";
+        ASSERT_EQ(n_freed, num_nodes) << "Destroy didn't free the right nodes of the unlinked splits";
+        ASSERT_EQ(bt->allocated_node_cnt(), 0u) << "Nodes are left behind by the destroy";
+    }
+}
+
+TYPED_TEST(BtreeTest, DeferredMerges) {
+    this->m_cfg.m_max_deferred_merges = 1000;
+    this->m_cfg.m_merge_fill_pct = 70;
+    this->recreate_btree();
+
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Remove 7 of every 8 entries, deferring the merges of the leaves left underfull");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        if (i % 8 != 0) { this->remove_one(i); }
+    }
+    ASSERT_GT(this->m_bt->deferred_merges_count(), 0u) << "Expected the removes to defer the merges";
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 3: Rebalance to apply the deferred merges");
+    auto const num_nodes = this->m_bt->get_btree_node_cnt();
+    ASSERT_EQ(this->m_bt->rebalance(nullptr), btree_status_t::success) << "Rebalance failed";
+    ASSERT_EQ(this->m_bt->deferred_merges_count(), 0u) << "Rebalance didn't apply all the deferred merges";
+    ASSERT_LT(this->m_bt->get_btree_node_cnt(), num_nodes) << "Rebalance didn't merge any leaves";
+    this->get_all();
+    this->query_all_paginate(80);
+
+    LOGINFO("Step 4: Reinsert the removed entries into the merged leaves");
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        if (i % 8 != 0) { this->put(i, btree_put_type::INSERT); }
+    }
+    this->get_all();
+    this->query_all();
+}
+
 TYPED_TEST(BtreeTest, SimpleRemoveRange) {
     // Forward sequential insert
     const auto num_entries = 20;
@@ -283,6 +871,221 @@ TYPED_TEST(BtreeTest, RandomRemoveRange) {
     this->query_all();
 }
 
+TYPED_TEST(BtreeTest, RangeRemoveDropSubtrees) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    auto const nodes_before = this->m_bt->get_btree_node_cnt();
+
+    LOGINFO("Step 2: Remove the middle range which covers whole subtrees, from a tree of {} nodes", nodes_before);
+    this->range_remove_any(num_entries / 8, num_entries - num_entries / 8);
+    LOGINFO("After range remove btree has {} nodes", this->m_bt->get_btree_node_cnt());
+    if (nodes_before > 4) { ASSERT_LT(this->m_bt->get_btree_node_cnt(), nodes_before); }
+    this->get_all();
+    this->query_all();
+    this->cursor_query(0, num_entries - 1, 0);
+
+    LOGINFO("Step 3: Reinsert into the dropped range and validate the sibling links through cursor");
+    for (uint32_t i{num_entries / 4}; i < num_entries / 2; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    this->get_all();
+    this->query_all_paginate(80);
+    this->cursor_query(0, num_entries - 1, 7);
+}
+
+TYPED_TEST(BtreeTest, CursorConcurrentRangeRemove) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    auto const drop_start = num_entries / 8;
+    auto const drop_end = num_entries - num_entries / 8;
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Position a cursor within [{}-{}] and remove the range from another thread", drop_start, drop_end);
+    std::vector< uint64_t > keys;
+    {
+        BtreeCursor< K, V > cursor{*this->m_bt, BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}};
+        while ((cursor.next() == btree_status_t::success) && (cursor.key().key() < num_entries / 4)) {}
+
+        // Cursor walks on through the dropped leaves, which the remove frees only once the cursor is done
+        std::thread remover([this, drop_start, drop_end]() { this->range_remove_any(drop_start, drop_end); });
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        while (cursor.next() == btree_status_t::success) {
+            keys.push_back(cursor.key().key());
+        }
+        remover.join();
+    }
+    ASSERT_FALSE(keys.empty()) << "Cursor returned no keys past the dropped range";
+    ASSERT_TRUE(std::is_sorted(keys.begin(), keys.end())) << "Cursor returned keys out of order";
+    ASSERT_EQ(keys.back(), num_entries - 1) << "Cursor didn't reach the end of the range";
+    this->get_all();
+    this->query_all();
+
+    LOGINFO("Step 3: Reinsert the range, release the cursor within it and remove the range behind its back");
+    for (uint32_t i{drop_start}; i <= drop_end; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    BtreeCursor< K, V > cursor{*this->m_bt, BtreeKeyRange< K >{K{0}, true, K{num_entries - 1}, true}};
+    while ((cursor.next() == btree_status_t::success) && (cursor.key().key() < num_entries / 4)) {}
+    auto const last_k = cursor.key().key();
+    cursor.release();
+    this->range_remove_any(drop_start, drop_end);
+
+    // Cursor repositions from root, past the dropped range, instead of relocking its freed leaf
+    auto it = this->m_shadow_map.map_const().upper_bound(K{last_k});
+    while (cursor.next() == btree_status_t::success) {
+        ASSERT_NE(it, this->m_shadow_map.map_const().end()) << "Cursor returned unexpected key=" << cursor.key();
+        ASSERT_EQ(cursor.key().compare(it->first), 0)
+            << "Cursor returned key=" << cursor.key() << " expected key=" << it->first;
+        ++it;
+    }
+    ASSERT_EQ(it, this->m_shadow_map.map_const().end()) << "Cursor didn't return all the keys past the dropped range";
+}
+
+TEST(SeparatorKeyTest, ShortSeparatorsOnLeafSplit) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    BtreeConfig cfg{g_node_size};
+    cfg.m_leaf_node_type = btree_node_type::VAR_KEY;
+    cfg.m_int_node_type = btree_node_type::VAR_KEY;
+
+    // Keys are spaced apart, so the first differing byte of adjacent keys mostly has room to be incremented and the
+    // long tail of the key is cut off from the separator
+    const auto str_key = [](uint32_t i) {
+        return fmt::format("tenant-0001/object-{:010}/{}", uint64_cast(i) * 37, std::string(40, 'x'));
+    };
+    const auto load = [&](auto& bt, auto key_type) {
+        using KeyT = decltype(key_type);
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            KeyT key{str_key(i)};
+            auto value = TestFixedValue::generate_rand();
+            auto sreq = BtreeSinglePutRequest{&key, &value, btree_put_type::INSERT};
+            ASSERT_EQ(bt.put(sreq), btree_status_t::success) << "Put failed for key " << key.to_string();
+        }
+        for (uint32_t i{0}; i < num_entries; ++i) {
+            KeyT key{str_key(i)};
+            TestFixedValue value;
+            auto greq = BtreeSingleGetRequest{&key, &value};
+            ASSERT_EQ(bt.get(greq), btree_status_t::success) << "Get failed for key " << key.to_string();
+        }
+    };
+
+    LOGINFO("Step 1: Insert {} string keys in a btree which promotes the shortest separators", num_entries);
+    MemBtree< TestStrKey, TestFixedValue > short_sep_bt{cfg};
+    short_sep_bt.init(nullptr);
+    load(short_sep_bt, TestStrKey{});
+
+    LOGINFO("Step 2: Insert the same keys in a btree which promotes the last key of the left leaf");
+    MemBtree< TestStrKeyFullSeparator, TestFixedValue > full_sep_bt{cfg};
+    full_sep_bt.init(nullptr);
+    load(full_sep_bt, TestStrKeyFullSeparator{});
+
+    auto const short_sep_nodes = short_sep_bt.get_btree_node_cnt();
+    auto const full_sep_nodes = full_sep_bt.get_btree_node_cnt();
+    LOGINFO("Short separator btree has {} nodes, full separator btree has {} nodes", short_sep_nodes, full_sep_nodes);
+    ASSERT_LT(short_sep_nodes, full_sep_nodes) << "Shorter separators did not increase the interior node fanout";
+}
+
+TEST(MergePutTest, GrowingMergeSplitsLeaf) {
+    BtreeConfig cfg{g_node_size};
+    cfg.m_leaf_node_type = btree_node_type::VAR_VALUE;
+    MemBtree< TestFixedKey, TestVarLenValue > bt{cfg};
+    bt.init(nullptr);
+
+    // Merge appends the operand, so the merged value outgrows the operand the leaf was checked to have room for
+    auto const append_op = [](BtreeKey const&, BtreeValue& existing, BtreeValue const& operand) {
+        auto& v = s_cast< TestVarLenValue& >(existing);
+        v = TestVarLenValue{v.value() + s_cast< TestVarLenValue const& >(operand).value()};
+    };
+
+    constexpr uint32_t num_keys{64};
+    constexpr uint32_t num_rounds{20};
+    auto const operand = TestVarLenValue{std::string(16, 'm')};
+    LOGINFO("Merge put {} keys {} times, growing each value by {} bytes every round", num_keys, num_rounds,
+            operand.serialized_size());
+    for (uint32_t r{0}; r < num_rounds; ++r) {
+        for (uint32_t k{0}; k < num_keys; ++k) {
+            TestFixedKey key{k};
+            auto sreq = BtreeSinglePutRequest{&key, &operand, btree_put_type::MERGE, nullptr /* existing_val */,
+                                              nullptr /* filter_cb */, append_op};
+            ASSERT_EQ(bt.put(sreq), btree_status_t::success) << "Merge put failed for key " << k << " round " << r;
+        }
+    }
+
+    LOGINFO("Range merge all the keys once more and validate, btree has {} nodes", bt.get_btree_node_cnt());
+    auto preq = BtreeRangePutRequest< TestFixedKey >{
+        BtreeKeyRange< TestFixedKey >{TestFixedKey{0u}, true, TestFixedKey{num_keys - 1}, true},
+        btree_put_type::MERGE,
+        &operand,
+        nullptr /* app_context */,
+        std::numeric_limits< uint32_t >::max(),
+        nullptr /* filter_cb */,
+        append_op};
+    ASSERT_EQ(bt.put(preq), btree_status_t::success) << "Range merge failed";
+
+    auto const expected = std::string(operand.serialized_size() * (num_rounds + 1), 'm');
+    for (uint32_t k{0}; k < num_keys; ++k) {
+        TestFixedKey key{k};
+        TestVarLenValue value;
+        auto greq = BtreeSingleGetRequest{&key, &value};
+        ASSERT_EQ(bt.get(greq), btree_status_t::success) << "Get failed for key " << k;
+        ASSERT_EQ(value.value(), expected) << "Merged value mismatch for key " << k;
+    }
+    ASSERT_GT(bt.get_btree_node_cnt(), 1u) << "Leaf was never split for the growing values";
+}
+
+TEST(EpochReclaimerTest, BoundedSlotsAndBatchedReclaim) {
+    EpochReclaimer< std::shared_ptr< uint32_t > > reclaimer;
+
+    LOGINFO("Step 1: Take all the reader slots, the next reader should be turned away instead of spinning");
+    std::vector< uint32_t > slots;
+    for (auto slot = reclaimer.enter(); slot != reclaimer.no_slot; slot = reclaimer.enter()) {
+        slots.push_back(slot);
+    }
+    ASSERT_FALSE(slots.empty()) << "No reader slot could be taken";
+    {
+        EpochReclaimer< std::shared_ptr< uint32_t > >::ReadGuard guard{reclaimer};
+        ASSERT_FALSE(guard.entered()) << "Reader entered with all the slots taken";
+    }
+    for (auto const slot : slots) {
+        reclaimer.exit(slot);
+    }
+
+    LOGINFO("Step 2: Objects retired while a reader is active are held till the reader exits");
+    std::weak_ptr< uint32_t > held;
+    {
+        EpochReclaimer< std::shared_ptr< uint32_t > >::ReadGuard guard{reclaimer};
+        ASSERT_TRUE(guard.entered()) << "Reader could not enter with all the slots free";
+        auto obj = std::make_shared< uint32_t >(0);
+        held = obj;
+        reclaimer.retire(std::move(obj));
+        reclaimer.reclaim();
+        ASSERT_FALSE(held.expired()) << "Object released while a reader which could see it is active";
+    }
+    reclaimer.reclaim();
+    ASSERT_TRUE(held.expired()) << "Object not released after the reader exited";
+
+    LOGINFO("Step 3: Without readers, retired objects are released in batches rather than on every retire");
+    std::vector< std::weak_ptr< uint32_t > > retired;
+    while (true) {
+        auto obj = std::make_shared< uint32_t >(uint32_cast(retired.size()));
+        retired.push_back(obj);
+        reclaimer.retire(std::move(obj));
+        if (reclaimer.num_retired() == 0) { break; }
+        ASSERT_LT(retired.size(), 1000u) << "Retired objects are never reclaimed";
+    }
+    LOGINFO("Retired objects got released after a batch of {}", retired.size());
+    ASSERT_GT(retired.size(), 1u) << "Reclaim is attempted on every retire";
+    for (auto const& w : retired) {
+        ASSERT_TRUE(w.expired()) << "Retired object not released by the batched reclaim";
+    }
+}
+
 template < typename TestType >
 struct BtreeConcurrentTest : public BtreeTestHelper< TestType >, public ::testing::Test {
     using T = TestType;
@@ -308,6 +1111,13 @@ struct BtreeConcurrentTest : public BtreeTestHelper< TestType >, public ::testin
         BtreeTestHelper< TestType >::TearDown();
         iomanager.stop();
     }
+
+    // Replaces the btree created by SetUp with one created with the config the test has set in m_cfg
+    void recreate_btree() {
+        this->m_bt.reset();
+        this->m_bt = std::make_shared< typename T::BtreeType >(this->m_cfg);
+        this->m_bt->init(nullptr);
+    }
 };
 
 TYPED_TEST_SUITE(BtreeConcurrentTest, BtreeTypes);
@@ -323,6 +1133,177 @@ TYPED_TEST(BtreeConcurrentTest, ConcurrentAllOps) {
     this->multi_op_execute(ops);
 }
 
+TYPED_TEST(BtreeConcurrentTest, ConcurrentParallelScan) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+
+    LOGINFO("Step 2: Scan all entries and a sub range in parallel, merging the results in order");
+    uint32_t num_partitions{0};
+    this->parallel_scan(0, num_entries - 1, false /* per_partition */, &num_partitions);
+    if (this->m_bt->get_btree_node_cnt() > 1) {
+        ASSERT_GT(num_partitions, 1u) << "Scan of all the entries is not split across the fibers";
+    }
+    this->parallel_scan(num_entries / 3, num_entries / 2, false /* per_partition */);
+
+    LOGINFO("Step 3: Scan all entries in parallel, delivering the results per partition");
+    this->parallel_scan(0, num_entries - 1, true /* per_partition */);
+
+    LOGINFO("Step 4: Scan a range past the last key");
+    this->parallel_scan(num_entries - 10, num_entries + 100, false /* per_partition */);
+
+    LOGINFO("Step 5: Scan the lower half in parallel, while the upper half is removed and reinserted");
+    auto const half_k = num_entries / 2;
+    std::atomic< bool > writes_done{false};
+    std::thread writer{[this, half_k, num_entries, &writes_done]() {
+        for (uint32_t k{half_k + 1}; k < num_entries; ++k) {
+            this->remove_one(k);
+        }
+        for (uint32_t k{half_k + 1}; k < num_entries; ++k) {
+            this->put(k, btree_put_type::INSERT);
+        }
+        writes_done.store(true);
+    }};
+    uint32_t num_scans{0};
+    do {
+        // Splits and merges next to the scanned range move its keys across the leaves, which the scan must not miss
+        this->parallel_scan(0, half_k, (num_scans % 2) != 0 /* per_partition */);
+        ++num_scans;
+    } while (!writes_done.load() && !this->HasFatalFailure());
+    writer.join();
+    LOGINFO("Scanned the lower half {} times alongside the writes", num_scans);
+    this->get_all();
+}
+
+TYPED_TEST(BtreeConcurrentTest, DestroyInBackground) {
+    const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+    LOGINFO("Step 1: Do forward sequential insert for {} entries", num_entries);
+    for (uint32_t i{0}; i < num_entries; ++i) {
+        this->put(i, btree_put_type::INSERT);
+    }
+    auto const num_nodes = this->m_bt->get_btree_node_cnt();
+
+    LOGINFO("Step 2: Destroy the btree of {} nodes in background across all fibers", num_nodes);
+    auto const [ret, n_freed] = this->m_bt->destroy_btree_async(this->m_fibers).get();
+    ASSERT_EQ(ret, btree_status_t::success) << "Background destroy failed";
+    ASSERT_EQ(n_freed, num_nodes) << "Background destroy didn't free all the nodes";
+
+    LOGINFO("Step 3: Destroy of already destroyed btree is ignored");
+    auto const [ret2, n_freed2] = this->m_bt->destroy_btree_async(this->m_fibers).get();
+    ASSERT_EQ(ret2, btree_status_t::not_found) << "Expected destroy to be ignored";
+    ASSERT_EQ(n_freed2, uint64_t{0}) << "Expected no nodes to be freed on repeated destroy";
+}
+
+TYPED_TEST(BtreeConcurrentTest, ConcurrentOptimisticReads) {
+    this->m_cfg.m_optimistic_read_turned_on = true;
+    this->recreate_btree();
+
+    std::vector< std::string > input_ops = {"put:30", "remove:20", "range_remove:10", "query:20", "get:20"};
+    if (SISL_OPTIONS.count("operation_list")) {
+        input_ops = SISL_OPTIONS["operation_list"].as< std::vector< std::string > >();
+    }
+    auto ops = this->build_op_list(input_ops);
+
+    this->multi_op_execute(ops);
+    this->get_all();
+
+    auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+    auto const optimistic_reads =
+        counters["number of reads done through optimistic traversal"].template get< uint64_t >();
+    auto const fallbacks =
+        counters["number of optimistic reads fell back to locked traversal"].template get< uint64_t >();
+    LOGINFO("Optimistic reads={} fallbacks={}", optimistic_reads, fallbacks);
+    if constexpr (TestFixture::T::interior_node_type == btree_node_type::FIXED) {
+        ASSERT_GT(optimistic_reads, 0u) << "No read took the optimistic path";
+        ASSERT_GT(optimistic_reads, fallbacks) << "Most reads fell back to the locked traversal";
+    } else {
+        ASSERT_EQ(optimistic_reads, 0u) << "Optimistic read taken on variable size interior nodes";
+    }
+}
+
+TYPED_TEST(BtreeConcurrentTest, ConcurrentBlinkSplits) {
+    using K = typename TestFixture::K;
+    using V = typename TestFixture::V;
+    this->m_cfg.m_blink_splits_turned_on = true;
+    auto bt = std::make_shared< UnlinkedSplitBtree< K, V, MemBtree > >(this->m_cfg);
+    bt->init(nullptr);
+    this->m_bt = bt;
+
+    std::vector< std::string > input_ops = {"put:40", "remove:15", "range_remove:5", "query:20", "get:20"};
+    if (SISL_OPTIONS.count("operation_list")) {
+        input_ops = SISL_OPTIONS["operation_list"].as< std::vector< std::string > >();
+    }
+    auto ops = this->build_op_list(input_ops);
+
+    this->multi_op_execute(ops);
+    this->get_all();
+    this->query_all();
+
+    // Put which splits a leaf unlinked walks down to it again and links it, so none are left once the writes are done
+    auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+    auto const blink_splits =
+        counters["Total number of leaf splits done before linking them to parent"].template get< uint64_t >();
+    LOGINFO("Leaves split before linking them to parent={}", blink_splits);
+    ASSERT_GT(blink_splits, 0u) << "No leaf was split before linking it to the parent";
+    ASSERT_EQ(bt->num_unlinked_splits(), 0u) << "Leaf splits are left unlinked after the writes are done";
+}
+
+TYPED_TEST(BtreeConcurrentTest, ConcurrentUpgradeLocks) {
+    this->m_cfg.m_upgrade_locks_turned_on = true;
+    this->recreate_btree();
+
+    // Splits and merges of the leaves promote their upgrade locked parents in place, while readers go through them
+    std::vector< std::string > input_ops = {"put:35", "remove:20", "range_put:5", "range_remove:5", "query:15",
+                                            "get:20"};
+    bool const default_ops = !SISL_OPTIONS.count("operation_list");
+    if (!default_ops) { input_ops = SISL_OPTIONS["operation_list"].as< std::vector< std::string > >(); }
+    auto ops = this->build_op_list(input_ops);
+
+    this->multi_op_execute(ops);
+    this->get_all();
+    this->query_all();
+
+    if (default_ops) {
+        // Parents are upgrade locked only by the writes which split or merge their leaf, not by every write
+        auto const counters = this->m_bt->get_metrics_in_json()["Counters"];
+        auto const promotes = counters["number of upgrade locks promoted to write in place"].template get< uint64_t >();
+        auto const upgrades =
+            counters["number of upgrade locks taken on parents of leaves to change"].template get< uint64_t >();
+        auto const write_ops = counters["number of btree operations"].template get< uint64_t >();
+        LOGINFO("Upgrade locks taken={} promoted={} across {} put operations", upgrades, promotes, write_ops);
+        ASSERT_GT(upgrades, 0u) << "No upgrade lock was taken on the parent of a leaf to change";
+        ASSERT_GT(promotes, 0u) << "No upgrade lock was promoted in place";
+        ASSERT_LT(upgrades, write_ops) << "Upgrade locks are taken by writes not changing the leaves";
+    }
+}
+
+TYPED_TEST(BtreeConcurrentTest, ConcurrentSubtreeCounts) {
+    // Subtree counts are kept only by the fixed and var key size interior nodes
+    if constexpr ((TestFixture::T::interior_node_type != btree_node_type::FIXED) &&
+                  (TestFixture::T::interior_node_type != btree_node_type::VAR_KEY)) {
+        GTEST_SKIP() << "Subtree counts not supported for this interior node type";
+    } else {
+        this->m_cfg.m_subtree_counts_turned_on = true;
+        this->recreate_btree();
+
+        // Single key writes recount their paths after the leaf write, concurrently with each other, the readers and the
+        // range counts, which are checked against the shadow map as they run
+        std::vector< std::string > input_ops = {"put:40", "remove:25", "query:10", "get:10", "count:15"};
+        if (SISL_OPTIONS.count("operation_list")) {
+            input_ops = SISL_OPTIONS["operation_list"].as< std::vector< std::string > >();
+        }
+        auto ops = this->build_op_list(input_ops);
+
+        this->multi_op_execute(ops);
+        const auto num_entries = SISL_OPTIONS["num_entries"].as< uint32_t >();
+        this->validate_counts(num_entries / 4, num_entries / 2);
+        this->validate_counts(0, num_entries - 1);
+        this->get_all();
+    }
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     SISL_OPTIONS_LOAD(argc, argv, logging, test_mem_btree)